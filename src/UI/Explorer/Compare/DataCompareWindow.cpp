@@ -0,0 +1,385 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "DataCompareWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLabel>
+#include <QDebug>
+#include <QTreeView>
+#include <QTableView>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QLocale>
+
+namespace UI {
+    namespace Explorer {
+        namespace Compare {
+            DataCompareWindow::DataCompareWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName, QString tableName) :
+                QMainWindow(parent),
+                sessionConf(sessionConf),
+                databaseName(databaseName)
+            {
+                setWindowTitle(tr("Compare data with..."));
+                setAttribute(Qt::WA_DeleteOnClose);
+
+                QWidget *mainContainer = new QWidget(this);
+                QHBoxLayout *mainContainerLayout = new QHBoxLayout(mainContainer);
+                mainContainerLayout->setContentsMargins(20, 20, 20, 20);
+                mainContainerLayout->setSpacing(0);
+
+                // LEFT PART: the table list with checkbox
+                QTreeView *tableList = new QTreeView(this);
+                tableList->setHeaderHidden(true);
+                tableList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+                this->model = new QStandardItemModel(this);
+                QSqlDatabase db = Util::DataBase::acquire(Util::DataBase::configurationFromJSON(sessionConf, databaseName));
+                if (db.isOpen()) {
+                    QStandardItem *dbItem = new QStandardItem(databaseName);
+                    dbItem->setCheckable(true);
+                    if (tableName.isEmpty()) {
+                        dbItem->setCheckState(Qt::Checked);
+                    }
+
+                    this->model->invisibleRootItem()->appendRow(dbItem);
+
+                    foreach (QString table, db.tables()) {
+                        QStandardItem *item = new QStandardItem(table);
+                        item->setCheckable(true);
+                        if (tableName.isEmpty() || table == tableName) {
+                            item->setCheckState(Qt::Checked);
+                        }
+
+                        dbItem->appendRow(item);
+                    }
+                }
+
+                Util::DataBase::release(db);
+
+                tableList->setModel(this->model);
+                tableList->expandAll();
+                mainContainerLayout->addWidget(tableList);
+
+                // RIGHT PART: the target and the options
+                QWidget *rightPartContainer = new QWidget(this);
+                rightPartContainer->setMinimumWidth(550);
+                QVBoxLayout *rightPartLayout = new QVBoxLayout(rightPartContainer);
+                rightPartLayout->setContentsMargins(20, 0, 0, 0);
+
+                QFont font;
+                font.setBold(true);
+
+                QLabel *labelTarget = new QLabel(tr("Target"), rightPartContainer);
+                labelTarget->setFont(font);
+                rightPartLayout->addWidget(labelTarget);
+
+                this->targetSession = new QComboBox(rightPartContainer);
+                this->sessions = Util::DataBase::getSessions();
+                for (int i = 0; i < this->sessions.count(); i++) {
+                    QJsonObject session = this->sessions.at(i).toObject();
+                    this->targetSession->addItem(QIcon(":/resources/icons/database-server-icon.png"), session.value("name").toString());
+                    if (session.value("uuid").toString() == sessionConf.value("uuid").toString()) {
+                        this->targetSession->setCurrentIndex(i);
+                    }
+                }
+
+                this->targetDatabase = new QLineEdit(databaseName, rightPartContainer);
+
+                QWidget *targetContainer = new QWidget(rightPartContainer);
+                QFormLayout *targetLayout = new QFormLayout(targetContainer);
+                targetLayout->setContentsMargins(30, 5, 0, 10);
+                targetLayout->addRow(tr("Session:"), this->targetSession);
+                targetLayout->addRow(tr("Database:"), this->targetDatabase);
+                rightPartLayout->addWidget(targetContainer);
+
+                QLabel *labelOptions = new QLabel(tr("Options"), rightPartContainer);
+                labelOptions->setFont(font);
+                rightPartLayout->addWidget(labelOptions);
+
+                this->chunkSize = new QSpinBox(rightPartContainer);
+                this->chunkSize->setRange(100, 1000000);
+                this->chunkSize->setSingleStep(1000);
+                this->chunkSize->setValue(10000);
+                this->chunkSize->setFixedWidth(100);
+
+                this->maxDifferences = new QSpinBox(rightPartContainer);
+                this->maxDifferences->setRange(1, 100000);
+                this->maxDifferences->setValue(1000);
+                this->maxDifferences->setFixedWidth(100);
+
+                QWidget *optionContainer = new QWidget(rightPartContainer);
+                QFormLayout *optionLayout = new QFormLayout(optionContainer);
+                optionLayout->setContentsMargins(30, 5, 0, 10);
+                optionLayout->addRow(tr("Rows per chunk:"), this->chunkSize);
+                optionLayout->addRow(tr("Max differences per table:"), this->maxDifferences);
+                rightPartLayout->addWidget(optionContainer);
+
+                // Progress of each table
+                this->progressModel = new QStandardItemModel(this);
+                this->progressModel->setHorizontalHeaderLabels(QStringList() << tr("Table") << tr("Chunks") << tr("Rows") << tr("Status"));
+                QTableView *progressTable = new QTableView(rightPartContainer);
+                progressTable->setModel(this->progressModel);
+                progressTable->verticalHeader()->hide();
+                progressTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+                progressTable->horizontalHeader()->setStretchLastSection(true);
+                progressTable->setColumnWidth(0, 200);
+                progressTable->setColumnWidth(1, 80);
+                progressTable->setColumnWidth(2, 100);
+                rightPartLayout->addWidget(progressTable);
+
+                // Rows which differ between the source and the target
+                QLabel *labelDifferences = new QLabel(tr("Differences"), rightPartContainer);
+                labelDifferences->setFont(font);
+                rightPartLayout->addWidget(labelDifferences);
+
+                this->differenceModel = new QStandardItemModel(this);
+                this->differenceModel->setHorizontalHeaderLabels(QStringList() << tr("Table") << tr("Primary key") << tr("Difference"));
+                QTableView *differenceTable = new QTableView(rightPartContainer);
+                differenceTable->setModel(this->differenceModel);
+                differenceTable->verticalHeader()->hide();
+                differenceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+                differenceTable->horizontalHeader()->setStretchLastSection(true);
+                differenceTable->setColumnWidth(0, 200);
+                differenceTable->setColumnWidth(1, 200);
+                rightPartLayout->addWidget(differenceTable);
+
+                this->progressbar = new QProgressBar(rightPartContainer);
+                this->progressbar->hide();
+                rightPartLayout->addWidget(this->progressbar);
+
+                QWidget *buttonContainer = new QWidget(this);
+                QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+                this->compareButton = new QPushButton(tr("Compare"), this);
+                this->stopButton = new QPushButton(tr("Stop"), this);
+                QPushButton *closeButton = new QPushButton(tr("Close"), this);
+                buttonLayout->addWidget(this->compareButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+                buttonLayout->setAlignment(Qt::AlignRight);
+                buttonLayout->setContentsMargins(0, 0, 0, 0);
+                this->stopButton->hide();
+
+                rightPartLayout->addWidget(buttonContainer);
+
+                mainContainerLayout->addWidget(rightPartContainer);
+                this->setCentralWidget(mainContainer);
+                this->resize(1000, 700);
+
+                // Events
+                connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+                connect(this->compareButton, SIGNAL(released()), SLOT(handleCompare()));
+                connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+                connect(tableList, SIGNAL(clicked(QModelIndex)), SLOT(databaseTreeClicked(QModelIndex)));
+            }
+
+            /**
+             * Starts the comparison in a background thread
+             * @brief DataCompareWindow::handleCompare
+             */
+            void DataCompareWindow::handleCompare()
+            {
+                QStringList tables = this->getSelectedTables();
+                QString target = this->targetDatabase->text().trimmed();
+                int sessionIndex = this->targetSession->currentIndex();
+                if (tables.isEmpty() || target.isEmpty() || sessionIndex < 0) {
+                    return;
+                }
+
+                QJsonObject targetConf = this->sessions.at(sessionIndex).toObject();
+                if (targetConf.value("uuid").toString() == this->sessionConf.value("uuid").toString() && target == this->databaseName) {
+                    QMessageBox::warning(this, "", tr("The target database must be different from the source database"));
+                    return;
+                }
+
+                this->compareButton->hide();
+                this->stopButton->show();
+
+                compareWorker = new Util::TableChecksum(Util::DataBase::configurationFromJSON(this->sessionConf, this->databaseName),
+                                                        Util::DataBase::configurationFromJSON(targetConf, target));
+                compareWorker->setTables(tables);
+                compareWorker->setChunkSize(this->chunkSize->value());
+                compareWorker->setMaxDifferences(this->maxDifferences->value());
+
+                this->differenceModel->removeRows(0, this->differenceModel->rowCount());
+                this->progressModel->removeRows(0, this->progressModel->rowCount());
+                foreach (QString table, tables) {
+                    QList<QStandardItem *> cols;
+                    cols << new QStandardItem(table) << new QStandardItem("") << new QStandardItem("") << new QStandardItem(tr("Waiting"));
+                    cols.at(1)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                    cols.at(2)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                    this->progressModel->appendRow(cols);
+                }
+
+                this->timer = new QTimer(this);
+                this->workerThread = new QThread();
+                compareWorker->moveToThread(workerThread);
+
+                connect(workerThread, &QThread::finished, compareWorker, &QObject::deleteLater);
+                connect(this, SIGNAL(startCompare()), compareWorker, SLOT(compare()));
+                connect(compareWorker, SIGNAL(compareFinished(bool)), SLOT(handleCompareFinished(bool)));
+                connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+
+                workerThread->start();
+
+                this->progressbar->setRange(0, tables.size());
+                this->progressbar->setValue(0);
+                this->progressbar->show();
+                this->timer->start(200);
+
+                emit startCompare();
+            }
+
+            /**
+             * Refreshes the progress of each table and appends the new differences
+             * @brief DataCompareWindow::handleTimer
+             */
+            void DataCompareWindow::handleTimer()
+            {
+                if (this->compareWorker == nullptr) {
+                    return;
+                }
+
+                QList<TableChecksumStatus> status = this->compareWorker->getStatus();
+                int finished = 0;
+                for (int i = 0; i < status.size() && i < this->progressModel->rowCount(); i++) {
+                    TableChecksumStatus tableStatus = status.at(i);
+
+                    QString state;
+                    if (!tableStatus.error.isEmpty()) {
+                        state = tableStatus.error;
+                    } else if (tableStatus.finished) {
+                        state = tableStatus.differences > 0 ? tr("%1 difference(s)").arg(tableStatus.differences) : tr("Identical");
+                    } else if (tableStatus.chunks > 0) {
+                        state = tr("Comparing...");
+                    } else {
+                        state = tr("Waiting");
+                    }
+
+                    if (tableStatus.finished) {
+                        finished++;
+                    }
+
+                    this->progressModel->item(i, 1)->setText(QLocale(QLocale::English).toString(tableStatus.chunks));
+                    this->progressModel->item(i, 2)->setText(QLocale(QLocale::English).toString(tableStatus.rows));
+                    this->progressModel->item(i, 3)->setText(state);
+                }
+
+                foreach (RowDifference difference, this->compareWorker->getDifferences(this->differenceModel->rowCount())) {
+                    QList<QStandardItem *> cols;
+                    cols << new QStandardItem(difference.table) << new QStandardItem(difference.key) << new QStandardItem(difference.difference);
+                    this->differenceModel->appendRow(cols);
+                }
+
+                this->progressbar->setValue(finished);
+            }
+
+            /**
+             * Called when all the tables are compared
+             * @brief DataCompareWindow::handleCompareFinished
+             * @param stopped true when the user has cancelled the comparison
+             */
+            void DataCompareWindow::handleCompareFinished(bool stopped)
+            {
+                this->handleTimer();
+
+                bool hasError = false;
+                foreach (TableChecksumStatus tableStatus, this->compareWorker->getStatus()) {
+                    hasError = hasError || !tableStatus.error.isEmpty();
+                }
+
+                if (!stopped && !hasError && this->differenceModel->rowCount() == 0) {
+                    QMessageBox::information(this, "", tr("The tables are identical"));
+                }
+
+                this->timer->stop();
+                delete this->timer;
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->compareWorker = nullptr;
+                this->progressbar->hide();
+                this->compareButton->show();
+                this->stopButton->hide();
+            }
+
+            /**
+             * Called when the user stops the comparison
+             * @brief DataCompareWindow::handleStop
+             */
+            void DataCompareWindow::handleStop()
+            {
+                if (this->compareWorker != nullptr) {
+                    this->compareWorker->stopRequired();
+                }
+            }
+
+            void DataCompareWindow::handleClose()
+            {
+                this->handleStop();
+                this->close();
+            }
+
+            /**
+             * Called when an item is selected in the database tree
+             * @brief DataCompareWindow::databaseTreeClicked
+             * @param index
+             */
+            void DataCompareWindow::databaseTreeClicked(QModelIndex index)
+            {
+                if (!index.parent().isValid()) {
+                    // Click on the database
+                    QStandardItem *databaseItem = this->model->itemFromIndex(index);
+
+                    for (int i = 0 ; i < databaseItem->rowCount() ; ++i) {
+                        databaseItem->child(i)->setCheckState(databaseItem->checkState());
+                    }
+                } else if (this->model->itemFromIndex(index)->checkState() != Qt::Checked) {
+                    this->model->invisibleRootItem()->child(0)->setCheckState(Qt::Unchecked);
+                }
+            }
+
+            /**
+             * @brief DataCompareWindow::getSelectedTables
+             * @return the list of tables checked
+             */
+            QStringList DataCompareWindow::getSelectedTables()
+            {
+                QStringList tables;
+                QStandardItem *databaseItem = this->model->invisibleRootItem()->child(0);
+                if (databaseItem == nullptr) {
+                    return tables;
+                }
+
+                for (int i = 0 ; i < databaseItem->rowCount() ; ++i) {
+                    QStandardItem* child = databaseItem->child(i);
+                    if (child->checkState() == Qt::Checked) {
+                        tables << child->text();
+                    }
+                }
+
+                return tables;
+            }
+
+            DataCompareWindow::~DataCompareWindow()
+            {
+                if (this->compareWorker != nullptr) {
+                    this->compareWorker->stopRequired();
+                }
+            }
+        }
+    }
+}
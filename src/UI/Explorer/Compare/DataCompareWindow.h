@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef DATACOMPAREWINDOW_H
+#define DATACOMPAREWINDOW_H
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include <QModelIndex>
+#include <QStandardItemModel>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "Util/DataBase.h"
+#include "Util/TableChecksum.h"
+
+namespace UI {
+    namespace Explorer {
+        namespace Compare {
+            class DataCompareWindow : public QMainWindow
+            {
+                Q_OBJECT
+            public:
+                explicit DataCompareWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName, QString tableName);
+                virtual ~DataCompareWindow();
+
+            private:
+                QThread *workerThread = nullptr;
+                Util::TableChecksum *compareWorker = nullptr;
+                QJsonObject sessionConf;
+                QJsonArray sessions;
+                QString databaseName;
+                QStandardItemModel *model;
+                QStandardItemModel *progressModel;
+                QStandardItemModel *differenceModel;
+                QComboBox *targetSession;
+                QLineEdit *targetDatabase;
+                QSpinBox *chunkSize, *maxDifferences;
+                QPushButton *compareButton;
+                QPushButton *stopButton;
+                QProgressBar *progressbar;
+                QTimer *timer;
+
+                QStringList getSelectedTables();
+
+            signals:
+                void startCompare();
+
+            public slots:
+                void handleCompare();
+                void handleStop();
+                void handleClose();
+                void handleCompareFinished(bool stopped);
+                void handleTimer();
+                void databaseTreeClicked(QModelIndex index);
+            };
+        }
+    }
+}
+#endif // DATACOMPAREWINDOW_H
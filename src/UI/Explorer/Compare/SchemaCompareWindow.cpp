@@ -0,0 +1,229 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SchemaCompareWindow.h"
+#include "UI/Explorer/Tabs/SQLSyntaxHighlighter.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QSplitter>
+#include <QTableView>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QFile>
+#include <QTextStream>
+#include <QLocale>
+
+namespace UI {
+    namespace Explorer {
+        namespace Compare {
+            SchemaCompareWindow::SchemaCompareWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName) :
+                QMainWindow(parent),
+                sessionConf(sessionConf),
+                databaseName(databaseName)
+            {
+                setWindowTitle(tr("Compare schema of %1 with...").arg(databaseName));
+                setAttribute(Qt::WA_DeleteOnClose);
+
+                QWidget *mainContainer = new QWidget(this);
+                QVBoxLayout *mainContainerLayout = new QVBoxLayout(mainContainer);
+                mainContainerLayout->setContentsMargins(20, 20, 20, 20);
+
+                // Target of the comparison
+                this->targetSession = new QComboBox(mainContainer);
+                this->sessions = Util::DataBase::getSessions();
+                for (int i = 0; i < this->sessions.count(); i++) {
+                    QJsonObject session = this->sessions.at(i).toObject();
+                    this->targetSession->addItem(QIcon(":/resources/icons/database-server-icon.png"), session.value("name").toString());
+                    if (session.value("uuid").toString() == sessionConf.value("uuid").toString()) {
+                        this->targetSession->setCurrentIndex(i);
+                    }
+                }
+
+                this->targetDatabase = new QLineEdit(databaseName, mainContainer);
+                this->compareButton = new QPushButton(tr("Compare"), mainContainer);
+
+                QWidget *targetContainer = new QWidget(mainContainer);
+                QFormLayout *targetLayout = new QFormLayout(targetContainer);
+                targetLayout->setContentsMargins(0, 0, 0, 10);
+                targetLayout->addRow(tr("Target session:"), this->targetSession);
+                targetLayout->addRow(tr("Target database:"), this->targetDatabase);
+                targetLayout->addRow("", this->compareButton);
+                mainContainerLayout->addWidget(targetContainer);
+
+                this->statusLabel = new QLabel(mainContainer);
+                mainContainerLayout->addWidget(this->statusLabel);
+
+                // Differences and script to apply on the target
+                QSplitter *splitter = new QSplitter(Qt::Vertical, mainContainer);
+
+                this->differenceModel = new QStandardItemModel(this);
+                this->differenceModel->setHorizontalHeaderLabels(QStringList() << tr("Table") << tr("Difference") << tr("Details"));
+                QTableView *differenceTable = new QTableView(splitter);
+                differenceTable->setModel(this->differenceModel);
+                differenceTable->verticalHeader()->hide();
+                differenceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+                differenceTable->horizontalHeader()->setStretchLastSection(true);
+                differenceTable->setColumnWidth(0, 200);
+                differenceTable->setColumnWidth(1, 150);
+                splitter->addWidget(differenceTable);
+
+                this->scriptTextEdit = new QTextEdit(splitter);
+                this->scriptTextEdit->setFontFamily("DejaVue Sans Mono");
+                this->scriptTextEdit->setLineWrapMode(QTextEdit::NoWrap);
+                new UI::Explorer::Tabs::SQLSyntaxHighlighter(this->scriptTextEdit->document());
+                splitter->addWidget(this->scriptTextEdit);
+
+                mainContainerLayout->addWidget(splitter);
+
+                QWidget *buttonContainer = new QWidget(this);
+                QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+                this->saveButton = new QPushButton(tr("Save script..."), this);
+                this->saveButton->setEnabled(false);
+                QPushButton *closeButton = new QPushButton(tr("Close"), this);
+                buttonLayout->addWidget(this->saveButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+                buttonLayout->setAlignment(Qt::AlignRight);
+                buttonLayout->setContentsMargins(0, 0, 0, 0);
+                mainContainerLayout->addWidget(buttonContainer);
+
+                this->setCentralWidget(mainContainer);
+                this->resize(1000, 700);
+
+                // Events
+                connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+                connect(this->saveButton, SIGNAL(released()), SLOT(handleSave()));
+                connect(this->compareButton, SIGNAL(released()), SLOT(handleCompare()));
+            }
+
+            /**
+             * Starts the comparison in a background thread
+             * @brief SchemaCompareWindow::handleCompare
+             */
+            void SchemaCompareWindow::handleCompare()
+            {
+                QString target = this->targetDatabase->text().trimmed();
+                int sessionIndex = this->targetSession->currentIndex();
+                if (target.isEmpty() || sessionIndex < 0) {
+                    return;
+                }
+
+                QJsonObject targetConf = this->sessions.at(sessionIndex).toObject();
+
+                this->compareButton->setEnabled(false);
+                this->saveButton->setEnabled(false);
+                this->statusLabel->setText(tr("Loading the schemas..."));
+                this->differenceModel->removeRows(0, this->differenceModel->rowCount());
+                this->scriptTextEdit->clear();
+
+                this->compareWorker = new Util::SchemaCompare(Util::DataBase::configurationFromJSON(this->sessionConf, this->databaseName),
+                                                              Util::DataBase::configurationFromJSON(targetConf, target));
+                this->workerThread = new QThread();
+                this->compareWorker->moveToThread(this->workerThread);
+
+                connect(this->workerThread, &QThread::finished, this->compareWorker, &QObject::deleteLater);
+                connect(this->workerThread, &QThread::finished, this->workerThread, &QObject::deleteLater);
+                connect(this, SIGNAL(startCompare()), this->compareWorker, SLOT(compare()));
+                connect(this->compareWorker, SIGNAL(compareFinished()), SLOT(handleCompareFinished()));
+
+                this->workerThread->start();
+
+                emit startCompare();
+            }
+
+            /**
+             * Displays the differences and the script
+             * @brief SchemaCompareWindow::handleCompareFinished
+             */
+            void SchemaCompareWindow::handleCompareFinished()
+            {
+                QString error = this->compareWorker->getError();
+                QList<SchemaDifference> differences = this->compareWorker->getDifferences();
+                QStringList statements = this->compareWorker->getStatements();
+                int sourceTables = this->compareWorker->getSourceTableCount();
+                int targetTables = this->compareWorker->getTargetTableCount();
+                double seconds = this->compareWorker->getElapsedTime() / 1000.0;
+
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->compareWorker = nullptr;
+                this->compareButton->setEnabled(true);
+
+                if (!error.isEmpty()) {
+                    this->statusLabel->setText("");
+                    QMessageBox::critical(this, "", error);
+                    return;
+                }
+
+                QLocale locale(QLocale::English);
+                this->statusLabel->setText(tr("%1 tables on the source, %2 tables on the target, %3 difference(s) found in %4 sec")
+                                           .arg(locale.toString(sourceTables))
+                                           .arg(locale.toString(targetTables))
+                                           .arg(locale.toString(differences.size()))
+                                           .arg(seconds));
+
+                foreach (SchemaDifference difference, differences) {
+                    QList<QStandardItem *> cols;
+                    cols << new QStandardItem(difference.table) << new QStandardItem(difference.type) << new QStandardItem(difference.details);
+                    this->differenceModel->appendRow(cols);
+                }
+
+                if (!statements.isEmpty()) {
+                    this->scriptTextEdit->setPlainText(statements.join("\n\n") + "\n");
+                    this->saveButton->setEnabled(true);
+                }
+            }
+
+            /**
+             * Saves the script in a file
+             * @brief SchemaCompareWindow::handleSave
+             */
+            void SchemaCompareWindow::handleSave()
+            {
+                QString fileName = QFileDialog::getSaveFileName(this, tr("Save File"));
+                if (fileName.isEmpty()) {
+                    return;
+                }
+
+                QFile file(fileName);
+                if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                    QMessageBox::critical(this, "", file.errorString());
+                    return;
+                }
+
+                QTextStream stream(&file);
+                stream.setCodec("UTF-8");
+                stream << this->scriptTextEdit->toPlainText();
+                file.close();
+            }
+
+            void SchemaCompareWindow::handleClose()
+            {
+                this->close();
+            }
+
+            SchemaCompareWindow::~SchemaCompareWindow()
+            {
+                if (this->compareWorker != nullptr) {
+                    // The result is not displayed, the worker is deleted when its thread ends
+                    disconnect(this->compareWorker, 0, this, 0);
+                    this->workerThread->quit();
+                }
+            }
+        }
+    }
+}
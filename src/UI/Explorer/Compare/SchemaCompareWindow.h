@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SCHEMACOMPAREWINDOW_H
+#define SCHEMACOMPAREWINDOW_H
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QLabel>
+#include <QTextEdit>
+#include <QThread>
+#include <QStandardItemModel>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "Util/DataBase.h"
+#include "Util/SchemaCompare.h"
+
+namespace UI {
+    namespace Explorer {
+        namespace Compare {
+            class SchemaCompareWindow : public QMainWindow
+            {
+                Q_OBJECT
+            public:
+                explicit SchemaCompareWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName);
+                virtual ~SchemaCompareWindow();
+
+            private:
+                QThread *workerThread = nullptr;
+                Util::SchemaCompare *compareWorker = nullptr;
+                QJsonObject sessionConf;
+                QJsonArray sessions;
+                QString databaseName;
+                QStandardItemModel *differenceModel;
+                QComboBox *targetSession;
+                QLineEdit *targetDatabase;
+                QPushButton *compareButton;
+                QPushButton *saveButton;
+                QLabel *statusLabel;
+                QTextEdit *scriptTextEdit;
+
+            signals:
+                void startCompare();
+
+            public slots:
+                void handleCompare();
+                void handleCompareFinished();
+                void handleSave();
+                void handleClose();
+            };
+        }
+    }
+}
+#endif // SCHEMACOMPAREWINDOW_H
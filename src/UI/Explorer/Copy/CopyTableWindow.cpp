@@ -0,0 +1,370 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "CopyTableWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLabel>
+#include <QDebug>
+#include <QTreeView>
+#include <QTableView>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QLocale>
+
+namespace UI {
+    namespace Explorer {
+        namespace Copy {
+            CopyTableWindow::CopyTableWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName, QString tableName) :
+                QMainWindow(parent),
+                sessionConf(sessionConf),
+                databaseName(databaseName)
+            {
+                setWindowTitle(tr("Copy table(s) to..."));
+                setAttribute(Qt::WA_DeleteOnClose);
+
+                QWidget *mainContainer = new QWidget(this);
+                QHBoxLayout *mainContainerLayout = new QHBoxLayout(mainContainer);
+                mainContainerLayout->setContentsMargins(20, 20, 20, 20);
+                mainContainerLayout->setSpacing(0);
+
+                // LEFT PART: the table list with checkbox
+                QTreeView *tableList = new QTreeView(this);
+                tableList->setHeaderHidden(true);
+                tableList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+                this->model = new QStandardItemModel(this);
+                QSqlDatabase db = Util::DataBase::acquire(Util::DataBase::configurationFromJSON(sessionConf, databaseName));
+                if (db.isOpen()) {
+                    QStandardItem *dbItem = new QStandardItem(databaseName);
+                    dbItem->setCheckable(true);
+                    if (tableName.isEmpty()) {
+                        dbItem->setCheckState(Qt::Checked);
+                    }
+
+                    this->model->invisibleRootItem()->appendRow(dbItem);
+
+                    foreach (QString table, db.tables()) {
+                        QStandardItem *item = new QStandardItem(table);
+                        item->setCheckable(true);
+                        if (tableName.isEmpty() || table == tableName) {
+                            item->setCheckState(Qt::Checked);
+                        }
+
+                        dbItem->appendRow(item);
+                    }
+                }
+
+                Util::DataBase::release(db);
+
+                tableList->setModel(this->model);
+                tableList->expandAll();
+                mainContainerLayout->addWidget(tableList);
+
+                // RIGHT PART: the target and the options
+                QWidget *rightPartContainer = new QWidget(this);
+                rightPartContainer->setMinimumWidth(550);
+                QVBoxLayout *rightPartLayout = new QVBoxLayout(rightPartContainer);
+                rightPartLayout->setContentsMargins(20, 0, 0, 0);
+
+                QFont font;
+                font.setBold(true);
+
+                QLabel *labelTarget = new QLabel(tr("Target"), rightPartContainer);
+                labelTarget->setFont(font);
+                rightPartLayout->addWidget(labelTarget);
+
+                this->targetSession = new QComboBox(rightPartContainer);
+                this->sessions = Util::DataBase::getSessions();
+                for (int i = 0; i < this->sessions.count(); i++) {
+                    QJsonObject session = this->sessions.at(i).toObject();
+                    this->targetSession->addItem(QIcon(":/resources/icons/database-server-icon.png"), session.value("name").toString());
+                    if (session.value("uuid").toString() == sessionConf.value("uuid").toString()) {
+                        this->targetSession->setCurrentIndex(i);
+                    }
+                }
+
+                this->targetDatabase = new QLineEdit(databaseName, rightPartContainer);
+
+                QWidget *targetContainer = new QWidget(rightPartContainer);
+                QFormLayout *targetLayout = new QFormLayout(targetContainer);
+                targetLayout->setContentsMargins(30, 5, 0, 10);
+                targetLayout->addRow(tr("Session:"), this->targetSession);
+                targetLayout->addRow(tr("Database:"), this->targetDatabase);
+                rightPartLayout->addWidget(targetContainer);
+
+                QLabel *labelOptions = new QLabel(tr("Options"), rightPartContainer);
+                labelOptions->setFont(font);
+                rightPartLayout->addWidget(labelOptions);
+
+                this->createTableCheckbox = new QCheckBox(tr("Create the missing tables"), rightPartContainer);
+                this->createTableCheckbox->setChecked(true);
+                this->dropTableCheckbox = new QCheckBox(tr("Drop the existing tables"), rightPartContainer);
+
+                this->parallelism = new QSpinBox(rightPartContainer);
+                this->parallelism->setRange(1, 16);
+                this->parallelism->setValue(4);
+                this->parallelism->setFixedWidth(100);
+
+                this->batchSize = new QSpinBox(rightPartContainer);
+                this->batchSize->setRange(1, 10000);
+                this->batchSize->setValue(1000);
+                this->batchSize->setFixedWidth(100);
+
+                QWidget *optionContainer = new QWidget(rightPartContainer);
+                QFormLayout *optionLayout = new QFormLayout(optionContainer);
+                optionLayout->setContentsMargins(30, 5, 0, 10);
+                optionLayout->addRow(this->createTableCheckbox);
+                optionLayout->addRow(this->dropTableCheckbox);
+                optionLayout->addRow(tr("Parallel workers:"), this->parallelism);
+                optionLayout->addRow(tr("Rows per INSERT:"), this->batchSize);
+                rightPartLayout->addWidget(optionContainer);
+
+                // Progress of each table
+                this->progressModel = new QStandardItemModel(this);
+                this->progressModel->setHorizontalHeaderLabels(QStringList() << tr("Table") << tr("Rows") << tr("Status"));
+                QTableView *progressTable = new QTableView(rightPartContainer);
+                progressTable->setModel(this->progressModel);
+                progressTable->verticalHeader()->hide();
+                progressTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+                progressTable->horizontalHeader()->setStretchLastSection(true);
+                progressTable->setColumnWidth(0, 200);
+                progressTable->setColumnWidth(1, 150);
+                rightPartLayout->addWidget(progressTable);
+
+                this->progressbar = new QProgressBar(rightPartContainer);
+                this->progressbar->hide();
+                rightPartLayout->addWidget(this->progressbar);
+
+                QWidget *buttonContainer = new QWidget(this);
+                QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+                this->copyButton = new QPushButton(tr("Copy"), this);
+                this->stopButton = new QPushButton(tr("Stop"), this);
+                QPushButton *closeButton = new QPushButton(tr("Close"), this);
+                buttonLayout->addWidget(this->copyButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+                buttonLayout->setAlignment(Qt::AlignRight);
+                buttonLayout->setContentsMargins(0, 0, 0, 0);
+                this->stopButton->hide();
+
+                rightPartLayout->addWidget(buttonContainer);
+
+                mainContainerLayout->addWidget(rightPartContainer);
+                this->setCentralWidget(mainContainer);
+                this->resize(1000, 600);
+
+                // Events
+                connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+                connect(this->copyButton, SIGNAL(released()), SLOT(handleCopy()));
+                connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+                connect(tableList, SIGNAL(clicked(QModelIndex)), SLOT(databaseTreeClicked(QModelIndex)));
+            }
+
+            /**
+             * Starts the copy in a background thread
+             * @brief CopyTableWindow::handleCopy
+             */
+            void CopyTableWindow::handleCopy()
+            {
+                QStringList tables = this->getSelectedTables();
+                QString target = this->targetDatabase->text().trimmed();
+                int sessionIndex = this->targetSession->currentIndex();
+                if (tables.isEmpty() || target.isEmpty() || sessionIndex < 0) {
+                    return;
+                }
+
+                QJsonObject targetConf = this->sessions.at(sessionIndex).toObject();
+                if (targetConf.value("uuid").toString() == this->sessionConf.value("uuid").toString() && target == this->databaseName) {
+                    QMessageBox::warning(this, "", tr("The target database must be different from the source database"));
+                    return;
+                }
+
+                this->copyButton->hide();
+                this->stopButton->show();
+
+                copyWorker = new Util::TableCopy(Util::DataBase::configurationFromJSON(this->sessionConf, this->databaseName),
+                                                 Util::DataBase::configurationFromJSON(targetConf, target));
+                copyWorker->setTables(tables);
+                copyWorker->setCreateTable(this->createTableCheckbox->isChecked());
+                copyWorker->setDropTable(this->dropTableCheckbox->isChecked());
+                copyWorker->setParallelism(this->parallelism->value());
+                copyWorker->setBatchSize(this->batchSize->value());
+
+                this->progressModel->removeRows(0, this->progressModel->rowCount());
+                foreach (QString table, tables) {
+                    QList<QStandardItem *> cols;
+                    cols << new QStandardItem(table) << new QStandardItem("") << new QStandardItem(tr("Waiting"));
+                    cols.at(1)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                    this->progressModel->appendRow(cols);
+                }
+
+                this->timer = new QTimer(this);
+                this->workerThread = new QThread();
+                copyWorker->moveToThread(workerThread);
+
+                connect(workerThread, &QThread::finished, copyWorker, &QObject::deleteLater);
+                connect(this, SIGNAL(startCopy()), copyWorker, SLOT(copy()));
+                connect(copyWorker, SIGNAL(copyFinished(bool)), SLOT(handleCopyFinished(bool)));
+                connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+
+                workerThread->start();
+
+                this->progressbar->setRange(0, tables.size());
+                this->progressbar->setValue(0);
+                this->progressbar->show();
+                this->timer->start(200);
+
+                emit startCopy();
+            }
+
+            /**
+             * Refreshes the progress of each table
+             * @brief CopyTableWindow::handleTimer
+             */
+            void CopyTableWindow::handleTimer()
+            {
+                if (this->copyWorker == nullptr) {
+                    return;
+                }
+
+                QList<TableCopyStatus> status = this->copyWorker->getStatus();
+                int finished = 0;
+                for (int i = 0; i < status.size() && i < this->progressModel->rowCount(); i++) {
+                    TableCopyStatus tableStatus = status.at(i);
+                    QString rows = QLocale(QLocale::English).toString(tableStatus.rowsCopied);
+                    if (tableStatus.estimatedRows > 0) {
+                        rows += " / ~" + QLocale(QLocale::English).toString(tableStatus.estimatedRows);
+                    }
+
+                    QString state;
+                    if (!tableStatus.error.isEmpty()) {
+                        state = tableStatus.error;
+                    } else if (tableStatus.finished) {
+                        state = tr("Done");
+                    } else if (tableStatus.rowsCopied > 0 || tableStatus.estimatedRows > 0) {
+                        state = tr("Copying...");
+                    } else {
+                        state = tr("Waiting");
+                    }
+
+                    if (tableStatus.finished) {
+                        finished++;
+                    }
+
+                    this->progressModel->item(i, 1)->setText(rows);
+                    this->progressModel->item(i, 2)->setText(state);
+                }
+
+                this->progressbar->setValue(finished);
+            }
+
+            /**
+             * Called when all the tables are copied
+             * @brief CopyTableWindow::handleCopyFinished
+             * @param stopped true when the user has cancelled the copy
+             */
+            void CopyTableWindow::handleCopyFinished(bool stopped)
+            {
+                this->handleTimer();
+
+                bool hasError = false;
+                foreach (TableCopyStatus tableStatus, this->copyWorker->getStatus()) {
+                    hasError = hasError || !tableStatus.error.isEmpty();
+                }
+
+                if (!stopped && !hasError) {
+                    QMessageBox::information(this, "", tr("Copy completed successfully"));
+                }
+
+                this->timer->stop();
+                delete this->timer;
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->copyWorker = nullptr;
+                this->progressbar->hide();
+                this->copyButton->show();
+                this->stopButton->hide();
+            }
+
+            /**
+             * Called when the user stops the copy
+             * @brief CopyTableWindow::handleStop
+             */
+            void CopyTableWindow::handleStop()
+            {
+                if (this->copyWorker != nullptr) {
+                    this->copyWorker->stopRequired();
+                }
+            }
+
+            void CopyTableWindow::handleClose()
+            {
+                this->handleStop();
+                this->close();
+            }
+
+            /**
+             * Called when an item is selected in the database tree
+             * @brief CopyTableWindow::databaseTreeClicked
+             * @param index
+             */
+            void CopyTableWindow::databaseTreeClicked(QModelIndex index)
+            {
+                if (!index.parent().isValid()) {
+                    // Click on the database
+                    QStandardItem *databaseItem = this->model->itemFromIndex(index);
+
+                    for (int i = 0 ; i < databaseItem->rowCount() ; ++i) {
+                        databaseItem->child(i)->setCheckState(databaseItem->checkState());
+                    }
+                } else if (this->model->itemFromIndex(index)->checkState() != Qt::Checked) {
+                    this->model->invisibleRootItem()->child(0)->setCheckState(Qt::Unchecked);
+                }
+            }
+
+            /**
+             * @brief CopyTableWindow::getSelectedTables
+             * @return the list of tables checked
+             */
+            QStringList CopyTableWindow::getSelectedTables()
+            {
+                QStringList tables;
+                QStandardItem *databaseItem = this->model->invisibleRootItem()->child(0);
+                if (databaseItem == nullptr) {
+                    return tables;
+                }
+
+                for (int i = 0 ; i < databaseItem->rowCount() ; ++i) {
+                    QStandardItem* child = databaseItem->child(i);
+                    if (child->checkState() == Qt::Checked) {
+                        tables << child->text();
+                    }
+                }
+
+                return tables;
+            }
+
+            CopyTableWindow::~CopyTableWindow()
+            {
+                if (this->copyWorker != nullptr) {
+                    this->copyWorker->stopRequired();
+                }
+            }
+        }
+    }
+}
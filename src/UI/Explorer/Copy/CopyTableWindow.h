@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef COPYTABLEWINDOW_H
+#define COPYTABLEWINDOW_H
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include <QModelIndex>
+#include <QStandardItemModel>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "Util/DataBase.h"
+#include "Util/TableCopy.h"
+
+namespace UI {
+    namespace Explorer {
+        namespace Copy {
+            class CopyTableWindow : public QMainWindow
+            {
+                Q_OBJECT
+            public:
+                explicit CopyTableWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName, QString tableName);
+                virtual ~CopyTableWindow();
+
+            private:
+                QThread *workerThread = nullptr;
+                Util::TableCopy *copyWorker = nullptr;
+                QJsonObject sessionConf;
+                QJsonArray sessions;
+                QString databaseName;
+                QStandardItemModel *model;
+                QStandardItemModel *progressModel;
+                QComboBox *targetSession;
+                QLineEdit *targetDatabase;
+                QCheckBox *createTableCheckbox, *dropTableCheckbox;
+                QSpinBox *parallelism, *batchSize;
+                QPushButton *copyButton;
+                QPushButton *stopButton;
+                QProgressBar *progressbar;
+                QTimer *timer;
+
+                QStringList getSelectedTables();
+
+            signals:
+                void startCopy();
+
+            public slots:
+                void handleCopy();
+                void handleStop();
+                void handleClose();
+                void handleCopyFinished(bool stopped);
+                void handleTimer();
+                void databaseTreeClicked(QModelIndex index);
+            };
+        }
+    }
+}
+#endif // COPYTABLEWINDOW_H
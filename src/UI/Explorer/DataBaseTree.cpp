@@ -25,9 +25,15 @@
 #include <QMessageBox>
 #include <QMenu>
 #include <QUuid>
+#include <QSet>
 #include "Explorer.h"
 #include <UI/Explorer/Model/TableFilterProxyModel.h>
 #include "ServerAction/NewDatabaseWindow.h"
+#include "Copy/CopyTableWindow.h"
+#include "Compare/DataCompareWindow.h"
+#include "Compare/SchemaCompareWindow.h"
+#include "Script/ExecuteScriptWindow.h"
+#include "Script/FanOutWindow.h"
 #include "Util/DataBase.h"
 
 namespace UI {
@@ -48,6 +54,8 @@ DataBaseTree::DataBaseTree(QWidget *parent, QJsonObject sessionConf) : QTreeView
 	this->setHeaderHidden(true);
 	this->expandToDepth(0);
 	this->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	// Several databases can be selected to execute a statement on all of them
+	this->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
 	// The first column with the table name takes all the space.
 	this->header()->setStretchLastSection(false);
@@ -113,6 +121,10 @@ void DataBaseTree::customContextMenuRequested(QPoint point)
 		refreshAction->setShortcut(QKeySequence(Qt::Key_F5));
 		menu->addAction(refreshAction);
 
+		QAction *fanOutAction = new QAction(tr("Execute on selected databases..."), this);
+		connect(fanOutAction, SIGNAL(triggered(bool)), SLOT(handleFanOutQuery()));
+		menu->addAction(fanOutAction);
+
 		connect(showProcessesAction, SIGNAL(triggered(bool)), SLOT(handleShowProcesses()));
 		connect(refreshAction, SIGNAL(triggered(bool)), SLOT(handleRefreshDatabase()));
 		connect(disconnectAction, SIGNAL (triggered(bool)), SLOT (handleDisconnect()));
@@ -139,6 +151,28 @@ void DataBaseTree::customContextMenuRequested(QPoint point)
         connect(exportAction, SIGNAL(triggered(bool)), SLOT(handleExportTableAsSql()));
         menu->addAction(exportAction);
 
+        QAction *copyAction = new QAction(tr("Copy table(s) to..."), this);
+        copyAction->setIcon(QIcon(":/resources/icons/copy-icon.png"));
+        connect(copyAction, SIGNAL(triggered(bool)), SLOT(handleCopyTables()));
+        menu->addAction(copyAction);
+
+        QAction *compareAction = new QAction(tr("Compare data with..."), this);
+        compareAction->setIcon(QIcon(":/resources/icons/check-icon.png"));
+        connect(compareAction, SIGNAL(triggered(bool)), SLOT(handleCompareData()));
+        menu->addAction(compareAction);
+
+        QAction *compareSchemaAction = new QAction(tr("Compare schema with..."), this);
+        connect(compareSchemaAction, SIGNAL(triggered(bool)), SLOT(handleCompareSchema()));
+        menu->addAction(compareSchemaAction);
+
+        QAction *executeScriptAction = new QAction(tr("Execute SQL file..."), this);
+        connect(executeScriptAction, SIGNAL(triggered(bool)), SLOT(handleExecuteScript()));
+        menu->addAction(executeScriptAction);
+
+        QAction *fanOutAction = new QAction(tr("Execute on selected databases..."), this);
+        connect(fanOutAction, SIGNAL(triggered(bool)), SLOT(handleFanOutQuery()));
+        menu->addAction(fanOutAction);
+
 		menu->addAction(refreshAction);
 	} else {
         // Table node
@@ -167,6 +201,15 @@ void DataBaseTree::customContextMenuRequested(QPoint point)
         connect(exportAction, SIGNAL(triggered(bool)), SLOT(handleExportTableAsSql()));
         menu->addAction(exportAction);
 
+        QAction *copyAction = new QAction(tr("Copy table(s) to..."), this);
+        copyAction->setIcon(QIcon(":/resources/icons/copy-icon.png"));
+        connect(copyAction, SIGNAL(triggered(bool)), SLOT(handleCopyTables()));
+        menu->addAction(copyAction);
+
+        QAction *compareAction = new QAction(tr("Compare data with..."), this);
+        compareAction->setIcon(QIcon(":/resources/icons/check-icon.png"));
+        connect(compareAction, SIGNAL(triggered(bool)), SLOT(handleCompareData()));
+        menu->addAction(compareAction);
 
         menu->addSeparator();
 
@@ -324,8 +367,13 @@ void DataBaseTree::queryError(QString error)
 void DataBaseTree::handleDisconnect()
 {
 	QStandardItem *rootItem = this->dataBaseModel->invisibleRootItem();
+	QModelIndex serverIndex = ((Model::TableFilterProxyModel *)this->model())->mapToSource(this->currentIndex());
+	QStandardItem *serverItem = rootItem->child(serverIndex.row(), 0);
+	if (serverItem != 0) {
+		Util::DataBase::closeSession(serverItem->data().toJsonObject().value("uuid").toString());
+	}
+
 	if (rootItem->rowCount() > 1) {
-		QModelIndex serverIndex = this->currentIndex();
 		rootItem->removeRow(serverIndex.row());
 	} else {
 		emit closeExplorer();
@@ -360,6 +408,151 @@ void DataBaseTree::handleExportTableAsSql()
     exportWindow->show();
 }
 
+/**
+ * Opens the window to copy the tables of the database node or the selected table
+ * to another database, possibly on another server.
+ */
+void DataBaseTree::handleCopyTables()
+{
+    QModelIndex index = this->contextMenuIndex;
+    QString tableName;
+    QModelIndex dbIndex = index;
+
+    if (!index.isValid() || !index.parent().isValid()) {
+        return;
+    } else if (index.parent().parent().isValid()) {
+        // Action on the table
+        dbIndex = index.parent();
+        tableName = this->dataBaseModel->itemFromIndex(index)->text();
+    }
+
+    QStandardItem *serverItem = this->dataBaseModel->invisibleRootItem()->child(dbIndex.parent().row(), 0);
+    QStandardItem *dbItem = serverItem->child(dbIndex.row());
+
+    Copy::CopyTableWindow *copyWindow = new Copy::CopyTableWindow(this, serverItem->data().toJsonObject(), dbItem->text(), tableName);
+    copyWindow->show();
+}
+
+/**
+ * Opens the window to compare the data of the tables of the database node or the selected table
+ * with another database, possibly on another server.
+ */
+void DataBaseTree::handleCompareData()
+{
+    QModelIndex index = this->contextMenuIndex;
+    QString tableName;
+    QModelIndex dbIndex = index;
+
+    if (!index.isValid() || !index.parent().isValid()) {
+        return;
+    } else if (index.parent().parent().isValid()) {
+        // Action on the table
+        dbIndex = index.parent();
+        tableName = this->dataBaseModel->itemFromIndex(index)->text();
+    }
+
+    QStandardItem *serverItem = this->dataBaseModel->invisibleRootItem()->child(dbIndex.parent().row(), 0);
+    QStandardItem *dbItem = serverItem->child(dbIndex.row());
+
+    Compare::DataCompareWindow *compareWindow = new Compare::DataCompareWindow(this, serverItem->data().toJsonObject(), dbItem->text(), tableName);
+    compareWindow->show();
+}
+
+/**
+ * Opens the window to compare the schema of the database node with another database
+ */
+void DataBaseTree::handleCompareSchema()
+{
+    QModelIndex dbIndex = this->contextMenuIndex;
+    if (!dbIndex.isValid() || !dbIndex.parent().isValid() || dbIndex.parent().parent().isValid()) {
+        return;
+    }
+
+    QStandardItem *serverItem = this->dataBaseModel->invisibleRootItem()->child(dbIndex.parent().row(), 0);
+    QStandardItem *dbItem = serverItem->child(dbIndex.row());
+
+    Compare::SchemaCompareWindow *compareWindow = new Compare::SchemaCompareWindow(this, serverItem->data().toJsonObject(), dbItem->text());
+    compareWindow->show();
+}
+
+/**
+ * Opens the window to execute a SQL file on the database node
+ */
+void DataBaseTree::handleExecuteScript()
+{
+    QModelIndex dbIndex = this->contextMenuIndex;
+    if (!dbIndex.isValid() || !dbIndex.parent().isValid() || dbIndex.parent().parent().isValid()) {
+        return;
+    }
+
+    QStandardItem *serverItem = this->dataBaseModel->invisibleRootItem()->child(dbIndex.parent().row(), 0);
+    QStandardItem *dbItem = serverItem->child(dbIndex.row());
+
+    Script::ExecuteScriptWindow *scriptWindow = new Script::ExecuteScriptWindow(this, serverItem->data().toJsonObject(), dbItem->text());
+    scriptWindow->show();
+}
+
+/**
+ * Opens the window to execute a statement on the selected databases. A selected server
+ * gives its databases shown by the filter, without the system schemas.
+ */
+void DataBaseTree::handleFanOutQuery()
+{
+    Model::TableFilterProxyModel *filter = (Model::TableFilterProxyModel *)this->model();
+    QModelIndexList selection = this->selectionModel()->selectedRows(0);
+    if (selection.isEmpty()) {
+        selection << filter->mapFromSource(this->contextMenuIndex);
+    }
+
+    QStringList systemSchemas;
+    systemSchemas << "information_schema" << "performance_schema" << "mysql" << "sys";
+
+    QList<FanOutTarget> targets;
+    QSet<QString> added;
+    foreach (QModelIndex index, selection) {
+        QModelIndexList databases;
+        if (!index.parent().isValid()) {
+            // Server node
+            for (int i = 0; i < filter->rowCount(index); i++) {
+                QModelIndex child = filter->index(i, 0, index);
+                if (!systemSchemas.contains(child.data().toString())) {
+                    databases << child;
+                }
+            }
+        } else if (!index.parent().parent().isValid()) {
+            databases << index;
+        } else {
+            // Table node
+            databases << index.parent();
+        }
+
+        foreach (QModelIndex dbIndex, databases) {
+            QModelIndex sourceIndex = filter->mapToSource(dbIndex);
+            QStandardItem *serverItem = this->dataBaseModel->invisibleRootItem()->child(sourceIndex.parent().row(), 0);
+            QStandardItem *dbItem = serverItem->child(sourceIndex.row());
+            QJsonObject serverConf = serverItem->data().toJsonObject();
+
+            QString key = serverConf.value("uuid").toString() + "/" + dbItem->text();
+            if (added.contains(key)) {
+                continue;
+            }
+            added << key;
+
+            FanOutTarget target;
+            target.server = serverItem->text();
+            target.connection = Util::DataBase::configurationFromJSON(serverConf, dbItem->text());
+            targets << target;
+        }
+    }
+
+    if (targets.isEmpty()) {
+        return;
+    }
+
+    Script::FanOutWindow *fanOutWindow = new Script::FanOutWindow(this, targets);
+    fanOutWindow->show();
+}
+
 void DataBaseTree::exportWindowDestroyed()
 {
     exportWindowOpened = false;
@@ -50,6 +50,11 @@ public slots:
     void createDatabase(QString databaseName, QString collation);
     void handleOpenTableInTab();
     void handleExportTableAsSql();
+    void handleCopyTables();
+    void handleCompareData();
+    void handleCompareSchema();
+    void handleExecuteScript();
+    void handleFanOutQuery();
     void exportWindowDestroyed();
     void processListWindowDestroyed();
 
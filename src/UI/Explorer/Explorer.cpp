@@ -176,8 +176,9 @@ void Explorer::handleOpenTableInTab()
 
 void Explorer::handleOpenForeignKeyInTab(QSqlDatabase connection, QString table, QString whereCondition)
 {
+    // Each tab has its own connection of the pool, released when the tab is closed
     Tabs::Table::TableTab *tableTab = new Tabs::Table::TableTab(this);
-    tableTab->setTable(connection, table);
+    tableTab->setTable(Util::DataBase::acquire(Util::DataBase::dumpConfiguration(connection)), table);
     tableTab->setFilter(whereCondition);
     tableTab->loadData();
     int tabIndex = this->explorerTabs->addTab(tableTab, connection.databaseName()+"."+table);
@@ -298,8 +299,9 @@ void Explorer::dataBaseTreeItemChanged()
 	}
 
 	QJsonObject sessionConf = dbItem->parent()->data().toJsonObject();
-    QSqlDatabase currentDatabase = QSqlDatabase::database();
-    QString previousDatabase = currentDatabase.databaseName();
+    // Each server has its own connection, the database changes when the server changes
+    QSqlDatabase currentDatabase = Util::DataBase::current();
+    QString previousDatabase = currentDatabase.connectionName() + "." + currentDatabase.databaseName();
 	if (!Util::DataBase::open(sessionConf, dataBaseName)){
 
 		QMessageBox *message = new QMessageBox();
@@ -315,8 +317,8 @@ void Explorer::dataBaseTreeItemChanged()
 
 	if (!tableName.isNull()){
         // Set the current table
-        this->tableTab->setTable(QSqlDatabase::database(), tableName);
-        this->tableDetailsTab->setTable(QSqlDatabase::database(), tableName);
+        this->tableTab->setTable(Util::DataBase::current(), tableName);
+        this->tableDetailsTab->setTable(Util::DataBase::current(), tableName);
 
         // If the table tab is not visible, do not load the data
         // We use lazy loading, the data will be loaded when the tab will be activated.
@@ -347,7 +349,7 @@ void Explorer::dataBaseTreeItemChanged()
     }
 
     this->explorerTabs->setTabText(0, QString(tr("Database: %1")).arg(dataBaseName));
-    if (dataBaseName != previousDatabase) {
+    if (Util::DataBase::current().connectionName() + "." + dataBaseName != previousDatabase) {
         this->databaseTab->refresh();
         emit databaseChanged();
     }
@@ -365,7 +367,7 @@ void Explorer::refreshDatabase()
         this->explorerTabs->removeTab(tableDetailsTabIndex);
     }
 
-	QSqlDatabase db = QSqlDatabase::database();
+	QSqlDatabase db = Util::DataBase::current();
     if (!db.isOpen() && !db.open()) {
         qDebug() << "Unable to refresh database, database connection failed";
 
@@ -395,12 +397,7 @@ void Explorer::addDatabase(QJsonObject sessionConfiguration)
 
 void Explorer::handleCloseExplorer()
 {
-	// We are closing the last open connection, we have to close the explorer and show the session window
-	QSqlDatabase db = QSqlDatabase::database();
-	if (db.isOpen()) {
-		db.close();
-	}
-
+	// We are closing the last open connection (closed by the tree), we have to close the explorer and show the session window
 	emit closeExplorer();
 }
 
@@ -50,8 +50,8 @@ namespace UI {
 
                 // Create model
                 this->model = new QStandardItemModel(this);
-                QSqlDatabase db = Util::DataBase::createFromConfig(conf);
-                if (db.open()) {
+                QSqlDatabase db = Util::DataBase::acquire(conf);
+                if (db.isOpen()) {
 
                     QStringList tables = db.tables();
                     QStandardItem *rootItem = this->model->invisibleRootItem();
@@ -73,10 +73,10 @@ namespace UI {
 
                         dbItem->appendRow(item);
                     }
-
-                    db.close();
                 }
 
+                Util::DataBase::release(db);
+
                 tableList->setModel(this->model);
                 tableList->expandAll();
                 mainContainerLayout->addWidget(tableList);
@@ -84,19 +84,41 @@ namespace UI {
                 // RIGHT PART: the configuration
                 QWidget *rightPartContainer = new QWidget(this);
                 rightPartContainer->setMinimumWidth(650);
-                rightPartContainer->setMaximumHeight(400);
+                rightPartContainer->setMaximumHeight(500);
                 QVBoxLayout *rightPartLayout = new QVBoxLayout(rightPartContainer);
                 rightPartLayout->setContentsMargins(20, 0, 0, 0);
                 rightPartLayout->setSpacing(0);
 
-                // Database options
-                QLabel *labelDatabase = new QLabel(tr("Database"), rightPartContainer);
+                // Export method
                 QFont font;
                 font.setBold(true);
+                QLabel *labelMethod = new QLabel(tr("Method"), rightPartContainer);
+                labelMethod->setFont(font);
+                rightPartLayout->addWidget(labelMethod);
+
+                QWidget *methodContainer = new QWidget(rightPartContainer);
+                QVBoxLayout *methodLayout = new QVBoxLayout(methodContainer);
+                methodLayout->setContentsMargins(30, 0, 0, 10);
+                methodLayout->setSpacing(0);
+
+                sqlDump = new QRadioButton(tr("SQL dump"), this);
+                tablespaceExport = new QRadioButton(tr("InnoDB tablespace export (FLUSH TABLES ... FOR EXPORT, fast file copy)"), this);
+                tablespaceImport = new QRadioButton(tr("InnoDB tablespace import (DISCARD / IMPORT TABLESPACE)"), this);
+                tablespaceExport->setToolTip(tr("Copies the .ibd/.cfg files, the server data directory must be accessible from this computer"));
+                tablespaceImport->setToolTip(tr("Replaces the tablespace of the selected tables by the files of the directory"));
+
+                sqlDump->setChecked(true);
+                methodLayout->addWidget(sqlDump);
+                methodLayout->addWidget(tablespaceExport);
+                methodLayout->addWidget(tablespaceImport);
+                rightPartLayout->addWidget(methodContainer);
+
+                // Database options
+                QLabel *labelDatabase = new QLabel(tr("Database"), rightPartContainer);
                 labelDatabase->setFont(font);
                 rightPartLayout->addWidget(labelDatabase);
 
-                QWidget *databaseCheckboxContainer = new QWidget(rightPartContainer);
+                databaseCheckboxContainer = new QWidget(rightPartContainer);
                 QHBoxLayout *databaseCheckboxLayout = new QHBoxLayout(databaseCheckboxContainer);
                 databaseCheckboxLayout->setContentsMargins(30, 5, 0, 10);
                 databaseCheckboxLayout->setAlignment(Qt::AlignLeft);
@@ -114,7 +136,7 @@ namespace UI {
                 labelTable->setFont(font);
                 rightPartLayout->addWidget(labelTable);
 
-                QWidget *tableCheckboxContainer = new QWidget(rightPartContainer);
+                tableCheckboxContainer = new QWidget(rightPartContainer);
                 QHBoxLayout *tableCheckboxLayout = new QHBoxLayout(tableCheckboxContainer);
                 tableCheckboxLayout->setContentsMargins(30, 5, 0, 10);
                 tableCheckboxLayout->setAlignment(Qt::AlignLeft);
@@ -131,7 +153,7 @@ namespace UI {
                 labelData->setFont(font);
                 rightPartLayout->addWidget(labelData);
 
-                QWidget *radioButtonContainer = new QWidget(this);
+                radioButtonContainer = new QWidget(this);
                 QVBoxLayout *radioButtonLayout = new QVBoxLayout(radioButtonContainer);
                 radioButtonLayout->setContentsMargins(30, 0, 0, 10);
                 radioButtonLayout->setSpacing(0);
@@ -149,7 +171,7 @@ namespace UI {
                 rightPartLayout->addWidget(radioButtonContainer);
 
                 // File selection
-                QLabel *fileSelectionLabel = new QLabel(tr("Filename"), this);
+                fileSelectionLabel = new QLabel(tr("Filename"), this);
                 fileSelectionLabel->setFont(font);
                 rightPartLayout->addWidget(fileSelectionLabel);
 
@@ -206,11 +228,43 @@ namespace UI {
                 connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
                 connect(this->filePath, SIGNAL (textEdited(QString)), SLOT (handleFilePathEdit(QString)));
                 connect(tableList, SIGNAL(clicked(QModelIndex)), SLOT(databaseTreeClicked(QModelIndex)));
+                connect(sqlDump, SIGNAL(toggled(bool)), SLOT(handleMethodChanged()));
+                connect(tablespaceExport, SIGNAL(toggled(bool)), SLOT(handleMethodChanged()));
+                connect(tablespaceImport, SIGNAL(toggled(bool)), SLOT(handleMethodChanged()));
+            }
+
+            /**
+             * Called when the export method changes, the tablespace copy works on a directory
+             * and does not use the SQL dump options
+             * @brief ExportWindow::handleMethodChanged
+             */
+            void ExportWindow::handleMethodChanged()
+            {
+                bool dump = sqlDump->isChecked();
+                databaseCheckboxContainer->setEnabled(dump);
+                tableCheckboxContainer->setEnabled(dump);
+                radioButtonContainer->setEnabled(dump);
+
+                if (dump) {
+                    fileSelectionLabel->setText(tr("Filename"));
+                    this->filePath->setText(QDir::currentPath()+"/export.sql");
+                } else {
+                    fileSelectionLabel->setText(tr("Directory"));
+                    this->filePath->setText(QDir::currentPath()+"/"+this->connectionConf.databaseName);
+                }
+
+                this->exportButton->setText(tablespaceImport->isChecked() ? tr("Import") : tr("Export"));
             }
 
             void ExportWindow::handleBrowseFile()
             {
-               QString file = QFileDialog::getSaveFileName(this, tr("Save File"));
+                QString file;
+                if (sqlDump->isChecked()) {
+                    file = QFileDialog::getSaveFileName(this, tr("Save File"));
+                } else {
+                    file = QFileDialog::getExistingDirectory(this, tr("Select directory"));
+                }
+
                 if (!file.isEmpty()) {
                     this->filePath->setText(file);
                     this->exportButton->setEnabled(true);
@@ -245,6 +299,14 @@ namespace UI {
                 this->exportButton->hide();
                 this->stopButton->show();
 
+                if (tablespaceExport->isChecked()) {
+                    this->startTablespaceCopy(filename, Util::TablespaceCopy::EXPORT);
+                    return;
+                } else if (tablespaceImport->isChecked()) {
+                    this->startTablespaceCopy(filename, Util::TablespaceCopy::IMPORT);
+                    return;
+                }
+
                 // Configure the dump
                 dumpWorker = new Util::MySQLDump(this->connectionConf, filename);
                 dumpWorker->setCreateDatabase(databaseCreateCheckbox->isChecked());
@@ -297,12 +359,101 @@ namespace UI {
                 emit startDump();
             }
 
+            /**
+             * Starts the copy of the tablespace files in a background thread
+             * @brief ExportWindow::startTablespaceCopy
+             * @param directory the directory which receives (export) or contains (import) the files
+             * @param mode export or import
+             */
+            void ExportWindow::startTablespaceCopy(QString directory, Util::TablespaceCopy::TablespaceCopyMode mode)
+            {
+                tablespaceWorker = new Util::TablespaceCopy(this->connectionConf, directory, mode);
+
+                QStandardItem *databaseItem = this->model->invisibleRootItem()->child(0);
+                if (databaseItem->checkState() != Qt::Checked) {
+                    tablespaceWorker->setTables(this->getSelectedTables());
+                }
+
+                this->timer = new QTimer(this);
+                this->workerThread = new QThread();
+                tablespaceWorker->moveToThread(workerThread);
+
+                connect(workerThread, &QThread::finished, tablespaceWorker, &QObject::deleteLater);
+                connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
+                connect(this, SIGNAL(startCopy()), tablespaceWorker, SLOT(copy()));
+                connect(tablespaceWorker, SIGNAL(copyFinished(bool)), SLOT(handleCopyFinished(bool)));
+                connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+
+                workerThread->start();
+
+                this->progressbar->setMinimum(0);
+                this->progressbar->reset();
+                this->progressLabel->setText("");
+                this->progressLabel->show();
+                this->progressbar->show();
+
+                this->timer->start(200);
+
+                emit startCopy();
+            }
+
+            /**
+             * Called when the tablespace copy is finished
+             * @brief ExportWindow::handleCopyFinished
+             * @param stopped true when the user has cancelled the copy
+             */
+            void ExportWindow::handleCopyFinished(bool stopped)
+            {
+                QString error = this->tablespaceWorker->getError();
+                if (!error.isEmpty()) {
+                    QMessageBox::critical(this, "", error);
+                } else if (!stopped) {
+                    QString message = this->tablespaceImport->isChecked() ? tr("Import completed successfully") : tr("Export completed successfully");
+                    QMessageBox::information(this, "", message);
+                } else {
+                    // The files of the table being copied are removed
+                    QMessageBox::warning(this, "", QString(tr("Incomplete: %1 of %2 tables copied"))
+                                         .arg(this->tablespaceWorker->getProgress())
+                                         .arg(this->tablespaceWorker->getTableCount()));
+                }
+
+                this->progressLabel->hide();
+                this->progressbar->hide();
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->tablespaceWorker = nullptr;
+                this->exportButton->show();
+                this->stopButton->hide();
+                this->timer->stop();
+                delete this->timer;
+            }
+
             /**
              * Called to refresh the progress bar status
              * @brief ExportWindow::handleTimer
              */
             void ExportWindow::handleTimer()
             {
+                if (this->tablespaceWorker != nullptr) {
+                    QString table = this->tablespaceWorker->getCurrentTable();
+                    if (!table.isEmpty()) {
+                        // The progress bar works with an int, the sizes are converted in Mb
+                        int copied = this->tablespaceWorker->getBytesCopied() / (1024 * 1024);
+                        int total = this->tablespaceWorker->getTotalBytes() / (1024 * 1024);
+                        QString label = QString("%1 (%2/%3): %4/%5 Mb").arg(table)
+                                .arg(qMin(this->tablespaceWorker->getProgress() + 1, this->tablespaceWorker->getTableCount()))
+                                .arg(this->tablespaceWorker->getTableCount())
+                                .arg(QLocale(QLocale::English).toString(copied))
+                                .arg(QLocale(QLocale::English).toString(total));
+
+                        this->progressLabel->setText(label);
+                        this->progressbar->setMaximum(total);
+                        this->progressbar->setValue(copied);
+                    }
+
+                    return;
+                }
+
                 QString table = this->dumpWorker->getCurrentTable();
                 int total = this->dumpWorker->getTableCount();
                 int progress = this->dumpWorker->getProgress();
@@ -350,14 +501,22 @@ namespace UI {
                 if (this->dumpWorker != nullptr) {
                     this->dumpWorker->stopRequired();
                 }
+
+                if (this->tablespaceWorker != nullptr) {
+                    this->tablespaceWorker->stopRequired();
+                }
             }
 
 
             ExportWindow::~ExportWindow()
             {
-                if (this->workerThread != nullptr) {
+                if (this->workerThread != nullptr && dumpWorker != nullptr) {
                     dumpWorker->stopRequired();
-                }                
+                }
+
+                if (this->tablespaceWorker != nullptr) {
+                    tablespaceWorker->stopRequired();
+                }
             }
 
             /**
@@ -30,6 +30,7 @@
 #include <QStandardItemModel>
 #include "Util/DataBase.h"
 #include "Util/MySQLDump.h"
+#include "Util/TablespaceCopy.h"
 namespace UI {
     namespace Explorer {
         namespace Export {
@@ -50,16 +51,22 @@ namespace UI {
                 QString tableName;
                 QCheckBox *databaseCreateCheckbox, *databaseDropCheckbox, *tableCreateCheckbox, *tableDropCheckbox;
                 QRadioButton *deleteAndInsert, *insert, *insertIgnore, *replace;
+                QRadioButton *sqlDump, *tablespaceExport, *tablespaceImport;
+                QWidget *databaseCheckboxContainer, *tableCheckboxContainer, *radioButtonContainer;
+                QLabel *fileSelectionLabel;
                 QProgressBar *progressbar;
                 QTimer *timer;
                 Util::MySQLDump *dumpWorker = nullptr;
+                Util::TablespaceCopy *tablespaceWorker = nullptr;
                 QStandardItemModel *model;
                 QWidget *progressbarContainer;
 
                 QStringList getSelectedTables();
+                void startTablespaceCopy(QString directory, Util::TablespaceCopy::TablespaceCopyMode mode);
 
             signals:
                 void startDump();
+                void startCopy();
 
             public slots:
                 void handleBrowseFile();
@@ -68,6 +75,8 @@ namespace UI {
                 void handleClose();
                 void handleFilePathEdit(QString value);
                 void handleDumpFinished(bool stopped);
+                void handleCopyFinished(bool stopped);
+                void handleMethodChanged();
                 void handleTimer();
                 void databaseTreeClicked(QModelIndex index);
             };
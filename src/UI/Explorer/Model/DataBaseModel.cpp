@@ -22,6 +22,8 @@
 #include <QSqlError>
 
 #include "../../../Util/DataBase.h"
+#include "../../../Util/MetadataService.h"
+#include "../../../Util/ResultCache.h"
 
 namespace UI {
 namespace Explorer {
@@ -30,6 +32,11 @@ namespace Model {
 DataBaseModel::DataBaseModel(QJsonObject sessionConf, QObject *parent) : QStandardItemModel(parent) {
 
 	this->setColumnCount(2);
+
+	Util::MetadataService *metadata = Util::MetadataService::instance();
+	connect(metadata, SIGNAL(resultReady(QString,QList<Util::ResultSet>)), SLOT(handleMetadataReady(QString,QList<Util::ResultSet>)));
+	connect(metadata, SIGNAL(requestFailed(QString,QString)), SLOT(handleMetadataFailed(QString,QString)));
+
     this->addServer(sessionConf);
 }
 
@@ -61,51 +68,36 @@ void DataBaseModel::addServer(QJsonObject sessionConf)
 
 	rootItem->appendRow(host);
 
-	QList<QStandardItem *> dbList = this->getDataBaseList();
-
-	foreach (QStandardItem * db, dbList){
-
-		db->setData(QIcon(":/resources/icons/database-icon.png"),Qt::DecorationRole);
-		QList<QStandardItem *> cols;
-		cols << db;
-		QStandardItem *size = new QStandardItem();
-		size->setTextAlignment(Qt::AlignRight);
-		cols << size;
-
-		host->appendRow(cols);
-	}
+	// The databases are added when the metadata service gives the list
+	this->requestMetadata(host->index(), sessionConf, QStringList() << "SHOW DATABASES");
 }
 
 void DataBaseModel::addDatabase(QString databaseName, QString collation)
 {
     QString sql = QString("CREATE DATABASE %1 COLLATE=%2").arg(databaseName).arg(collation);
 
-    QSqlQuery query;
+    QSqlQuery query(Util::DataBase::current());
     if (!query.exec(sql)) {
         qDebug() << "DataBaseModel::addDatabase - " + query.lastError().text();
         emit queryError(query.lastError().text());
     }
 }
 
-QList<QStandardItem *> DataBaseModel::getDataBaseList()
+/**
+ * Sends the queries for a node of the tree to the metadata service, the previous request for the node is cancelled
+ * @brief DataBaseModel::requestMetadata
+ * @param index the node updated with the result
+ * @param serverConf the configuration of the server
+ * @param queries the queries, with the database names
+ */
+void DataBaseModel::requestMetadata(const QModelIndex & index, QJsonObject serverConf, QStringList queries)
 {
-	QList<QStandardItem *> dbList;
+	// The result updates the name column of the node
+	QModelIndex node = index.sibling(index.row(), 0);
+	QString key = QString("DataBaseModel/%1/%2").arg(quintptr(this)).arg(quintptr(this->itemFromIndex(node)));
+	this->pendingRequests.insert(key, QPersistentModelIndex(node));
 
-	QSqlQuery query;
-	query.exec("SHOW DATABASES");
-
-	if (query.lastError().isValid()) {
-		qWarning() << "DataBaseModel::getDataBaseList - " + query.lastError().text();
-		return dbList;
-	}
-
-	while (query.next()) {
-		QString dbname = query.value(0).toString();
-		QStandardItem *currentDB = new QStandardItem(dbname);
-		dbList.append(currentDB);
-	}
-
-	return dbList;
+	Util::MetadataService::instance()->request(key, Util::DataBase::configurationFromJSON(serverConf), queries);
 }
 
 bool DataBaseModel::canFetchMore(const QModelIndex & parent) const
@@ -139,17 +131,9 @@ bool DataBaseModel::hasChildren(const QModelIndex & index) const
 	} else if (!index.parent().isValid()) {
 		// Server node: is there database ?
 
+		// The databases are listed when the server is added, no query while the tree is painted
 		QStandardItem *serverItem = rootItem->child(index.row());
-		QJsonObject serverConf = serverItem->data().toJsonObject();
-
-		if (Util::DataBase::open(serverConf)) {
-			QSqlQuery query;
-			if (query.exec("SHOW DATABASES")) {
-				return query.size() > 0;
-			} else {
-				qDebug() << "DataBaseModel::hasChildren - " + query.lastError().text();
-			}
-		}
+		return serverItem != 0 && serverItem->rowCount() > 0;
 
 	} else if (!index.parent().parent().isValid()) {
 
@@ -168,27 +152,24 @@ void DataBaseModel::fetchMore(const QModelIndex & index)
 	}
 }
 
-QMap<QString, QString> DataBaseModel::getTableSize()
+QMap<QString, QString> DataBaseModel::getTableSize(Util::ResultSet status)
 {
 	QMap<QString, QString> size;
-	QSqlQuery query;
-
-	if (!query.exec("show table status")) {
-		qWarning() << "DataBaseModel::getTableSize - " + query.lastError().text();
-		return size;
-	}
+	int nameColumn = status.indexOf("Name");
+	int dataLengthColumn = status.indexOf("Data_length");
+	int indexLengthColumn = status.indexOf("Index_length");
 
 	double dataBaseTotalSize = 0;
 
-	while (query.next()){
-		double dataLength = query.value("Data_length").toDouble();
-		double indexLength = query.value("Index_length").toDouble();
+	for (int i = 0; i < status.rowCount(); i++){
+		double dataLength = status.value(i, dataLengthColumn).toDouble();
+		double indexLength = status.value(i, indexLengthColumn).toDouble();
 
 		double totalSize = (dataLength + indexLength) / 1024;
 
 		dataBaseTotalSize += totalSize;
 
-		size.insert(query.value("Name").toString(), this->getSizeString(totalSize));
+		size.insert(status.value(i, nameColumn).toString(), this->getSizeString(totalSize));
 	}
 
 	size.insert("DATABASE_SIZE", this->getSizeString(dataBaseTotalSize));
@@ -220,9 +201,10 @@ void DataBaseModel::dropDatabase(const QModelIndex & index)
 
 	QJsonObject serverConf = serverItem->data().toJsonObject();
 	if (Util::DataBase::open(serverConf, databaseItem->text())) {
-		QSqlQuery dropQuery;
+		QSqlQuery dropQuery(Util::DataBase::current());
 
 		if (dropQuery.exec("DROP DATABASE "+databaseItem->text())){
+			Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(), dropQuery.lastQuery());
 			serverItem->removeRow(index.row());
 		} else {
 			qDebug() << "DataBaseModel::dropDatabase - " + dropQuery.lastError().text();
@@ -240,10 +222,11 @@ void DataBaseModel::dropTable(const QModelIndex & index)
 
 	QJsonObject serverConf = serverItem->data().toJsonObject();
 	if (Util::DataBase::open(serverConf, databaseItem->text())) {
-		QSqlQuery dropQuery;
+		QSqlQuery dropQuery(Util::DataBase::current());
 
 		qInfo() << "Drop table " + tableItem->text();
 		if (dropQuery.exec("DROP TABLE "+tableItem->text())){
+			Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(), dropQuery.lastQuery());
 			databaseItem->removeRow(index.row());
 		} else {
 			qDebug() << "DataBaseModel::dropTable - " + dropQuery.lastError().text() ;
@@ -261,10 +244,11 @@ void DataBaseModel::truncateTable(const QModelIndex & index)
 
 	QJsonObject serverConf = serverItem->data().toJsonObject();
 	if (Util::DataBase::open(serverConf, databaseItem->text())) {
-		QSqlQuery truncateQuery;
+		QSqlQuery truncateQuery(Util::DataBase::current());
 
 		qInfo() << "Truncate table " + tableItem->text();
 		if (truncateQuery.exec("TRUNCATE TABLE "+tableItem->text())){
+			Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(), truncateQuery.lastQuery());
 
 			this->refresh(index); // Refresh table size
 		} else {
@@ -286,56 +270,7 @@ void DataBaseModel::refresh(const QModelIndex & index)
 
 		qInfo() << "Reload database list: " + serverItem->text();
 
-		if (Util::DataBase::open(serverConf)) {
-			QList<QStandardItem *> dbList = this->getDataBaseList();
-
-			// Process item to add
-			foreach (QStandardItem *db, dbList) {
-
-				bool bdFound = false;
-				for (int i = 0; i < serverItem->rowCount(); i++) {
-					QStandardItem *currentItem = serverItem->child(i, 0);
-					if (db->text() == currentItem->text()) {
-						bdFound = true;
-						break;
-					}
-				}
-
-				// Item not found in the current model, it should be added
-				if (!bdFound) {
-					db->setData(QIcon(":/resources/icons/database-icon.png"),Qt::DecorationRole);
-					QList<QStandardItem *> cols;
-					cols << db;
-					QStandardItem *size = new QStandardItem();
-					size->setTextAlignment(Qt::AlignRight);
-					cols << size;
-
-                    serverItem->appendRow(cols);
-				}
-			}
-
-			// Process item to remove
-			int i = 0;
-			while (i < serverItem->rowCount()) {
-				QStandardItem *currentItem = serverItem->child(i, 0);
-
-				bool bdFound = false;
-				foreach (QStandardItem *db, dbList) {
-					if (db->text() == currentItem->text()) {
-						bdFound = true;
-						break;
-					}
-				}
-
-				if (!bdFound) {
-					serverItem->removeRow(i); // Do not increase `i` in this case, because we are removing the current index
-				} else {
-					i++;
-				}
-			}
-
-		}
-
+		this->requestMetadata(index, serverConf, QStringList() << "SHOW DATABASES");
 
 	} else if (!index.parent().parent().isValid()) { // Refresh Database node, reload table list
 
@@ -345,103 +280,191 @@ void DataBaseModel::refresh(const QModelIndex & index)
 		QJsonObject serverConf = serverItem->data().toJsonObject();
 
 		if (Util::DataBase::open(serverConf, dbItem->text())) {
-			QMap<QString, QString> tableSize = this->getTableSize();
+			dbItem->setData(QVariant(false)); // Mark data as loading
+			this->requestMetadata(index, serverConf, QStringList() << QString("SHOW TABLE STATUS FROM `%1`").arg(dbItem->text()));
+		}
+	} else if (!index.parent().parent().parent().isValid()) {
+		// Table node: refresh table size
 
-			QMapIterator<QString, QString> iterator(tableSize);
-			while(iterator.hasNext()){
-				iterator.next();
+		QStandardItem *serverItem = rootItem->child(index.parent().parent().row());
+		QStandardItem *dbItem = serverItem->child(index.parent().row());
+		QStandardItem *tableItem = dbItem->child(index.row());
 
+		qInfo() << "Reload table size: " + tableItem->text();
 
-				if (iterator.key() != "DATABASE_SIZE"){
+		QJsonObject serverConf = serverItem->data().toJsonObject();
+		this->requestMetadata(index, serverConf, QStringList() << QString("SHOW TABLE STATUS FROM `%1` LIKE '%2'").arg(dbItem->text()).arg(tableItem->text()));
+	}
+}
 
-					bool tableFound = false;
-					for (int i = 0; i < dbItem->rowCount(); i++) {
-						QStandardItem *currentItem = dbItem->child(i, 0);
-						if (iterator.key() == currentItem->text()) {
-							tableFound = true;
-							break;
-						}
-					}
+/**
+ * Updates the node of the request with the result of the metadata service
+ * @brief DataBaseModel::handleMetadataReady
+ * @param key the key of the request
+ * @param results the result of the query
+ */
+void DataBaseModel::handleMetadataReady(QString key, QList<Util::ResultSet> results)
+{
+	if (!this->pendingRequests.contains(key)) {
+		return;
+	}
 
-					if (!tableFound) {
+	// The node may have been removed while the query was running
+	QModelIndex index = this->pendingRequests.take(key);
+	if (!index.isValid() || results.isEmpty()) {
+		return;
+	}
 
-						QList<QStandardItem *> cols;
+	QStandardItem *item = this->itemFromIndex(index);
 
-						QStandardItem *table = new QStandardItem(iterator.key());
-						table->setData(QIcon(":/resources/icons/database-table-icon.png"),Qt::DecorationRole);
+	if (!index.parent().isValid()) {
+		this->updateDatabaseList(item, results.first());
+	} else if (!index.parent().parent().isValid()) {
+		this->updateTableList(item, results.first());
+	} else {
+		Util::ResultSet status = results.first();
+		if (!status.isEmpty()) {
+			double dataLength = status.value(0, status.indexOf("Data_length")).toDouble();
+			double indexLength = status.value(0, status.indexOf("Index_length")).toDouble();
+
+			double totalSize = (dataLength + indexLength) / 1024;
+			QStandardItem *tableSize = item->parent()->child(index.row(), 1);
+			tableSize->setText(this->getSizeString(totalSize));
+		}
+	}
+}
 
-						cols << table;
-						QStandardItem *size = new QStandardItem(iterator.value());
-						size->setTextAlignment(Qt::AlignRight);
-						cols << size;
+void DataBaseModel::handleMetadataFailed(QString key, QString error)
+{
+	if (!this->pendingRequests.contains(key)) {
+		return;
+	}
 
-						dbItem->appendRow(cols);
-					}
-				}
-			}
+	QModelIndex index = this->pendingRequests.take(key);
+	qWarning() << "DataBaseModel::refresh - " + error;
 
-			// Process item to remove
-			int i = 0;
-			while (i < dbItem->rowCount()) {
-				QStandardItem *currentItem = dbItem->child(i, 0);
+	// The table list of a database can be asked again
+	if (index.isValid() && index.parent().isValid() && !index.parent().parent().isValid()) {
+		this->itemFromIndex(index)->setData(QVariant());
+	}
+}
 
-				bool tableFound = false;
-				QMapIterator<QString, QString> iterator(tableSize);
-				while(iterator.hasNext()){
-					iterator.next();
+/**
+ * Adds the new databases of the server and removes the dropped ones
+ * @brief DataBaseModel::updateDatabaseList
+ * @param serverItem the server node
+ * @param databases the result of SHOW DATABASES
+ */
+void DataBaseModel::updateDatabaseList(QStandardItem *serverItem, Util::ResultSet databases)
+{
+	QStringList dbList;
+	for (int i = 0; i < databases.rowCount(); i++) {
+		dbList << databases.value(i, 0).toString();
+	}
 
-					if (iterator.key() == currentItem->text()) {
-						tableFound = true;
-						break;
-					}
-				}
+	// Process item to add
+	foreach (QString db, dbList) {
 
-				if (!tableFound) {
-					dbItem->removeRow(i); // Do not increase `i` in this case, because we are removing the current index
-				} else {
-					i++;
-				}
+		bool bdFound = false;
+		for (int i = 0; i < serverItem->rowCount(); i++) {
+			QStandardItem *currentItem = serverItem->child(i, 0);
+			if (db == currentItem->text()) {
+				bdFound = true;
+				break;
 			}
-
-			dbItem->setData(QVariant(true)); // Mark data as loaded
-            QStandardItem *dbSize = serverItem->child(index.row(), 1);
-            dbSize->setText(tableSize.value("DATABASE_SIZE"));
 		}
-	} else if (!index.parent().parent().parent().isValid()) {
-		// Table node: refresh table size
 
-		QStandardItem *serverItem = rootItem->child(index.parent().parent().row());
-		QStandardItem *dbItem = serverItem->child(index.parent().row());
-		QStandardItem *tableItem = dbItem->child(index.row());
+		// Item not found in the current model, it should be added
+		if (!bdFound) {
+			QStandardItem *dbItem = new QStandardItem(db);
+			dbItem->setData(QIcon(":/resources/icons/database-icon.png"),Qt::DecorationRole);
+			QList<QStandardItem *> cols;
+			cols << dbItem;
+			QStandardItem *size = new QStandardItem();
+			size->setTextAlignment(Qt::AlignRight);
+			cols << size;
+
+			serverItem->appendRow(cols);
+		}
+	}
 
-		qInfo() << "Reload table size: " + tableItem->text();
+	// Process item to remove
+	int i = 0;
+	while (i < serverItem->rowCount()) {
+		QStandardItem *currentItem = serverItem->child(i, 0);
 
-		QJsonObject serverConf = serverItem->data().toJsonObject();
+		if (!dbList.contains(currentItem->text())) {
+			serverItem->removeRow(i); // Do not increase `i` in this case, because we are removing the current index
+		} else {
+			i++;
+		}
+	}
+}
 
-		if (Util::DataBase::open(serverConf, dbItem->text())) {
+/**
+ * Adds the new tables of the database, removes the dropped ones and updates the sizes
+ * @brief DataBaseModel::updateTableList
+ * @param dbItem the database node
+ * @param status the result of SHOW TABLE STATUS
+ */
+void DataBaseModel::updateTableList(QStandardItem *dbItem, Util::ResultSet status)
+{
+	QMap<QString, QString> tableSize = this->getTableSize(status);
 
-			QSqlQuery query;
+	QMapIterator<QString, QString> iterator(tableSize);
+	while(iterator.hasNext()){
+		iterator.next();
 
-			if (query.exec(QString("show table status WHERE Name LIKE '%1'").arg(tableItem->text()))) {
 
-				if (query.next()) {
-					double dataLength = query.value("Data_length").toDouble();
-					double indexLength = query.value("Index_length").toDouble();
+		if (iterator.key() != "DATABASE_SIZE"){
 
-					double totalSize = (dataLength + indexLength) / 1024;
-					QStandardItem *tableSize = dbItem->child(index.row(), 1);
-					tableSize->setText(this->getSizeString(totalSize));
+			bool tableFound = false;
+			for (int i = 0; i < dbItem->rowCount(); i++) {
+				QStandardItem *currentItem = dbItem->child(i, 0);
+				if (iterator.key() == currentItem->text()) {
+					tableFound = true;
+					break;
 				}
-			} else {
+			}
 
-				qWarning() << "DataBaseModel::refresh - " + query.lastError().text();
+			if (!tableFound) {
+
+				QList<QStandardItem *> cols;
+
+				QStandardItem *table = new QStandardItem(iterator.key());
+				table->setData(QIcon(":/resources/icons/database-table-icon.png"),Qt::DecorationRole);
+
+				cols << table;
+				QStandardItem *size = new QStandardItem(iterator.value());
+				size->setTextAlignment(Qt::AlignRight);
+				cols << size;
+
+				dbItem->appendRow(cols);
 			}
 		}
 	}
+
+	// Process item to remove
+	int i = 0;
+	while (i < dbItem->rowCount()) {
+		QStandardItem *currentItem = dbItem->child(i, 0);
+
+		if (!tableSize.contains(currentItem->text())) {
+			dbItem->removeRow(i); // Do not increase `i` in this case, because we are removing the current index
+		} else {
+			i++;
+		}
+	}
+
+	dbItem->setData(QVariant(true)); // Mark data as loaded
+	QStandardItem *dbSize = dbItem->parent()->child(dbItem->row(), 1);
+	dbSize->setText(tableSize.value("DATABASE_SIZE"));
 }
 
 DataBaseModel::~DataBaseModel() {
-
+	foreach (QString key, this->pendingRequests.keys()) {
+		Util::MetadataService::instance()->cancel(key);
+	}
 }
 
 } /* namespace Model */
@@ -26,6 +26,9 @@
 #include <QSqlDatabase>
 #include <QModelIndex>
 #include <QMap>
+#include <QHash>
+#include <QPersistentModelIndex>
+#include "Util/ResultSet.h"
 
 namespace UI {
 namespace Explorer {
@@ -50,9 +53,17 @@ protected:
 	bool hasChildren(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
     void fetchMore(const QModelIndex & index) Q_DECL_OVERRIDE;
 
+private slots:
+	void handleMetadataReady(QString key, QList<Util::ResultSet> results);
+	void handleMetadataFailed(QString key, QString error);
+
 private:
-	QList<QStandardItem *> getDataBaseList();
-	QMap<QString, QString> getTableSize();
+	QHash<QString, QPersistentModelIndex> pendingRequests;
+
+	void requestMetadata(const QModelIndex & index, QJsonObject serverConf, QStringList queries);
+	void updateDatabaseList(QStandardItem *serverItem, Util::ResultSet databases);
+	void updateTableList(QStandardItem *dbItem, Util::ResultSet status);
+	QMap<QString, QString> getTableSize(Util::ResultSet status);
 	QString getSizeString(double size);
 
 signals:
@@ -0,0 +1,308 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ExecuteScriptWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QLocale>
+#include <QDebug>
+#include "Util/ResultCache.h"
+
+// The progress bar counts per mille of the file
+#define PROGRESS_RANGE 1000
+
+namespace UI {
+    namespace Explorer {
+        namespace Script {
+            ExecuteScriptWindow::ExecuteScriptWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName) :
+                QMainWindow(parent),
+                sessionConf(sessionConf),
+                databaseName(databaseName)
+            {
+                setWindowTitle(tr("Execute SQL file on %1").arg(databaseName));
+                setAttribute(Qt::WA_DeleteOnClose);
+
+                QWidget *mainContainer = new QWidget(this);
+                QVBoxLayout *mainLayout = new QVBoxLayout(mainContainer);
+                mainLayout->setContentsMargins(20, 20, 20, 20);
+
+                QFont font;
+                font.setBold(true);
+
+                // File selection
+                QLabel *labelFile = new QLabel(tr("Script"), mainContainer);
+                labelFile->setFont(font);
+                mainLayout->addWidget(labelFile);
+
+                QWidget *fileContainer = new QWidget(mainContainer);
+                QHBoxLayout *fileLayout = new QHBoxLayout(fileContainer);
+                fileLayout->setContentsMargins(30, 5, 0, 10);
+                this->filePath = new QLineEdit(fileContainer);
+                QPushButton *browseButton = new QPushButton(tr("browse..."), fileContainer);
+                fileLayout->addWidget(this->filePath);
+                fileLayout->addWidget(browseButton);
+                mainLayout->addWidget(fileContainer);
+
+                // Options
+                QLabel *labelOptions = new QLabel(tr("Options"), mainContainer);
+                labelOptions->setFont(font);
+                mainLayout->addWidget(labelOptions);
+
+                this->errorPolicy = new QComboBox(mainContainer);
+                this->errorPolicy->addItem(tr("Stop the execution"), Util::ScriptExecution::STOP);
+                this->errorPolicy->addItem(tr("Skip the statement"), Util::ScriptExecution::SKIP);
+                this->errorPolicy->addItem(tr("Write the statement in a log file"), Util::ScriptExecution::LOG);
+
+                QWidget *logContainer = new QWidget(mainContainer);
+                QHBoxLayout *logLayout = new QHBoxLayout(logContainer);
+                logLayout->setContentsMargins(0, 0, 0, 0);
+                this->logFilePath = new QLineEdit(logContainer);
+                QPushButton *browseLogButton = new QPushButton(tr("browse..."), logContainer);
+                logLayout->addWidget(this->logFilePath);
+                logLayout->addWidget(browseLogButton);
+                logContainer->setEnabled(false);
+
+                this->commitInterval = new QSpinBox(mainContainer);
+                this->commitInterval->setRange(0, 1000000);
+                this->commitInterval->setValue(0);
+                this->commitInterval->setSpecialValueText(tr("autocommit"));
+                this->commitInterval->setFixedWidth(150);
+
+                QWidget *optionContainer = new QWidget(mainContainer);
+                QFormLayout *optionLayout = new QFormLayout(optionContainer);
+                optionLayout->setContentsMargins(30, 5, 0, 10);
+                optionLayout->addRow(tr("On error:"), this->errorPolicy);
+                optionLayout->addRow(tr("Log file:"), logContainer);
+                optionLayout->addRow(tr("Commit every:"), this->commitInterval);
+                mainLayout->addWidget(optionContainer);
+
+                // Progress
+                QLabel *labelProgress = new QLabel(tr("Progress"), mainContainer);
+                labelProgress->setFont(font);
+                mainLayout->addWidget(labelProgress);
+
+                QWidget *progressContainer = new QWidget(mainContainer);
+                QVBoxLayout *progressLayout = new QVBoxLayout(progressContainer);
+                progressLayout->setContentsMargins(30, 5, 0, 10);
+
+                this->progressbar = new QProgressBar(progressContainer);
+                this->progressbar->setRange(0, PROGRESS_RANGE);
+                this->progressbar->setValue(0);
+                this->progressLabel = new QLabel(progressContainer);
+                this->progressLabel->setWordWrap(true);
+                this->progressLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+                this->currentStatement = new QPlainTextEdit(progressContainer);
+                this->currentStatement->setReadOnly(true);
+                this->currentStatement->setFont(QFont("DejaVu Sans Mono"));
+                this->currentStatement->setPlaceholderText(tr("Current statement"));
+
+                progressLayout->addWidget(this->progressbar);
+                progressLayout->addWidget(this->progressLabel);
+                progressLayout->addWidget(this->currentStatement);
+                mainLayout->addWidget(progressContainer, 1);
+
+                QWidget *buttonContainer = new QWidget(this);
+                QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+                this->executeButton = new QPushButton(tr("Execute"), this);
+                this->stopButton = new QPushButton(tr("Stop"), this);
+                QPushButton *closeButton = new QPushButton(tr("Close"), this);
+                buttonLayout->addWidget(this->executeButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+                buttonLayout->setAlignment(Qt::AlignRight);
+                buttonLayout->setContentsMargins(0, 0, 0, 0);
+                this->stopButton->hide();
+
+                mainLayout->addWidget(buttonContainer);
+
+                this->setCentralWidget(mainContainer);
+                this->resize(800, 600);
+
+                // Events
+                connect(browseButton, SIGNAL(released()), SLOT(handleBrowseFile()));
+                connect(browseLogButton, SIGNAL(released()), SLOT(handleBrowseLogFile()));
+                connect(this->errorPolicy, SIGNAL(currentIndexChanged(int)), SLOT(handleErrorPolicyChanged(int)));
+                connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+                connect(this->executeButton, SIGNAL(released()), SLOT(handleExecute()));
+                connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+            }
+
+            void ExecuteScriptWindow::handleBrowseFile()
+            {
+                QString file = QFileDialog::getOpenFileName(this, tr("Open SQL file"), QString(), tr("SQL files (*.sql);;All files (*)"));
+                if (!file.isEmpty()) {
+                    this->filePath->setText(file);
+                    if (this->logFilePath->text().isEmpty()) {
+                        this->logFilePath->setText(file + ".errors.sql");
+                    }
+                }
+            }
+
+            void ExecuteScriptWindow::handleBrowseLogFile()
+            {
+                QString file = QFileDialog::getSaveFileName(this, tr("Log file"));
+                if (!file.isEmpty()) {
+                    this->logFilePath->setText(file);
+                }
+            }
+
+            /**
+             * The log file is only used with the LOG policy
+             * @brief ExecuteScriptWindow::handleErrorPolicyChanged
+             */
+            void ExecuteScriptWindow::handleErrorPolicyChanged(int index)
+            {
+                this->logFilePath->parentWidget()->setEnabled(this->errorPolicy->itemData(index).toInt() == Util::ScriptExecution::LOG);
+            }
+
+            /**
+             * Starts the execution in a background thread
+             * @brief ExecuteScriptWindow::handleExecute
+             */
+            void ExecuteScriptWindow::handleExecute()
+            {
+                QString file = this->filePath->text().trimmed();
+                if (file.isEmpty() || !QFileInfo(file).isReadable()) {
+                    QMessageBox::warning(this, "", tr("The file cannot be read"));
+                    return;
+                }
+
+                Util::ScriptExecution::ErrorPolicy policy = (Util::ScriptExecution::ErrorPolicy) this->errorPolicy->currentData().toInt();
+                if (policy == Util::ScriptExecution::LOG && this->logFilePath->text().trimmed().isEmpty()) {
+                    QMessageBox::warning(this, "", tr("The log file is required"));
+                    return;
+                }
+
+                this->executeButton->hide();
+                this->stopButton->show();
+
+                // The statements of the script are not read before their execution
+                Util::ResultCache::instance()->invalidateSession(Util::DataBase::configurationFromJSON(this->sessionConf, this->databaseName));
+
+                scriptWorker = new Util::ScriptExecution(Util::DataBase::configurationFromJSON(this->sessionConf, this->databaseName), file);
+                scriptWorker->setErrorPolicy(policy);
+                scriptWorker->setLogFile(this->logFilePath->text().trimmed());
+                scriptWorker->setCommitInterval(this->commitInterval->value());
+
+                this->timer = new QTimer(this);
+                this->workerThread = new QThread();
+                scriptWorker->moveToThread(workerThread);
+
+                connect(workerThread, &QThread::finished, scriptWorker, &QObject::deleteLater);
+                connect(this, SIGNAL(startExecution()), scriptWorker, SLOT(execute()));
+                connect(scriptWorker, SIGNAL(executionFinished(bool)), SLOT(handleExecutionFinished(bool)));
+                connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+
+                workerThread->start();
+
+                this->progressbar->setValue(0);
+                this->progressLabel->clear();
+                this->currentStatement->clear();
+                this->elapsed.start();
+                this->timer->start(200);
+
+                emit startExecution();
+            }
+
+            /**
+             * Refreshes the bytes read, the statements executed and the current statement
+             * @brief ExecuteScriptWindow::handleTimer
+             */
+            void ExecuteScriptWindow::handleTimer()
+            {
+                if (this->scriptWorker == nullptr) {
+                    return;
+                }
+
+                ScriptExecutionStatus status = this->scriptWorker->getStatus();
+                QLocale locale(QLocale::English);
+
+                if (status.totalBytes > 0) {
+                    this->progressbar->setValue(status.bytesRead * PROGRESS_RANGE / status.totalBytes);
+                }
+
+                QString text = tr("%1 / %2 MB read, %3 statements executed (%4 committed), %5 errors, %6 s")
+                        .arg(locale.toString(status.bytesRead / (1024.0 * 1024.0), 'f', 1))
+                        .arg(locale.toString(status.totalBytes / (1024.0 * 1024.0), 'f', 1))
+                        .arg(locale.toString(status.statements))
+                        .arg(locale.toString(status.committedStatements))
+                        .arg(locale.toString(status.errors))
+                        .arg(this->elapsed.elapsed() / 1000);
+                if (!status.lastError.isEmpty()) {
+                    text += "\n" + tr("Last error: %1").arg(status.lastError);
+                }
+
+                this->progressLabel->setText(text);
+                if (this->currentStatement->toPlainText() != status.currentStatement) {
+                    this->currentStatement->setPlainText(status.currentStatement);
+                }
+            }
+
+            /**
+             * Called when the script has been executed or interrupted
+             * @brief ExecuteScriptWindow::handleExecutionFinished
+             * @param stopped true when the user has stopped the execution
+             */
+            void ExecuteScriptWindow::handleExecutionFinished(bool stopped)
+            {
+                this->handleTimer();
+                ScriptExecutionStatus status = this->scriptWorker->getStatus();
+
+                if (!stopped && status.errors == 0) {
+                    QMessageBox::information(this, "", tr("Script executed successfully"));
+                } else if (!stopped && this->errorPolicy->currentData().toInt() == Util::ScriptExecution::STOP) {
+                    QMessageBox::warning(this, "", tr("The execution has stopped on an error:\n%1").arg(status.lastError));
+                }
+
+                this->timer->stop();
+                delete this->timer;
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->scriptWorker = nullptr;
+                this->executeButton->show();
+                this->stopButton->hide();
+            }
+
+            /**
+             * The execution stops after the current statement
+             * @brief ExecuteScriptWindow::handleStop
+             */
+            void ExecuteScriptWindow::handleStop()
+            {
+                if (this->scriptWorker != nullptr) {
+                    this->scriptWorker->stopRequired();
+                }
+            }
+
+            void ExecuteScriptWindow::handleClose()
+            {
+                this->handleStop();
+                this->close();
+            }
+
+            ExecuteScriptWindow::~ExecuteScriptWindow()
+            {
+                if (this->scriptWorker != nullptr) {
+                    this->scriptWorker->stopRequired();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef EXECUTESCRIPTWINDOW_H
+#define EXECUTESCRIPTWINDOW_H
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include "Util/DataBase.h"
+#include "Util/ScriptExecution.h"
+
+namespace UI {
+    namespace Explorer {
+        namespace Script {
+            class ExecuteScriptWindow : public QMainWindow
+            {
+                Q_OBJECT
+            public:
+                explicit ExecuteScriptWindow(QWidget *parent, QJsonObject sessionConf, QString databaseName);
+                virtual ~ExecuteScriptWindow();
+
+            private:
+                QThread *workerThread = nullptr;
+                Util::ScriptExecution *scriptWorker = nullptr;
+                QJsonObject sessionConf;
+                QString databaseName;
+                QLineEdit *filePath;
+                QComboBox *errorPolicy;
+                QLineEdit *logFilePath;
+                QSpinBox *commitInterval;
+                QPushButton *executeButton;
+                QPushButton *stopButton;
+                QProgressBar *progressbar;
+                QLabel *progressLabel;
+                QPlainTextEdit *currentStatement;
+                QTimer *timer;
+                QElapsedTimer elapsed;
+
+            signals:
+                void startExecution();
+
+            public slots:
+                void handleExecute();
+                void handleStop();
+                void handleClose();
+                void handleBrowseFile();
+                void handleBrowseLogFile();
+                void handleErrorPolicyChanged(int index);
+                void handleExecutionFinished(bool stopped);
+                void handleTimer();
+            };
+        }
+    }
+}
+#endif // EXECUTESCRIPTWINDOW_H
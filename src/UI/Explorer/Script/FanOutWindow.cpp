@@ -0,0 +1,339 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "FanOutWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QLocale>
+#include <QSet>
+#include "UI/Explorer/Tabs/SQLSyntaxHighlighter.h"
+#include "Util/ResultCache.h"
+
+// Columns of the table of the databases
+#define SHARD_SERVER 0
+#define SHARD_DATABASE 1
+#define SHARD_STATUS 2
+#define SHARD_ROWS 3
+#define SHARD_MSEC 4
+#define SHARD_ERROR 5
+
+namespace UI {
+    namespace Explorer {
+        namespace Script {
+            FanOutWindow::FanOutWindow(QWidget *parent, QList<FanOutTarget> targets) :
+                QMainWindow(parent),
+                targets(targets)
+            {
+                qRegisterMetaType<FanOutShard>("FanOutShard");
+
+                QSet<QString> servers;
+                foreach (FanOutTarget target, targets) {
+                    servers << target.server;
+                }
+
+                setWindowTitle(tr("Execute on %1 databases of %2 server(s)").arg(targets.size()).arg(servers.size()));
+                setAttribute(Qt::WA_DeleteOnClose);
+
+                QWidget *mainContainer = new QWidget(this);
+                QVBoxLayout *mainLayout = new QVBoxLayout(mainContainer);
+                mainLayout->setContentsMargins(20, 20, 20, 20);
+
+                QFont font;
+                font.setBold(true);
+
+                // Statement
+                QLabel *labelStatement = new QLabel(tr("Statement"), mainContainer);
+                labelStatement->setFont(font);
+                mainLayout->addWidget(labelStatement);
+
+                this->statementText = new QPlainTextEdit(mainContainer);
+                this->statementText->setFont(QFont("DejaVu Sans Mono"));
+                this->statementText->setToolTip(tr("The statement is executed on each database, the rows of its first result are shown"));
+                new Tabs::SQLSyntaxHighlighter(this->statementText->document());
+                mainLayout->addWidget(this->statementText);
+
+                // Options
+                QLabel *labelOptions = new QLabel(tr("Options"), mainContainer);
+                labelOptions->setFont(font);
+                mainLayout->addWidget(labelOptions);
+
+                this->concurrency = new QSpinBox(mainContainer);
+                this->concurrency->setRange(1, 32);
+                this->concurrency->setValue(8);
+                this->concurrency->setSuffix(" " + tr("connection(s)"));
+                this->concurrency->setFixedWidth(150);
+
+                this->rowLimit = new QSpinBox(mainContainer);
+                this->rowLimit->setRange(0, 100000);
+                this->rowLimit->setValue(1000);
+                this->rowLimit->setSuffix(" " + tr("rows"));
+                this->rowLimit->setToolTip(tr("The next rows of each database are only counted"));
+                this->rowLimit->setFixedWidth(150);
+
+                QWidget *optionContainer = new QWidget(mainContainer);
+                QFormLayout *optionLayout = new QFormLayout(optionContainer);
+                optionLayout->setContentsMargins(30, 5, 0, 10);
+                optionLayout->addRow(tr("Concurrency:"), this->concurrency);
+                optionLayout->addRow(tr("Per database:"), this->rowLimit);
+                mainLayout->addWidget(optionContainer);
+
+                // Results
+                QLabel *labelResults = new QLabel(tr("Results"), mainContainer);
+                labelResults->setFont(font);
+                mainLayout->addWidget(labelResults);
+
+                this->progressbar = new QProgressBar(mainContainer);
+                this->progressbar->setRange(0, qMax(1, targets.size()));
+                this->progressbar->setValue(0);
+                this->progressLabel = new QLabel(mainContainer);
+                this->progressLabel->setWordWrap(true);
+                this->progressLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+                mainLayout->addWidget(this->progressbar);
+                mainLayout->addWidget(this->progressLabel);
+
+                this->resultTabs = new QTabWidget(mainContainer);
+
+                this->rowsView = new QTableView(this->resultTabs);
+                this->rowsView->verticalHeader()->hide();
+                this->resultTabs->addTab(this->rowsView, tr("Rows"));
+
+                this->shardTable = new QTableWidget(0, 6, this->resultTabs);
+                this->shardTable->setHorizontalHeaderLabels(QStringList() << tr("Server") << tr("Database") << tr("Status") << tr("Rows") << tr("Time (ms)") << tr("Error"));
+                this->shardTable->horizontalHeader()->setStretchLastSection(true);
+                this->shardTable->verticalHeader()->hide();
+                this->shardTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+                this->shardTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+                this->resultTabs->addTab(this->shardTable, tr("Databases"));
+
+                mainLayout->addWidget(this->resultTabs, 3);
+
+                QWidget *buttonContainer = new QWidget(this);
+                QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+                this->executeButton = new QPushButton(tr("Execute"), this);
+                this->stopButton = new QPushButton(tr("Stop"), this);
+                QPushButton *closeButton = new QPushButton(tr("Close"), this);
+                buttonLayout->addWidget(this->executeButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+                buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+                buttonLayout->setAlignment(Qt::AlignRight);
+                buttonLayout->setContentsMargins(0, 0, 0, 0);
+                this->stopButton->hide();
+
+                mainLayout->addWidget(buttonContainer);
+
+                this->setCentralWidget(mainContainer);
+                this->resize(1000, 750);
+
+                this->timer = new QTimer(this);
+
+                // Events
+                connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+                connect(this->executeButton, SIGNAL(released()), SLOT(handleExecute()));
+                connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+                connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+            }
+
+            /**
+             * Starts the execution in a background thread, which starts the workers
+             * @brief FanOutWindow::handleExecute
+             */
+            void FanOutWindow::handleExecute()
+            {
+                QString query = this->statementText->toPlainText().trimmed();
+                if (query.isEmpty()) {
+                    QMessageBox::warning(this, "", tr("The statement is empty"));
+                    return;
+                }
+
+                if (!Util::ResultCache::isReadOnly(query)) {
+                    int answer = QMessageBox::question(this, "", tr("The statement modifies the data of %1 databases, execute it?").arg(this->targets.size()),
+                                                       QMessageBox::Yes | QMessageBox::Cancel);
+                    if (answer != QMessageBox::Yes) {
+                        return;
+                    }
+
+                    foreach (FanOutTarget target, this->targets) {
+                        Util::ResultCache::instance()->invalidate(target.connection, query);
+                    }
+                }
+
+                // The previous results are replaced
+                delete this->rowsModel;
+                this->rowsModel = nullptr;
+                this->columns.clear();
+                this->shardTable->setSortingEnabled(false);
+                this->shardTable->setRowCount(0);
+
+                this->fanOutWorker = new Util::FanOutExecution(this->targets, query);
+                this->fanOutWorker->setConcurrency(this->concurrency->value());
+                this->fanOutWorker->setRowLimit(this->rowLimit->value());
+
+                this->executeButton->hide();
+                this->stopButton->show();
+
+                this->workerThread = new QThread();
+                this->fanOutWorker->moveToThread(this->workerThread);
+
+                connect(this->workerThread, &QThread::finished, this->fanOutWorker, &QObject::deleteLater);
+                connect(this->workerThread, &QThread::finished, this->workerThread, &QObject::deleteLater);
+                connect(this, SIGNAL(startExecution()), this->fanOutWorker, SLOT(execute()));
+                connect(this->fanOutWorker, SIGNAL(shardFinished(FanOutShard)), SLOT(handleShardFinished(FanOutShard)));
+                connect(this->fanOutWorker, SIGNAL(executionFinished(bool)), SLOT(handleExecutionFinished(bool)));
+
+                this->workerThread->start();
+
+                this->progressbar->setValue(0);
+                this->progressLabel->clear();
+                this->timer->start(200);
+
+                emit startExecution();
+            }
+
+            /**
+             * Adds the rows of a database to the grid, and the database to the list of the databases
+             * @brief FanOutWindow::handleShardFinished
+             */
+            void FanOutWindow::handleShardFinished(FanOutShard shard)
+            {
+                if (!shard.error.isEmpty() || !shard.isSelect) {
+                    this->addShardRow(shard, shard.error.isEmpty() ? tr("Done") : tr("Error"));
+                    return;
+                }
+
+                QStringList names;
+                for (int i = 0; i < shard.data.columnCount(); i++) {
+                    names << shard.data.fieldName(i);
+                }
+
+                if (this->rowsModel == nullptr) {
+                    // The first result gives the columns of the grid
+                    this->columns = names;
+                    this->rowsModel = new Tabs::Query::QueryModel(Util::ResultSet(shard.data.record()), this);
+                    this->rowsView->setModel(this->rowsModel);
+                } else if (names != this->columns) {
+                    shard.error = tr("The columns are not the same as the columns of the other databases: %1").arg(names.mid(2).join(", "));
+                    this->addShardRow(shard, tr("Error"));
+                    return;
+                }
+
+                this->rowsModel->handleRowsFetched(shard.data, true, false, QString());
+                this->addShardRow(shard, shard.limited ? tr("Limited") : tr("Done"));
+            }
+
+            void FanOutWindow::addShardRow(FanOutShard shard, QString status)
+            {
+                int row = this->shardTable->rowCount();
+                this->shardTable->insertRow(row);
+
+                QTableWidgetItem *rowsItem = new QTableWidgetItem();
+                rowsItem->setData(Qt::DisplayRole, shard.rows);
+                QTableWidgetItem *msecItem = new QTableWidgetItem();
+                msecItem->setData(Qt::DisplayRole, shard.msec);
+
+                this->shardTable->setItem(row, SHARD_SERVER, new QTableWidgetItem(shard.server));
+                this->shardTable->setItem(row, SHARD_DATABASE, new QTableWidgetItem(shard.databaseName));
+                this->shardTable->setItem(row, SHARD_STATUS, new QTableWidgetItem(status));
+                this->shardTable->setItem(row, SHARD_ROWS, rowsItem);
+                this->shardTable->setItem(row, SHARD_MSEC, msecItem);
+                this->shardTable->setItem(row, SHARD_ERROR, new QTableWidgetItem(shard.error));
+
+                if (!shard.error.isEmpty()) {
+                    for (int column = 0; column < this->shardTable->columnCount(); column++) {
+                        this->shardTable->item(row, column)->setForeground(Qt::red);
+                    }
+                }
+            }
+
+            /**
+             * Refreshes the number of databases done
+             * @brief FanOutWindow::handleTimer
+             */
+            void FanOutWindow::handleTimer()
+            {
+                if (this->fanOutWorker == nullptr) {
+                    return;
+                }
+
+                FanOutStatus status = this->fanOutWorker->getStatus();
+                QLocale locale(QLocale::English);
+
+                this->progressbar->setValue(status.finished);
+                this->progressLabel->setText(tr("%1 / %2 databases, %3 errors, %4 rows, %5 s")
+                                             .arg(locale.toString(status.finished))
+                                             .arg(locale.toString(status.shards))
+                                             .arg(locale.toString(status.errors))
+                                             .arg(locale.toString(status.rows))
+                                             .arg(locale.toString(status.elapsedMsec / 1000.0, 'f', 1)));
+            }
+
+            /**
+             * Called when all the workers have finished
+             * @brief FanOutWindow::handleExecutionFinished
+             * @param stopped true when the user has stopped the execution
+             */
+            void FanOutWindow::handleExecutionFinished(bool stopped)
+            {
+                this->handleTimer();
+                this->timer->stop();
+                if (stopped) {
+                    this->progressLabel->setText(this->progressLabel->text() + " - " + tr("Stopped"));
+                }
+
+                // The slowest databases and the errors are found by sorting the list
+                this->shardTable->setSortingEnabled(true);
+                this->shardTable->resizeColumnsToContents();
+                this->shardTable->horizontalHeader()->setStretchLastSection(true);
+
+                // The worker is deleted with its thread
+                this->workerThread->quit();
+                this->workerThread = nullptr;
+                this->fanOutWorker = nullptr;
+                this->executeButton->show();
+                this->stopButton->hide();
+            }
+
+            /**
+             * The workers stop after their current database
+             * @brief FanOutWindow::handleStop
+             */
+            void FanOutWindow::handleStop()
+            {
+                if (this->fanOutWorker != nullptr) {
+                    this->fanOutWorker->stopRequired();
+                }
+            }
+
+            void FanOutWindow::handleClose()
+            {
+                this->handleStop();
+                this->close();
+            }
+
+            FanOutWindow::~FanOutWindow()
+            {
+                if (this->fanOutWorker != nullptr) {
+                    // The thread ends with the execution
+                    connect(this->fanOutWorker, SIGNAL(executionFinished(bool)), this->workerThread, SLOT(quit()));
+                    this->fanOutWorker->stopRequired();
+                }
+            }
+        }
+    }
+}
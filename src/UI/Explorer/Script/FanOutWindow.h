@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef FANOUTWINDOW_H
+#define FANOUTWINDOW_H
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QTableView>
+#include <QTableWidget>
+#include <QTabWidget>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include <QStringList>
+#include "Util/FanOutExecution.h"
+#include "UI/Explorer/Tabs/Query/QueryModel.h"
+
+namespace UI {
+    namespace Explorer {
+        namespace Script {
+            /**
+             * Executes a statement on the databases selected in the tree, the rows of all the
+             * databases are shown in one grid as soon as each database is done
+             */
+            class FanOutWindow : public QMainWindow
+            {
+                Q_OBJECT
+            public:
+                explicit FanOutWindow(QWidget *parent, QList<FanOutTarget> targets);
+                virtual ~FanOutWindow();
+
+            private:
+                QList<FanOutTarget> targets;
+                QThread *workerThread = nullptr;
+                Util::FanOutExecution *fanOutWorker = nullptr;
+                QPlainTextEdit *statementText;
+                QSpinBox *concurrency;
+                QSpinBox *rowLimit;
+                QPushButton *executeButton;
+                QPushButton *stopButton;
+                QProgressBar *progressbar;
+                QLabel *progressLabel;
+                QTabWidget *resultTabs;
+                QTableView *rowsView;
+                QTableWidget *shardTable;
+                Tabs::Query::QueryModel *rowsModel = nullptr;
+                QStringList columns; // of the grid, the results with other columns are not added
+                QTimer *timer;
+
+                void addShardRow(FanOutShard shard, QString status);
+
+            signals:
+                void startExecution();
+
+            public slots:
+                void handleExecute();
+                void handleStop();
+                void handleClose();
+                void handleShardFinished(FanOutShard shard);
+                void handleExecutionFinished(bool stopped);
+                void handleTimer();
+            };
+        }
+    }
+}
+#endif // FANOUTWINDOW_H
@@ -21,6 +21,7 @@
 #include <QDebug>
 #include <QPushButton>
 #include <QStringListModel>
+#include "Util/DataBase.h"
 
 
 namespace UI {
@@ -31,7 +32,7 @@ namespace ServerAction {
 NewDatabaseWindow::NewDatabaseWindow(QWidget *parent) : QMainWindow(parent)
 {
     // Search the default collation, MySQL server configuration
-    QSqlQuery defaultCollationQuery;
+    QSqlQuery defaultCollationQuery(Util::DataBase::current());
     QString defaultCollation = "";
     if (defaultCollationQuery.exec("SHOW VARIABLES LIKE 'collation_server'")){
         if (defaultCollationQuery.next()) {
@@ -43,7 +44,7 @@ NewDatabaseWindow::NewDatabaseWindow(QWidget *parent) : QMainWindow(parent)
 
     // Load the list of collations available
     QStringList collations;
-    QSqlQuery query;
+    QSqlQuery query(Util::DataBase::current());
     int index = 0;
     int defaultIndex = -1;
     if (query.exec("SHOW COLLATION")) {
@@ -40,7 +40,7 @@ namespace ServerAction {
 ShowProcessesWindow::ShowProcessesWindow(QJsonObject sessionConf, QWidget * parent) : QMainWindow(parent) {
 
     this->setAttribute(Qt::WA_DeleteOnClose);
-    this->database = Util::DataBase::createFromJSON(sessionConf);
+    this->database = Util::DataBase::acquire(Util::DataBase::configurationFromJSON(sessionConf));
 
 	this->setMinimumSize(900, 300);	
 
@@ -90,7 +90,7 @@ ShowProcessesWindow::ShowProcessesWindow(QJsonObject sessionConf, QWidget * pare
     connect(killButton, SIGNAL (released()), SLOT(killProcess()));
     connect(refreshButton, SIGNAL (released()), SLOT(refreshProcess()));
 
-    if (this->database.open()) {
+    if (this->database.isOpen()) {
         QSqlQuery query(this->database);
 
         if (query.exec("SELECT * FROM `information_schema`.`PROCESSLIST`")) {
@@ -133,9 +133,7 @@ void ShowProcessesWindow::killProcess()
 }
 
 ShowProcessesWindow::~ShowProcessesWindow() {
-    if (this->database.isOpen()) {
-        this->database.close();
-    }
+    Util::DataBase::release(this->database);
 }
 
 } /* namespace ServerAction */
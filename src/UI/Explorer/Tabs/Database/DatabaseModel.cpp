@@ -17,10 +17,10 @@
 #include "DatabaseModel.h"
 
 #include <QSqlDatabase>
-#include <QSqlQuery>
-#include <QSqlError>
 #include <QDebug>
 #include <QFont>
+#include "Util/DataBase.h"
+#include "Util/MetadataService.h"
 
 
 namespace UI {
@@ -30,7 +30,16 @@ namespace Database {
 
 DatabaseModel::DatabaseModel(QObject * parent) : QAbstractTableModel(parent)
 {
+    this->metadataKey = QString("DatabaseModel/%1").arg(quintptr(this));
 
+    Util::MetadataService *metadata = Util::MetadataService::instance();
+    connect(metadata, SIGNAL(resultReady(QString,QList<Util::ResultSet>)), SLOT(handleMetadataReady(QString,QList<Util::ResultSet>)));
+    connect(metadata, SIGNAL(requestFailed(QString,QString)), SLOT(handleMetadataFailed(QString,QString)));
+}
+
+DatabaseModel::~DatabaseModel()
+{
+    Util::MetadataService::instance()->cancel(this->metadataKey);
 }
 
 int DatabaseModel::rowCount(const QModelIndex & parent) const
@@ -97,38 +106,66 @@ QString  DatabaseModel::getTableName(int row)
 }
 
 
+/**
+ * Asks the table list of the current database to the metadata service
+ * @brief DatabaseModel::reload
+ */
 void DatabaseModel::reload()
 {
-    QSqlDatabase db = QSqlDatabase::database();
-    if (!db.open()) {
-        qWarning() << "DatabaseModel::reload - Database not open";
+    QSqlDatabase db = Util::DataBase::current();
+    if (!db.isValid() || db.databaseName().isEmpty()) {
+        qWarning() << "DatabaseModel::reload - No database selected";
         return;
     }
 
+    QStringList queries;
+    queries << QString("SHOW TABLE STATUS FROM `%1`").arg(db.databaseName());
+
+    Util::MetadataService::instance()->request(this->metadataKey, Util::DataBase::dumpConfiguration(db), queries);
+}
+
+void DatabaseModel::handleMetadataReady(QString key, QList<Util::ResultSet> results)
+{
+    if (key != this->metadataKey || results.isEmpty()) {
+        return;
+    }
+
+    Util::ResultSet status = results.first();
+    int nameColumn = status.indexOf("Name");
+    int collationColumn = status.indexOf("Collation");
+    int engineColumn = status.indexOf("Engine");
+    int rowFormatColumn = status.indexOf("Row_format");
+    int rowsColumn = status.indexOf("Rows");
+    int dataLengthColumn = status.indexOf("Data_length");
+    int indexLengthColumn = status.indexOf("Index_length");
+
+    beginResetModel();
     this->tableList = QList<TableDescription>();
 
-    QSqlQuery query;
-    if (query.exec("SHOW TABLE STATUS")) {
-        while (query.next()) {
-            TableDescription table;
-            table.name = query.value("Name").toString();
-            table.collation = query.value("Collation").toString();
-            table.engine = query.value("Engine").toString();
-            table.rowFormat = query.value("Row_format").toString();
-            table.rowCount = query.value("Rows").toInt();
+    for (int i = 0; i < status.rowCount(); i++) {
+        TableDescription table;
+        table.name = status.value(i, nameColumn).toString();
+        table.collation = status.value(i, collationColumn).toString();
+        table.engine = status.value(i, engineColumn).toString();
+        table.rowFormat = status.value(i, rowFormatColumn).toString();
+        table.rowCount = status.value(i, rowsColumn).toInt();
 
-            double dataLength = query.value("Data_length").toDouble();
-            double indexLength = query.value("Index_length").toDouble();
+        double dataLength = status.value(i, dataLengthColumn).toDouble();
+        double indexLength = status.value(i, indexLengthColumn).toDouble();
 
-            table.rawSize = (dataLength + indexLength) / 1024;
-            table.size = this->getSizeString(table.rawSize);
+        table.rawSize = (dataLength + indexLength) / 1024;
+        table.size = this->getSizeString(table.rawSize);
 
-            this->tableList << table;
-        }
+        this->tableList << table;
+    }
+
+    endResetModel();
+}
 
-        emit layoutChanged();
-    } else {
-        qWarning() << "DatabaseModel::reload - " + query.lastError().text();
+void DatabaseModel::handleMetadataFailed(QString key, QString error)
+{
+    if (key == this->metadataKey) {
+        qWarning() << "DatabaseModel::reload - " + error;
     }
 }
 
@@ -20,6 +20,7 @@
 #include <QAbstractTableModel>
 #include <QList>
 #include <QModelIndex>
+#include "Util/ResultSet.h"
 
 namespace UI {
 namespace Explorer {
@@ -31,6 +32,7 @@ class DatabaseModel : public QAbstractTableModel
     Q_OBJECT
 public:
     DatabaseModel(QObject * parent = 0);
+    virtual ~DatabaseModel();
     QVariant data(const QModelIndex & item, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
     int rowCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
     int columnCount(const QModelIndex & parent) const Q_DECL_OVERRIDE;
@@ -38,6 +40,10 @@ public:
     QString getTableName(int row);
     void reload();
 
+private slots:
+    void handleMetadataReady(QString key, QList<Util::ResultSet> results);
+    void handleMetadataFailed(QString key, QString error);
+
 private:
 
     struct TableDescription {
@@ -60,6 +66,7 @@ private:
 
 
     QList<TableDescription> tableList;
+    QString metadataKey;
 };
 } /* namespace Database */
 } /* namespace Tabs */
@@ -0,0 +1,339 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "BenchmarkWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QLocale>
+
+// The progress bar counts per mille of the executions or of the duration
+#define PROGRESS_RANGE 1000
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+BenchmarkWindow::BenchmarkWindow(QWidget *parent, ConnectionConfiguration connection, QString query) :
+    QMainWindow(parent),
+    connection(connection)
+{
+    setWindowTitle(tr("Benchmark on %1").arg(connection.databaseName.isEmpty() ? connection.hostname : connection.databaseName));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    QWidget *mainContainer = new QWidget(this);
+    QVBoxLayout *mainLayout = new QVBoxLayout(mainContainer);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+
+    QFont font;
+    font.setBold(true);
+
+    // Statement
+    QLabel *labelStatement = new QLabel(tr("Statement"), mainContainer);
+    labelStatement->setFont(font);
+    mainLayout->addWidget(labelStatement);
+
+    this->statementText = new QPlainTextEdit(mainContainer);
+    this->statementText->setFont(QFont("DejaVu Sans Mono"));
+    this->statementText->setPlainText(query);
+    this->statementText->setToolTip(tr("The :name parameters are replaced by the values of the column 'name' of the CSV file"));
+    mainLayout->addWidget(this->statementText, 1);
+
+    // Options
+    QLabel *labelOptions = new QLabel(tr("Options"), mainContainer);
+    labelOptions->setFont(font);
+    mainLayout->addWidget(labelOptions);
+
+    this->concurrency = new QSpinBox(mainContainer);
+    this->concurrency->setRange(1, 64);
+    this->concurrency->setValue(1);
+    this->concurrency->setSuffix(" " + tr("connection(s)"));
+    this->concurrency->setFixedWidth(150);
+
+    QWidget *limitContainer = new QWidget(mainContainer);
+    QHBoxLayout *limitLayout = new QHBoxLayout(limitContainer);
+    limitLayout->setContentsMargins(0, 0, 0, 0);
+    this->limitValue = new QSpinBox(limitContainer);
+    this->limitValue->setRange(1, 100000000);
+    this->limitValue->setValue(1000);
+    this->limitValue->setFixedWidth(150);
+    this->limitMode = new QComboBox(limitContainer);
+    this->limitMode->addItem(tr("executions"), EXECUTIONS);
+    this->limitMode->addItem(tr("seconds"), SECONDS);
+    limitLayout->addWidget(this->limitValue);
+    limitLayout->addWidget(this->limitMode);
+    limitLayout->addStretch();
+
+    this->warmup = new QSpinBox(mainContainer);
+    this->warmup->setRange(0, 1000000);
+    this->warmup->setValue(100);
+    this->warmup->setSuffix(" " + tr("executions"));
+    this->warmup->setFixedWidth(150);
+
+    QWidget *csvContainer = new QWidget(mainContainer);
+    QHBoxLayout *csvLayout = new QHBoxLayout(csvContainer);
+    csvLayout->setContentsMargins(0, 0, 0, 0);
+    this->csvFilePath = new QLineEdit(csvContainer);
+    this->csvFilePath->setPlaceholderText(tr("optional, the first line has the names of the parameters"));
+    QPushButton *browseButton = new QPushButton(tr("browse..."), csvContainer);
+    csvLayout->addWidget(this->csvFilePath);
+    csvLayout->addWidget(browseButton);
+
+    QWidget *optionContainer = new QWidget(mainContainer);
+    QFormLayout *optionLayout = new QFormLayout(optionContainer);
+    optionLayout->setContentsMargins(30, 5, 0, 10);
+    optionLayout->addRow(tr("Concurrency:"), this->concurrency);
+    optionLayout->addRow(tr("Run for:"), limitContainer);
+    optionLayout->addRow(tr("Warmup:"), this->warmup);
+    optionLayout->addRow(tr("Parameters:"), csvContainer);
+    mainLayout->addWidget(optionContainer);
+
+    // Results
+    QLabel *labelResults = new QLabel(tr("Results"), mainContainer);
+    labelResults->setFont(font);
+    mainLayout->addWidget(labelResults);
+
+    QWidget *progressContainer = new QWidget(mainContainer);
+    QVBoxLayout *progressLayout = new QVBoxLayout(progressContainer);
+    progressLayout->setContentsMargins(30, 5, 0, 10);
+
+    this->progressbar = new QProgressBar(progressContainer);
+    this->progressbar->setRange(0, PROGRESS_RANGE);
+    this->progressbar->setValue(0);
+    this->progressLabel = new QLabel(progressContainer);
+    this->progressLabel->setWordWrap(true);
+    this->progressLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    this->report = new QPlainTextEdit(progressContainer);
+    this->report->setReadOnly(true);
+    this->report->setFont(QFont("DejaVu Sans Mono"));
+
+    progressLayout->addWidget(this->progressbar);
+    progressLayout->addWidget(this->progressLabel);
+    progressLayout->addWidget(this->report);
+    mainLayout->addWidget(progressContainer, 1);
+
+    QWidget *buttonContainer = new QWidget(this);
+    QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+    this->startButton = new QPushButton(tr("Start"), this);
+    this->stopButton = new QPushButton(tr("Stop"), this);
+    QPushButton *closeButton = new QPushButton(tr("Close"), this);
+    buttonLayout->addWidget(this->startButton, 0, Qt::AlignRight);
+    buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+    buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+    buttonLayout->setAlignment(Qt::AlignRight);
+    buttonLayout->setContentsMargins(0, 0, 0, 0);
+    this->stopButton->hide();
+
+    mainLayout->addWidget(buttonContainer);
+
+    this->setCentralWidget(mainContainer);
+    this->resize(800, 700);
+
+    this->timer = new QTimer(this);
+
+    // Events
+    connect(browseButton, SIGNAL(released()), SLOT(handleBrowseCsvFile()));
+    connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+    connect(this->startButton, SIGNAL(released()), SLOT(handleStart()));
+    connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+    connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+}
+
+void BenchmarkWindow::handleBrowseCsvFile()
+{
+    QString file = QFileDialog::getOpenFileName(this, tr("Open CSV file"), QString(), tr("CSV files (*.csv);;All files (*)"));
+    if (!file.isEmpty()) {
+        this->csvFilePath->setText(file);
+    }
+}
+
+/**
+ * Starts the benchmark in a background thread, which starts the workers
+ * @brief BenchmarkWindow::handleStart
+ */
+void BenchmarkWindow::handleStart()
+{
+    QString query = this->statementText->toPlainText().trimmed();
+    if (query.isEmpty()) {
+        QMessageBox::warning(this, "", tr("The statement is empty"));
+        return;
+    }
+
+    this->benchmarkWorker = new Util::QueryBenchmark(this->connection, query);
+    this->benchmarkWorker->setConcurrency(this->concurrency->value());
+    this->benchmarkWorker->setWarmup(this->warmup->value());
+    if (this->limitMode->currentData().toInt() == SECONDS) {
+        this->benchmarkWorker->setDuration(this->limitValue->value());
+    } else {
+        this->benchmarkWorker->setIterations(this->limitValue->value());
+    }
+
+    QString error;
+    QString csvFile = this->csvFilePath->text().trimmed();
+    if (!csvFile.isEmpty() && !this->benchmarkWorker->setParameters(csvFile, &error)) {
+        QMessageBox::warning(this, "", error);
+        delete this->benchmarkWorker;
+        this->benchmarkWorker = nullptr;
+        return;
+    }
+
+    this->startButton->hide();
+    this->stopButton->show();
+
+    this->workerThread = new QThread();
+    this->benchmarkWorker->moveToThread(this->workerThread);
+
+    connect(this->workerThread, &QThread::finished, this->benchmarkWorker, &QObject::deleteLater);
+    connect(this->workerThread, &QThread::finished, this->workerThread, &QObject::deleteLater);
+    connect(this, SIGNAL(startBenchmark()), this->benchmarkWorker, SLOT(execute()));
+    connect(this->benchmarkWorker, SIGNAL(executionFinished(bool)), SLOT(handleBenchmarkFinished(bool)));
+
+    this->workerThread->start();
+
+    this->progressbar->setValue(0);
+    this->progressLabel->clear();
+    this->report->clear();
+    this->timer->start(200);
+
+    emit startBenchmark();
+}
+
+/**
+ * Refreshes the progress and the percentiles measured so far
+ * @brief BenchmarkWindow::handleTimer
+ */
+void BenchmarkWindow::handleTimer()
+{
+    if (this->benchmarkWorker == nullptr) {
+        return;
+    }
+
+    BenchmarkStatus status = this->benchmarkWorker->getStatus();
+    QLocale locale(QLocale::English);
+
+    if (status.warmup) {
+        int warmup = qMax(1, this->warmup->value());
+        this->progressbar->setValue(qMin(status.warmupExecutions * PROGRESS_RANGE / warmup, Q_INT64_C(PROGRESS_RANGE)));
+        this->progressLabel->setText(tr("Warmup: %1 / %2 executions").arg(locale.toString(status.warmupExecutions)).arg(locale.toString(warmup)));
+        return;
+    }
+
+    qint64 done = status.executions + status.errors;
+    qint64 total = this->limitValue->value();
+    if (this->limitMode->currentData().toInt() == SECONDS) {
+        done = status.elapsedMsec;
+        total *= 1000;
+    }
+    this->progressbar->setValue(qMin(done * PROGRESS_RANGE / total, Q_INT64_C(PROGRESS_RANGE)));
+
+    QString text = tr("%1 executions, %2 errors, %3 s")
+            .arg(locale.toString(status.executions))
+            .arg(locale.toString(status.errors))
+            .arg(locale.toString(status.elapsedMsec / 1000.0, 'f', 1));
+    if (!status.lastError.isEmpty()) {
+        text += "\n" + tr("Last error: %1").arg(status.lastError);
+    }
+
+    this->progressLabel->setText(text);
+    this->report->setPlainText(this->formatReport(status));
+}
+
+/**
+ * @return the throughput and the latency percentiles
+ */
+QString BenchmarkWindow::formatReport(BenchmarkStatus status)
+{
+    QLocale locale(QLocale::English);
+    Util::LatencyHistogram histogram = status.histogram;
+    double seconds = status.elapsedMsec / 1000.0;
+
+    QStringList lines;
+    lines << QString(tr("Concurrency:   %1")).arg(this->concurrency->value());
+    lines << QString(tr("Executions:    %1 (+ %2 warmup)")).arg(locale.toString(status.executions)).arg(locale.toString(status.warmupExecutions));
+    lines << QString(tr("Errors:        %1")).arg(locale.toString(status.errors));
+    lines << QString(tr("Duration:      %1 s")).arg(locale.toString(seconds, 'f', 2));
+    lines << QString(tr("Throughput:    %1 queries/s")).arg(locale.toString(seconds > 0 ? status.executions / seconds : 0.0, 'f', 1));
+    lines << "";
+    lines << tr("Latency (ms)");
+    lines << QString(tr("  min:  %1")).arg(locale.toString(histogram.min() / 1000.0, 'f', 3));
+    lines << QString(tr("  mean: %1")).arg(locale.toString(histogram.mean() / 1000.0, 'f', 3));
+    lines << QString(tr("  p50:  %1")).arg(locale.toString(histogram.valueAtPercentile(50) / 1000.0, 'f', 3));
+    lines << QString(tr("  p90:  %1")).arg(locale.toString(histogram.valueAtPercentile(90) / 1000.0, 'f', 3));
+    lines << QString(tr("  p99:  %1")).arg(locale.toString(histogram.valueAtPercentile(99) / 1000.0, 'f', 3));
+    lines << QString(tr("  max:  %1")).arg(locale.toString(histogram.max() / 1000.0, 'f', 3));
+
+    if (!status.lastError.isEmpty()) {
+        lines << "" << QString(tr("Last error: %1")).arg(status.lastError);
+    }
+
+    return lines.join("\n");
+}
+
+/**
+ * Called when all the workers have finished
+ * @brief BenchmarkWindow::handleBenchmarkFinished
+ * @param stopped true when the user has stopped the benchmark
+ */
+void BenchmarkWindow::handleBenchmarkFinished(bool stopped)
+{
+    this->timer->stop();
+    BenchmarkStatus status = this->benchmarkWorker->getStatus();
+
+    this->progressbar->setValue(stopped ? this->progressbar->value() : PROGRESS_RANGE);
+    this->progressLabel->setText(stopped ? tr("Stopped") : tr("Finished"));
+    this->report->setPlainText(this->formatReport(status));
+
+    // The worker is deleted with its thread
+    this->workerThread->quit();
+    this->workerThread = nullptr;
+    this->benchmarkWorker = nullptr;
+    this->startButton->show();
+    this->stopButton->hide();
+}
+
+/**
+ * The workers stop after their current execution
+ * @brief BenchmarkWindow::handleStop
+ */
+void BenchmarkWindow::handleStop()
+{
+    if (this->benchmarkWorker != nullptr) {
+        this->benchmarkWorker->stopRequired();
+    }
+}
+
+void BenchmarkWindow::handleClose()
+{
+    this->handleStop();
+    this->close();
+}
+
+BenchmarkWindow::~BenchmarkWindow()
+{
+    if (this->benchmarkWorker != nullptr) {
+        // The thread ends with the benchmark
+        connect(this->benchmarkWorker, SIGNAL(executionFinished(bool)), this->workerThread, SLOT(quit()));
+        this->benchmarkWorker->stopRequired();
+    }
+}
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef UI_EXPLORER_TABS_QUERY_BENCHMARKWINDOW_H_
+#define UI_EXPLORER_TABS_QUERY_BENCHMARKWINDOW_H_
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include "Util/DataBase.h"
+#include "Util/QueryBenchmark.h"
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+/**
+ * Executes a statement many times at a given concurrency and shows its latency percentiles
+ */
+class BenchmarkWindow : public QMainWindow
+{
+    Q_OBJECT
+public:
+    explicit BenchmarkWindow(QWidget *parent, ConnectionConfiguration connection, QString query);
+    virtual ~BenchmarkWindow();
+
+private:
+    enum LimitMode {
+        EXECUTIONS,
+        SECONDS
+    };
+
+    ConnectionConfiguration connection;
+    QThread *workerThread = nullptr;
+    Util::QueryBenchmark *benchmarkWorker = nullptr;
+    QPlainTextEdit *statementText;
+    QSpinBox *concurrency;
+    QComboBox *limitMode;
+    QSpinBox *limitValue;
+    QSpinBox *warmup;
+    QLineEdit *csvFilePath;
+    QPushButton *startButton;
+    QPushButton *stopButton;
+    QProgressBar *progressbar;
+    QLabel *progressLabel;
+    QPlainTextEdit *report;
+    QTimer *timer;
+
+    QString formatReport(BenchmarkStatus status);
+
+signals:
+    void startBenchmark();
+
+public slots:
+    void handleStart();
+    void handleStop();
+    void handleClose();
+    void handleBrowseCsvFile();
+    void handleBenchmarkFinished(bool stopped);
+    void handleTimer();
+};
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
+
+#endif /* UI_EXPLORER_TABS_QUERY_BENCHMARKWINDOW_H_ */
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ExplainView.h"
+#include <QHeaderView>
+#include <QLocale>
+#include <QColor>
+
+// The columns of the tree
+#define COLUMN_OPERATION 0
+#define COLUMN_TABLE 1
+#define COLUMN_ACCESS 2
+#define COLUMN_KEY 3
+#define COLUMN_ROWS 4
+#define COLUMN_COST 5
+#define COLUMN_ACTUAL_ROWS 6
+#define COLUMN_ACTUAL_TIME 7
+#define COLUMN_LOOPS 8
+#define COLUMN_FLAGS 9
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+ExplainView::ExplainView(QWidget *parent) : QTreeView(parent)
+{
+    this->warnings = 0;
+    this->model = new QStandardItemModel(this);
+    this->model->setHorizontalHeaderLabels(QStringList() << tr("Operation") << tr("Table") << tr("Access") << tr("Key")
+                                           << tr("Rows") << tr("Cost") << tr("Actual rows") << tr("Actual time (ms)")
+                                           << tr("Loops") << tr("Extra"));
+
+    this->setModel(this->model);
+    this->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->setAlternatingRowColors(true);
+    this->setColumnWidth(COLUMN_OPERATION, 350);
+}
+
+/**
+ * @brief ExplainView::setPlan
+ * @param plan the root of the plan
+ * @param analyze true for the plan of EXPLAIN ANALYZE, with the measures of the execution
+ */
+void ExplainView::setPlan(ExplainNode plan, bool analyze)
+{
+    this->warnings = 0;
+    this->model->removeRows(0, this->model->rowCount());
+
+    foreach (ExplainNode node, plan.children) {
+        this->appendNode(this->model->invisibleRootItem(), node);
+    }
+
+    this->setColumnHidden(COLUMN_ACTUAL_ROWS, !analyze);
+    this->setColumnHidden(COLUMN_ACTUAL_TIME, !analyze);
+    this->setColumnHidden(COLUMN_LOOPS, !analyze);
+
+    this->expandAll();
+    for (int i = COLUMN_TABLE; i < COLUMN_FLAGS; i++) {
+        this->resizeColumnToContents(i);
+    }
+}
+
+/**
+ * @return the number of full scans and bad joins found in the plan
+ */
+int ExplainView::warningCount() const
+{
+    return this->warnings;
+}
+
+void ExplainView::appendNode(QStandardItem *parent, ExplainNode node)
+{
+    QLocale locale(QLocale::English);
+    QList<QStandardItem *> columns;
+    for (int i = 0; i <= COLUMN_FLAGS; i++) {
+        columns << new QStandardItem();
+    }
+
+    columns.at(COLUMN_OPERATION)->setText(node.operation);
+    columns.at(COLUMN_TABLE)->setText(node.table);
+    columns.at(COLUMN_ACCESS)->setText(node.accessType);
+    columns.at(COLUMN_KEY)->setText(node.key);
+    if (node.rows >= 0) {
+        columns.at(COLUMN_ROWS)->setText(locale.toString(node.rows, 'f', 0));
+    }
+    if (node.cost >= 0) {
+        columns.at(COLUMN_COST)->setText(locale.toString(node.cost, 'f', 2));
+    }
+    if (node.actualRows >= 0) {
+        columns.at(COLUMN_ACTUAL_ROWS)->setText(locale.toString(node.actualRows, 'f', 0));
+        columns.at(COLUMN_ACTUAL_TIME)->setText(locale.toString(node.actualMsec, 'f', 3));
+        columns.at(COLUMN_LOOPS)->setText(locale.toString(node.loops));
+    }
+    columns.at(COLUMN_FLAGS)->setText(node.flags.join(", "));
+
+    for (int i = COLUMN_ROWS; i <= COLUMN_LOOPS; i++) {
+        columns.at(i)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    QString toolTip = node.condition.isEmpty() ? node.operation : node.operation + "\n" + tr("Condition: %1").arg(node.condition);
+    if (!node.warning.isEmpty()) {
+        // A full scan in a join is worse than a single full scan
+        QColor color = node.loops > 1 || node.warning.contains("join") ? QColor(255, 180, 180) : QColor(255, 225, 180);
+        foreach (QStandardItem *item, columns) {
+            item->setBackground(color);
+        }
+
+        toolTip = node.warning + "\n" + toolTip;
+        this->warnings++;
+    }
+
+    foreach (QStandardItem *item, columns) {
+        item->setToolTip(toolTip);
+    }
+
+    parent->appendRow(columns);
+
+    foreach (ExplainNode child, node.children) {
+        this->appendNode(columns.first(), child);
+    }
+}
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
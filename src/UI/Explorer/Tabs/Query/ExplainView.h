@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef EXPLAINVIEW_H
+#define EXPLAINVIEW_H
+
+#include <QTreeView>
+#include <QStandardItemModel>
+#include "Util/ExplainPlan.h"
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+/**
+ * Shows a query plan as a tree, the full scans of the large tables are highlighted
+ */
+class ExplainView : public QTreeView
+{
+    Q_OBJECT
+public:
+    explicit ExplainView(QWidget *parent = 0);
+    void setPlan(ExplainNode plan, bool analyze);
+    int warningCount() const;
+
+private:
+    QStandardItemModel *model;
+    int warnings;
+
+    void appendNode(QStandardItem *parent, ExplainNode node);
+};
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
+#endif // EXPLAINVIEW_H
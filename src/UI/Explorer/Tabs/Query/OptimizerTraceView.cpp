@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "OptimizerTraceView.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFont>
+#include <QColor>
+
+// The columns of the tree
+#define COLUMN_KEY 0
+#define COLUMN_VALUE 1
+#define COLUMN_COST 2
+#define COLUMN_ROWS 3
+#define COLUMN_CHOSEN 4
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+OptimizerTraceView::OptimizerTraceView(QString query, QString trace, QString warning, QWidget *parent) :
+    QWidget(parent),
+    trace(trace)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 5, 0, 0);
+
+    QWidget *headerContainer = new QWidget(this);
+    QHBoxLayout *headerLayout = new QHBoxLayout(headerContainer);
+    headerLayout->setContentsMargins(5, 0, 5, 0);
+
+    QLabel *queryLabel = new QLabel(this);
+    queryLabel->setText(QString(query).simplified().left(200));
+    queryLabel->setToolTip(query);
+    headerLayout->addWidget(queryLabel, 1);
+
+    QPushButton *exportButton = new QPushButton(tr("Export..."), this);
+    exportButton->setEnabled(!trace.isEmpty());
+    headerLayout->addWidget(exportButton);
+    layout->addWidget(headerContainer);
+
+    if (!warning.isEmpty()) {
+        QLabel *warningLabel = new QLabel(warning, this);
+        warningLabel->setStyleSheet("color: #c00000; padding-left: 5px;");
+        layout->addWidget(warningLabel);
+    }
+
+    this->model = new QStandardItemModel(this);
+    this->model->setHorizontalHeaderLabels(QStringList() << tr("Step") << tr("Value") << tr("Cost") << tr("Rows") << tr("Chosen"));
+
+    this->tree = new QTreeView(this);
+    this->tree->setModel(this->model);
+    this->tree->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->tree->setColumnWidth(COLUMN_KEY, 400);
+    this->tree->setColumnWidth(COLUMN_VALUE, 300);
+    layout->addWidget(this->tree);
+
+    QFont font;
+    font.setBold(true);
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(trace.toUtf8(), &parseError);
+    if (document.isNull()) {
+        QStandardItem *errorItem = new QStandardItem(QString(tr("The trace cannot be read: %1")).arg(parseError.errorString()));
+        this->model->invisibleRootItem()->appendRow(errorItem);
+    } else {
+        QJsonValue root = document.isObject() ? QJsonValue(document.object()) : QJsonValue(document.array());
+
+        // The decisions of the optimizer, each section with its place in the trace
+        QStandardItem *focusItem = new QStandardItem(tr("Range analysis and considered plans"));
+        focusItem->setFont(font);
+        this->model->invisibleRootItem()->appendRow(focusItem);
+        this->appendFocusedSections(focusItem, root, QStringList());
+
+        QStandardItem *traceItem = new QStandardItem(tr("Full trace"));
+        traceItem->setFont(font);
+        this->model->invisibleRootItem()->appendRow(traceItem);
+        this->appendValue(traceItem, "trace", root);
+
+        this->tree->expand(focusItem->index());
+        for (int i = 0; i < focusItem->rowCount(); i++) {
+            this->tree->expand(focusItem->child(i)->index());
+        }
+    }
+
+    connect(exportButton, SIGNAL(released()), SLOT(handleExport()));
+}
+
+/**
+ * Saves the trace as it is given by the server, to share it or to open it in other tools
+ * @brief OptimizerTraceView::handleExport
+ */
+void OptimizerTraceView::handleExport()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export the optimizer trace"), "optimizer_trace.json", tr("JSON files (*.json)"));
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(this->trace.toUtf8()) == -1) {
+        QMessageBox::warning(this, "", file.errorString());
+    }
+}
+
+/**
+ * Adds a value of the trace, the objects and the arrays are added with their content
+ */
+void OptimizerTraceView::appendValue(QStandardItem *parent, QString key, QJsonValue value)
+{
+    QList<QStandardItem *> columns;
+    for (int i = 0; i <= COLUMN_CHOSEN; i++) {
+        columns << new QStandardItem();
+    }
+    columns.at(COLUMN_KEY)->setText(key);
+
+    if (value.isObject()) {
+        QJsonObject object = value.toObject();
+
+        // The summary of a step: its cost, its rows and if it is chosen
+        QJsonValue cost = object.contains("cost") ? object.value("cost") : object.value("cost_for_plan");
+        QJsonValue rows = object.contains("rows") ? object.value("rows") : object.contains("rows_for_plan") ? object.value("rows_for_plan") : object.value("rows_to_scan");
+        if (!cost.isUndefined()) {
+            columns.at(COLUMN_COST)->setText(cost.toVariant().toString());
+        }
+        if (!rows.isUndefined()) {
+            columns.at(COLUMN_ROWS)->setText(rows.toVariant().toString());
+        }
+        if (object.value("chosen").isBool()) {
+            bool chosen = object.value("chosen").toBool();
+            columns.at(COLUMN_CHOSEN)->setText(chosen ? tr("yes") : tr("no"));
+            foreach (QStandardItem *item, columns) {
+                if (chosen) {
+                    item->setBackground(QColor(200, 240, 200));
+                } else {
+                    item->setForeground(QColor(128, 128, 128));
+                }
+            }
+        }
+
+        foreach (QString name, object.keys()) {
+            this->appendValue(columns.first(), name, object.value(name));
+        }
+    } else if (value.isArray()) {
+        QJsonArray array = value.toArray();
+        columns.at(COLUMN_VALUE)->setText(QString("[%1]").arg(array.size()));
+        for (int i = 0; i < array.size(); i++) {
+            QString label = this->labelOf(array.at(i));
+            this->appendValue(columns.first(), label.isEmpty() ? QString("[%1]").arg(i) : label, array.at(i));
+        }
+    } else {
+        columns.at(COLUMN_VALUE)->setText(value.toVariant().toString());
+        columns.at(COLUMN_VALUE)->setToolTip(value.toVariant().toString());
+    }
+
+    columns.at(COLUMN_COST)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    columns.at(COLUMN_ROWS)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    parent->appendRow(columns);
+}
+
+/**
+ * Looks for the sections about the choice of the plan, they are added with their path
+ */
+void OptimizerTraceView::appendFocusedSections(QStandardItem *parent, QJsonValue value, QStringList path)
+{
+    static QStringList sections = QStringList() << "range_analysis" << "considered_execution_plans"
+                                                << "reconsidering_access_paths_for_index_ordering";
+
+    if (value.isObject()) {
+        QJsonObject object = value.toObject();
+        foreach (QString name, object.keys()) {
+            if (sections.contains(name)) {
+                this->appendValue(parent, (path + QStringList(name)).join(" > "), object.value(name));
+            } else {
+                this->appendFocusedSections(parent, object.value(name), path + QStringList(name));
+            }
+        }
+    } else if (value.isArray()) {
+        QJsonArray array = value.toArray();
+        for (int i = 0; i < array.size(); i++) {
+            // The steps are objects with one key, their name is enough
+            QString label = this->labelOf(array.at(i));
+            bool step = array.at(i).isObject() && array.at(i).toObject().size() == 1;
+            this->appendFocusedSections(parent, array.at(i), step ? path : path + QStringList(label.isEmpty() ? QString("[%1]").arg(i) : label));
+        }
+    }
+}
+
+/**
+ * @return the name of an element of an array: its table, its index... or its key if it is alone
+ */
+QString OptimizerTraceView::labelOf(QJsonValue value)
+{
+    static QStringList names = QStringList() << "table" << "select#" << "index" << "access_type" << "plan_prefix" << "database";
+
+    QJsonObject object = value.toObject();
+    foreach (QString name, names) {
+        if (object.contains(name) && !object.value(name).isObject() && !object.value(name).isArray()) {
+            return name + " " + object.value(name).toVariant().toString();
+        }
+    }
+
+    if (object.size() == 1) {
+        return object.keys().first();
+    }
+
+    return "";
+}
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
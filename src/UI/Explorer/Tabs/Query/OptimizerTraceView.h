@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef OPTIMIZERTRACEVIEW_H
+#define OPTIMIZERTRACEVIEW_H
+
+#include <QWidget>
+#include <QTreeView>
+#include <QStandardItemModel>
+#include <QJsonValue>
+#include <QJsonObject>
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+/**
+ * Shows an optimizer trace as a tree. The sections which explain the choice of the plan
+ * (range analysis, considered plans with their costs) are shown first, the whole trace is
+ * available below them and can be exported as it is given by the server.
+ */
+class OptimizerTraceView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit OptimizerTraceView(QString query, QString trace, QString warning, QWidget *parent = 0);
+
+public slots:
+    void handleExport();
+
+private:
+    QString trace;
+    QTreeView *tree;
+    QStandardItemModel *model;
+
+    void appendValue(QStandardItem *parent, QString key, QJsonValue value);
+    void appendFocusedSections(QStandardItem *parent, QJsonValue value, QStringList path);
+    QString labelOf(QJsonValue value);
+};
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
+#endif // OPTIMIZERTRACEVIEW_H
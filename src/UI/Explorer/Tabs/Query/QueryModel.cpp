@@ -24,21 +24,119 @@
 #include <QFont>
 #include <QDateTime>
 
+// Rows asked to the query thread each time the view reaches the last row
+#define FETCH_BATCH_SIZE 1000
+// Converted cells kept by the model, a few screens of the view
+#define CELL_CACHE_SIZE 4096
+
 namespace UI {
 namespace Explorer {
 namespace Tabs {
 namespace Query {
 
-QueryModel::QueryModel(QList<QSqlRecord> data, QObject * parent) : QAbstractTableModel(parent) {
+QueryModel::QueryModel(Util::ResultSet data, QObject * parent) : QAbstractTableModel(parent) {
     this->records = data;
+    this->fetching = false;
+    this->finished = true;
+    this->limited = false;
+    this->cells.setMaxCost(CELL_CACHE_SIZE);
+}
+
+/**
+ * The next rows of the result are read by the query thread when the view needs them
+ * @brief QueryModel::setStream
+ * @param worker the thread with the streamed result
+ */
+void QueryModel::setStream(QueryThread *worker)
+{
+    this->stream = worker;
+    this->finished = false;
+    connect(worker, SIGNAL(rowsFetched(Util::ResultSet,bool,bool,QString)), this, SLOT(handleRowsFetched(Util::ResultSet,bool,bool,QString)));
+}
+
+/**
+ * @brief QueryModel::isLimited
+ * @return true if the streamed result has been stopped by the memory limit
+ */
+bool QueryModel::isLimited() const
+{
+    return this->limited;
+}
+
+/**
+ * @brief QueryModel::lastError
+ * @return the error which has ended the streamed result, empty if the result is complete
+ */
+QString QueryModel::lastError() const
+{
+    return this->error;
+}
+
+bool QueryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !this->finished && !this->stream.isNull();
+}
+
+void QueryModel::fetchMore(const QModelIndex &parent)
+{
+    if (!this->canFetchMore(parent) || this->fetching) {
+        return;
+    }
+
+    this->fetching = true;
+    this->stream->fetchMore(FETCH_BATCH_SIZE);
+}
+
+/**
+ * Appends the rows read by the query thread
+ * @brief QueryModel::handleRowsFetched
+ * @param rows the new rows
+ * @param finished true when there is no more row to read
+ * @param limited true when the memory limit is reached
+ * @param error the error which has ended the result, the rows read before are kept
+ */
+void QueryModel::handleRowsFetched(Util::ResultSet rows, bool finished, bool limited, QString error)
+{
+    if (!rows.isEmpty()) {
+        beginInsertRows(QModelIndex(), this->records.rowCount(), this->records.rowCount() + rows.rowCount() - 1);
+        this->records.append(rows);
+        endInsertRows();
+    }
+
+    this->fetching = false;
+    this->finished = finished;
+    this->limited = limited;
+    this->error = error;
+
+    emit rowsFetched();
 }
 
+/**
+ * The cells are converted from the bytes of the result when the view displays them, the
+ * last converted cells are kept as the view asks the same cell for each role
+ * @brief QueryModel::cellValue
+ * @param row the row number
+ * @param column the column number
+ * @return the value of the cell
+ */
+QVariant QueryModel::cellValue(int row, int column) const
+{
+    quint64 key = (quint64(row) << 32) | quint32(column);
+    QVariant *cached = this->cells.object(key);
+    if (cached != nullptr) {
+        return *cached;
+    }
+
+    QVariant value = this->records.value(row, column);
+    this->cells.insert(key, new QVariant(value));
+
+    return value;
+}
 
 QVariant QueryModel::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < this->records.size()) {
-        QSqlRecord record = this->records.at(index.row());
-        QVariant value = record.value(index.column());
+    if (index.row() < this->records.rowCount()) {
+        QVariant value = this->cellValue(index.row(), index.column());
 
         if (value.isNull() && role == Qt::DisplayRole) {
                 return QVariant("(NULL)");
@@ -66,23 +164,18 @@ QVariant QueryModel::data(const QModelIndex &index, int role) const
 
 int QueryModel::rowCount(const QModelIndex & parent) const
 {
-    return this->records.size();
+    return this->records.rowCount();
 }
 
 int QueryModel::columnCount(const QModelIndex & parent) const
 {
-    if (this->records.isEmpty()) {
-        return 0;
-    } else {
-        return this->records.at(0).count();
-    }
+    return this->records.columnCount();
 }
 
 QVariant QueryModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
-    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && !this->records.isEmpty()) {
-        QSqlRecord r = this->records.at(0);
-        return r.fieldName(section);
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        return this->records.fieldName(section);
     }
 
     return QVariant();
@@ -90,7 +183,10 @@ QVariant QueryModel::headerData(int section, Qt::Orientation orientation, int ro
 
 QueryModel::~QueryModel() {
 
-    this->records.clear();
+    // The rows not read are skipped by the query thread
+    if (!this->finished && !this->stream.isNull()) {
+        this->stream->stopStreaming();
+    }
 }
 
 } /* namespace Query */
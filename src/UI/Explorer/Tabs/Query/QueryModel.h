@@ -20,6 +20,9 @@
 
 #include <QAbstractTableModel>
 #include <QSqlRecord>
+#include <QPointer>
+#include <QCache>
+#include "QueryThread.h"
 
 namespace UI {
 namespace Explorer {
@@ -31,15 +34,34 @@ class QueryModel: public QAbstractTableModel {
 	Q_OBJECT
 
 public:
-    QueryModel(QList<QSqlRecord> data, QObject * parent = 0);
+    QueryModel(Util::ResultSet data, QObject * parent = 0);
 	virtual ~QueryModel();
+    void setStream(QueryThread *worker);
+    bool isLimited() const;
+    QString lastError() const;
     QVariant data(const QModelIndex &index, int role) const;
     int rowCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
     int columnCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    bool canFetchMore(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex &parent) Q_DECL_OVERRIDE;
+
+public slots:
+    void handleRowsFetched(Util::ResultSet rows, bool finished, bool limited, QString error);
+
+signals:
+    void rowsFetched();
 
 private:
-    QList<QSqlRecord> records;
+    Util::ResultSet records;
+    mutable QCache<quint64, QVariant> cells;
+    QPointer<QueryThread> stream;
+    bool fetching;
+    bool finished;
+    bool limited;
+    QString error;
+
+    QVariant cellValue(int row, int column) const;
 };
 
 } /* namespace Query */
@@ -30,8 +30,19 @@
 #include <QShortcut>
 #include <QJsonObject>
 #include <QSqlRecord>
+#include <QLabel>
+#include <QStandardItemModel>
+#include <QStyle>
+#include <QSettings>
+#include <algorithm>
 #include "QueryModel.h"
 #include "ResultTableView.h"
+#include "ExplainView.h"
+#include "OptimizerTraceView.h"
+#include "BenchmarkWindow.h"
+#include "VariantComparisonWindow.h"
+#include "Util/SqlSplitter.h"
+#include "UI/History/PlanDiffView.h"
 
 namespace UI {
 namespace Explorer {
@@ -41,7 +52,12 @@ namespace Query {
 QueryTab::QueryTab(QWidget *parent) : QSplitter(parent) {
 
     // Defines a new type for the SIGNAL
-    qRegisterMetaType< QList<QueryExecutionResult> >("QList<QueryExecutionResult>");
+    qRegisterMetaType<QueryExecutionResult>("QueryExecutionResult");
+    qRegisterMetaType<QueryProfile>("QueryProfile");
+    qRegisterMetaType<Util::ResultSet>("Util::ResultSet");
+    this->killMsec = -1;
+    this->explainMode = NO_EXPLAIN;
+    this->cacheOwner = QUuid::createUuid().toString();
 
     // Horizontal split
 	this->setOrientation(Qt::Vertical);
@@ -78,14 +94,85 @@ QueryTab::QueryTab(QWidget *parent) : QSplitter(parent) {
 	this->stopButton->setEnabled(false);
 	buttonLayout->addWidget(this->stopButton);
 
+    // Plan of the statement under the cursor
+    this->explainButton = new QPushButton(tr("Explain"), this);
+    this->explainButton->setToolTip(tr("Shows the plan of the current statement (EXPLAIN FORMAT=JSON)"));
+    this->explainButton->setFixedHeight(30);
+    buttonLayout->addWidget(this->explainButton);
+
+    this->analyzeCheckbox = new QCheckBox(tr("Analyze"), this);
+    this->analyzeCheckbox->setToolTip(tr("Uses EXPLAIN ANALYZE (MySQL 8.0.18): the query is executed to measure each step"));
+    buttonLayout->addWidget(this->analyzeCheckbox);
+
+    this->traceCheckbox = new QCheckBox(tr("Optimizer trace"), this);
+    this->traceCheckbox->setToolTip(tr("Executes the statements with the optimizer trace, the results are limited to 1,000 rows"));
+    buttonLayout->addWidget(this->traceCheckbox);
+
+    // The results of the read-only queries are shown again without executing them
+    QSettings settings("smartarello", "mysqlclient");
+    this->cacheCheckbox = new QCheckBox(tr("Cache results"), this);
+    this->cacheCheckbox->setToolTip(QString(tr("Shows again the result of a read-only query executed in the last %1 seconds, without executing it. "
+                                               "The results are removed when the client modifies the data"))
+                                    .arg(Util::ResultCache::instance()->ttlSeconds()));
+    this->cacheCheckbox->setChecked(settings.value("resultCache/enabled", false).toBool());
+    buttonLayout->addWidget(this->cacheCheckbox);
+
+    this->clearCacheButton = new QPushButton(tr("Clear cache"), this);
+    this->clearCacheButton->setToolTip(tr("Removes the cached results of all the sessions"));
+    this->clearCacheButton->setFixedHeight(30);
+    buttonLayout->addWidget(this->clearCacheButton);
+
+    this->benchmarkButton = new QPushButton(tr("Benchmark"), this);
+    this->benchmarkButton->setToolTip(tr("Executes the current statement many times on several connections to measure its latency"));
+    this->benchmarkButton->setFixedHeight(30);
+    buttonLayout->addWidget(this->benchmarkButton);
+
+    this->variantsButton = new QPushButton(tr("Compare variants"), this);
+    this->variantsButton->setToolTip(tr("Executes the statements of the editor alternately to know which one is the fastest"));
+    this->variantsButton->setFixedHeight(30);
+    buttonLayout->addWidget(this->variantsButton);
+
+    // Comparison of the result with another session
+    buttonLayout->addSpacing(20);
+    buttonLayout->addWidget(new QLabel(tr("Compare with:"), this));
+
+    this->compareSession = new QComboBox(this);
+    this->compareSession->setToolTip(tr("Executes the query on both sessions and compares the results"));
+    this->compareSession->addItem(tr("(no comparison)"));
+    this->sessions = Util::DataBase::getSessions();
+    for (int i = 0; i < this->sessions.count(); i++) {
+        this->compareSession->addItem(QIcon(":/resources/icons/database-server-icon.png"), this->sessions.at(i).toObject().value("name").toString());
+    }
+    buttonLayout->addWidget(this->compareSession);
+
+    this->orderedCompare = new QCheckBox(tr("Same row order"), this);
+    this->orderedCompare->setToolTip(tr("The rows must be returned in the same order on both sessions"));
+    this->orderedCompare->setEnabled(false);
+    buttonLayout->addWidget(this->orderedCompare);
+
+    // Progress of the scripts
+    buttonLayout->addSpacing(20);
+    this->statusLabel = new QLabel(this);
+    buttonLayout->addWidget(this->statusLabel);
+
 	topLayout->addWidget(buttonContainer);
 
     // Tabs container to display the query results
     // Several queries can be played with the same editor
-	this->queryTabs = new QTabWidget(this);
+	QSplitter *resultSplitter = new QSplitter(Qt::Horizontal, this);
+	this->queryTabs = new QTabWidget(resultSplitter);
+
+    // Execution profile of the selected result
+    this->profileText = new QTextEdit(resultSplitter);
+    this->profileText->setReadOnly(true);
+    this->profileText->setFontFamily("DejaVu Sans Mono");
+
+    resultSplitter->addWidget(this->queryTabs);
+    resultSplitter->addWidget(this->profileText);
+    resultSplitter->setSizes(QList<int>() << 400 << 150);
 
 	this->addWidget(topPart);
-	this->addWidget(this->queryTabs);
+	this->addWidget(resultSplitter);
 
     // Proportion between the query editor and the tabs for the results
 	QList<int> sizes;
@@ -98,11 +185,36 @@ QueryTab::QueryTab(QWidget *parent) : QSplitter(parent) {
 	connect(this->queryTextEdit, SIGNAL (queryChanged()), this, SLOT (queryChanged()));
 	connect(this->executeButton, SIGNAL (clicked(bool)), this, SLOT (queryChanged()));
 	connect(this->stopButton, SIGNAL (clicked(bool)), this, SLOT (stopQueries()));
+	connect(this->explainButton, SIGNAL (clicked(bool)), this, SLOT (explainQuery()));
+	connect(this->benchmarkButton, SIGNAL (clicked(bool)), this, SLOT (benchmarkQuery()));
+	connect(this->variantsButton, SIGNAL (clicked(bool)), this, SLOT (compareVariants()));
+    connect(this->queryTabs, SIGNAL (currentChanged(int)), this, SLOT (showProfile()));
+    connect(this->compareSession, SIGNAL (currentIndexChanged(int)), this, SLOT (compareSessionChanged(int)));
+    connect(this->cacheCheckbox, SIGNAL (toggled(bool)), this, SLOT (cacheToggled(bool)));
+    connect(this->clearCacheButton, SIGNAL (clicked(bool)), this, SLOT (clearCache()));
 }
 
 void QueryTab::stopQueries()
 {
-    this->queryWorker->killQuery();
+    if (this->compareWorker != nullptr) {
+        // The comparison ends when the rows being read are hashed
+        this->compareWorker->stopRequired();
+        return;
+    }
+
+    if (!this->queryWorker.isNull()) {
+        bool executing = !this->executeButton->isEnabled();
+        this->queryWorker->stopStreaming();
+
+        // The time until the thread gives the control back is shown when the execution ends
+        this->cancelTimer.start();
+        this->killMsec = executing ? this->queryWorker->killQuery() : -1;
+        if (this->killMsec < 0) {
+            this->cancelTimer.invalidate();
+        } else {
+            this->statusLabel->setText(tr("Cancelling..."));
+        }
+    }
 	this->executeButton->setEnabled(true);
 	this->stopButton->setEnabled(false);
 }
@@ -116,84 +228,756 @@ void QueryTab::queryChanged()
 		this->executeButton->setEnabled(false);
 		this->stopButton->setEnabled(true);
 
-        // Creates the thread that will play the queries
-        this->queryWorker = new QueryThread(Util::DataBase::dumpConfiguration(), query, this);
-        // Event fire when the execution is terminated
-        connect(this->queryWorker, SIGNAL(queryResultReady(QList<QueryExecutionResult>)), this, SLOT(handleQueryResultReady(QList<QueryExecutionResult>)));
+        if (this->compareSession->currentIndex() > 0) {
+            this->startComparison(query);
+            return;
+        }
 
-        this->queryWorker->start();
+        this->executeQuery(query, NO_EXPLAIN);
 	}
 
 }
 
-void QueryTab::handleQueryResultReady(QList<QueryExecutionResult> results)
+/**
+ * Shows the plan of the selected statement, or of the statement under the cursor
+ * @brief QueryTab::explainQuery
+ */
+void QueryTab::explainQuery()
 {
-	this->executeButton->setEnabled(true);
+    QString statement = this->queryTextEdit->currentStatement();
+    if (statement.isEmpty() || !this->executeButton->isEnabled()) {
+        return;
+    }
+
+    ExplainMode mode = EXPLAIN_JSON;
+    if (this->analyzeCheckbox->isChecked()) {
+        MYSQL *mysql = Util::MySQLCursor::nativeHandle(Util::DataBase::current());
+        bool supported = mysql != nullptr && mysql_get_server_version(mysql) >= 80018 && !QString(mysql_get_server_info(mysql)).contains("MariaDB");
+
+        // EXPLAIN ANALYZE executes the statement, the statements which modify the data are not analyzed
+        bool readOnly = Util::ExplainPlan::canExplain(statement);
+
+        if (!supported) {
+            QMessageBox::warning(this, "", tr("EXPLAIN ANALYZE requires MySQL 8.0.18 or later"));
+            return;
+        } else if (!readOnly) {
+            QMessageBox::warning(this, "", tr("EXPLAIN ANALYZE executes the statement, it is only available for the queries which do not modify the data"));
+            return;
+        }
+
+        mode = EXPLAIN_ANALYZE;
+    }
+
+    this->executeButton->setEnabled(false);
+    this->stopButton->setEnabled(true);
+    this->executeQuery((mode == EXPLAIN_ANALYZE ? "EXPLAIN ANALYZE " : "EXPLAIN FORMAT=JSON ") + statement, mode);
+}
+
+/**
+ * Opens the benchmark of the selected statement, or of the statement under the cursor
+ * @brief QueryTab::benchmarkQuery
+ */
+void QueryTab::benchmarkQuery()
+{
+    BenchmarkWindow *window = new BenchmarkWindow(this, Util::DataBase::dumpConfiguration(), this->queryTextEdit->currentStatement());
+    window->show();
+}
+
+/**
+ * Opens the comparison of the statements of the editor, each statement is a variant
+ * @brief QueryTab::compareVariants
+ */
+void QueryTab::compareVariants()
+{
+    QStringList variants = Util::SqlSplitter::split(this->queryTextEdit->toPlainText());
+    if (variants.size() < 2) {
+        variants = QStringList() << this->queryTextEdit->currentStatement();
+    }
+
+    VariantComparisonWindow *window = new VariantComparisonWindow(this, Util::DataBase::dumpConfiguration(), variants.mid(0, 8));
+    window->show();
+}
+
+/**
+ * Starts the thread which executes the query, the results replace the current ones
+ * @brief QueryTab::executeQuery
+ * @param query the query or the script
+ * @param mode the kind of plan given by the query, the plans are shown as a tree
+ */
+void QueryTab::executeQuery(QString query, ExplainMode mode)
+{
+    // The previous result is not read anymore
+    if (!this->queryWorker.isNull()) {
+        this->queryWorker->stopStreaming();
+    }
+
+    // The statements of the previous execution are kept, even if their server time is not known yet
+    this->recordHistory(false);
+
+    this->queryTabs->clear();
+    this->profiles.clear();
+    this->statusLabel->setText(tr("Executing..."));
+    this->cancelTimer.invalidate();
+    this->explainMode = mode;
+
+    // The statements modifying the data remove the cached results of the session
+    ConnectionConfiguration connection = Util::DataBase::dumpConfiguration();
+    Util::ResultCache *cache = Util::ResultCache::instance();
+    this->writeStatements.clear();
+    foreach (QString statement, Util::SqlSplitter::split(query)) {
+        if (!Util::ResultCache::isReadOnly(statement)) {
+            this->writeStatements << statement;
+            cache->invalidate(connection, statement);
+        }
+    }
+
+    this->guardrails = Util::Guardrails::fromSession(Util::DataBase::currentSessionConfiguration());
+
+    bool cacheable = mode == NO_EXPLAIN && this->cacheCheckbox->isChecked() && !this->traceCheckbox->isChecked() && Util::ResultCache::isCacheable(query);
+    CachedResult cached;
+    if (cacheable && cache->lookup(connection, this->cacheOwner, query, &cached)) {
+        this->showCachedResult(query, cached);
+        return;
+    }
+    this->cacheQuery = cacheable ? query : QString();
+
+    // Creates the thread that will play the queries
+    this->queryWorker = new QueryThread(connection, query, this);
+    connect(this->queryWorker, &QThread::finished, this, &QueryTab::handleQueryThreadFinished);
+    connect(this->queryWorker, &QThread::finished, this->queryWorker, &QObject::deleteLater);
+    // Events fired for each statement and when the execution is terminated
+    connect(this->queryWorker, SIGNAL(resultReady(QueryExecutionResult,int,int)), this, SLOT(handleResultReady(QueryExecutionResult,int,int)));
+    connect(this->queryWorker, SIGNAL(executionFinished()), this, SLOT(handleExecutionFinished()));
+    connect(this->queryWorker, SIGNAL(serverProfileReady(int,QueryProfile)), this, SLOT(handleServerProfileReady(int,QueryProfile)));
+    connect(this->queryWorker, SIGNAL(optimizerTraceReady(QString,QString,QString)), this, SLOT(handleOptimizerTraceReady(QString,QString,QString)));
+    connect(this->queryWorker, SIGNAL(planReady(int,QString)), this, SLOT(handlePlanReady(int,QString)));
+    connect(this->queryWorker, SIGNAL(confirmationRequired(int,int,qint64)), this, SLOT(handleConfirmationRequired(int,int,qint64)));
+
+    // The statements which would examine too many rows are confirmed before their execution,
+    // the plans asked by the user are not
+    QueryGuardrails workerGuardrails = this->guardrails;
+    if (mode != NO_EXPLAIN) {
+        workerGuardrails.confirmRows = 0;
+    }
+
+    this->queryWorker->setOptimizerTrace(this->traceCheckbox->isChecked());
+    // The plans shown in the tab are not the plans of the queries
+    this->queryWorker->setPlanCapture(mode == NO_EXPLAIN);
+    this->queryWorker->setCacheable(cacheable);
+    this->queryWorker->setGuardrails(workerGuardrails);
+    this->queryWorker->start();
+}
+
+/**
+ * Asks for a confirmation when the plan of a SELECT statement estimates that it examines
+ * more rows than the limit of the session, the query thread waits for the answer
+ * @brief QueryTab::handleConfirmationRequired
+ */
+void QueryTab::handleConfirmationRequired(int statement, int statementCount, qint64 estimatedRows)
+{
+    QPointer<QueryThread> worker = qobject_cast<QueryThread *>(this->sender());
+    if (worker.isNull()) {
+        return;
+    }
+
+    QLocale locale(QLocale::English);
+    QString text = QString(tr("EXPLAIN estimates that statement %1 of %2 examines %3 rows, the limit of the session is %4.\n\nExecute it?"))
+            .arg(statement).arg(statementCount)
+            .arg(locale.toString(estimatedRows))
+            .arg(locale.toString(this->guardrails.confirmRows));
+    bool confirmed = QMessageBox::question(this, "", text, QMessageBox::Yes | QMessageBox::Cancel) == QMessageBox::Yes;
+
+    if (!confirmed && worker == this->queryWorker) {
+        this->statusLabel->setText(tr("Not executed"));
+    }
+
+    // The thread may have been stopped while the question was shown
+    if (!worker.isNull()) {
+        worker->confirmExecution(confirmed);
+    }
+}
+
+/**
+ * Shows the result of a previous execution of the query, the query is not executed
+ * @brief QueryTab::showCachedResult
+ */
+void QueryTab::showCachedResult(QString query, CachedResult cached)
+{
+    // The rows still streamed by the previous execution are not shown anymore
+    this->queryWorker = nullptr;
+    this->cacheQuery = QString();
+
+    QueryExecutionResult result;
+    result.data = cached.data;
+    result.msec = cached.msec;
+    result.profile = QueryProfile();
+    result.isSelect = true;
+    result.affectedRows = 0;
+    result.rows = cached.data.rowCount();
+    result.query = query;
+    result.limitedResult = false;
+    result.streaming = false;
+
+    this->showResult(result, 1);
+
+    this->statusLabel->setText(QString(tr("Result from the cache (%1 s old)")).arg(cached.cachedAt.secsTo(QDateTime::currentDateTime())));
+    this->executeButton->setEnabled(true);
     this->stopButton->setEnabled(false);
+}
 
-	this->queryTabs->clear();
-    foreach(QueryExecutionResult result, results) {
+/**
+ * Adds the tab of a result as soon as its statement is executed
+ * @brief QueryTab::handleResultReady
+ * @param result the result of the statement
+ * @param statement the number of the statement in the script, from 1
+ * @param statementCount the number of statements in the script
+ */
+void QueryTab::handleResultReady(QueryExecutionResult result, int statement, int statementCount)
+{
+    // The results of a previous execution are ignored
+    QueryThread *worker = qobject_cast<QueryThread *>(this->sender());
+    if (worker == nullptr || worker != this->queryWorker) {
+        return;
+    }
+
+    this->addHistoryEntry(result, statement);
+
+    // Only the complete results are kept, the next rows of a streamed result are not read yet
+    if (!this->cacheQuery.isEmpty() && statementCount == 1 && result.error.isEmpty() && result.isSelect
+            && !result.streaming && !result.limitedResult && (this->guardrails.rowCap == 0 || result.rows < this->guardrails.rowCap)) {
+        Util::ResultCache::instance()->insert(worker->connectionConfiguration(), this->cacheOwner, this->cacheQuery, result.data, result.msec);
+    }
+
+    if (!result.error.isEmpty() && this->cancelTimer.isValid()) {
+        // The statement interrupted by the user, the status is updated at the end of the execution
+        return;
+    } else if (!result.error.isEmpty()) {
+        this->statusLabel->setText(QString(tr("Error in statement %1 of %2")).arg(statement).arg(statementCount));
+
+        QMessageBox *message = new QMessageBox(this);
+        message->setText(result.error);
+        message->setIcon(QMessageBox::Critical);
+        message->show();
+        return ;
+    }
+
+    this->statusLabel->setText(QString(tr("Statement %1 of %2")).arg(statement).arg(statementCount));
+
+    if (this->explainMode != NO_EXPLAIN && result.isSelect && result.data.rowCount() > 0) {
+        this->showPlan(result, statement);
+        return;
+    }
+
+    this->showResult(result, statement);
+}
+
+/**
+ * Adds the tab of the rows of a result, or of the rows affected by a statement
+ * @brief QueryTab::showResult
+ */
+void QueryTab::showResult(QueryExecutionResult result, int statement)
+{
+    double seconds = result.msec / 1000.0;
+
+    if (result.isSelect) {
+        ResultTableView *tableData = new ResultTableView(this->queryTabs);
+        tableData->verticalHeader()->hide();
+
+        QShortcut* refreshShortcut = new QShortcut(QKeySequence(Qt::Key_F5), tableData);
+        refreshShortcut->setContext(Qt::WidgetShortcut);
+        connect(refreshShortcut, SIGNAL(activated()), this, SLOT(queryChanged()));
+
+        QElapsedTimer modelTimer;
+        modelTimer.start();
+        QueryModel *model = new QueryModel(result.data, this);
+
+        // The next rows are read from the query thread when the view is scrolled to the end
+        if (result.streaming) {
+            model->setStream(this->queryWorker);
+            tableData->setProperty("msec", result.msec);
+            connect(model, SIGNAL(rowsFetched()), this, SLOT(handleRowsFetched()));
+        }
+
+        tableData->setModel(model);
+
+        QString rowCount = QLocale(QLocale::English).toString(result.rows);
+
+        QString headerText = QString(tr("Result (%1 rows, %2 sec)")).arg(rowCount + (result.streaming ? "+" : "")).arg(seconds);
+        if (result.limitedResult) {
+            headerText += " " + tr("Limited to 1,000");
+        } else if (!result.streaming && this->guardrails.rowCap > 0 && result.rows >= this->guardrails.rowCap) {
+            headerText += " " + tr("Capped by the session");
+        }
+
+        this->queryTabs->addTab(tableData, headerText);
+
+        // Defines the initial column width
+        int colCount = model->columnCount();
+        for (int i = 0; i < colCount; i++) {
+            QVariant header = model->headerData(i, Qt::Horizontal, Qt::DisplayRole);
+            int size = header.toString().size() * 15;
+            if (size < 100) {
+                size = 100;
+            }
+            tableData->setColumnWidth(i, size);
+        }
+
+        result.profile.modelMsec = modelTimer.nsecsElapsed() / 1000000.0;
+        tableData->setProperty("statement", statement);
+        this->profiles.insert(tableData, result.profile);
+    }
+    else {
+        QTextEdit *resultText = new QTextEdit();
+        resultText->setFontFamily("DejaVue Sans Mono Oblique");
+        resultText->setReadOnly(true);
+
+        QString rowCount = QLocale(QLocale::English).toString(result.affectedRows);
+        QString headerText = QString(tr("Result (%1 rows, %2 sec)")).arg(rowCount).arg(seconds);
+        QString affectedRows = QString(tr("Affected rows: %1")).arg(rowCount);
+
+        resultText->setPlainText(affectedRows + "\n\n" + result.query);
+        resultText->setProperty("statement", statement);
+        this->profiles.insert(resultText, result.profile);
+        this->queryTabs->addTab(resultText, headerText);
+    }
+
+    this->showProfile();
+}
 
+/**
+ * Shows the plan given by EXPLAIN as a tree, and as it is given by the server
+ * @brief QueryTab::showPlan
+ */
+void QueryTab::showPlan(QueryExecutionResult result, int statement)
+{
+    QString text = result.data.value(0, 0).toString();
+    bool analyze = this->explainMode == EXPLAIN_ANALYZE;
+
+    QString error;
+    ExplainNode plan = analyze ? Util::ExplainPlan::fromAnalyze(text) : Util::ExplainPlan::fromJson(text, &error);
+
+    ExplainView *planView = new ExplainView(this->queryTabs);
+    planView->setPlan(plan, analyze);
+    planView->setProperty("statement", statement);
+    this->profiles.insert(planView, result.profile);
+
+    QString headerText = analyze ? tr("Plan (analyze)") : tr("Plan");
+    if (planView->warningCount() > 0) {
+        headerText += " " + QString(tr("%1 warning(s)")).arg(planView->warningCount());
+    }
+    this->queryTabs->addTab(planView, headerText);
+
+    // The plan as given by the server, to copy it in other tools
+    QTextEdit *planText = new QTextEdit();
+    planText->setFontFamily("DejaVu Sans Mono");
+    planText->setReadOnly(true);
+    planText->setPlainText(error.isEmpty() ? text : error + "\n\n" + text);
+    this->queryTabs->addTab(planText, analyze ? tr("Tree") : tr("JSON"));
+
+    this->showProfile();
+}
+
+/**
+ * Adds the tab of the optimizer trace of a statement
+ * @brief QueryTab::handleOptimizerTraceReady
+ */
+void QueryTab::handleOptimizerTraceReady(QString query, QString trace, QString warning)
+{
+    if (this->sender() != this->queryWorker) {
+        return;
+    }
 
+    OptimizerTraceView *traceView = new OptimizerTraceView(query, trace, warning, this->queryTabs);
+    this->queryTabs->addTab(traceView, tr("Optimizer trace"));
+}
+
+/**
+ * Adds the server statistics from performance_schema to the profile of the results of a statement
+ * @brief QueryTab::handleServerProfileReady
+ */
+void QueryTab::handleServerProfileReady(int statement, QueryProfile profile)
+{
+    if (this->sender() != this->queryWorker) {
+        return;
+    }
+
+    foreach (QWidget *widget, this->profiles.keys()) {
+        if (widget->property("statement").toInt() == statement) {
+            QueryProfile &result = this->profiles[widget];
+            result.serverLoaded = true;
+            result.serverMsec = profile.serverMsec;
+            result.lockMsec = profile.lockMsec;
+            result.rowsExamined = profile.rowsExamined;
+            result.rowsSent = profile.rowsSent;
+        }
+    }
+
+    if (this->historyEntries.contains(statement)) {
+        this->historyEntries[statement].serverMsec = profile.serverMsec;
+    }
+
+    this->showProfile();
+}
+
+/**
+ * Shows the time spent on the server, on the network and in the client for the selected result
+ * @brief QueryTab::showProfile
+ */
+void QueryTab::showProfile()
+{
+    QWidget *widget = this->queryTabs->currentWidget();
+    if (widget == nullptr || !this->profiles.contains(widget)) {
+        this->profileText->clear();
+        return;
+    }
+
+    QueryProfile profile = this->profiles.value(widget);
+    QLocale locale(QLocale::English);
+    QStringList lines;
+
+    lines << QString(tr("Statement %1")).arg(widget->property("statement").toInt()) << "";
+    lines << tr("Client");
+    lines << QString(tr("  Total:         %1 ms")).arg(locale.toString(profile.totalMsec, 'f', 2));
+    lines << QString(tr("  First row:     %1 ms")).arg(locale.toString(profile.firstRowMsec, 'f', 2));
+    lines << QString(tr("  Network fetch: %1 ms")).arg(locale.toString(profile.fetchMsec, 'f', 2));
+    lines << QString(tr("  Decoding:      %1 ms")).arg(locale.toString(profile.decodeMsec, 'f', 2));
+    lines << QString(tr("  Model:         %1 ms")).arg(locale.toString(profile.modelMsec, 'f', 2));
+    lines << QString(tr("  Rows read:     %1")).arg(locale.toString(profile.rowsRead));
+    lines << QString(tr("  Bytes read:    %1")).arg(locale.toString(profile.bytes));
+    lines << "";
+    lines << tr("Server (performance_schema)");
+
+    if (profile.serverLoaded) {
+        lines << QString(tr("  Execution:     %1 ms")).arg(locale.toString(profile.serverMsec, 'f', 2));
+        lines << QString(tr("  Lock wait:     %1 ms")).arg(locale.toString(profile.lockMsec, 'f', 2));
+        lines << QString(tr("  Rows examined: %1")).arg(locale.toString(profile.rowsExamined));
+        lines << QString(tr("  Rows sent:     %1")).arg(locale.toString(profile.rowsSent));
+        lines << "";
+        // What the server does not see: network, client buffering and decoding
+        lines << QString(tr("Outside the server: %1 ms")).arg(locale.toString(qMax(0.0, profile.totalMsec - profile.serverMsec), 'f', 2));
+    } else {
+        lines << tr("  Not available");
+    }
+
+    this->profileText->setPlainText(lines.join("\n"));
+}
+
+/**
+ * All the statements are executed, only the rows of the last result may still be streamed
+ * @brief QueryTab::handleExecutionFinished
+ */
+void QueryTab::handleExecutionFinished()
+{
+    if (this->sender() != this->queryWorker) {
+        return;
+    }
+
+    if (this->cancelTimer.isValid()) {
+        this->statusLabel->setText(QString(tr("Cancelled in %1 ms (KILL QUERY: %2 ms)")).arg(this->cancelTimer.elapsed()).arg(this->killMsec));
+        this->cancelTimer.invalidate();
+    }
+
+    // The other tabs may have cached results of the session during the execution
+    ConnectionConfiguration connection = this->queryWorker->connectionConfiguration();
+    foreach (QString statement, this->writeStatements) {
+        Util::ResultCache::instance()->invalidate(connection, statement);
+    }
+
+    this->executeButton->setEnabled(true);
+    this->stopButton->setEnabled(false);
+}
+
+/**
+ * The thread has read the server profiles, the statements can be written in the history
+ * @brief QueryTab::handleQueryThreadFinished
+ */
+void QueryTab::handleQueryThreadFinished()
+{
+    if (this->sender() != this->queryWorker) {
+        return;
+    }
+
+    this->recordHistory(true);
+}
+
+/**
+ * Keeps the plan of a query for the query history
+ * @brief QueryTab::handlePlanReady
+ */
+void QueryTab::handlePlanReady(int statement, QString plan)
+{
+    if (this->sender() != this->queryWorker || !this->historyEntries.contains(statement)) {
+        return;
+    }
+
+    this->historyEntries[statement].plan = plan;
+}
+
+/**
+ * Keeps a statement for the query history, a procedure gives several results for one statement
+ * @brief QueryTab::addHistoryEntry
+ */
+void QueryTab::addHistoryEntry(QueryExecutionResult result, int statement)
+{
+    if (this->historyEntries.contains(statement)) {
+        HistoryEntry &entry = this->historyEntries[statement];
+        entry.rows += result.isSelect ? result.rows : result.affectedRows;
+        entry.totalMsec += result.profile.totalMsec;
+        entry.fetchMsec += result.profile.fetchMsec;
         if (!result.error.isEmpty()) {
-			QMessageBox *message = new QMessageBox(this);
-            message->setText(result.error);
-			message->setIcon(QMessageBox::Critical);
-			message->show();
-			return ;
-		}
+            entry.error = result.error;
+        }
+        return;
+    }
+
+    ConnectionConfiguration connection = this->queryWorker->connectionConfiguration();
+
+    HistoryEntry entry;
+    entry.executedAt = QDateTime::currentDateTime();
+    entry.session = QString("%1@%2:%3").arg(connection.username).arg(connection.hostname).arg(connection.port);
+    entry.databaseName = connection.databaseName;
+    entry.query = result.query;
+    entry.totalMsec = result.profile.totalMsec;
+    entry.firstRowMsec = result.profile.firstRowMsec;
+    entry.fetchMsec = result.profile.fetchMsec;
+    entry.serverMsec = -1;
+    entry.rows = result.isSelect ? result.rows : result.affectedRows;
+    entry.error = result.error;
+
+    this->historyEntries.insert(statement, entry);
+}
 
-        double seconds = result.msec / 1000.0;
+/**
+ * Writes the statements of the last execution in the query history
+ * @brief QueryTab::recordHistory
+ * @param checkRegressions compares the statements with their previous executions, the changes are shown in a tab
+ */
+void QueryTab::recordHistory(bool checkRegressions)
+{
+    QList<int> statements = this->historyEntries.keys();
+    std::sort(statements.begin(), statements.end());
 
-        if (result.isSelect) {
-            ResultTableView *tableData = new ResultTableView(this->queryTabs);
-            tableData->verticalHeader()->hide();
+    Util::QueryHistory *history = Util::QueryHistory::instance();
+    foreach (int statement, statements) {
+        HistoryEntry entry = this->historyEntries.value(statement);
+        if (entry.query.trimmed().isEmpty()) {
+            continue;
+        }
 
-            QShortcut* refreshShortcut = new QShortcut(QKeySequence(Qt::Key_F5), tableData);
-            refreshShortcut->setContext(Qt::WidgetShortcut);
-            connect(refreshShortcut, SIGNAL(activated()), this, SLOT(queryChanged()));
+        PlanRegression regression;
+        if (checkRegressions && history->checkRegression(entry, &regression)) {
+            this->showRegression(regression, statement);
+        }
 
-            QueryModel *model = new QueryModel(result.data, this);
+        history->record(entry);
+    }
 
-            tableData->setModel(model);
+    this->historyEntries.clear();
+}
 
-            QString rowCount = QLocale(QLocale::English).toString(result.rows);
+/**
+ * Adds a tab comparing the plan of a statement with its previous plan
+ * @brief QueryTab::showRegression
+ */
+void QueryTab::showRegression(PlanRegression regression, int statement)
+{
+    QLocale locale(QLocale::English);
+    QStringList summary;
+    summary << QString(tr("Statement %1: %2")).arg(statement).arg(regression.fingerprint.simplified().left(200).toHtmlEscaped());
+
+    if (regression.planChanged) {
+        summary << QString(tr("The plan has changed, it was used from %1 to %2"))
+                   .arg(regression.previousPlan.firstSeen.toString("yyyy-MM-dd HH:mm"))
+                   .arg(regression.previousPlan.lastSeen.toString("yyyy-MM-dd HH:mm"));
+        summary << QString(tr("Before: %1")).arg(regression.previousPlan.signature.toHtmlEscaped());
+        summary << QString(tr("Now: %1")).arg(regression.signature.toHtmlEscaped());
+    } else if (!regression.signature.isEmpty()) {
+        // The data or the server load have changed, not the plan
+        summary << QString(tr("Same plan: %1")).arg(regression.signature.toHtmlEscaped());
+    }
+
+    if (regression.latencyJump) {
+        summary << QString(tr("<b>%1 ms</b>, the median of the previous executions is %2 ms"))
+                   .arg(locale.toString(regression.totalMsec, 'f', 2))
+                   .arg(locale.toString(regression.p50, 'f', 2));
+    }
+
+    History::PlanDiffView *diffView = new History::PlanDiffView(this->queryTabs);
+    diffView->setSummary(summary.join("<br>"));
+    diffView->setPlans(tr("Previous plan"), regression.previousPlan.plan, tr("Current plan"), regression.plan);
+
+    int index = this->queryTabs->addTab(diffView, this->style()->standardIcon(QStyle::SP_MessageBoxWarning),
+                                        regression.planChanged ? tr("Plan changed") : tr("Slower than usual"));
+    this->queryTabs->setCurrentIndex(index);
+    this->statusLabel->setText(this->statusLabel->text() + " - " + this->queryTabs->tabText(index));
+}
 
-            QString headerText = QString(tr("Result (%1 rows, %2 sec)")).arg(rowCount).arg(seconds);
-            if (result.limitedResult) {
-                headerText += " " + tr("Limited to 1,000");
+/**
+ * Updates the row count of the result tab when the rows of a streamed result are read
+ * @brief QueryTab::handleRowsFetched
+ */
+void QueryTab::handleRowsFetched()
+{
+    QueryModel *model = qobject_cast<QueryModel *>(this->sender());
+    if (model == nullptr) {
+        return;
+    }
+
+    for (int i = 0; i < this->queryTabs->count(); i++) {
+        ResultTableView *tableData = qobject_cast<ResultTableView *>(this->queryTabs->widget(i));
+        if (tableData != nullptr && tableData->model() == model) {
+            double seconds = tableData->property("msec").toLongLong() / 1000.0;
+            QString rowCount = QLocale(QLocale::English).toString(model->rowCount());
+            if (model->canFetchMore(QModelIndex())) {
+                rowCount += "+";
             }
 
-            this->queryTabs->addTab(tableData, headerText);
-
-            // Defines the initial column width
-            int colCount = model->columnCount();
-            for (int i = 0; i < colCount; i++) {
-                QVariant header = model->headerData(i, Qt::Horizontal, Qt::DisplayRole);
-                int size = header.toString().size() * 15;
-                if (size < 100) {
-                    size = 100;
+            QString headerText = QString(tr("Result (%1 rows, %2 sec)")).arg(rowCount).arg(seconds);
+            if (!model->lastError().isEmpty()) {
+                // The rows read before the error are kept, the result is not complete
+                headerText += " " + tr("Failed");
+                this->queryTabs->setTabIcon(i, this->style()->standardIcon(QStyle::SP_MessageBoxCritical));
+                this->statusLabel->setText(tr("Error while reading the rows"));
+
+                QMessageBox *message = new QMessageBox(this);
+                message->setText(model->lastError());
+                if (this->guardrails.maxExecutionSec > 0) {
+                    // The rows of the last result are read while the view is scrolled
+                    message->setInformativeText(QString(tr("The maximum execution time of the session (%1 s) includes the time to read the rows of the result."))
+                                                .arg(this->guardrails.maxExecutionSec));
                 }
-                tableData->setColumnWidth(i, size);
+                message->setIcon(QMessageBox::Critical);
+                message->show();
+            } else if (model->isLimited()) {
+                headerText += " " + tr("Limited by the memory");
+            } else if (!model->canFetchMore(QModelIndex()) && this->guardrails.rowCap > 0 && model->rowCount() >= this->guardrails.rowCap) {
+                headerText += " " + tr("Capped by the session");
             }
-		}
-		else {
-			QTextEdit *resultText = new QTextEdit();
-            resultText->setFontFamily("DejaVue Sans Mono Oblique");
-			resultText->setReadOnly(true);
 
-            QString rowCount = QLocale(QLocale::English).toString(result.affectedRows);
-            QString headerText = QString(tr("Result (%1 rows, %2 sec)")).arg(rowCount).arg(seconds);
-            QString affectedRows = QString(tr("Affected rows: %1")).arg(rowCount);
+            this->queryTabs->setTabText(i, headerText);
+            break;
+        }
+    }
+}
 
-            resultText->setPlainText(affectedRows + "\n\n" + result.query);
-			this->queryTabs->addTab(resultText, headerText);
-		}
-	}
+void QueryTab::compareSessionChanged(int index)
+{
+    this->orderedCompare->setEnabled(index > 0);
+}
+
+/**
+ * The choice is kept for the next query tabs
+ * @brief QueryTab::cacheToggled
+ */
+void QueryTab::cacheToggled(bool enabled)
+{
+    QSettings settings("smartarello", "mysqlclient");
+    settings.setValue("resultCache/enabled", enabled);
+}
+
+void QueryTab::clearCache()
+{
+    Util::ResultCache::instance()->clear();
+    this->statusLabel->setText(tr("Cache cleared"));
+}
+
+/**
+ * Executes the query on the current session and on the session selected for the comparison,
+ * the database of the current session is used on both sides.
+ * @brief QueryTab::startComparison
+ * @param query the query to compare
+ */
+void QueryTab::startComparison(QString query)
+{
+    ConnectionConfiguration source = Util::DataBase::dumpConfiguration();
+    QJsonObject targetSession = this->sessions.at(this->compareSession->currentIndex() - 1).toObject();
+    ConnectionConfiguration target = Util::DataBase::configurationFromJSON(targetSession, source.databaseName);
+
+    this->compareWorker = new Util::ResultComparison(source, target, query, this->orderedCompare->isChecked());
+    this->compareThread = new QThread();
+    this->compareWorker->moveToThread(this->compareThread);
 
+    connect(this->compareThread, &QThread::finished, this->compareWorker, &QObject::deleteLater);
+    connect(this->compareThread, &QThread::finished, this->compareThread, &QObject::deleteLater);
+    connect(this, SIGNAL(startCompare()), this->compareWorker, SLOT(compare()));
+    connect(this->compareWorker, SIGNAL(compareFinished(bool)), this, SLOT(handleCompareFinished(bool)));
 
-    results.clear();
+    this->compareThread->start();
 
+    emit startCompare();
+}
+
+/**
+ * Displays the report of the comparison and the first differing rows
+ * @brief QueryTab::handleCompareFinished
+ * @param stopped true when the user has cancelled the comparison
+ */
+void QueryTab::handleCompareFinished(bool stopped)
+{
+    ResultComparisonReport report = this->compareWorker->getReport();
+    QString targetName = this->compareSession->currentText();
+
+    this->compareThread->quit();
+    this->compareThread = nullptr;
+    this->compareWorker = nullptr;
+
+    this->executeButton->setEnabled(true);
+    this->stopButton->setEnabled(false);
+    this->queryTabs->clear();
+    this->profiles.clear();
+
+    QString status;
+    if (stopped) {
+        status = tr("Comparison cancelled");
+    } else if (!report.source.error.isEmpty() || !report.target.error.isEmpty()) {
+        status = tr("Comparison failed");
+    } else if (report.match) {
+        status = tr("The results are identical");
+    } else {
+        status = tr("The results are different");
+    }
+
+    QString html = "<h3>" + status.toHtmlEscaped() + "</h3>";
+    if (!report.message.isEmpty()) {
+        html += "<p>" + report.message.toHtmlEscaped() + "</p>";
+    }
+
+    QLocale locale(QLocale::English);
+    html += "<table cellpadding=\"4\">";
+    html += QString("<tr><th></th><th align=\"left\">%1</th><th align=\"left\">%2</th></tr>").arg(tr("Current session")).arg(targetName.toHtmlEscaped());
+    html += QString("<tr><td>%1</td><td>%2</td><td>%3</td></tr>").arg(tr("Rows")).arg(locale.toString(report.source.rows)).arg(locale.toString(report.target.rows));
+    html += QString("<tr><td>%1</td><td>%2 sec</td><td>%3 sec</td></tr>").arg(tr("Execution")).arg(report.source.executionMsec / 1000.0).arg(report.target.executionMsec / 1000.0);
+    html += QString("<tr><td>%1</td><td>%2 sec</td><td>%3 sec</td></tr>").arg(tr("Total (with fetch)")).arg(report.source.totalMsec / 1000.0).arg(report.target.totalMsec / 1000.0);
+    html += QString("<tr><td>%1</td><td>%2</td><td>%3</td></tr>").arg(report.ordered ? tr("Hash (ordered)") : tr("Hash (any order)")).arg(QString(report.source.hash)).arg(QString(report.target.hash));
+    html += QString("<tr><td>%1</td><td>%2</td><td>%3</td></tr>").arg(tr("Error")).arg(report.source.error.toHtmlEscaped()).arg(report.target.error.toHtmlEscaped());
+    html += "</table>";
+
+    QTextEdit *reportText = new QTextEdit();
+    reportText->setReadOnly(true);
+    reportText->setHtml(html);
+    this->queryTabs->addTab(reportText, tr("Comparison"));
+
+    if (!report.differences.isEmpty()) {
+        QStandardItemModel *model = new QStandardItemModel(this);
+        model->setHorizontalHeaderLabels(QStringList() << tr("Side") << tr("Row") << report.columns);
+
+        foreach (ResultDifference difference, report.differences) {
+            QList<QStandardItem *> cols;
+            cols << new QStandardItem(difference.side) << new QStandardItem(locale.toString(difference.row));
+            foreach (QString value, difference.values) {
+                cols << new QStandardItem(value);
+            }
+            model->appendRow(cols);
+        }
+
+        ResultTableView *differenceTable = new ResultTableView(this->queryTabs);
+        differenceTable->verticalHeader()->hide();
+        differenceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        differenceTable->setModel(model);
+
+        this->queryTabs->addTab(differenceTable, QString(tr("First differences (%1 rows)")).arg(report.differences.size()));
+        this->queryTabs->setCurrentIndex(1);
+    }
 }
 
 void QueryTab::focus()
@@ -204,7 +988,21 @@ void QueryTab::focus()
 
 
 QueryTab::~QueryTab() {
-
+    this->recordHistory(false);
+    if (this->compareWorker != nullptr) {
+        this->compareWorker->stopRequired();
+        this->compareThread->quit();
+    }
+
+    // The query threads are children of the tab, they must be finished before they are deleted:
+    // the stop ends a streamed result or a pending confirmation, the kill a running statement
+    foreach (QueryThread *worker, this->findChildren<QueryThread *>()) {
+        if (worker->isRunning()) {
+            worker->stopStreaming();
+            worker->killQuery();
+            worker->wait();
+        }
+    }
 }
 
 } /* namespace Query */
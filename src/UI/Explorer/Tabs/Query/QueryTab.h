@@ -22,8 +22,21 @@
 #include <QTabWidget>
 #include <QSqlRecord>
 #include <QPushButton>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QThread>
+#include <QJsonArray>
+#include <QPointer>
+#include <QLabel>
+#include <QElapsedTimer>
+#include <QTextEdit>
+#include <QHash>
 #include "QueryTextEdit.h"
 #include "QueryThread.h"
+#include "Util/ResultComparison.h"
+#include "Util/ExplainPlan.h"
+#include "Util/QueryHistory.h"
+#include "Util/ResultCache.h"
 
 
 namespace UI {
@@ -42,15 +55,71 @@ public:
 
 public slots:
 	void queryChanged();
+	void explainQuery();
+	void benchmarkQuery();
+	void compareVariants();
 	void stopQueries();
-    void handleQueryResultReady(QList<QueryExecutionResult> results);
+    void handleResultReady(QueryExecutionResult result, int statement, int statementCount);
+    void handleExecutionFinished();
+    void handleQueryThreadFinished();
+    void handlePlanReady(int statement, QString plan);
+    void handleServerProfileReady(int statement, QueryProfile profile);
+    void handleOptimizerTraceReady(QString query, QString trace, QString warning);
+    void showProfile();
+    void handleRowsFetched();
+    void handleConfirmationRequired(int statement, int statementCount, qint64 estimatedRows);
+    void handleCompareFinished(bool stopped);
+    void compareSessionChanged(int index);
+    void cacheToggled(bool enabled);
+    void clearCache();
+
+signals:
+    void startCompare();
 
 private:
+    enum ExplainMode {
+        NO_EXPLAIN,
+        EXPLAIN_JSON,
+        EXPLAIN_ANALYZE
+    };
+
 	QueryTextEdit *queryTextEdit;
 	QTabWidget *queryTabs;
-	QueryThread *queryWorker;
+    QTextEdit *profileText;
+    QHash<QWidget *, QueryProfile> profiles;
+    QHash<int, HistoryEntry> historyEntries;
+	QPointer<QueryThread> queryWorker;
 	QPushButton *executeButton;
 	QPushButton *stopButton;
+    QPushButton *explainButton;
+    QCheckBox *analyzeCheckbox;
+    QCheckBox *traceCheckbox;
+    QCheckBox *cacheCheckbox;
+    QPushButton *clearCacheButton;
+    QPushButton *benchmarkButton;
+    QPushButton *variantsButton;
+    ExplainMode explainMode;
+    QLabel *statusLabel;
+    QElapsedTimer cancelTimer;
+    qint64 killMsec;
+    QComboBox *compareSession;
+    QCheckBox *orderedCompare;
+    QJsonArray sessions;
+    QString cacheQuery; // the query of the execution when its result can be cached
+    QString cacheOwner; // the cached results of the tab are not shown in the other tabs
+    QStringList writeStatements; // the statements of the execution invalidating the cached results
+    QueryGuardrails guardrails; // of the session of the execution
+    QThread *compareThread = nullptr;
+    Util::ResultComparison *compareWorker = nullptr;
+
+    void startComparison(QString query);
+    void executeQuery(QString query, ExplainMode mode);
+    void showResult(QueryExecutionResult result, int statement);
+    void showCachedResult(QString query, CachedResult cached);
+    void showPlan(QueryExecutionResult result, int statement);
+    void addHistoryEntry(QueryExecutionResult result, int statement);
+    void recordHistory(bool checkRegressions);
+    void showRegression(PlanRegression regression, int statement);
 };
 
 } /* namespace Query */
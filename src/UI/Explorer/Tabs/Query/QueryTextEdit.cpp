@@ -18,16 +18,17 @@
 #include <UI/Explorer/Tabs/Query/QueryTextEdit.h>
 #include "../SQLSyntaxHighlighter.h"
 #include <QFont>
-#include <QSqlQuery>
 #include <QTextCursor>
 #include <QDebug>
 #include <QAction>
 #include <QMenu>
 #include <QAbstractItemView>
 #include <QScrollBar>
-#include <QSqlError>
 #include <QShortcut>
 #include <QKeySequence>
+#include "Util/DataBase.h"
+#include "Util/MetadataService.h"
+#include "Util/SqlSplitter.h"
 
 
 namespace UI {
@@ -42,7 +43,7 @@ QueryTextEdit::QueryTextEdit(QWidget *parent) : QTextEdit(parent) {
 
 
     SQLSyntaxHighlighter *highlighter  = new SQLSyntaxHighlighter(this->document());
-	this->tableList = this->getTableList();
+	this->metadataKey = QString("QueryTextEdit/%1").arg(quintptr(this));
 
 	this->autocomplete = new QCompleter(this);
 	this->autocomplete->setCaseSensitivity(Qt::CaseInsensitive);
@@ -62,6 +63,11 @@ QueryTextEdit::QueryTextEdit(QWidget *parent) : QTextEdit(parent) {
 
     connect(refreshShortcut, SIGNAL(activated()), SLOT(formatSql()));
     connect(this->autocomplete, SIGNAL(activated(QString)), SLOT(insertCompletion(QString)));
+
+    Util::MetadataService *metadata = Util::MetadataService::instance();
+    connect(metadata, SIGNAL(resultReady(QString,QList<Util::ResultSet>)), SLOT(handleMetadataReady(QString,QList<Util::ResultSet>)));
+
+    this->requestTableList();
 }
 
 void QueryTextEdit::showContextMenu(const QPoint &pt)
@@ -144,8 +150,9 @@ void QueryTextEdit::formatSql()
 void QueryTextEdit::databaseChanged()
 {
 	// Refresh the table list from the new database
-	this->tableList = this->getTableList();
-	this->autoCompleteModel->setStringList(this->tableList);
+	this->tableColumns.clear();
+	this->pendingTable = "";
+	this->requestTableList();
 }
 
 
@@ -223,6 +230,36 @@ void QueryTextEdit::keyPressEvent(QKeyEvent *e)
     }
 }
 
+/**
+ * @brief QueryTextEdit::currentStatement
+ * @return the selected text, or the statement of the script where the cursor is
+ */
+QString QueryTextEdit::currentStatement() const
+{
+    QTextCursor cursor = this->textCursor();
+    if (cursor.hasSelection()) {
+        return cursor.selectedText().replace(QChar::ParagraphSeparator, '\n').trimmed();
+    }
+
+    QString text = this->toPlainText();
+    QStringList statements = Util::SqlSplitter::split(text);
+    QString statement = statements.value(0);
+    int from = 0;
+
+    // The statements are in the text, the cursor after a delimiter is still on the previous statement
+    foreach (QString candidate, statements) {
+        int start = text.indexOf(candidate, from);
+        if (start == -1 || start > cursor.position()) {
+            break;
+        }
+
+        statement = candidate;
+        from = start + candidate.size();
+    }
+
+    return statement;
+}
+
 QString QueryTextEdit::textUnderCursor() const
 {
     QTextCursor tc = textCursor();
@@ -231,25 +268,44 @@ QString QueryTextEdit::textUnderCursor() const
     return tc.selectedText();
 }
 
-QStringList QueryTextEdit::getTableList()
+/**
+ * Asks the tables of the current database to the metadata service
+ * @brief QueryTextEdit::requestTableList
+ */
+void QueryTextEdit::requestTableList()
 {
-    QSqlDatabase db = QSqlDatabase::database();
+    QSqlDatabase db = Util::DataBase::current();
 
-	QStringList tables;
+    if (db.isValid() && db.databaseName() != "") {
+        this->databaseName = db.databaseName();
+        Util::MetadataService::instance()->request(this->metadataKey + "/tables", Util::DataBase::dumpConfiguration(db), QStringList() << QString("SHOW TABLES FROM `%1`").arg(this->databaseName));
+    }
+}
 
-    if (db.isValid() && db.isOpen() && db.databaseName() != "") {
-        QSqlQuery query;
-        if (query.exec("show table status")) {
-            while (query.next()){
-                    tables << query.value("Name").toString();
-                }
-        } else {
-            qDebug() << "QueryTextEdit::getTableList - " + query.lastError().text();
-        }
+/**
+ * Receives the tables of the database or the columns of a table for the autocompleter
+ * @brief QueryTextEdit::handleMetadataReady
+ */
+void QueryTextEdit::handleMetadataReady(QString key, QList<Util::ResultSet> results)
+{
+    if (results.isEmpty()) {
+        return;
     }
 
+    Util::ResultSet names = results.first();
+    QStringList values;
+    for (int i = 0; i < names.rowCount(); i++) {
+        values << names.value(i, 0).toString();
+    }
 
-	return tables;
+    if (key == this->metadataKey + "/tables") {
+        this->tableList = values;
+        this->autoCompleteModel->setStringList(this->tableList);
+    } else if (key == this->metadataKey + "/columns") {
+        this->tableColumns.insert(this->pendingTable, values);
+        this->pendingTable = "";
+        this->autoCompleteModel->setStringList(values);
+    }
 }
 
 void QueryTextEdit::loadTableFields()
@@ -271,26 +327,19 @@ void QueryTextEdit::loadTableFields()
 		return ;
 	}
 
-	if (this->tableList.contains(tableName)){
-
-		QString queryString = QString("SHOW COLUMNS FROM %1").arg(tableName);
-		QSqlQuery query;
-		if (query.exec(queryString)) {
-
-			QStringList columns;
-
-			while (query.next()){
-				columns << query.value("Field").toString();
-			}
-
-			this->autoCompleteModel->setStringList(columns);
-		} else {
-			qDebug() << "QueryTextEdit::loadTableFields - " + query.lastError().text();
-		}
+	if (this->tableColumns.contains(tableName)) {
+		this->autoCompleteModel->setStringList(this->tableColumns.value(tableName));
+	} else if (this->tableList.contains(tableName) && tableName != this->pendingTable) {
+		// The columns are shown when the metadata service gives them
+		this->pendingTable = tableName;
+		QString queryString = QString("SHOW COLUMNS FROM `%1` FROM `%2`").arg(tableName).arg(this->databaseName);
+		Util::MetadataService::instance()->request(this->metadataKey + "/columns", Util::DataBase::dumpConfiguration(Util::DataBase::current()), QStringList() << queryString);
 	}
 }
 
 QueryTextEdit::~QueryTextEdit() {
+	Util::MetadataService::instance()->cancel(this->metadataKey + "/tables");
+	Util::MetadataService::instance()->cancel(this->metadataKey + "/columns");
 }
 
 } /* namespace Query */
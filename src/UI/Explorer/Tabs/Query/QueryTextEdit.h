@@ -21,6 +21,8 @@
 #include <qtextedit.h>
 #include <QCompleter>
 #include <QStringListModel>
+#include <QHash>
+#include "Util/ResultSet.h"
 
 namespace UI {
 namespace Explorer {
@@ -34,6 +36,7 @@ class QueryTextEdit: public QTextEdit {
 public:
 	QueryTextEdit(QWidget *parent = 0);
 	virtual ~QueryTextEdit();
+	QString currentStatement() const;
 
 signals:
 	void queryChanged();
@@ -44,6 +47,7 @@ protected:
 private slots:
 	void insertCompletion(const QString &completion);
     void showContextMenu(const QPoint &);
+    void handleMetadataReady(QString key, QList<Util::ResultSet> results);
 
 public slots:
 		void databaseChanged();
@@ -51,9 +55,13 @@ public slots:
 
 private:
 	QString textUnderCursor() const;
-	QStringList getTableList();
+	void requestTableList();
 	QCompleter *autocomplete;
 	QStringList tableList;
+	QHash<QString, QStringList> tableColumns;
+	QString pendingTable;
+	QString databaseName;
+	QString metadataKey;
 	QStringListModel *autoCompleteModel;
 	void loadTableFields();
 };
@@ -19,8 +19,32 @@
 #include <QDebug>
 #include <QSqlError>
 #include <QSqlResult>
-#include <QDateTime>
+#include <QElapsedTimer>
 #include <QUuid>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QRegExp>
+#include "Util/SqlSplitter.h"
+#include "Util/ExplainPlan.h"
+#include "Util/SqlFingerprint.h"
+#include "Util/QueryGuardrails.h"
+
+// Rows of the result sets which are not the last one
+#define RESULT_LIMIT 1000
+// Rows of the last result set sent with queryResultReady
+#define FIRST_BATCH_SIZE 200
+// Rows of the first batch when the result is kept in the result cache, only the complete results are cached
+#define CACHED_BATCH_SIZE 5000
+// Memory used by the rows of a streamed result
+#define STREAMING_MEMORY_LIMIT (Q_INT64_C(256) * 1024 * 1024)
+// Seconds the server waits for the next rows to be read, the default (60) is reached when the view is not scrolled
+#define STREAMING_WRITE_TIMEOUT 28800
+// Memory of the optimizer traces, the default (1 MB) is too small for the joins
+#define OPTIMIZER_TRACE_MEMORY (16 * 1024 * 1024)
+// Traces kept for a script
+#define OPTIMIZER_TRACE_LIMIT 100
+// Statements of a script explained for the query history
+#define PLAN_CAPTURE_LIMIT 20
 
 
 namespace UI {
@@ -33,91 +57,550 @@ QueryThread::QueryThread(ConnectionConfiguration connection, QString query, QObj
     connection(connection),
     query(query)
 {
-
+    this->requestedRows = 0;
+    this->stop = false;
+    this->optimizerTrace = false;
+    this->planCapture = false;
+    this->firstBatchSize = FIRST_BATCH_SIZE;
+    this->guardrails = QueryGuardrails();
+    this->confirmation = 0;
+    this->connectionId = 0;
 }
 
+/**
+ * Executes the query with an unbuffered cursor.
+ *
+ * Each result is sent with resultReady as soon as it is read, with the number of the
+ * statement in the script. The result sets followed by another one are limited to 1,000 rows
+ * as the next statements can only be executed when they are entirely read. The rows of the
+ * last result set are streamed: the first rows are sent with resultReady and the next ones
+ * are read when the model asks for them (fetchMore), until the memory limit.
+ */
 void QueryThread::run()
 {
-    QSqlDatabase database = Util::DataBase::createFromConfig(this->connection);
+    QSqlDatabase database = Util::DataBase::acquire(this->connection);
+
+    QStringList statements = Util::SqlSplitter::split(this->query);
+    int statementCount = qMax(1, statements.size());
 
-    QList<QueryExecutionResult>  results;
-    if (database.open()) {
+    if (database.isOpen()) {
 
-        QSqlQuery query(database);
-        if (query.exec("SELECT CONNECTION_ID()")) {
-            query.next();
-            this->connectionId = query.value(0).toString();
+        Util::MySQLCursor cursor(database);
+        this->connectionLock.lockForWrite();
+        this->connectionId = cursor.connectionId();
+        this->connectionLock.unlock();
 
+        // The statements which would examine too many rows are confirmed before the execution
+        if (this->guardrails.confirmRows > 0 && !this->confirmEstimatedRows(database, statements)) {
+            this->connectionLock.lockForWrite();
+            this->connectionId = 0;
+            this->connectionLock.unlock();
 
+            Util::DataBase::release(database, true);
+            emit executionFinished();
+            return;
+        }
 
-            QSqlQuery query(database);
+        bool traced = this->optimizerTrace && this->enableOptimizerTrace(cursor, statementCount);
 
-            QDateTime mStartTime = QDateTime::currentDateTime();
-            if (query.exec(this->query)) {
+        // The server waits for the view to read the next rows of a streamed result
+        if (!cursor.exec(QString("SET SESSION net_write_timeout = %1").arg(STREAMING_WRITE_TIMEOUT))) {
+            qDebug() << "QueryThread::run - " + cursor.lastError();
+        }
 
-                qint64 msec = mStartTime.msecsTo(QDateTime::currentDateTime());
+        // The rows are capped by the server, the connection is reset when it goes back to the pool
+        if (this->guardrails.rowCap > 0 && !cursor.exec(QString("SET SESSION sql_select_limit = %1").arg(this->guardrails.rowCap))) {
+            qDebug() << "QueryThread::run - " + cursor.lastError();
+        }
 
-                do {
+        bool streaming = false;
+        int statement = 0;
+        // The next result belongs to the same CALL statement
+        bool callResults = false;
+        QElapsedTimer timer;
+        timer.start();
+        if (cursor.exec(Util::Guardrails::withMaxExecutionTime(this->query, this->guardrails.maxExecutionSec * 1000))) {
 
-                    QueryExecutionResult result;
-                    result.msec = msec;
-                    result.rows = query.size();
-                    if (query.isSelect()) {
-                        result.isSelect = true;
-                        QList<QSqlRecord> data;
-                        if (query.size() > 1000) {
-                            result.limitedResult = true;
-                        } else {
-                            result.limitedResult = false;
-                        }
+            do {
+                // A procedure gives its result sets then the status of the CALL, all for one statement
+                if (!callResults) {
+                    statement = qMin(statement + 1, statementCount);
+                }
+                callResults = cursor.isSelect() && isCall(statements.value(statement - 1));
 
-                        int i = 0;
-                        while (query.next() && i++ < 1000) {
-                            data << query.record();
+                QueryExecutionResult result;
+                result.profile = QueryProfile();
+                result.profile.firstRowMsec = timer.nsecsElapsed() / 1000000.0;
+                result.affectedRows = 0;
+                result.limitedResult = false;
+                result.streaming = false;
+                result.query = statements.value(statement - 1, this->query);
+                if (cursor.isSelect()) {
+                    result.isSelect = true;
+                    // The trace is read when all the results are read, the traced results are not streamed
+                    bool lastResult = !cursor.hasMoreResults() && !traced;
+                    int limit = lastResult ? this->firstBatchSize : RESULT_LIMIT;
+
+                    Util::ResultSet data(cursor.record());
+                    QElapsedTimer rowTimer;
+                    while (data.rowCount() < limit && this->fetchRow(cursor, result.profile)) {
+                        if (data.rowCount() == 0) {
+                            result.profile.firstRowMsec = timer.nsecsElapsed() / 1000000.0;
                         }
 
-                        result.data = data;
-                    } else {
-                        result.query = query.executedQuery();
-                        result.isSelect = false;
-                        result.affectedRows = query.numRowsAffected();
+                        rowTimer.start();
+                        data.appendRow(cursor);
+                        result.profile.decodeMsec += rowTimer.nsecsElapsed() / 1000000.0;
                     }
 
+                    result.data = data;
+                    result.rows = data.rowCount();
+                    if (data.rowCount() == limit && lastResult) {
+                        result.streaming = true;
+                        streaming = true;
+                    } else if (data.rowCount() == limit) {
+                        // Counts the rows which are not kept
+                        while (this->fetchRow(cursor, result.profile)) {
+                            result.rows++;
+                        }
+                        result.limitedResult = result.rows > limit;
+                    }
+                } else {
+                    result.isSelect = false;
+                    result.affectedRows = cursor.numRowsAffected();
+                }
+
+                // Time of the statement on the client side, without the rows read later
+                result.msec = timer.elapsed();
+                result.profile.totalMsec = timer.nsecsElapsed() / 1000000.0;
+                emit resultReady(result, statement, statementCount);
+
+                // The next statement is timed from the end of this one
+                timer.restart();
+            } while (!streaming && cursor.nextResult());
 
-                    results << result;
-                } while (query.nextResult());
-            } else {
-                qDebug() << "QueryThread::run - " + query.lastError().text();
+            if (!cursor.lastError().isEmpty()) {
+                qDebug() << "QueryThread::run - " + cursor.lastError();
                 QueryExecutionResult result;
-                result.error = query.lastError().text();
-                results << result;
+                result.error = cursor.lastError();
+                if (!callResults) {
+                    statement = qMin(statement + 1, statementCount);
+                }
+                result.query = statements.value(statement - 1, this->query);
+                emit resultReady(result, statement, statementCount);
             }
+        } else {
+            qDebug() << "QueryThread::run - " + cursor.lastError();
+            QueryExecutionResult result;
+            result.error = cursor.lastError();
+            result.query = statements.value(0, this->query);
+            statement = 1;
+            emit resultReady(result, 1, statementCount);
+        }
+
+        emit executionFinished();
 
+        bool killed = false;
+        if (streaming && !this->streamRows(cursor)) {
+            // The server stops sending the rows, otherwise they are all read when the result is freed
+            this->killQuery();
+            killed = true;
         }
 
-        database.close();
-        emit queryResultReady(results);
-        results.clear();
+        cursor.freeResult();
+
+        // The statements executed after the script are skipped from the history of the connection
+        int skippedStatements = 0;
+
+        // The statistics read after the statements are not capped
+        if (!killed && this->guardrails.rowCap > 0) {
+            cursor.exec("SET SESSION sql_select_limit = DEFAULT");
+            skippedStatements++;
+        }
+
+        if (!killed && traced) {
+            this->loadOptimizerTrace(database);
+            skippedStatements++;
+        }
+
+        if (!killed) {
+            this->loadServerProfiles(database, statement, skippedStatements);
+        }
+
+        if (!killed && this->planCapture) {
+            this->loadPlans(database, statements.mid(0, statement));
+        }
+
+        // The connection can be given to another thread, its statements must not be killed:
+        // waits for the KILL QUERY being sent
+        this->connectionLock.lockForWrite();
+        this->connectionId = 0;
+        this->connectionLock.unlock();
+
+        // The session state left by the query is cleared before the connection is reused,
+        // the pool closes it if the reset fails
+        Util::DataBase::release(database, true);
 
 	} else {
         qWarning() << database.lastError();
         QueryExecutionResult result;
         result.error = database.lastError().text();
-        results << result;
-        emit queryResultReady(results);
+        Util::DataBase::release(database);
+        emit resultReady(result, 1, statementCount);
+        emit executionFinished();
 	}
 
 }
 
-void QueryThread::killQuery()
+/**
+ * Reads the rows asked by the model until the end of the result or the memory limit
+ * @brief QueryThread::streamRows
+ * @param cursor the cursor on the last result set
+ * @return true if all the rows are read, or if the result has been ended by an error
+ */
+bool QueryThread::streamRows(Util::MySQLCursor &cursor)
+{
+    QSqlRecord header = cursor.record();
+    qint64 memory = 0;
+
+    forever {
+        this->mutex.lock();
+        while (this->requestedRows == 0 && !this->stop) {
+            this->condition.wait(&this->mutex);
+        }
+
+        if (this->stop) {
+            this->mutex.unlock();
+            return false;
+        }
+
+        int count = this->requestedRows;
+        this->requestedRows = 0;
+        this->mutex.unlock();
+
+        Util::ResultSet rows(header);
+        bool finished = false;
+        bool limited = false;
+        QString error;
+        while (rows.rowCount() < count) {
+            if (!cursor.next()) {
+                // The end of the result, or an error (killed, network, timeout) which ends it
+                error = cursor.lastError();
+                finished = true;
+                break;
+            }
+
+            rows.appendRow(cursor);
+            if (memory + rows.memoryUsage() > STREAMING_MEMORY_LIMIT) {
+                limited = true;
+                break;
+            }
+        }
+
+        memory += rows.memoryUsage();
+        emit rowsFetched(rows, finished || limited, limited, error);
+
+        if (!error.isEmpty()) {
+            qDebug() << "QueryThread::streamRows - " + error;
+        }
+
+        if (finished) {
+            return true;
+        } else if (limited) {
+            return false;
+        }
+    }
+}
+
+/**
+ * Estimates the rows examined by the statements from their plan, on the connection of the
+ * thread, and waits for the user to confirm the statements above the limit of the session
+ * @brief QueryThread::confirmEstimatedRows
+ * @return false if the execution is cancelled
+ */
+bool QueryThread::confirmEstimatedRows(QSqlDatabase database, QStringList statements)
 {
-    if (!this->connectionId.isEmpty()) {
-        QSqlDatabase database = Util::DataBase::createFromConfig(this->connection);
+    for (int i = 0; i < statements.size(); i++) {
+        // The comments before the statement are ignored
+        if (!Util::ExplainPlan::canExplain(Util::SqlFingerprint::normalize(statements.at(i)))) {
+            continue;
+        }
+
+        double rows = Util::Guardrails::estimateRows(database, statements.at(i));
+        if (rows <= this->guardrails.confirmRows) {
+            continue;
+        }
 
-        QSqlQuery killQuery(database);
-        killQuery.exec("KILL "+this->connectionId);
-        database.close();
+        QMutexLocker locker(&this->mutex);
+        this->confirmation = 0;
+        emit confirmationRequired(i + 1, statements.size(), qint64(rows));
+
+        while (this->confirmation == 0 && !this->stop) {
+            this->condition.wait(&this->mutex);
+        }
+
+        if (this->stop || this->confirmation < 0) {
+            return false;
+        }
     }
+
+    return true;
+}
+
+/**
+ * Gives the answer of the user to confirmationRequired, the execution goes on if it is confirmed
+ * @brief QueryThread::confirmExecution
+ */
+void QueryThread::confirmExecution(bool confirmed)
+{
+    QMutexLocker locker(&this->mutex);
+    this->confirmation = confirmed ? 1 : -1;
+    this->condition.wakeOne();
+}
+
+/**
+ * @brief QueryThread::isCall
+ * @return true if the statement calls a procedure, which can give several results
+ */
+bool QueryThread::isCall(QString statement)
+{
+    return QRegExp("^call\\b").indexIn(Util::SqlFingerprint::normalize(statement)) != -1;
+}
+
+/**
+ * Reads the next row and adds its network time and size to the profile
+ * @return false at the end of the result
+ */
+bool QueryThread::fetchRow(Util::MySQLCursor &cursor, QueryProfile &profile)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool hasRow = cursor.next();
+    profile.fetchMsec += timer.nsecsElapsed() / 1000000.0;
+
+    if (hasRow) {
+        profile.bytes += cursor.rowLength();
+        profile.rowsRead++;
+    }
+
+    return hasRow;
+}
+
+/**
+ * Reads the server time and the rows examined of the last statements from
+ * performance_schema.events_statements_history, on the connection which executed them: they
+ * are the last top-level statements of its thread. The history keeps the last 10 statements
+ * by default, the profiles are not sent when performance_schema is not available.
+ * @brief QueryThread::loadServerProfiles
+ * @param database the connection, all its results must be read
+ * @param statementCount the number of statements executed
+ * @param skippedStatements the number of statements executed after the script
+ */
+void QueryThread::loadServerProfiles(QSqlDatabase database, int statementCount, int skippedStatements)
+{
+    if (statementCount <= 0) {
+        return;
+    }
+
+    QString query = QString("SELECT h.TIMER_WAIT, h.LOCK_TIME, h.ROWS_EXAMINED, h.ROWS_SENT "
+                            "FROM performance_schema.events_statements_history h "
+                            "JOIN performance_schema.threads t ON t.THREAD_ID = h.THREAD_ID "
+                            "WHERE t.PROCESSLIST_ID = CONNECTION_ID() AND h.NESTING_EVENT_ID IS NULL "
+                            "AND h.EVENT_NAME LIKE 'statement/sql/%' "
+                            "ORDER BY h.EVENT_ID DESC LIMIT %1, %2").arg(skippedStatements).arg(statementCount);
+
+    Util::MySQLCursor cursor(database);
+    if (!cursor.exec(query)) {
+        qDebug() << "QueryThread::loadServerProfiles - " + cursor.lastError();
+        return;
+    }
+
+    // The most recent statement is the last one of the script
+    int statement = statementCount;
+    while (cursor.next()) {
+        QueryProfile profile = QueryProfile();
+        profile.serverLoaded = true;
+        // The timers are in picoseconds
+        profile.serverMsec = cursor.value(0).toDouble() / 1000000000.0;
+        profile.lockMsec = cursor.value(1).toDouble() / 1000000000.0;
+        profile.rowsExamined = cursor.value(2).toLongLong();
+        profile.rowsSent = cursor.value(3).toLongLong();
+
+        emit serverProfileReady(statement, profile);
+        statement--;
+    }
+
+    cursor.freeResult();
+}
+
+/**
+ * Traces the optimization of the next statements, the traces are read by loadOptimizerTrace
+ * @brief QueryThread::enableOptimizerTrace
+ * @return false if the trace is not available (old server, privileges)
+ */
+bool QueryThread::enableOptimizerTrace(Util::MySQLCursor &cursor, int statementCount)
+{
+    int limit = qMin(statementCount, OPTIMIZER_TRACE_LIMIT);
+    QString query = QString("SET SESSION optimizer_trace = 'enabled=on', optimizer_trace_offset = -%1, "
+                            "optimizer_trace_limit = %1, optimizer_trace_max_mem_size = %2").arg(limit).arg(OPTIMIZER_TRACE_MEMORY);
+
+    if (!cursor.exec(query)) {
+        qDebug() << "QueryThread::enableOptimizerTrace - " + cursor.lastError();
+        emit optimizerTraceReady(this->query, "", cursor.lastError());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Reads the traces of the statements from information_schema.OPTIMIZER_TRACE, the session
+ * variables are reset when the connection goes back to the pool
+ * @brief QueryThread::loadOptimizerTrace
+ * @param database the connection, all its results must be read
+ */
+void QueryThread::loadOptimizerTrace(QSqlDatabase database)
+{
+    Util::MySQLCursor cursor(database);
+    if (!cursor.exec("SELECT QUERY, TRACE, MISSING_BYTES_BEYOND_MAX_MEM_SIZE, INSUFFICIENT_PRIVILEGES FROM information_schema.OPTIMIZER_TRACE")) {
+        qDebug() << "QueryThread::loadOptimizerTrace - " + cursor.lastError();
+        emit optimizerTraceReady(this->query, "", cursor.lastError());
+        return;
+    }
+
+    bool empty = true;
+    while (cursor.next()) {
+        QString warning;
+        if (cursor.value(3).toInt() != 0) {
+            warning = tr("Insufficient privileges to trace the statement");
+        } else if (cursor.value(2).toLongLong() > 0) {
+            warning = QString(tr("The trace is truncated, %1 bytes are missing")).arg(cursor.value(2).toLongLong());
+        }
+
+        emit optimizerTraceReady(cursor.value(0).toString(), cursor.value(1).toString(), warning);
+        empty = false;
+    }
+
+    cursor.freeResult();
+
+    if (empty) {
+        emit optimizerTraceReady(this->query, "", tr("No statement has been traced"));
+    }
+}
+
+/**
+ * Explains the queries of the script once they are executed, the plans are kept in the
+ * query history to find the plan changes. Read after the server profiles, which are the
+ * last statements of the connection.
+ * @brief QueryThread::loadPlans
+ * @param database the connection, all its results must be read
+ * @param statements the statements executed
+ */
+void QueryThread::loadPlans(QSqlDatabase database, QStringList statements)
+{
+    Util::MySQLCursor cursor(database);
+    int explained = 0;
+
+    for (int i = 0; i < statements.size() && explained < PLAN_CAPTURE_LIMIT; i++) {
+        if (!Util::ExplainPlan::canExplain(statements.at(i))) {
+            continue;
+        }
+
+        explained++;
+        if (!cursor.exec("EXPLAIN FORMAT=JSON " + statements.at(i))) {
+            // e.g. a temporary table dropped by the script
+            qDebug() << "QueryThread::loadPlans - " + cursor.lastError();
+            continue;
+        }
+
+        if (cursor.next()) {
+            emit planReady(i + 1, cursor.value(0).toString());
+        }
+        cursor.freeResult();
+    }
+}
+
+/**
+ * The plans of the queries are captured after the execution, called before the thread starts
+ * @brief QueryThread::setPlanCapture
+ */
+void QueryThread::setPlanCapture(bool enabled)
+{
+    this->planCapture = enabled;
+}
+
+/**
+ * Reads more rows before streaming the result, to send the complete result of the queries
+ * kept in the result cache, called before the thread starts
+ * @brief QueryThread::setCacheable
+ */
+void QueryThread::setCacheable(bool enabled)
+{
+    this->firstBatchSize = enabled ? CACHED_BATCH_SIZE : FIRST_BATCH_SIZE;
+}
+
+/**
+ * The limits of the session are applied to the statements, called before the thread starts
+ * @brief QueryThread::setGuardrails
+ */
+void QueryThread::setGuardrails(QueryGuardrails guardrails)
+{
+    this->guardrails = guardrails;
+}
+
+/**
+ * The statements are executed with the optimizer trace, called before the thread starts
+ * @brief QueryThread::setOptimizerTrace
+ */
+void QueryThread::setOptimizerTrace(bool enabled)
+{
+    this->optimizerTrace = enabled;
+}
+
+ConnectionConfiguration QueryThread::connectionConfiguration() const
+{
+    return this->connection;
+}
+
+/**
+ * Asks the thread to read the next rows of the streamed result, called by the model
+ * @brief QueryThread::fetchMore
+ * @param rows the number of rows
+ */
+void QueryThread::fetchMore(int rows)
+{
+    QMutexLocker locker(&this->mutex);
+    this->requestedRows += rows;
+    this->condition.wakeOne();
+}
+
+/**
+ * Stops reading the streamed result, the thread ends
+ * @brief QueryThread::stopStreaming
+ */
+void QueryThread::stopStreaming()
+{
+    QMutexLocker locker(&this->mutex);
+    this->stop = true;
+    this->condition.wakeOne();
+}
+
+/**
+ * Interrupts the running statement with KILL QUERY, the connection of the thread is kept
+ * and goes back to the pool
+ * @brief QueryThread::killQuery
+ * @return the milliseconds taken by KILL QUERY, -1 if no statement has been interrupted
+ */
+qint64 QueryThread::killQuery()
+{
+    // The connection is not released while the statement is killed, the mutex of the streamed
+    // rows (fetchMore, stopStreaming) is not held during the round trip
+    QReadLocker locker(&this->connectionLock);
+    if (this->connectionId == 0) {
+        return -1;
+    }
+
+    return Util::DataBase::killQuery(this->connection, this->connectionId);
 }
 
 
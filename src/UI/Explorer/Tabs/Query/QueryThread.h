@@ -24,17 +24,41 @@
 #include <QSqlResult>
 #include <QJsonObject>
 #include <QSqlRecord>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QWaitCondition>
 #include "Util/DataBase.h"
+#include "Util/MySQLCursor.h"
+#include "Util/ResultSet.h"
+#include "Util/QueryGuardrails.h"
+
+struct QueryProfile {
+    double totalMsec; // from the start of the statement to its last row read
+    double firstRowMsec; // from the start of the statement to the first row (or the answer)
+    double fetchMsec; // reading the rows from the network
+    double decodeMsec; // converting the values of the rows
+    double modelMsec; // building the model of the view, measured by the tab
+    qint64 bytes; // size of the values read
+    qint64 rowsRead;
+    // From performance_schema, when it is enabled and readable
+    bool serverLoaded;
+    double serverMsec;
+    double lockMsec;
+    qint64 rowsExamined;
+    qint64 rowsSent;
+};
 
 struct QueryExecutionResult {
-    QList<QSqlRecord> data;
+    Util::ResultSet data;
     qint64 msec; // millisecond
+    QueryProfile profile;
     bool isSelect;
     int affectedRows;
     int rows;
     QString error;
     QString query;
     bool limitedResult;
+    bool streaming; // the next rows are sent by rowsFetched
 } ;
 
 namespace UI {
@@ -52,15 +76,48 @@ public:
     QueryThread(ConnectionConfiguration connection, QString query, QObject * parent = 0);
 	virtual ~QueryThread();
 	virtual void run();
-    void killQuery();
+    qint64 killQuery();
+    void fetchMore(int rows);
+    void stopStreaming();
+    void confirmExecution(bool confirmed);
+    void setOptimizerTrace(bool enabled);
+    void setPlanCapture(bool enabled);
+    void setCacheable(bool enabled);
+    void setGuardrails(QueryGuardrails guardrails);
+    ConnectionConfiguration connectionConfiguration() const;
 
 private:
     QString query;
-    QString connectionId;
+    quint64 connectionId; // protected by connectionLock
     ConnectionConfiguration connection;
+    QReadWriteLock connectionLock;
+    QMutex mutex;
+    QWaitCondition condition;
+    int requestedRows;
+    bool stop;
+    bool optimizerTrace;
+    bool planCapture;
+    int firstBatchSize;
+    QueryGuardrails guardrails;
+    int confirmation; // answer to confirmationRequired: 0 while waiting, 1 to execute, -1 to cancel
+
+    bool streamRows(Util::MySQLCursor &cursor);
+    bool fetchRow(Util::MySQLCursor &cursor, QueryProfile &profile);
+    static bool isCall(QString statement);
+    bool confirmEstimatedRows(QSqlDatabase database, QStringList statements);
+    void loadServerProfiles(QSqlDatabase database, int statementCount, int skippedStatements);
+    bool enableOptimizerTrace(Util::MySQLCursor &cursor, int statementCount);
+    void loadOptimizerTrace(QSqlDatabase database);
+    void loadPlans(QSqlDatabase database, QStringList statements);
 
 signals:
-    void queryResultReady(QList<QueryExecutionResult>);
+    void resultReady(QueryExecutionResult result, int statement, int statementCount);
+    void executionFinished();
+    void serverProfileReady(int statement, QueryProfile profile);
+    void optimizerTraceReady(QString query, QString trace, QString warning);
+    void planReady(int statement, QString plan);
+    void rowsFetched(Util::ResultSet rows, bool finished, bool limited, QString error);
+    void confirmationRequired(int statement, int statementCount, qint64 estimatedRows);
 };
 
 } /* namespace Query */
@@ -0,0 +1,372 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "VariantComparisonWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QMessageBox>
+#include <QLocale>
+
+// The progress bar counts per mille of the rounds
+#define PROGRESS_RANGE 1000
+// Variants compared at most, named from A
+#define MAX_VARIANTS 8
+// Threshold of the p-value of the test
+#define SIGNIFICANCE_LEVEL 0.05
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+VariantComparisonWindow::VariantComparisonWindow(QWidget *parent, ConnectionConfiguration connection, QStringList variants) :
+    QMainWindow(parent),
+    connection(connection)
+{
+    setWindowTitle(tr("Compare query variants on %1").arg(connection.databaseName.isEmpty() ? connection.hostname : connection.databaseName));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    QWidget *mainContainer = new QWidget(this);
+    QVBoxLayout *mainLayout = new QVBoxLayout(mainContainer);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+
+    QFont font;
+    font.setBold(true);
+
+    // Variants
+    QLabel *labelVariants = new QLabel(tr("Variants"), mainContainer);
+    labelVariants->setFont(font);
+    mainLayout->addWidget(labelVariants);
+
+    this->variantTabs = new QTabWidget(mainContainer);
+    mainLayout->addWidget(this->variantTabs, 1);
+
+    QWidget *variantButtons = new QWidget(mainContainer);
+    QHBoxLayout *variantButtonLayout = new QHBoxLayout(variantButtons);
+    variantButtonLayout->setContentsMargins(0, 0, 0, 0);
+    QPushButton *addButton = new QPushButton(QIcon(":/resources/icons/plus.png"), tr("Add variant"), variantButtons);
+    QPushButton *removeButton = new QPushButton(QIcon(":/resources/icons/delete-icon.png"), tr("Remove variant"), variantButtons);
+    variantButtonLayout->addWidget(addButton);
+    variantButtonLayout->addWidget(removeButton);
+    variantButtonLayout->addStretch();
+    mainLayout->addWidget(variantButtons);
+
+    foreach (QString query, variants) {
+        this->addVariant(query);
+    }
+    while (this->variantTabs->count() < 2) {
+        this->addVariant("");
+    }
+
+    // Options
+    QLabel *labelOptions = new QLabel(tr("Options"), mainContainer);
+    labelOptions->setFont(font);
+    mainLayout->addWidget(labelOptions);
+
+    this->rounds = new QSpinBox(mainContainer);
+    this->rounds->setRange(2, 1000000);
+    this->rounds->setValue(100);
+    this->rounds->setSuffix(" " + tr("executions of each variant"));
+    this->rounds->setFixedWidth(250);
+
+    this->warmup = new QSpinBox(mainContainer);
+    this->warmup->setRange(1, 10000);
+    this->warmup->setValue(3);
+    this->warmup->setSuffix(" " + tr("rounds"));
+    this->warmup->setToolTip(tr("The results of the variants are compared during the first round"));
+    this->warmup->setFixedWidth(250);
+
+    this->orderedResults = new QCheckBox(tr("The rows must be in the same order"), mainContainer);
+
+    QWidget *optionContainer = new QWidget(mainContainer);
+    QFormLayout *optionLayout = new QFormLayout(optionContainer);
+    optionLayout->setContentsMargins(30, 5, 0, 10);
+    optionLayout->addRow(tr("Measures:"), this->rounds);
+    optionLayout->addRow(tr("Warmup:"), this->warmup);
+    optionLayout->addRow(tr("Results:"), this->orderedResults);
+    mainLayout->addWidget(optionContainer);
+
+    // Results
+    QLabel *labelResults = new QLabel(tr("Results"), mainContainer);
+    labelResults->setFont(font);
+    mainLayout->addWidget(labelResults);
+
+    QWidget *progressContainer = new QWidget(mainContainer);
+    QVBoxLayout *progressLayout = new QVBoxLayout(progressContainer);
+    progressLayout->setContentsMargins(30, 5, 0, 10);
+
+    this->progressbar = new QProgressBar(progressContainer);
+    this->progressbar->setRange(0, PROGRESS_RANGE);
+    this->progressbar->setValue(0);
+    this->progressLabel = new QLabel(progressContainer);
+    this->progressLabel->setWordWrap(true);
+    this->progressLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    this->report = new QPlainTextEdit(progressContainer);
+    this->report->setReadOnly(true);
+    this->report->setFont(QFont("DejaVu Sans Mono"));
+    this->report->setLineWrapMode(QPlainTextEdit::NoWrap);
+
+    progressLayout->addWidget(this->progressbar);
+    progressLayout->addWidget(this->progressLabel);
+    progressLayout->addWidget(this->report);
+    mainLayout->addWidget(progressContainer, 1);
+
+    QWidget *buttonContainer = new QWidget(this);
+    QHBoxLayout *buttonLayout = new QHBoxLayout(buttonContainer);
+    this->startButton = new QPushButton(tr("Start"), this);
+    this->stopButton = new QPushButton(tr("Stop"), this);
+    QPushButton *closeButton = new QPushButton(tr("Close"), this);
+    buttonLayout->addWidget(this->startButton, 0, Qt::AlignRight);
+    buttonLayout->addWidget(this->stopButton, 0, Qt::AlignRight);
+    buttonLayout->addWidget(closeButton, 0, Qt::AlignRight);
+    buttonLayout->setAlignment(Qt::AlignRight);
+    buttonLayout->setContentsMargins(0, 0, 0, 0);
+    this->stopButton->hide();
+
+    mainLayout->addWidget(buttonContainer);
+
+    this->setCentralWidget(mainContainer);
+    this->resize(900, 800);
+
+    this->timer = new QTimer(this);
+
+    // Events
+    connect(addButton, SIGNAL(released()), SLOT(handleAddVariant()));
+    connect(removeButton, SIGNAL(released()), SLOT(handleRemoveVariant()));
+    connect(closeButton, SIGNAL(released()), SLOT(handleClose()));
+    connect(this->startButton, SIGNAL(released()), SLOT(handleStart()));
+    connect(this->stopButton, SIGNAL(released()), SLOT(handleStop()));
+    connect(this->timer, SIGNAL(timeout()), SLOT(handleTimer()));
+}
+
+void VariantComparisonWindow::addVariant(QString query)
+{
+    QPlainTextEdit *editor = new QPlainTextEdit(this->variantTabs);
+    editor->setFont(QFont("DejaVu Sans Mono"));
+    editor->setPlainText(query);
+    this->variantTabs->addTab(editor, QString(QChar('A' + this->variantTabs->count())));
+}
+
+void VariantComparisonWindow::handleAddVariant()
+{
+    if (this->variantTabs->count() >= MAX_VARIANTS) {
+        return;
+    }
+
+    this->addVariant("");
+    this->variantTabs->setCurrentIndex(this->variantTabs->count() - 1);
+}
+
+/**
+ * Removes the current variant, the next ones are renamed
+ * @brief VariantComparisonWindow::handleRemoveVariant
+ */
+void VariantComparisonWindow::handleRemoveVariant()
+{
+    if (this->variantTabs->count() <= 2) {
+        return;
+    }
+
+    QWidget *editor = this->variantTabs->currentWidget();
+    this->variantTabs->removeTab(this->variantTabs->currentIndex());
+    delete editor;
+
+    for (int i = 0; i < this->variantTabs->count(); i++) {
+        this->variantTabs->setTabText(i, QString(QChar('A' + i)));
+    }
+}
+
+/**
+ * Starts the comparison in a background thread
+ * @brief VariantComparisonWindow::handleStart
+ */
+void VariantComparisonWindow::handleStart()
+{
+    QStringList variants;
+    for (int i = 0; i < this->variantTabs->count(); i++) {
+        QString query = qobject_cast<QPlainTextEdit *>(this->variantTabs->widget(i))->toPlainText().trimmed();
+        if (query.isEmpty()) {
+            QMessageBox::warning(this, "", tr("The variant %1 is empty").arg(this->variantTabs->tabText(i)));
+            return;
+        }
+        variants << query;
+    }
+
+    this->startButton->hide();
+    this->stopButton->show();
+    this->variantTabs->setEnabled(false);
+
+    this->comparisonWorker = new Util::VariantComparison(this->connection, variants);
+    this->comparisonWorker->setRounds(this->rounds->value());
+    this->comparisonWorker->setWarmup(this->warmup->value());
+    this->comparisonWorker->setOrdered(this->orderedResults->isChecked());
+
+    this->workerThread = new QThread();
+    this->comparisonWorker->moveToThread(this->workerThread);
+
+    connect(this->workerThread, &QThread::finished, this->comparisonWorker, &QObject::deleteLater);
+    connect(this->workerThread, &QThread::finished, this->workerThread, &QObject::deleteLater);
+    connect(this, SIGNAL(startComparison()), this->comparisonWorker, SLOT(execute()));
+    connect(this->comparisonWorker, SIGNAL(executionFinished(bool)), SLOT(handleComparisonFinished(bool)));
+
+    this->workerThread->start();
+
+    this->progressbar->setValue(0);
+    this->progressLabel->clear();
+    this->report->clear();
+    this->timer->start(500);
+
+    emit startComparison();
+}
+
+/**
+ * Refreshes the progress and the statistics measured so far
+ * @brief VariantComparisonWindow::handleTimer
+ */
+void VariantComparisonWindow::handleTimer()
+{
+    if (this->comparisonWorker == nullptr) {
+        return;
+    }
+
+    VariantComparisonStatus status = this->comparisonWorker->getStatus();
+    this->progressbar->setValue(status.round * PROGRESS_RANGE / qMax(1, status.rounds));
+    this->progressLabel->setText(QString(tr("Round %1 of %2 (%3 warmup)")).arg(status.round).arg(status.rounds).arg(this->warmup->value()));
+    this->report->setPlainText(this->formatReport(status));
+}
+
+/**
+ * @return the latencies of each variant and the conclusion of the test against the variant A
+ */
+QString VariantComparisonWindow::formatReport(VariantComparisonStatus status)
+{
+    QLocale locale(QLocale::English);
+    QStringList lines;
+
+    if (!status.lastError.isEmpty()) {
+        lines << QString(tr("Error: %1")).arg(status.lastError) << "";
+    }
+
+    if (status.round == 0) {
+        return lines.join("\n");
+    } else if (!status.resultsMatch) {
+        lines << tr("WARNING: the variants do not return the same result, the comparison is not valid");
+        for (int i = 0; i < status.variants.size(); i++) {
+            lines << QString(tr("  %1: %2 rows, hash %3")).arg(QChar('A' + i))
+                     .arg(locale.toString(status.variants.at(i).rows)).arg(QString(status.variants.at(i).hash));
+        }
+    } else {
+        lines << QString(tr("All the variants return the same result (%1 rows)")).arg(locale.toString(status.variants.first().rows));
+    }
+    lines << "";
+
+    lines << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+             .arg(tr("Variant"), -8).arg(tr("Runs"), 8).arg(tr("Median"), 10).arg(tr("p90"), 10).arg(tr("Mean"), 10)
+             .arg(tr("Min"), 10).arg(tr("Max"), 10).arg(tr("vs A"), 9).arg(tr("p-value"), 9);
+
+    for (int i = 0; i < status.variants.size(); i++) {
+        VariantStatistics variant = status.variants.at(i);
+        if (variant.latencies.isEmpty()) {
+            lines << QString("%1 %2").arg(QString(QChar('A' + i)), -8).arg(0, 8);
+            continue;
+        }
+
+        lines << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+                 .arg(QString(QChar('A' + i)), -8)
+                 .arg(variant.latencies.size(), 8)
+                 .arg(locale.toString(variant.median, 'f', 3), 10)
+                 .arg(locale.toString(variant.p90, 'f', 3), 10)
+                 .arg(locale.toString(variant.mean, 'f', 3), 10)
+                 .arg(locale.toString(variant.min, 'f', 3), 10)
+                 .arg(locale.toString(variant.max, 'f', 3), 10)
+                 .arg(i == 0 ? "" : locale.toString(variant.change * 100, 'f', 1) + "%", 9)
+                 .arg(variant.pValue < 0 ? "" : locale.toString(variant.pValue, 'g', 3), 9);
+    }
+    lines << tr("(latencies in ms)") << "";
+
+    // Conclusion of the Mann-Whitney test for each variant
+    for (int i = 1; i < status.variants.size(); i++) {
+        VariantStatistics variant = status.variants.at(i);
+        QString name = QString(QChar('A' + i));
+        if (variant.pValue < 0) {
+            lines << QString(tr("%1: not enough measures")).arg(name);
+        } else if (variant.pValue >= SIGNIFICANCE_LEVEL) {
+            lines << QString(tr("%1: no significant difference with A (p = %2)")).arg(name).arg(locale.toString(variant.pValue, 'g', 3));
+        } else {
+            lines << QString(tr("%1 is %2% %3 than A (median, p = %4, significant at 5%)")).arg(name)
+                     .arg(locale.toString(qAbs(variant.change) * 100, 'f', 1))
+                     .arg(variant.change < 0 ? tr("faster") : tr("slower"))
+                     .arg(locale.toString(variant.pValue, 'g', 3));
+        }
+    }
+
+    return lines.join("\n");
+}
+
+/**
+ * Called when all the rounds are done, or on the first error
+ * @brief VariantComparisonWindow::handleComparisonFinished
+ * @param stopped true when the user has stopped the comparison
+ */
+void VariantComparisonWindow::handleComparisonFinished(bool stopped)
+{
+    this->timer->stop();
+    VariantComparisonStatus status = this->comparisonWorker->getStatus();
+
+    this->progressbar->setValue(stopped || !status.lastError.isEmpty() ? this->progressbar->value() : PROGRESS_RANGE);
+    this->progressLabel->setText(stopped ? tr("Stopped") : (status.lastError.isEmpty() ? tr("Finished") : tr("Failed")));
+    this->report->setPlainText(this->formatReport(status));
+
+    // The worker is deleted with its thread
+    this->workerThread->quit();
+    this->workerThread = nullptr;
+    this->comparisonWorker = nullptr;
+    this->startButton->show();
+    this->stopButton->hide();
+    this->variantTabs->setEnabled(true);
+}
+
+/**
+ * The comparison stops after the current execution
+ * @brief VariantComparisonWindow::handleStop
+ */
+void VariantComparisonWindow::handleStop()
+{
+    if (this->comparisonWorker != nullptr) {
+        this->comparisonWorker->stopRequired();
+    }
+}
+
+void VariantComparisonWindow::handleClose()
+{
+    this->handleStop();
+    this->close();
+}
+
+VariantComparisonWindow::~VariantComparisonWindow()
+{
+    if (this->comparisonWorker != nullptr) {
+        // The thread ends with the comparison
+        connect(this->comparisonWorker, SIGNAL(executionFinished(bool)), this->workerThread, SLOT(quit()));
+        this->comparisonWorker->stopRequired();
+    }
+}
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef UI_EXPLORER_TABS_QUERY_VARIANTCOMPARISONWINDOW_H_
+#define UI_EXPLORER_TABS_QUERY_VARIANTCOMPARISONWINDOW_H_
+
+#include <QMainWindow>
+#include <QPushButton>
+#include <QTabWidget>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QThread>
+#include <QProgressBar>
+#include <QTimer>
+#include "Util/DataBase.h"
+#include "Util/VariantComparison.h"
+
+namespace UI {
+namespace Explorer {
+namespace Tabs {
+namespace Query {
+
+/**
+ * Executes several versions of a query alternately and tells which one is the fastest
+ */
+class VariantComparisonWindow : public QMainWindow
+{
+    Q_OBJECT
+public:
+    explicit VariantComparisonWindow(QWidget *parent, ConnectionConfiguration connection, QStringList variants);
+    virtual ~VariantComparisonWindow();
+
+private:
+    ConnectionConfiguration connection;
+    QThread *workerThread = nullptr;
+    Util::VariantComparison *comparisonWorker = nullptr;
+    QTabWidget *variantTabs;
+    QSpinBox *rounds;
+    QSpinBox *warmup;
+    QCheckBox *orderedResults;
+    QPushButton *startButton;
+    QPushButton *stopButton;
+    QProgressBar *progressbar;
+    QLabel *progressLabel;
+    QPlainTextEdit *report;
+    QTimer *timer;
+
+    void addVariant(QString query);
+    QString formatReport(VariantComparisonStatus status);
+
+signals:
+    void startComparison();
+
+public slots:
+    void handleAddVariant();
+    void handleRemoveVariant();
+    void handleStart();
+    void handleStop();
+    void handleClose();
+    void handleComparisonFinished(bool stopped);
+    void handleTimer();
+};
+
+} /* namespace Query */
+} /* namespace Tabs */
+} /* namespace Explorer */
+} /* namespace UI */
+
+#endif /* UI_EXPLORER_TABS_QUERY_VARIANTCOMPARISONWINDOW_H_ */
@@ -16,24 +16,57 @@
 **/
 
 #include "ServerTab.h"
-#include <QSqlQueryModel>
+#include <QStandardItemModel>
 #include <QHeaderView>
+#include "Util/DataBase.h"
+#include "Util/MetadataService.h"
 
 ServerTab::ServerTab(QWidget *parent) : QTableView(parent)
 {
-    QSqlQueryModel *model = new QSqlQueryModel(this);
-    model->setQuery("SHOW DATABASES");
+    this->metadataKey = QString("ServerTab/%1").arg(quintptr(this));
+
+    QStandardItemModel *model = new QStandardItemModel(this);
+    model->setHorizontalHeaderLabels(QStringList() << "Database");
 
     this->setModel(model);
-    this->resizeColumnsToContents();
     this->verticalHeader()->hide();
 
+    Util::MetadataService *metadata = Util::MetadataService::instance();
+    connect(metadata, SIGNAL(resultReady(QString,QList<Util::ResultSet>)), SLOT(handleMetadataReady(QString,QList<Util::ResultSet>)));
     connect(this, SIGNAL(doubleClicked(QModelIndex)), SLOT(handleDoubleClicked(QModelIndex)));
+
+    this->reload();
 }
 
+/**
+ * Asks the database list of the current server to the metadata service
+ * @brief ServerTab::reload
+ */
 void ServerTab::reload()
 {
-    ((QSqlQueryModel * )this->model())->setQuery("SHOW DATABASES");
+    QSqlDatabase db = Util::DataBase::current();
+    if (!db.isValid()) {
+        return;
+    }
+
+    Util::MetadataService::instance()->request(this->metadataKey, Util::DataBase::dumpConfiguration(db), QStringList() << "SHOW DATABASES");
+}
+
+void ServerTab::handleMetadataReady(QString key, QList<Util::ResultSet> results)
+{
+    if (key != this->metadataKey || results.isEmpty()) {
+        return;
+    }
+
+    QStandardItemModel *model = (QStandardItemModel *)this->model();
+    model->removeRows(0, model->rowCount());
+
+    Util::ResultSet databases = results.first();
+    for (int i = 0; i < databases.rowCount(); i++) {
+        model->appendRow(new QStandardItem(databases.value(i, 0).toString()));
+    }
+
+    this->resizeColumnsToContents();
 }
 
 void ServerTab::handleDoubleClicked(QModelIndex index)
@@ -43,5 +76,5 @@ void ServerTab::handleDoubleClicked(QModelIndex index)
 }
 
 ServerTab::~ServerTab() {
-
+    Util::MetadataService::instance()->cancel(this->metadataKey);
 }
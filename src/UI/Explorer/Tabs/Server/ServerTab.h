@@ -20,6 +20,7 @@
 
 #include <QTableView>
 #include <QWidget>
+#include "Util/ResultSet.h"
 
 class ServerTab : public QTableView
 {
@@ -33,8 +34,14 @@ public:
 public slots:
     void handleDoubleClicked(QModelIndex index);
 
+private slots:
+    void handleMetadataReady(QString key, QList<Util::ResultSet> results);
+
 signals:
     void showDatabase(QString databaseName);
+
+private:
+    QString metadataKey;
 };
 
 #endif // SERVERTAB_H
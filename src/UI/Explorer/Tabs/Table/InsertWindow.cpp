@@ -31,6 +31,8 @@
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include "UI/Explorer/Tabs/SQLSyntaxHighlighter.h"
+#include "Util/DataBase.h"
+#include "Util/ResultCache.h"
 
 
 namespace UI {
@@ -215,6 +217,7 @@ void InsertWindow::handleInsert()
 {
     QSqlQuery insertQuery(this->connection);
     if (insertQuery.exec(insertStatement->toPlainText())) {
+        Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(this->connection), insertStatement->toPlainText());
         emit insertDone();
         this->close();
     } else {
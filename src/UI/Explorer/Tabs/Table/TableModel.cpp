@@ -25,6 +25,13 @@
 #include <QColor>
 #include <QDateTime>
 #include <QDate>
+#include "Util/MySQLCursor.h"
+#include "Util/MetadataService.h"
+#include "Util/DataBase.h"
+#include "Util/ResultCache.h"
+
+// Converted cells kept by the model, a few screens of the view
+#define CELL_CACHE_SIZE 4096
 
 namespace UI {
 namespace Explorer {
@@ -32,12 +39,18 @@ namespace Tabs {
 namespace Table {
 
 TableModel::TableModel(QObject * parent) : QAbstractTableModel(parent) {
+	this->cells.setMaxCost(CELL_CACHE_SIZE);
+	this->estimatedRowCount = -1;
+	this->metadataKey = QString("TableModel/%1").arg(quintptr(this));
 
-
+	Util::MetadataService *metadata = Util::MetadataService::instance();
+	connect(metadata, SIGNAL(resultReady(QString,QList<Util::ResultSet>)), SLOT(handleMetadataReady(QString,QList<Util::ResultSet>)));
+	connect(metadata, SIGNAL(requestFailed(QString,QString)), SLOT(handleMetadataFailed(QString,QString)));
 }
 
 void TableModel::setTable(QSqlDatabase database, QString table, QString filter){
 
+    beginResetModel();
     this->database = database;
 	this->table = table;
 	this->sortOrder = "";
@@ -45,52 +58,75 @@ void TableModel::setTable(QSqlDatabase database, QString table, QString filter){
     this->columns = QList<QString>();
     this->primaryKey = QStringList();
     this->foreignKeys = QHash<QString, QStringList>();
+    this->estimatedRowCount = -1;
+    this->results = Util::ResultSet();
+    this->cells.clear();
+    endResetModel();
+
+    // The columns and the keys are read by the metadata service, the rows are loaded when they are known
+    QString databaseName = this->database.databaseName();
+    QStringList queries;
+    queries << QString("SHOW COLUMNS FROM `%1` FROM `%2`").arg(table).arg(databaseName);
+    queries << QString("SHOW INDEX FROM `%1` FROM `%2` WHERE Key_name LIKE 'PRIMARY'").arg(table).arg(databaseName);
+    queries << QString("SELECT COLUMN_NAME, REFERENCED_TABLE_NAME, REFERENCED_COLUMN_NAME FROM INFORMATION_SCHEMA.KEY_COLUMN_USAGE WHERE TABLE_SCHEMA = '%1' AND TABLE_NAME = '%2' AND REFERENCED_TABLE_NAME IS NOT NULL").arg(databaseName).arg(table);
+    queries << QString("SHOW TABLE STATUS FROM `%1` LIKE '%2'").arg(databaseName).arg(table);
+
+    Util::MetadataService::instance()->request(this->metadataKey, Util::DataBase::dumpConfiguration(this->database), queries);
+}
 
-
-    if (!this->database.isOpen() && !this->database.open()) {
-        qWarning() << "TableModel::setTable - Unable to open the connection - " + this->database.lastError().text();
-        return ;
+/**
+ * Receives the columns, the primary key, the foreign keys and the status of the table, then loads the rows
+ * @brief TableModel::handleMetadataReady
+ * @param key the key of the request
+ * @param results the result of each query of setTable
+ */
+void TableModel::handleMetadataReady(QString key, QList<Util::ResultSet> results)
+{
+    if (key != this->metadataKey || results.size() < 4) {
+        return;
     }
 
-    QSqlQuery query(this->database);
-	if (query.exec(QString("SHOW COLUMNS FROM %1").arg(this->table))) {
+    Util::ResultSet columns = results.at(0);
+    int fieldColumn = columns.indexOf("Field");
+    for (int i = 0; i < columns.rowCount(); i++) {
+        this->columns.append(columns.value(i, fieldColumn).toString());
+    }
 
-		while(query.next()){
-			this->columns.append(query.value("Field").toString());
-		}
+    Util::ResultSet index = results.at(1);
+    int columnNameColumn = index.indexOf("Column_name");
+    for (int i = 0; i < index.rowCount(); i++) {
+        this->primaryKey << index.value(i, columnNameColumn).toString();
+    }
 
-        QSqlQuery queryIndex(this->database);
-		if (queryIndex.exec(QString("SHOW INDEX FROM %1 WHERE Key_name LIKE 'PRIMARY'").arg(this->table))) {
+    Util::ResultSet references = results.at(2);
+    for (int i = 0; i < references.rowCount(); i++) {
+        QStringList fk;
+        fk << references.value(i, 1).toString(); // Referenced table
+        fk << references.value(i, 2).toString(); // Referenced column
+        this->foreignKeys.insert(references.value(i, 0).toString(), fk);
+    }
 
-			while(queryIndex.next()){
-				this->primaryKey << queryIndex.value("Column_name").toString();
-			}
+    Util::ResultSet status = results.at(3);
+    if (!status.isEmpty()) {
+        this->estimatedRowCount = status.value(0, status.indexOf("Rows")).toLongLong();
+    }
 
-			this->reload();
-		} else {
-			qDebug() << "TableModel::setTable - " + queryIndex.lastError().text();
-		}
+    emit metadataLoaded();
 
-        // Finds the foreign keys
-        QString queryString = QString("SELECT  COLUMN_NAME, REFERENCED_TABLE_NAME, REFERENCED_COLUMN_NAME FROM INFORMATION_SCHEMA.KEY_COLUMN_USAGE WHERE TABLE_SCHEMA = '%1'  AND TABLE_NAME = '%2' AND REFERENCED_TABLE_NAME IS NOT NULL").arg(this->database.databaseName()).arg(table);
-        QSqlQuery queryFK(this->database);
-        if (query.exec(queryString)) {
-            while (query.next()) {
-                QStringList fk;
-                fk << query.value(1).toString(); // Referenced table
-                fk << query.value(2).toString(); // Referenced column
-                this->foreignKeys.insert(query.value(0).toString(), fk);
-            }
-        }
+    this->reload();
+}
 
-	} else {
-		qDebug() << "TableModel::setTable - " + query.lastError().text();
-	}
+void TableModel::handleMetadataFailed(QString key, QString error)
+{
+    if (key == this->metadataKey) {
+        qDebug() << "TableModel::setTable - " + error;
+        emit queryError("", error);
+    }
 }
 
 int TableModel::rowCount(const QModelIndex & parent) const
 {
-	return this->results.size();
+	return this->results.rowCount();
 }
 
 int TableModel::columnCount(const QModelIndex & parent) const
@@ -124,6 +160,15 @@ QHash<QString,QStringList> TableModel::getForeignKeys()
     return this->foreignKeys;
 }
 
+/**
+ * @brief TableModel::getEstimatedRowCount
+ * @return the number of rows from the table statistics, -1 if it is not loaded
+ */
+qint64 TableModel::getEstimatedRowCount()
+{
+    return this->estimatedRowCount;
+}
+
 void TableModel::sort(int column, Qt::SortOrder order){
 	if (column >= this->columns.count()){
 		return ;
@@ -174,16 +219,16 @@ Qt::ItemFlags TableModel::flags(const QModelIndex &index) const
 
 bool TableModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-    if (index.isValid() && role == Qt::EditRole && index.row() < this->results.count()) {
+    if (index.isValid() && role == Qt::EditRole && index.row() < this->results.rowCount()) {
 
-    	QSqlRecord record = this->results.at(index.row());
+    	int row = index.row();
 
         // The value is not changed
-        if (value == record.value(index.column())) {
+        if (value == this->cellValue(row, index.column())) {
             return false;
         }
 
-    	QString columnName = record.fieldName(index.column());
+    	QString columnName = this->results.fieldName(index.column());
 
         QString updateQuery = QString("UPDATE %1 SET %2=:new_%3 WHERE ").arg(this->table).arg(columnName).arg(columnName);
     	QStringList where;
@@ -194,8 +239,8 @@ bool TableModel::setData(const QModelIndex &index, const QVariant &value, int ro
             }
         } else {
             // There is no primary key for this table
-            for (int i = 0; i < record.count(); i++) {
-                where << QString("%1=:%2").arg(record.fieldName(i)).arg(record.fieldName(i));
+            for (int i = 0; i < this->results.columnCount(); i++) {
+                where << QString("%1=:%2").arg(this->results.fieldName(i)).arg(this->results.fieldName(i));
             }
         }
 
@@ -211,18 +256,19 @@ bool TableModel::setData(const QModelIndex &index, const QVariant &value, int ro
 
         if (!this->primaryKey.isEmpty()) {
             foreach(QString primaryKeyIndex, this->primaryKey) {
-                query.bindValue(":"+primaryKeyIndex, record.value(primaryKeyIndex));
+                query.bindValue(":"+primaryKeyIndex, this->results.value(row, this->results.indexOf(primaryKeyIndex)));
             }
         } else {
             // There is no primary key for this table
-            for (int i = 0; i < record.count(); i++) {
-                query.bindValue(":"+record.fieldName(i), record.value(i));
+            for (int i = 0; i < this->results.columnCount(); i++) {
+                query.bindValue(":"+this->results.fieldName(i), this->results.value(row, i));
             }
         }
 
         if (query.exec()){
-    		record.setValue(index.column(), value);
-    		this->results.replace(index.row(), record);
+    		Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(this->database), updateQuery);
+    		this->results.setValue(row, index.column(), value);
+    		this->cells.remove((quint64(row) << 32) | quint32(index.column()));
     		emit dataChanged(index, index);
     		return true;
     	} else {
@@ -237,9 +283,8 @@ bool TableModel::setData(const QModelIndex &index, const QVariant &value, int ro
 
 QVariant TableModel::data(const QModelIndex &index, int role) const
 {
-    if ((role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::FontRole) && index.isValid() && index.row() < this->results.size()) {
-		QSqlRecord record = this->results.at(index.row());
-        QVariant value = record.value(index.column());
+    if ((role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::FontRole) && index.isValid() && index.row() < this->results.rowCount()) {
+        QVariant value = this->cellValue(index.row(), index.column());
 
         if (role == Qt::DisplayRole || role == Qt::EditRole) {
             if (value.isNull() && role == Qt::DisplayRole) {
@@ -259,10 +304,9 @@ QVariant TableModel::data(const QModelIndex &index, int role) const
         }
     }
 
-    if(role == Qt::ForegroundRole && index.isValid() && index.row() < this->results.size())
+    if(role == Qt::ForegroundRole && index.isValid() && index.row() < this->results.rowCount())
     {
-        QSqlRecord record = this->results.at(index.row());
-        QString column = record.fieldName(index.column());
+        QString column = this->results.fieldName(index.column());
         if (this->foreignKeys.contains(column)) {
             return QVariant::fromValue(QColor(Qt::blue));
         }
@@ -274,7 +318,7 @@ QVariant TableModel::data(const QModelIndex &index, int role) const
 bool TableModel::removeRows(int row, int count, const QModelIndex & parent)
 {
 	int lastRow = row + count -1;
-	if (this->results.count() < row || this->results.count() <= lastRow) {
+	if (this->results.rowCount() < row || this->results.rowCount() <= lastRow) {
 		return false;
 	}
 
@@ -282,17 +326,12 @@ bool TableModel::removeRows(int row, int count, const QModelIndex & parent)
 	QString deleteQuery = QString("DELETE FROM %1 WHERE ").arg(this->table);
 	QStringList orStatement;
 
-	QList<QSqlRecord> recordToRemove;
-
 	for (int i = row; i <= lastRow; i++) {
 
-		QSqlRecord record = this->results.at(i);
-		recordToRemove << record;
-
 		// Adds a WHERE condition with the primary key for the current record
 		QStringList where;
 		foreach(QString primaryKeyIndex, this->primaryKey) {
-			where << QString("%1='%2'").arg(primaryKeyIndex).arg(record.value(primaryKeyIndex).toString());
+			where << QString("%1='%2'").arg(primaryKeyIndex).arg(this->results.value(i, this->results.indexOf(primaryKeyIndex)).toString());
 		}
 
 		orStatement << where.join(" AND ");
@@ -313,12 +352,14 @@ bool TableModel::removeRows(int row, int count, const QModelIndex & parent)
 		emit queryError("", query.lastError().text());
 		return false;
 	}
+	Util::ResultCache::instance()->invalidate(Util::DataBase::dumpConfiguration(this->database), deleteQuery);
 
 	beginRemoveRows(parent, row, lastRow);
 
-	foreach (QSqlRecord record, recordToRemove) {
-		this->results.removeOne(record);
+	for (int i = lastRow; i >= row; i--) {
+		this->results.removeRow(i);
 	}
+	this->cells.clear();
 
 	endRemoveRows();
 	return true;
@@ -331,26 +372,53 @@ void TableModel::reload()
     }
 
 	QString sql = this->buildQuery();
-    QSqlQuery query(this->database);
-    query.exec(sql);
 
-    if (query.lastError().isValid()){
+	// The rows are kept as sent by the server and converted when they are displayed
+	Util::MySQLCursor cursor(this->database);
+	if (!cursor.exec(sql)) {
 		this->filter = "";
-        qDebug() << "TableModel::reload - " + query.lastError().text();
-        QString lastError =  query.lastError().text();
-		emit queryError("", lastError);
+		qDebug() << "TableModel::reload - " + cursor.lastError();
+		emit queryError("", cursor.lastError());
 	} else {
-		this->results = QList<QSqlRecord>();
-        while (query.next()) {
-            this->results << query.record();
+		Util::ResultSet results(cursor.record());
+		while (cursor.next()) {
+			results.appendRow(cursor);
 		}
 
+		if (!cursor.lastError().isEmpty()) {
+			qDebug() << "TableModel::reload - " + cursor.lastError();
+			emit queryError("", cursor.lastError());
+		}
+
+		this->results = results;
+		this->cells.clear();
 		emit layoutChanged();
 	}
 }
 
+/**
+ * Same cache as the query results, invalidated when a row is edited or removed
+ * @brief TableModel::cellValue
+ * @param row the row number
+ * @param column the column number
+ * @return the value of the cell
+ */
+QVariant TableModel::cellValue(int row, int column) const
+{
+	quint64 key = (quint64(row) << 32) | quint32(column);
+	QVariant *cached = this->cells.object(key);
+	if (cached != nullptr) {
+		return *cached;
+	}
+
+	QVariant value = this->results.value(row, column);
+	this->cells.insert(key, new QVariant(value));
+
+	return value;
+}
+
 TableModel::~TableModel() {
-    this->database.close();
+	Util::MetadataService::instance()->cancel(this->metadataKey);
 }
 
 } /* namespace Model */
@@ -26,6 +26,8 @@
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QAbstractTableModel>
+#include <QCache>
+#include "Util/ResultSet.h"
 
 
 namespace UI {
@@ -51,12 +53,18 @@ public:
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
     void reload();
     QHash<QString,QStringList> getForeignKeys();
+    qint64 getEstimatedRowCount();
 
 public slots:
 	void refreshWithFilter(QString filter);
 
+private slots:
+    void handleMetadataReady(QString key, QList<Util::ResultSet> results);
+    void handleMetadataFailed(QString key, QString error);
+
 signals:
 	void queryError(QString query, QString error);
+	void metadataLoaded();
 
 private:
 	QString table;
@@ -66,9 +74,13 @@ private:
 	QStringList primaryKey;
 	void sort(int column, Qt::SortOrder order);
 	QString buildQuery();
-	QList<QSqlRecord> results;
+	Util::ResultSet results;
+	mutable QCache<quint64, QVariant> cells;
+	QVariant cellValue(int row, int column) const;
     QSqlDatabase database;
     QHash<QString, QStringList> foreignKeys;
+    qint64 estimatedRowCount;
+    QString metadataKey;
 };
 
 } /* namespace Table */
@@ -36,6 +36,7 @@
 #include <QInputDialog>
 #include <QShortcut>
 #include "TableModel.h"
+#include "Util/DataBase.h"
 
 namespace UI {
 namespace Explorer {
@@ -96,6 +97,7 @@ TableTab::TableTab(QWidget *parent) : QSplitter(parent) {
 	connect(queryModel, SIGNAL(queryError(QString, QString)), this, SLOT(queryError(QString, QString)));
     connect(filterButton, SIGNAL(clicked(bool)), SLOT(applyFilterClicked()));
     connect(queryModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), SLOT(dataUpdatedSuccessfully()));
+    connect(queryModel, SIGNAL(metadataLoaded()), SLOT(handleMetadataLoaded()));
 
 }
 
@@ -106,9 +108,7 @@ void TableTab::refreshData()
 
 void TableTab::applyFilterClicked()
 {
-    QSqlDatabase database = QSqlDatabase::database();
-
-    QString key = database.hostName() + ":" + database.databaseName() + ":" + this->tableName;
+    QString key = this->database.hostName() + ":" + this->database.databaseName() + ":" + this->tableName;
     this->savedFilter.insert(key, this->whereConditionText->toPlainText());
 
 	((TableModel *)this->tableData->model())->refreshWithFilter(this->whereConditionText->toPlainText());
@@ -133,51 +133,51 @@ void TableTab::setTable(QSqlDatabase database, QString tableName) {
 
 /**
  * Load the table data, the first 1000 lines and initializes the
- * autocompleter for the filter part.
+ * autocompleter for the filter part when the columns are known.
  */
 void TableTab::loadData()
 {
     if (!this->loaded) {
         TableModel *queryModel = (TableModel *)this->tableData->model();
+        this->tableInfoLabel->setText("");
         queryModel->setTable(database, this->tableName, this->whereConditionText->toPlainText());
+        this->loaded = true;
+    }
+}
 
-        int i = 0;
-        foreach(QString col, queryModel->getColumns()) {
-            int size = col.size() * 15;
-            if (size < 100) {
-                size = 100;
-            }
-            this->tableData->setColumnWidth(i++, size);
-        }
+/**
+ * Sizes the columns, shows the row estimation and fills the autocompleter
+ * @brief TableTab::handleMetadataLoaded
+ */
+void TableTab::handleMetadataLoaded()
+{
+    TableModel *queryModel = (TableModel *)this->tableData->model();
 
-        QSqlQuery query(this->database);
-        query.prepare("SHOW TABLE STATUS WHERE Name LIKE :table");
-        query.bindValue(":table", this->tableName);
-        query.exec();
+    int i = 0;
+    foreach(QString col, queryModel->getColumns()) {
+        int size = col.size() * 15;
+        if (size < 100) {
+            size = 100;
+        }
+        this->tableData->setColumnWidth(i++, size);
+    }
 
-        if (query.lastError().isValid()) {
-            qDebug() << "TableTab::setTable - " + query.lastError().text();
-            this->tableInfoLabel->setText("");
+    qint64 rows = queryModel->getEstimatedRowCount();
+    if (rows < 0) {
+        this->tableInfoLabel->setText("");
+    } else {
+        QString rowCount = QLocale(QLocale::English).toString(rows);
+        if (rows > 1000){
+            this->tableInfoLabel->setText(QString(tr("%1.%2: %3 rows (approximately), limited to 1000")).arg(this->database.databaseName()).arg(this->tableName).arg(rowCount));
         } else {
-            if (query.next()){
-                int rows = query.value(4).toInt();
-                QString rowCount = QLocale(QLocale::English).toString(rows);
-                if (rows > 1000){
-                    this->tableInfoLabel->setText(QString(tr("%1.%2: %3 rows (approximately), limited to 1000")).arg(this->database.databaseName()).arg(this->tableName).arg(rowCount));
-                } else {
-                    this->tableInfoLabel->setText(QString(tr("%1.%2: %3 rows (approximately)")).arg(this->database.databaseName()).arg(this->tableName).arg(rowCount));
-                }
-            } else {
-                this->tableInfoLabel->setText("");
-            }
+            this->tableInfoLabel->setText(QString(tr("%1.%2: %3 rows (approximately)")).arg(this->database.databaseName()).arg(this->tableName).arg(rowCount));
         }
+    }
 
-        QCompleter *completer = this->whereConditionText->getAutocomplete();
+    QCompleter *completer = this->whereConditionText->getAutocomplete();
 
-        QStringListModel *model =  new QStringListModel(QStringList(queryModel->getColumns()), completer);
-        completer->setModel(model);
-        this->loaded = true;
-    }
+    QStringListModel *model =  new QStringListModel(QStringList(queryModel->getColumns()), completer);
+    completer->setModel(model);
 }
 
 void TableTab::customContextMenuRequested(QPoint point)
@@ -460,6 +460,8 @@ void TableTab::hideNotification()
 }
 
 TableTab::~TableTab() {
+    // The connection of a table opened in a new tab comes from the pool
+    Util::DataBase::release(this->database);
 }
 
 } /* namespace Table */
@@ -59,6 +59,7 @@ public slots:
     void hideNotification();
     void dataUpdatedSuccessfully();
     void handleGoToForeignKeyAction();
+    void handleMetadataLoaded();
 
 signals:
     void openForeignKeyInTab(QSqlDatabase connection, QString table, QString whereCondition);
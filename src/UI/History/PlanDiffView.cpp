@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "PlanDiffView.h"
+#include "Util/ExplainPlan.h"
+#include <QVBoxLayout>
+#include <QSplitter>
+#include <QScrollBar>
+#include <QVector>
+
+// Background of the operations removed from the previous plan, and added in the new one
+#define REMOVED_COLOR "#ffd7d7"
+#define ADDED_COLOR "#d7f5d7"
+
+namespace UI {
+    namespace History {
+        PlanDiffView::PlanDiffView(QWidget *parent) : QWidget(parent)
+        {
+            QVBoxLayout *layout = new QVBoxLayout(this);
+
+            this->summaryLabel = new QLabel(this);
+            this->summaryLabel->setWordWrap(true);
+            this->summaryLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+            layout->addWidget(this->summaryLabel);
+
+            QSplitter *splitter = new QSplitter(Qt::Horizontal, this);
+
+            QWidget *previousContainer = new QWidget(splitter);
+            QVBoxLayout *previousLayout = new QVBoxLayout(previousContainer);
+            previousLayout->setContentsMargins(0, 0, 0, 0);
+            this->previousTitle = new QLabel(previousContainer);
+            this->previousText = new QTextEdit(previousContainer);
+            this->previousText->setReadOnly(true);
+            this->previousText->setLineWrapMode(QTextEdit::NoWrap);
+            previousLayout->addWidget(this->previousTitle);
+            previousLayout->addWidget(this->previousText);
+
+            QWidget *currentContainer = new QWidget(splitter);
+            QVBoxLayout *currentLayout = new QVBoxLayout(currentContainer);
+            currentLayout->setContentsMargins(0, 0, 0, 0);
+            this->currentTitle = new QLabel(currentContainer);
+            this->currentText = new QTextEdit(currentContainer);
+            this->currentText->setReadOnly(true);
+            this->currentText->setLineWrapMode(QTextEdit::NoWrap);
+            currentLayout->addWidget(this->currentTitle);
+            currentLayout->addWidget(this->currentText);
+
+            splitter->addWidget(previousContainer);
+            splitter->addWidget(currentContainer);
+            layout->addWidget(splitter);
+
+            // The lines of the two plans are aligned
+            connect(this->previousText->verticalScrollBar(), SIGNAL(valueChanged(int)), this->currentText->verticalScrollBar(), SLOT(setValue(int)));
+            connect(this->currentText->verticalScrollBar(), SIGNAL(valueChanged(int)), this->previousText->verticalScrollBar(), SLOT(setValue(int)));
+        }
+
+        void PlanDiffView::setSummary(QString summary)
+        {
+            this->summaryLabel->setText(summary);
+        }
+
+        /**
+         * Compares the operations of the two plans, a blank line is shown in front of the
+         * operations which are only in one of them
+         * @brief PlanDiffView::setPlans
+         * @param previousPlan the previous plan, EXPLAIN FORMAT=JSON, may be empty
+         * @param plan the new plan, EXPLAIN FORMAT=JSON
+         */
+        void PlanDiffView::setPlans(QString previousTitle, QString previousPlan, QString title, QString plan)
+        {
+            this->previousTitle->setText(previousTitle);
+            this->currentTitle->setText(title);
+
+            QStringList before = outline(previousPlan);
+            QStringList after = outline(plan);
+
+            // Longest common subsequence of the operations
+            int n = before.size();
+            int m = after.size();
+            QVector<QVector<int> > common(n + 1, QVector<int>(m + 1, 0));
+            for (int i = n - 1; i >= 0; i--) {
+                for (int j = m - 1; j >= 0; j--) {
+                    common[i][j] = before.at(i) == after.at(j) ? common[i + 1][j + 1] + 1 : qMax(common[i + 1][j], common[i][j + 1]);
+                }
+            }
+
+            QString left;
+            QString right;
+            int i = 0;
+            int j = 0;
+            while (i < n || j < m) {
+                if (i < n && j < m && before.at(i) == after.at(j)) {
+                    left += line(before.at(i++), "");
+                    right += line(after.at(j++), "");
+                } else if (j >= m || (i < n && common[i + 1][j] >= common[i][j + 1])) {
+                    left += line(before.at(i++), REMOVED_COLOR);
+                    right += line("", "");
+                } else {
+                    left += line("", "");
+                    right += line(after.at(j++), ADDED_COLOR);
+                }
+            }
+
+            this->previousText->setHtml("<pre>" + left + "</pre>");
+            this->currentText->setHtml("<pre>" + right + "</pre>");
+        }
+
+        void PlanDiffView::clear()
+        {
+            this->summaryLabel->clear();
+            this->previousTitle->clear();
+            this->currentTitle->clear();
+            this->previousText->clear();
+            this->currentText->clear();
+        }
+
+        QStringList PlanDiffView::outline(QString plan)
+        {
+            if (plan.isEmpty()) {
+                return QStringList();
+            }
+
+            return Util::ExplainPlan::outline(Util::ExplainPlan::fromJson(plan));
+        }
+
+        QString PlanDiffView::line(QString text, QString color)
+        {
+            QString html = text.isEmpty() ? " " : text.toHtmlEscaped();
+            if (!color.isEmpty()) {
+                html = QString("<span style=\"background-color: %1\">%2</span>").arg(color).arg(html);
+            }
+
+            return html + "\n";
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef PLANDIFFVIEW_H
+#define PLANDIFFVIEW_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QTextEdit>
+#include <QStringList>
+
+namespace UI {
+    namespace History {
+        /**
+         * Shows two plans of a query side by side, the operations which are only in one of
+         * them are highlighted
+         */
+        class PlanDiffView : public QWidget
+        {
+            Q_OBJECT
+        public:
+            explicit PlanDiffView(QWidget *parent = 0);
+
+            void setSummary(QString summary);
+            void setPlans(QString previousTitle, QString previousPlan, QString title, QString plan);
+            void clear();
+
+        private:
+            QLabel *summaryLabel;
+            QLabel *previousTitle;
+            QLabel *currentTitle;
+            QTextEdit *previousText;
+            QTextEdit *currentText;
+
+            static QStringList outline(QString plan);
+            static QString line(QString text, QString color);
+        };
+    }
+}
+
+#endif // PLANDIFFVIEW_H
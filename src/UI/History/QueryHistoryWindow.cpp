@@ -0,0 +1,277 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "QueryHistoryWindow.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTabWidget>
+#include <QSplitter>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QElapsedTimer>
+#include <QLocale>
+
+// Delay after the last key before the search
+#define SEARCH_DELAY 250
+
+namespace UI {
+    namespace History {
+        QueryHistoryWindow::QueryHistoryWindow(QWidget *parent) : QMainWindow(parent)
+        {
+            setWindowTitle(tr("Query history"));
+            setAttribute(Qt::WA_DeleteOnClose);
+            resize(1000, 700);
+
+            QTabWidget *tabs = new QTabWidget(this);
+
+            // The executed statements
+            QWidget *historyContainer = new QWidget(tabs);
+            QVBoxLayout *historyLayout = new QVBoxLayout(historyContainer);
+
+            this->searchText = new QLineEdit(historyContainer);
+            this->searchText->setPlaceholderText(tr("Search the statements"));
+            this->searchText->setClearButtonEnabled(true);
+            historyLayout->addWidget(this->searchText);
+
+            QSplitter *historySplitter = new QSplitter(Qt::Vertical, historyContainer);
+            this->historyModel = new QStandardItemModel(0, 7, this);
+            this->historyModel->setHorizontalHeaderLabels(QStringList() << tr("Executed at") << tr("Session") << tr("Database")
+                                                          << tr("Statement") << tr("Total (ms)") << tr("Server (ms)") << tr("Rows"));
+            this->historyView = new QTableView(historySplitter);
+            this->historyView->setModel(this->historyModel);
+            this->historyView->setSelectionBehavior(QAbstractItemView::SelectRows);
+            this->historyView->setSelectionMode(QAbstractItemView::SingleSelection);
+            this->historyView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+            this->historyView->verticalHeader()->hide();
+            this->historyView->horizontalHeader()->setStretchLastSection(true);
+            this->historyView->setColumnWidth(3, 400);
+
+            this->queryText = new QPlainTextEdit(historySplitter);
+            this->queryText->setReadOnly(true);
+            historySplitter->addWidget(this->historyView);
+            historySplitter->addWidget(this->queryText);
+            historySplitter->setStretchFactor(0, 3);
+            historySplitter->setStretchFactor(1, 1);
+            historyLayout->addWidget(historySplitter);
+
+            this->searchStatus = new QLabel(historyContainer);
+            historyLayout->addWidget(this->searchStatus);
+            tabs->addTab(historyContainer, tr("History"));
+
+            // The latencies by fingerprint
+            QWidget *statisticsContainer = new QWidget(tabs);
+            QVBoxLayout *statisticsLayout = new QVBoxLayout(statisticsContainer);
+
+            QPushButton *refreshButton = new QPushButton(QIcon(":/resources/icons/refresh-icon.png"), tr("Refresh"), statisticsContainer);
+            QHBoxLayout *buttonLayout = new QHBoxLayout();
+            buttonLayout->addWidget(refreshButton);
+            buttonLayout->addStretch();
+            statisticsLayout->addLayout(buttonLayout);
+
+            QSplitter *statisticsSplitter = new QSplitter(Qt::Vertical, statisticsContainer);
+            this->statisticsModel = new QStandardItemModel(0, 7, this);
+            this->statisticsModel->setHorizontalHeaderLabels(QStringList() << tr("Fingerprint") << tr("Count") << tr("p50 (ms)")
+                                                             << tr("p95 (ms)") << tr("Max (ms)") << tr("Last seen") << tr("Plans"));
+            this->statisticsView = new QTableView(statisticsSplitter);
+            this->statisticsView->setModel(this->statisticsModel);
+            this->statisticsView->setSelectionBehavior(QAbstractItemView::SelectRows);
+            this->statisticsView->setSelectionMode(QAbstractItemView::SingleSelection);
+            this->statisticsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+            this->statisticsView->verticalHeader()->hide();
+            this->statisticsView->setColumnWidth(0, 450);
+
+            QWidget *trendContainer = new QWidget(statisticsSplitter);
+            QVBoxLayout *trendLayout = new QVBoxLayout(trendContainer);
+            trendLayout->setContentsMargins(0, 0, 0, 0);
+            this->trendLabel = new QLabel(tr("Select a fingerprint to see its latencies by day"), trendContainer);
+            trendLayout->addWidget(this->trendLabel);
+            this->trendModel = new QStandardItemModel(0, 5, this);
+            this->trendModel->setHorizontalHeaderLabels(QStringList() << tr("Day") << tr("Count") << tr("p50 (ms)") << tr("p95 (ms)") << tr("Max (ms)"));
+            QTableView *trendView = new QTableView(trendContainer);
+            trendView->setModel(this->trendModel);
+            trendView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+            trendView->verticalHeader()->hide();
+            trendLayout->addWidget(trendView);
+
+            // The last plan of the fingerprint, compared with the previous one
+            this->planDiff = new PlanDiffView(statisticsSplitter);
+
+            statisticsSplitter->addWidget(this->statisticsView);
+            statisticsSplitter->addWidget(trendContainer);
+            statisticsSplitter->addWidget(this->planDiff);
+            statisticsLayout->addWidget(statisticsSplitter);
+            tabs->addTab(statisticsContainer, tr("Statistics"));
+
+            setCentralWidget(tabs);
+
+            this->searchTimer = new QTimer(this);
+            this->searchTimer->setSingleShot(true);
+
+            connect(this->searchText, SIGNAL(textChanged(QString)), SLOT(handleSearchChanged()));
+            connect(this->searchTimer, SIGNAL(timeout()), SLOT(handleSearch()));
+            connect(this->historyView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), SLOT(handleHistorySelection()));
+            connect(refreshButton, SIGNAL(clicked(bool)), SLOT(handleRefreshStatistics()));
+            connect(this->statisticsView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), SLOT(handleFingerprintSelection()));
+
+            this->handleSearch();
+            this->handleRefreshStatistics();
+        }
+
+        QueryHistoryWindow::~QueryHistoryWindow()
+        {
+
+        }
+
+        void QueryHistoryWindow::handleSearchChanged()
+        {
+            this->searchTimer->start(SEARCH_DELAY);
+        }
+
+        /**
+         * Shows the last statements matching the words of the search
+         * @brief QueryHistoryWindow::handleSearch
+         */
+        void QueryHistoryWindow::handleSearch()
+        {
+            Util::QueryHistory *history = Util::QueryHistory::instance();
+
+            QElapsedTimer timer;
+            timer.start();
+            QList<HistoryEntry> entries = history->search(this->searchText->text());
+            qint64 msec = timer.elapsed();
+
+            this->historyModel->removeRows(0, this->historyModel->rowCount());
+            this->queryText->clear();
+
+            QLocale locale(QLocale::English);
+            foreach (HistoryEntry entry, entries) {
+                QList<QStandardItem *> row;
+                row << new QStandardItem(entry.executedAt.toString("yyyy-MM-dd HH:mm:ss"));
+                row << new QStandardItem(entry.session);
+                row << new QStandardItem(entry.databaseName);
+                row << new QStandardItem(entry.query.simplified().left(300));
+                row << new QStandardItem(entry.error.isEmpty() ? formatMsec(entry.totalMsec) : tr("Error"));
+                row << new QStandardItem(formatMsec(entry.serverMsec));
+                row << new QStandardItem(locale.toString(entry.rows));
+
+                // The full statement and the error are shown under the list
+                QString details = entry.query;
+                if (!entry.error.isEmpty()) {
+                    details = entry.error + "\n\n" + details;
+                }
+                row.first()->setData(details, Qt::UserRole);
+                this->historyModel->appendRow(row);
+            }
+
+            this->searchStatus->setText(QString(tr("%1 statement(s) in %2 ms, %3")).arg(entries.size()).arg(msec)
+                                        .arg(history->hasFullTextSearch() ? tr("full-text index") : tr("no full-text index, the search scans the history")));
+        }
+
+        void QueryHistoryWindow::handleHistorySelection()
+        {
+            QModelIndex index = this->historyView->currentIndex();
+            if (!index.isValid()) {
+                this->queryText->clear();
+                return;
+            }
+
+            this->queryText->setPlainText(this->historyModel->item(index.row(), 0)->data(Qt::UserRole).toString());
+        }
+
+        /**
+         * Shows the most executed fingerprints with their percentiles
+         * @brief QueryHistoryWindow::handleRefreshStatistics
+         */
+        void QueryHistoryWindow::handleRefreshStatistics()
+        {
+            this->statisticsModel->removeRows(0, this->statisticsModel->rowCount());
+            this->trendModel->removeRows(0, this->trendModel->rowCount());
+            this->planDiff->clear();
+
+            QLocale locale(QLocale::English);
+            foreach (FingerprintStatistics statistics, Util::QueryHistory::instance()->statistics()) {
+                QList<QStandardItem *> row;
+                row << new QStandardItem(statistics.fingerprint.simplified());
+                row << new QStandardItem(locale.toString(statistics.count));
+                row << new QStandardItem(formatMsec(statistics.p50));
+                row << new QStandardItem(formatMsec(statistics.p95));
+                row << new QStandardItem(formatMsec(statistics.max));
+                row << new QStandardItem(statistics.lastSeen.toString("yyyy-MM-dd HH:mm:ss"));
+                row << new QStandardItem(locale.toString(statistics.planCount));
+                row.first()->setData(statistics.id, Qt::UserRole);
+                row.first()->setToolTip(statistics.fingerprint);
+                this->statisticsModel->appendRow(row);
+            }
+        }
+
+        /**
+         * Shows the latencies of the selected fingerprint for the last days
+         * @brief QueryHistoryWindow::handleFingerprintSelection
+         */
+        void QueryHistoryWindow::handleFingerprintSelection()
+        {
+            this->trendModel->removeRows(0, this->trendModel->rowCount());
+            this->planDiff->clear();
+
+            QModelIndex index = this->statisticsView->currentIndex();
+            if (!index.isValid()) {
+                return;
+            }
+
+            qint64 fingerprintId = this->statisticsModel->item(index.row(), 0)->data(Qt::UserRole).toLongLong();
+            QList<FingerprintTrend> trend = Util::QueryHistory::instance()->trend(fingerprintId);
+
+            QLocale locale(QLocale::English);
+            foreach (FingerprintTrend point, trend) {
+                QList<QStandardItem *> row;
+                row << new QStandardItem(point.day.toString("yyyy-MM-dd"));
+                row << new QStandardItem(locale.toString(point.count));
+                row << new QStandardItem(formatMsec(point.p50));
+                row << new QStandardItem(formatMsec(point.p95));
+                row << new QStandardItem(formatMsec(point.max));
+                this->trendModel->appendRow(row);
+            }
+
+            this->trendLabel->setText(QString(tr("Latencies by day for the last 30 days (%1 day(s) with executions)")).arg(trend.size()));
+
+            QList<PlanVersion> plans = Util::QueryHistory::instance()->plans(fingerprintId);
+            if (plans.isEmpty()) {
+                this->planDiff->setSummary(tr("No plan captured for this query"));
+                return;
+            }
+
+            PlanVersion current = plans.first();
+            PlanVersion previous = plans.value(1);
+            QString format = "yyyy-MM-dd HH:mm";
+            this->planDiff->setSummary(plans.size() > 1 ? QString(tr("The plan has changed on %1")).arg(current.firstSeen.toString(format))
+                                                        : tr("The plan has not changed"));
+            this->planDiff->setPlans(previous.plan.isEmpty() ? "" : QString(tr("From %1 to %2: %3")).arg(previous.firstSeen.toString(format))
+                                                                  .arg(previous.lastSeen.toString(format)).arg(previous.signature),
+                                     previous.plan,
+                                     QString(tr("Since %1: %2")).arg(current.firstSeen.toString(format)).arg(current.signature),
+                                     current.plan);
+        }
+
+        QString QueryHistoryWindow::formatMsec(double msec)
+        {
+            if (msec < 0) {
+                return "";
+            }
+
+            return QLocale(QLocale::English).toString(msec, 'f', 2);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef QUERYHISTORYWINDOW_H
+#define QUERYHISTORYWINDOW_H
+
+#include <QMainWindow>
+#include <QLineEdit>
+#include <QLabel>
+#include <QTableView>
+#include <QStandardItemModel>
+#include <QPlainTextEdit>
+#include <QTimer>
+#include "Util/QueryHistory.h"
+#include "PlanDiffView.h"
+
+namespace UI {
+    namespace History {
+        /**
+         * Searches the executed statements and shows the latencies of each fingerprint
+         */
+        class QueryHistoryWindow : public QMainWindow
+        {
+            Q_OBJECT
+        public:
+            explicit QueryHistoryWindow(QWidget *parent = 0);
+            virtual ~QueryHistoryWindow();
+
+        private:
+            QLineEdit *searchText;
+            QLabel *searchStatus;
+            QStandardItemModel *historyModel;
+            QTableView *historyView;
+            QPlainTextEdit *queryText;
+            QStandardItemModel *statisticsModel;
+            QTableView *statisticsView;
+            QStandardItemModel *trendModel;
+            QLabel *trendLabel;
+            PlanDiffView *planDiff;
+            QTimer *searchTimer;
+
+            static QString formatMsec(double msec);
+
+        public slots:
+            void handleSearchChanged();
+            void handleSearch();
+            void handleHistorySelection();
+            void handleRefreshStatistics();
+            void handleFingerprintSelection();
+        };
+    }
+}
+
+#endif // QUERYHISTORYWINDOW_H
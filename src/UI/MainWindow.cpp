@@ -25,6 +25,7 @@
 
 
 #include "Session/SessionWindow.h"
+#include "History/QueryHistoryWindow.h"
 #include "Util/DataBase.h"
 
 namespace UI {
@@ -66,7 +67,7 @@ void MainWindow::handleOpenConnection(QJsonObject sessionConfiguration)
 	}
 	else{
 		qInfo() << "Connection failed";
-		QSqlDatabase db = QSqlDatabase::database();
+		QSqlDatabase db = Util::DataBase::current();
 		QSqlError err = db.lastError();
 
 		QMessageBox *message = new QMessageBox();
@@ -77,8 +78,7 @@ void MainWindow::handleOpenConnection(QJsonObject sessionConfiguration)
 
 		qDebug() << err.text();
 
-		db = QSqlDatabase();
-		db.removeDatabase("");
+		Util::DataBase::closeSession(sessionConfiguration.value("uuid").toString());
 
 		message->exec();
 	}
@@ -99,6 +99,12 @@ void MainWindow::openSessionManager()
 
 }
 
+void MainWindow::openQueryHistory()
+{
+	History::QueryHistoryWindow *window = new History::QueryHistoryWindow(this);
+	window->show();
+}
+
 void MainWindow::closeExplorer()
 {
 
@@ -46,6 +46,7 @@ private:
 public slots:
 	void handleOpenConnection(QJsonObject sessionConfiguration);
 	void openSessionManager();
+	void openQueryHistory();
 	void exit();
 	void closeExplorer();
 
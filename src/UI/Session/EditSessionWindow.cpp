@@ -43,14 +43,41 @@ EditSessionWindow::EditSessionWindow(QWidget *parent) : QWidget(parent){
 	// Asterisks will be shown when values are entered
 	this->passwordLineEdit->setEchoMode(QLineEdit::Password);
 
+	// Guardrails of the statements executed in the query tabs
+	this->maxExecutionTime = new QSpinBox();
+	this->maxExecutionTime->setRange(0, 86400);
+	this->maxExecutionTime->setSuffix(" " + tr("s"));
+	this->maxExecutionTime->setSpecialValueText(tr("no limit"));
+	this->maxExecutionTime->setToolTip(tr("The SELECT statements are stopped by the server after this time (MAX_EXECUTION_TIME hint, MySQL 5.7.8), including the time to read the rows of a large result"));
+	this->maxExecutionTime->setFixedWidth(150);
+
+	this->confirmRows = new QSpinBox();
+	this->confirmRows->setRange(0, 2000000000);
+	this->confirmRows->setSingleStep(100000);
+	this->confirmRows->setSuffix(" " + tr("rows"));
+	this->confirmRows->setSpecialValueText(tr("never"));
+	this->confirmRows->setToolTip(tr("Asks for a confirmation when EXPLAIN estimates that a statement examines more rows"));
+	this->confirmRows->setFixedWidth(150);
+
+	this->rowCap = new QSpinBox();
+	this->rowCap->setRange(0, 2000000000);
+	this->rowCap->setSingleStep(1000);
+	this->rowCap->setSuffix(" " + tr("rows"));
+	this->rowCap->setSpecialValueText(tr("no limit"));
+	this->rowCap->setToolTip(tr("The server returns at most this number of rows for each SELECT (sql_select_limit)"));
+	this->rowCap->setFixedWidth(150);
+
 	QFormLayout *formLayout = new QFormLayout;
 	formLayout->addRow(tr("Connection name:"), this->nameLineEdit);
 	formLayout->addRow(tr("Hostname / IP:"), this->hostLineEdit);
 	formLayout->addRow(tr("User:"), this->userLineEdit);
 	formLayout->addRow(tr("Password:"), this->passwordLineEdit);
 	formLayout->addRow(tr("Port:"), this->portLineEdit);
+	formLayout->addRow(tr("Max execution time:"), this->maxExecutionTime);
+	formLayout->addRow(tr("Confirm above:"), this->confirmRows);
+	formLayout->addRow(tr("Row cap:"), this->rowCap);
 
-	formWidget->setFixedHeight(200);
+	formWidget->setFixedHeight(300);
 	formWidget->setLayout(formLayout);
 
 	QVBoxLayout *layout = new QVBoxLayout;
@@ -88,6 +115,9 @@ EditSessionWindow::EditSessionWindow(QWidget *parent) : QWidget(parent){
 	connect(this->userLineEdit, SIGNAL (textEdited(QString)), this, SLOT (edited()));
 	connect(this->passwordLineEdit, SIGNAL (textEdited(QString)), this, SLOT (edited()));
 	connect(this->portLineEdit, SIGNAL (valueChanged(int)), this, SLOT (edited()));
+	connect(this->maxExecutionTime, SIGNAL (valueChanged(int)), this, SLOT (edited()));
+	connect(this->confirmRows, SIGNAL (valueChanged(int)), this, SLOT (edited()));
+	connect(this->rowCap, SIGNAL (valueChanged(int)), this, SLOT (edited()));
 }
 
 
@@ -159,6 +189,16 @@ int EditSessionWindow::getPort()
 	return this->portLineEdit->value();
 }
 
+QueryGuardrails EditSessionWindow::getGuardrails()
+{
+	QueryGuardrails guardrails;
+	guardrails.maxExecutionSec = this->maxExecutionTime->value();
+	guardrails.confirmRows = this->confirmRows->value();
+	guardrails.rowCap = this->rowCap->value();
+
+	return guardrails;
+}
+
 void EditSessionWindow::setName(QString name)
 {
 	this->nameLineEdit->setText(name);
@@ -179,6 +219,12 @@ void EditSessionWindow::setPort(int port)
 {
 	this->portLineEdit->setValue(port);
 }
+void EditSessionWindow::setGuardrails(QueryGuardrails guardrails)
+{
+	this->maxExecutionTime->setValue(guardrails.maxExecutionSec);
+	this->confirmRows->setValue(int(qMin(guardrails.confirmRows, qint64(this->confirmRows->maximum()))));
+	this->rowCap->setValue(int(qMin(guardrails.rowCap, qint64(this->rowCap->maximum()))));
+}
 
 } /* namespace Session */
 } /* namespace UI */
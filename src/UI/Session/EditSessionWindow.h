@@ -22,6 +22,7 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QSpinBox>
+#include "Util/QueryGuardrails.h"
 
 namespace UI {
 namespace Session {
@@ -39,11 +40,13 @@ public:
 	QString getUser();
 	QString getPassword();
 	int getPort();
+	QueryGuardrails getGuardrails();
 	void setName(QString name);
 	void setHostName(QString hostname);
 	void setUser(QString user);
 	void setPassword(QString password);
 	void setPort(int port);
+	void setGuardrails(QueryGuardrails guardrails);
 	QPushButton *saveButton;
 
 private:
@@ -52,6 +55,9 @@ private:
 	QLineEdit *userLineEdit ;
 	QLineEdit *passwordLineEdit ;
 	QSpinBox *portLineEdit ;
+	QSpinBox *maxExecutionTime;
+	QSpinBox *confirmRows;
+	QSpinBox *rowCap;
 
 
 public slots:
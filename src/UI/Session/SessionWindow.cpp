@@ -211,6 +211,7 @@ void SessionWindow::updateSelected()
 		this->editSession->setUser(session.value("user").toString());
 		this->editSession->setPassword(session.value("password").toString());
 		this->editSession->setPort(session.value("port").toInt());
+		this->editSession->setGuardrails(Util::Guardrails::fromSession(session));
 		this->editSession->saveButton->setDisabled(true);
 	}
 }
@@ -237,6 +238,7 @@ void SessionWindow::handleSaveConnection()
 		session.insert("user", this->editSession->getUser());
 		session.insert("password", this->editSession->getPassword());
 		session.insert("port", this->editSession->getPort());
+		Util::Guardrails::writeSession(this->editSession->getGuardrails(), session);
 
 		this->sessionStore.replace(index.row(), session);
 
@@ -24,10 +24,13 @@ ToolBar::ToolBar(QWidget *parent) : QToolBar(parent) {
 
 	QAction *openSession = this->addAction(QIcon(":/resources/icons/connect.png"), tr("Display session manager"));
 
+	QAction *queryHistory = this->addAction(QIcon(":/resources/icons/database-process-icon.png"), tr("Query history"));
+
 	this->addSeparator();
 	QAction *exitAction = this->addAction(QIcon(":/resources/icons/exit.png"), tr("Exit"));
 
 	connect(openSession, SIGNAL(triggered(bool)), parent, SLOT(openSessionManager()));
+	connect(queryHistory, SIGNAL(triggered(bool)), parent, SLOT(openQueryHistory()));
 	connect(exitAction, SIGNAL(triggered(bool)), parent, SLOT(exit()));
 }
 
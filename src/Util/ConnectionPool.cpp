@@ -0,0 +1,310 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+// Connections kept for each key
+#define DEFAULT_MAX_SIZE 8
+// An idle connection is closed after 10 minutes
+#define DEFAULT_IDLE_TIMEOUT (10 * 60 * 1000)
+
+namespace Util {
+
+    ConnectionPool::ConnectionPool()
+    {
+        this->maxSize = DEFAULT_MAX_SIZE;
+        this->idleTimeout = DEFAULT_IDLE_TIMEOUT;
+        this->counters = ConnectionPoolStatistics();
+        this->clock.start();
+    }
+
+    ConnectionPool *ConnectionPool::instance()
+    {
+        static ConnectionPool pool;
+        return &pool;
+    }
+
+    /**
+     * Gives an idle connection with the same parameters, or opens a new one.
+     * The connection is returned even if it cannot be opened, to read the error.
+     * @brief ConnectionPool::acquire
+     * @param configuration the connection parameters
+     * @return the connection, to give back with release
+     */
+    QSqlDatabase ConnectionPool::acquire(ConnectionConfiguration configuration)
+    {
+        QString key = keyOf(configuration);
+
+        QMutexLocker locker(&this->mutex);
+        this->removeClosedConnections();
+        this->closeIdleConnections();
+
+        while (!this->idle.value(key).isEmpty()) {
+            QString name = this->idle[key].takeLast();
+            this->inUse.insert(name);
+            QSqlDatabase database = this->connections.value(name).database;
+            bool checkRequired = this->clock.elapsed() - this->connections.value(name).lastUsed > DataBase::getPingInterval();
+
+            // The driver has no thread while the connection is idle
+            database.driver()->moveToThread(QThread::currentThread());
+
+            locker.unlock();
+            bool alive = !checkRequired || DataBase::ping(database);
+            locker.relock();
+
+            if (alive) {
+                this->counters.reused++;
+                return database;
+            }
+
+            qDebug() << "ConnectionPool::acquire - the connection " + name + " is lost";
+            this->counters.failedChecks++;
+            this->inUse.remove(name);
+            this->closeConnection(name);
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.databaseName = configuration.databaseName;
+        entry.database = DataBase::createFromConfig(configuration);
+        entry.lastUsed = this->clock.elapsed();
+        entry.overflow = this->sizes.value(key) >= this->maxSize;
+        entry.closeOnRelease = false;
+
+        QString name = entry.database.connectionName();
+        this->connections.insert(name, entry);
+        this->inUse.insert(name);
+        this->counters.created++;
+        if (entry.overflow) {
+            this->counters.overflow++;
+        } else {
+            this->sizes[key]++;
+        }
+
+        locker.unlock();
+        if (!entry.database.open()) {
+            qDebug() << "ConnectionPool::acquire - " + entry.database.lastError().text();
+        }
+
+        return entry.database;
+    }
+
+    /**
+     * Gives back a connection, it is kept for the next callers if it is still open.
+     * The connections which are not from the pool are ignored.
+     * @brief ConnectionPool::release
+     * @param database the connection
+     * @param reset true to reset the session (variables, temporary tables, transaction)
+     * before the connection is reused, when it has been used to execute any query
+     */
+    void ConnectionPool::release(QSqlDatabase database, bool reset)
+    {
+        QString name = database.connectionName();
+
+        QMutexLocker locker(&this->mutex);
+        if (!this->inUse.contains(name)) {
+            return;
+        }
+
+        Entry entry = this->connections.value(name);
+        locker.unlock();
+
+        bool keep = !entry.overflow && database.isOpen() && database.driver()->thread() == QThread::currentThread();
+        if (keep && reset) {
+            keep = resetSession(database, entry.databaseName);
+        }
+
+        if (keep) {
+            database.driver()->moveToThread(nullptr);
+        }
+
+        locker.relock();
+        this->inUse.remove(name);
+        if (keep && !this->connections.value(name).closeOnRelease) {
+            this->connections[name].lastUsed = this->clock.elapsed();
+            this->idle[entry.key] << name;
+        } else {
+            this->closeConnection(name, QThread::currentThreadId());
+        }
+    }
+
+    /**
+     * Gives back a connection which must not be reused, e.g. killed
+     * @brief ConnectionPool::discard
+     * @param database the connection
+     */
+    void ConnectionPool::discard(QSqlDatabase database)
+    {
+        QMutexLocker locker(&this->mutex);
+        QString name = database.connectionName();
+        if (this->inUse.remove(name)) {
+            this->closeConnection(name, QThread::currentThreadId());
+        }
+    }
+
+    /**
+     * Closes all the connections, called when the application quits.
+     * The connections still used are closed when they are released.
+     * @brief ConnectionPool::closeAll
+     */
+    void ConnectionPool::closeAll()
+    {
+        QMutexLocker locker(&this->mutex);
+        foreach (QString name, this->connections.keys()) {
+            if (this->inUse.contains(name)) {
+                this->connections[name].closeOnRelease = true;
+            } else {
+                this->closeConnection(name);
+            }
+        }
+
+        this->removeClosedConnections();
+    }
+
+    void ConnectionPool::setMaxSize(int maxSize)
+    {
+        QMutexLocker locker(&this->mutex);
+        this->maxSize = qMax(1, maxSize);
+    }
+
+    void ConnectionPool::setIdleTimeout(int msec)
+    {
+        QMutexLocker locker(&this->mutex);
+        this->idleTimeout = msec;
+    }
+
+    /**
+     * @brief ConnectionPool::statistics
+     * @return the number of idle and used connections, and the counters since the start
+     */
+    ConnectionPoolStatistics ConnectionPool::statistics()
+    {
+        QMutexLocker locker(&this->mutex);
+        ConnectionPoolStatistics statistics = this->counters;
+        statistics.inUse = this->inUse.size();
+        statistics.idle = this->connections.size() - this->inUse.size();
+
+        return statistics;
+    }
+
+    QString ConnectionPool::keyOf(ConnectionConfiguration configuration)
+    {
+        QStringList parts;
+        parts << configuration.username << configuration.password << configuration.hostname << QString::number(configuration.port) << configuration.databaseName;
+
+        return parts.join(QChar(0));
+    }
+
+    /**
+     * Clears the state left by the previous user of the connection (mysql_reset_connection)
+     * and selects the default database again, in case of a USE statement
+     * @brief ConnectionPool::resetSession
+     * @return false if the connection cannot be reused
+     */
+    bool ConnectionPool::resetSession(QSqlDatabase database, QString databaseName)
+    {
+        MYSQL *mysql = MySQLCursor::nativeHandle(database);
+        if (mysql == nullptr || mysql_reset_connection(mysql) != 0) {
+            return false;
+        }
+
+        return databaseName.isEmpty() || mysql_select_db(mysql, databaseName.toUtf8().constData()) == 0;
+    }
+
+    /**
+     * Closes a connection which is not used, the connection is removed later as the
+     * caller which released it may still have a copy
+     * @param holder the thread which released the connection, nullptr if it was idle
+     */
+    void ConnectionPool::closeConnection(QString name, Qt::HANDLE holder)
+    {
+        Entry entry = this->connections.take(name);
+        this->idle[entry.key].removeAll(name);
+        if (!entry.overflow) {
+            this->sizes[entry.key]--;
+        }
+
+        entry.database.close();
+        this->pendingRemoval.insert(name, holder);
+        this->counters.closed++;
+    }
+
+    void ConnectionPool::closeIdleConnections()
+    {
+        qint64 now = this->clock.elapsed();
+        foreach (QStringList names, this->idle) {
+            foreach (QString name, names) {
+                if (now - this->connections.value(name).lastUsed > this->idleTimeout) {
+                    this->closeConnection(name);
+                }
+            }
+        }
+    }
+
+    /**
+     * Removes the closed connections which were idle, and the ones released by the current
+     * thread: its copy is gone once it calls the pool again. The connections released by the
+     * other threads are removed by their next call.
+     */
+    void ConnectionPool::removeClosedConnections()
+    {
+        Qt::HANDLE current = QThread::currentThreadId();
+        QMutableHashIterator<QString, Qt::HANDLE> i(this->pendingRemoval);
+        while (i.hasNext()) {
+            i.next();
+            if (i.value() == nullptr || i.value() == current) {
+                QSqlDatabase::removeDatabase(i.key());
+                i.remove();
+            }
+        }
+    }
+
+    PooledConnection::PooledConnection(ConnectionConfiguration configuration, bool resetOnRelease):
+        resetOnRelease(resetOnRelease)
+    {
+        this->discarded = false;
+        this->connection = ConnectionPool::instance()->acquire(configuration);
+    }
+
+    QSqlDatabase PooledConnection::database() const
+    {
+        return this->connection;
+    }
+
+    /**
+     * The connection is closed instead of being reused
+     * @brief PooledConnection::discard
+     */
+    void PooledConnection::discard()
+    {
+        this->discarded = true;
+    }
+
+    PooledConnection::~PooledConnection()
+    {
+        if (this->discarded) {
+            ConnectionPool::instance()->discard(this->connection);
+        } else {
+            ConnectionPool::instance()->release(this->connection, this->resetOnRelease);
+        }
+    }
+}
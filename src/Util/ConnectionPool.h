@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include "DataBase.h"
+#include <QSqlDatabase>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+
+namespace Util {
+    /**
+     * Open connections shared by the tabs and the workers, keyed by the connection parameters
+     * (server, user and default database).
+     *
+     * A released connection is kept open and given to the next caller with the same parameters,
+     * after a mysql_ping when it has been idle for longer than DataBase::getPingInterval. At most maxSize connections are kept for
+     * each key: the connections created beyond this limit are closed when they are released, so
+     * acquire never waits. The connections idle for too long are closed.
+     *
+     * A connection is used by one thread at a time: the driver is detached from the releasing
+     * thread and attached to the acquiring one.
+     *
+     * A closed connection is removed from QSqlDatabase only when no caller can still have a copy:
+     * at once when it was idle, otherwise by the next call of the thread which released it.
+     */
+    class ConnectionPool
+    {
+    public:
+        static ConnectionPool *instance();
+
+        QSqlDatabase acquire(ConnectionConfiguration configuration);
+        void release(QSqlDatabase database, bool reset = false);
+        void discard(QSqlDatabase database);
+        void closeAll();
+
+        void setMaxSize(int maxSize);
+        void setIdleTimeout(int msec);
+        ConnectionPoolStatistics statistics();
+
+    private:
+        struct Entry {
+            QString key;
+            QString databaseName;
+            QSqlDatabase database;
+            qint64 lastUsed;
+            bool overflow;
+            bool closeOnRelease;
+        };
+
+        QMutex mutex;
+        QElapsedTimer clock;
+        QHash<QString, Entry> connections;
+        QHash<QString, QStringList> idle;
+        QSet<QString> inUse;
+        QHash<QString, int> sizes;
+        QHash<QString, Qt::HANDLE> pendingRemoval;
+        ConnectionPoolStatistics counters;
+        int maxSize;
+        int idleTimeout;
+
+        ConnectionPool();
+        static QString keyOf(ConnectionConfiguration configuration);
+        static bool resetSession(QSqlDatabase database, QString databaseName);
+        void closeConnection(QString name, Qt::HANDLE holder = nullptr);
+        void closeIdleConnections();
+        void removeClosedConnections();
+    };
+
+    /**
+     * Connection of the pool released when the object is destroyed
+     */
+    class PooledConnection
+    {
+    public:
+        PooledConnection(ConnectionConfiguration configuration, bool resetOnRelease = false);
+        ~PooledConnection();
+        QSqlDatabase database() const;
+        void discard();
+
+    private:
+        QSqlDatabase connection;
+        bool resetOnRelease;
+        bool discarded;
+
+        Q_DISABLE_COPY(PooledConnection)
+    };
+}
+
+#endif // CONNECTIONPOOL_H
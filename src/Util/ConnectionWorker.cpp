@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ConnectionWorker.h"
+#include "ConnectionPool.h"
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QDebug>
+
+namespace Util {
+    ConnectionWorker::ConnectionWorker(ConnectionConfiguration conf, QObject *parent):
+        QThread(parent),
+        configuration(conf)
+    {
+        this->stop = false;
+    }
+
+    /**
+     * Adds a job to the queue, the job receives the connection of the worker
+     * @brief ConnectionWorker::post
+     * @param job the job to execute in the worker thread
+     */
+    void ConnectionWorker::post(Job job)
+    {
+        QMutexLocker locker(&this->mutex);
+        this->jobs.enqueue(job);
+        this->condition.wakeOne();
+    }
+
+    /**
+     * The worker stops when the pending jobs are executed
+     * @brief ConnectionWorker::stopRequired
+     */
+    void ConnectionWorker::stopRequired()
+    {
+        QMutexLocker locker(&this->mutex);
+        this->stop = true;
+        this->condition.wakeOne();
+    }
+
+    void ConnectionWorker::run()
+    {
+        {
+            // The jobs may change the session, it is reset when the connection goes back to the pool
+            PooledConnection connection(this->configuration, true);
+            QSqlDatabase database = connection.database();
+
+            // The jobs are executed even if the connection fails, they receive a closed connection
+            if (!database.isOpen()) {
+                qWarning() << "ConnectionWorker::run - " + database.lastError().text();
+            }
+
+            forever {
+                this->mutex.lock();
+                while (this->jobs.isEmpty() && !this->stop) {
+                    this->condition.wait(&this->mutex);
+                }
+
+                if (this->jobs.isEmpty()) {
+                    this->mutex.unlock();
+                    break;
+                }
+
+                Job job = this->jobs.dequeue();
+                this->mutex.unlock();
+
+                job(database);
+            }
+        }
+    }
+
+    ConnectionWorker::~ConnectionWorker()
+    {
+        this->stopRequired();
+        this->wait();
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef CONNECTIONWORKER_H
+#define CONNECTIONWORKER_H
+
+#include "DataBase.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <functional>
+
+namespace Util {
+    /**
+     * A thread which owns a connection and executes the jobs posted by other threads.
+     *
+     * A QSqlDatabase can only be used by one thread, the worker takes its connection from the
+     * pool in its own thread and runs the jobs in the order they are posted.
+     */
+    class ConnectionWorker : public QThread
+    {
+
+        Q_OBJECT
+
+    public:
+        typedef std::function<void(QSqlDatabase)> Job;
+
+        ConnectionWorker(ConnectionConfiguration conf, QObject *parent = 0);
+        virtual ~ConnectionWorker();
+        void post(Job job);
+        void stopRequired();
+
+    protected:
+        void run();
+
+    private:
+        ConnectionConfiguration configuration;
+        QMutex mutex;
+        QWaitCondition condition;
+        QQueue<Job> jobs;
+        bool stop;
+    };
+}
+
+#endif // CONNECTIONWORKER_H
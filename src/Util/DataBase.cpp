@@ -16,56 +16,135 @@
 **/
 
 #include <Util/DataBase.h>
+#include <Util/ConnectionPool.h>
+#include <Util/MySQLCursor.h>
 #include <QSqlError>
 #include <QDebug>
 #include <QUuid>
 #include <QSqlQuery>
+#include <QSettings>
+#include <QJsonDocument>
 
 namespace Util {
 
-QSqlDatabase DataBase::defaultConnection;
+// Idle time after which a connection is pinged before being used
+#define DEFAULT_PING_INTERVAL 60000
+
+QHash<QString, DataBase::SessionConnection> DataBase::sessions;
+QString DataBase::currentSession;
+QAtomicInt DataBase::pingInterval(-1);
 
 DataBase::DataBase() {
 
 
 }
 
+/**
+ * Opens the connection of a session and makes it the current connection. Each session (server
+ * node of the explorer) keeps its own connection: the default database is changed with
+ * mysql_select_db (as USE) and the connection is only checked with mysql_ping when it has not
+ * been used for a while.
+ *
+ * The session connections belong to the GUI thread, the other threads use the pool.
+ *
+ * @param sessionConfiguration the session configuration
+ * @param database the default database, empty to keep the current one
+ */
 bool DataBase::open(QJsonObject sessionConfiguration, QString database)
 {
-	if (!defaultConnection.isValid()) {
-		defaultConnection = QSqlDatabase::addDatabase("QMYSQL");
+	QString uuid = sessionConfiguration.value("uuid").toString();
+	SessionConnection &entry = sessions[uuid];
+	if (!entry.database.isValid()) {
+		entry.database = QSqlDatabase::addDatabase("QMYSQL", "session-" + uuid);
 	}
 
+	currentSession = uuid;
+	QSqlDatabase connection = entry.database;
+
 	QString hostName = sessionConfiguration.value("hostname").toString();
 	QString userName = sessionConfiguration.value("user").toString();
 	int port = sessionConfiguration.value("port").toInt();
 
-    if (!defaultConnection.isOpen() || hostName != defaultConnection.hostName() || defaultConnection.userName() != userName || port != defaultConnection.port() || (database != "" && database != defaultConnection.databaseName()) || !defaultConnection.exec("SELECT 1").isValid()) {
+	bool reusable = connection.isOpen() && hostName == connection.hostName() && connection.userName() == userName && port == connection.port();
+
+	if (reusable && entry.lastActivity.isValid() && entry.lastActivity.elapsed() > getPingInterval()) {
+		reusable = ping(connection);
+	}
+
+	if (reusable && database != "" && database != connection.databaseName()) {
+		MYSQL *mysql = MySQLCursor::nativeHandle(connection);
+		if (mysql != nullptr && mysql_select_db(mysql, database.toUtf8().constData()) == 0) {
+			// Only the name is changed on an open connection
+			connection.setDatabaseName(database);
+		} else {
+			qDebug() << "DataBase::open - unable to change the database, reconnecting";
+			reusable = false;
+		}
+	}
+
+	if (!reusable) {
 
-		if (defaultConnection.isOpen()) {
-			defaultConnection.close();
+		if (connection.isOpen()) {
+			connection.close();
 		}
 
-		defaultConnection.setHostName(hostName);
-		defaultConnection.setUserName(userName);
-		defaultConnection.setDatabaseName(database);
-		defaultConnection.setPassword(sessionConfiguration.value("password").toString());
-		defaultConnection.setPort(port);
+		connection.setHostName(hostName);
+		connection.setUserName(userName);
+		connection.setDatabaseName(database);
+		connection.setPassword(sessionConfiguration.value("password").toString());
+		connection.setPort(port);
 
-		if (!defaultConnection.open()) {
-			qDebug() << "DataBase::open - " + defaultConnection.lastError().text();
+		if (!connection.open()) {
+			qDebug() << "DataBase::open - " + connection.lastError().text();
 			return false;
 		}
 	}
 
+	entry.lastActivity.start();
+
 	return true;
 }
 
+/**
+ * @return the connection of the session opened by the last call to open
+ */
+QSqlDatabase DataBase::current()
+{
+	return sessions.value(currentSession).database;
+}
+
+/**
+ * @param uuid the session identifier
+ * @return the connection of the session, invalid if the session has never been opened
+ */
+QSqlDatabase DataBase::session(QString uuid)
+{
+	return sessions.value(uuid).database;
+}
+
+/**
+ * Closes the connection of a session, e.g. when the server is disconnected. The connection
+ * stays registered as the tabs may still have a copy, it is opened again by open.
+ *
+ * @param uuid the session identifier
+ */
+void DataBase::closeSession(QString uuid)
+{
+	if (sessions.contains(uuid)) {
+		sessions[uuid].database.close();
+	}
+}
+
+/**
+ * The connection comes from the pool, it must be given back with release
+ *
+ * @return a connection with the parameters of the current connection
+ */
 QSqlDatabase DataBase::cloneCurrentConnection()
 {
     QSqlDatabase db;
-    if (defaultConnection.isValid()) {
-        db = QSqlDatabase::cloneDatabase(defaultConnection, QUuid::createUuid().toString());
+    if (current().isValid()) {
+        db = acquire(dumpConfiguration(current()));
     }
 
     return db;
@@ -93,9 +172,59 @@ QSqlDatabase DataBase::createFromJSON(QJsonObject config) {
     return database;
 }
 
-ConnectionConfiguration DataBase::dumpConfiguration()
+/**
+ * Builds the connection configuration of a session
+ *
+ * @param config the session configuration
+ * @param database the default database of the connection
+ */
+ConnectionConfiguration DataBase::configurationFromJSON(QJsonObject config, QString database)
+{
+    ConnectionConfiguration conf;
+    conf.hostname = config.value("hostname").toString();
+    conf.username = config.value("user").toString();
+    conf.password = config.value("password").toString();
+    conf.databaseName = database;
+    conf.port = config.value("port").toInt();
+
+    return conf;
+}
+
+/**
+ * @return the sessions saved by the session manager
+ */
+QJsonArray DataBase::getSessions()
+{
+    QSettings settings("smartarello", "mysqlclient");
+    QString sessions = settings.value("sessions").toString();
+    if (sessions.isEmpty()) {
+        return QJsonArray();
+    }
+
+    return QJsonDocument::fromJson(sessions.toUtf8()).array();
+}
+
+/**
+ * @return the saved configuration of the current session, empty if the session is not saved
+ */
+QJsonObject DataBase::currentSessionConfiguration()
+{
+    QJsonArray sessions = getSessions();
+    for (int i = 0; i < sessions.count(); i++) {
+        if (sessions.at(i).toObject().value("uuid").toString() == currentSession) {
+            return sessions.at(i).toObject();
+        }
+    }
+
+    return QJsonObject();
+}
+
+/**
+ * @param db the connection, the current connection by default
+ * @return the parameters of the connection
+ */
+ConnectionConfiguration DataBase::dumpConfiguration(QSqlDatabase db)
 {
-    QSqlDatabase db = QSqlDatabase::database();
     ConnectionConfiguration conf;
     conf.hostname = db.hostName();
     conf.username = db.userName();
@@ -106,6 +235,121 @@ ConnectionConfiguration DataBase::dumpConfiguration()
     return conf;
 }
 
+/**
+ * Gives an open connection of the pool, idle connections with the same parameters are reused
+ *
+ * @param config the connection parameters
+ * @return the connection, to give back with release
+ */
+QSqlDatabase DataBase::acquire(ConnectionConfiguration config)
+{
+    return ConnectionPool::instance()->acquire(config);
+}
+
+/**
+ * Gives back a connection of the pool, the other connections are ignored
+ *
+ * @param database the connection
+ * @param reset true to clear the session state when arbitrary queries have been executed
+ */
+void DataBase::release(QSqlDatabase database, bool reset)
+{
+    ConnectionPool::instance()->release(database, reset);
+}
+
+ConnectionPoolStatistics DataBase::poolStatistics()
+{
+    return ConnectionPool::instance()->statistics();
+}
+
+/**
+ * Closes the connections of the pool, called when the application quits
+ */
+void DataBase::closePool()
+{
+    ConnectionPoolStatistics statistics = poolStatistics();
+    qDebug() << QString("DataBase::closePool - %1 connections created, %2 reused, %3 failed checks, %4 overflows")
+                .arg(statistics.created).arg(statistics.reused).arg(statistics.failedChecks).arg(statistics.overflow);
+
+    ConnectionPool::instance()->closeAll();
+}
+
+/**
+ * The interval can be set in the settings (pingInterval, in milliseconds)
+ *
+ * @return the idle time in milliseconds after which a connection is pinged before being used
+ */
+int DataBase::getPingInterval()
+{
+    int interval = pingInterval.load();
+    if (interval < 0) {
+        QSettings settings("smartarello", "mysqlclient");
+        interval = qMax(0, settings.value("pingInterval", DEFAULT_PING_INTERVAL).toInt());
+        pingInterval.store(interval);
+    }
+
+    return interval;
+}
+
+void DataBase::setPingInterval(int msec)
+{
+    pingInterval.store(qMax(0, msec));
+}
+
+/**
+ * Checks the connection with mysql_ping, a lighter round trip than a query
+ *
+ * @param database the connection
+ * @return true if the server answers
+ */
+bool DataBase::ping(QSqlDatabase database)
+{
+    MYSQL *mysql = MySQLCursor::nativeHandle(database);
+
+    return database.isOpen() && mysql != nullptr && mysql_ping(mysql) == 0;
+}
+
+/**
+ * Interrupts the statement executed by a connection with KILL QUERY: the connection and its
+ * session (temporary tables, variables) are kept. The statement is sent on a connection of
+ * the pool without default database, shared with the other administration queries of the
+ * server, which is usually idle and already open.
+ *
+ * @param config the configuration of the server
+ * @param connectionId the id of the connection to interrupt (CONNECTION_ID())
+ * @param error receives the error, if any
+ * @return the milliseconds taken by KILL QUERY, -1 on error
+ */
+qint64 DataBase::killQuery(ConnectionConfiguration config, quint64 connectionId, QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    config.databaseName = "";
+    PooledConnection connection(config);
+    QSqlDatabase database = connection.database();
+
+    QString message;
+    if (!database.isOpen()) {
+        message = database.lastError().text();
+    } else {
+        MySQLCursor cursor(database);
+        if (!cursor.exec(QString("KILL QUERY %1").arg(connectionId))) {
+            message = cursor.lastError();
+        }
+    }
+
+    if (!message.isEmpty()) {
+        qDebug() << "DataBase::killQuery - " + message;
+        if (error != nullptr) {
+            *error = message;
+        }
+        return -1;
+    }
+
+    return timer.elapsed();
+}
+
 DataBase::~DataBase() {
 }
 
@@ -19,7 +19,11 @@
 #define UTIL_DATABASE_H_
 
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QSqlDatabase>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QHash>
 
 struct ConnectionConfiguration {
     QString hostname;
@@ -29,6 +33,16 @@ struct ConnectionConfiguration {
     int port;
 };
 
+struct ConnectionPoolStatistics {
+    int idle;
+    int inUse;
+    qint64 created;
+    qint64 reused;
+    qint64 failedChecks;
+    qint64 closed;
+    qint64 overflow;
+};
+
 namespace Util {
 
 class DataBase {
@@ -37,13 +51,34 @@ public:
 	virtual ~DataBase();
 
 	static bool open(QJsonObject sessionConfiguration, QString database = "");
+    static QSqlDatabase current();
+    static QSqlDatabase session(QString uuid);
+    static void closeSession(QString uuid);
     static QSqlDatabase cloneCurrentConnection();
     static QSqlDatabase createFromConfig(ConnectionConfiguration config);
-    static ConnectionConfiguration dumpConfiguration();
+    static ConnectionConfiguration dumpConfiguration(QSqlDatabase db = current());
     static QSqlDatabase createFromJSON(QJsonObject config);
+    static ConnectionConfiguration configurationFromJSON(QJsonObject config, QString database = "");
+    static QJsonArray getSessions();
+    static QJsonObject currentSessionConfiguration();
+    static QSqlDatabase acquire(ConnectionConfiguration config);
+    static void release(QSqlDatabase database, bool reset = false);
+    static ConnectionPoolStatistics poolStatistics();
+    static void closePool();
+    static int getPingInterval();
+    static void setPingInterval(int msec);
+    static bool ping(QSqlDatabase database);
+    static qint64 killQuery(ConnectionConfiguration config, quint64 connectionId, QString *error = nullptr);
 
 private:
-	static QSqlDatabase defaultConnection;
+	struct SessionConnection {
+		QSqlDatabase database;
+		QElapsedTimer lastActivity;
+	};
+
+	static QHash<QString, SessionConnection> sessions;
+	static QString currentSession;
+	static QAtomicInt pingInterval;
 };
 
 } /* namespace Util */
@@ -0,0 +1,401 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ExplainPlan.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QRegExp>
+#include <QHash>
+#include <QDebug>
+
+// A full scan of a table with more rows is reported
+#define LARGE_TABLE_ROWS 10000
+// Rows of a full scan done for each row of the previous tables of a join
+#define JOIN_SCAN_ROWS 1000
+// A number of EXPLAIN ANALYZE, e.g. 0.35 or 1.2e+06
+#define NUMBER "([0-9]+(?:\\.[0-9]+)?(?:e[+-]?[0-9]+)?)"
+
+namespace Util {
+
+    /**
+     * @brief ExplainPlan::fromJson
+     * @param json the result of EXPLAIN FORMAT=JSON
+     * @param error receives the parse error, if any
+     * @return the root of the plan, its children are the query blocks
+     */
+    ExplainNode ExplainPlan::fromJson(QString json, QString *error)
+    {
+        ExplainNode root = createNode("Query");
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(json.toUtf8(), &parseError);
+        if (!document.isObject()) {
+            qDebug() << "ExplainPlan::fromJson - " + parseError.errorString();
+            if (error != nullptr) {
+                *error = parseError.errorString();
+            }
+            return root;
+        }
+
+        readBlock(document.object(), root);
+
+        return root;
+    }
+
+    /**
+     * Reads the tree of EXPLAIN ANALYZE, each line is an operation indented under its parent:
+     * -> Nested loop inner join  (cost=4.95 rows=9) (actual time=0.153..0.200 rows=9 loops=1)
+     *     -> Table scan on t1  (cost=1.15 rows=9) (actual time=0.050..0.060 rows=9 loops=1)
+     * @brief ExplainPlan::fromAnalyze
+     * @param tree the result of EXPLAIN ANALYZE
+     * @return the root of the plan
+     */
+    ExplainNode ExplainPlan::fromAnalyze(QString tree)
+    {
+        ExplainNode root = createNode("Query");
+        QList<QPair<int, ExplainNode> > lines;
+        QRegExp operationRegExp("^(\\s*)-> (.*)$");
+
+        foreach (QString line, tree.split("\n")) {
+            if (operationRegExp.indexIn(line) != -1) {
+                lines << qMakePair(operationRegExp.cap(1).size(), readAnalyzeLine(operationRegExp.cap(2)));
+            } else if (!lines.isEmpty() && !line.trimmed().isEmpty()) {
+                // A long condition continues on the next line
+                lines.last().second.operation += " " + line.trimmed();
+            }
+        }
+
+        int index = 0;
+        while (index < lines.size()) {
+            appendAnalyzeChildren(root, lines, index, lines.at(index).first);
+        }
+
+        return root;
+    }
+
+    /**
+     * The access of each table in the join order and the sorts, without the estimations
+     * which change with the statistics of the tables:
+     * o/ALL, c/eq_ref/PRIMARY, filesort
+     * @brief ExplainPlan::signature
+     * @return an empty string if the plan has no table
+     */
+    QString ExplainPlan::signature(const ExplainNode &plan)
+    {
+        QStringList parts;
+        appendSignature(plan, parts);
+
+        return parts.join(", ");
+    }
+
+    void ExplainPlan::appendSignature(const ExplainNode &node, QStringList &parts)
+    {
+        if (!node.table.isEmpty()) {
+            QString access = node.table + "/" + node.accessType;
+            if (!node.key.isEmpty()) {
+                access += "/" + node.key;
+            }
+            parts << access;
+        }
+
+        foreach (QString flag, node.flags) {
+            if (flag == "filesort" || flag == "temporary table") {
+                parts << flag;
+            }
+        }
+
+        foreach (ExplainNode child, node.children) {
+            appendSignature(child, parts);
+        }
+    }
+
+    /**
+     * @brief ExplainPlan::outline
+     * @return the operations of the plan as indented lines, without the estimations, to compare two plans
+     */
+    QStringList ExplainPlan::outline(const ExplainNode &plan)
+    {
+        QStringList lines;
+        foreach (ExplainNode child, plan.children) {
+            appendOutline(child, lines, 0);
+        }
+
+        return lines;
+    }
+
+    void ExplainPlan::appendOutline(const ExplainNode &node, QStringList &lines, int level)
+    {
+        QString line = QString(level * 2, ' ') + node.operation;
+        if (!node.table.isEmpty()) {
+            line += " " + node.table;
+        }
+        if (!node.accessType.isEmpty()) {
+            line += " (" + node.accessType + (node.key.isEmpty() ? "" : ", " + node.key) + ")";
+        }
+        if (!node.flags.isEmpty()) {
+            line += " [" + node.flags.join(", ") + "]";
+        }
+        lines << line;
+
+        foreach (ExplainNode child, node.children) {
+            appendOutline(child, lines, level + 1);
+        }
+    }
+
+    /**
+     * EXPLAIN ANALYZE executes the statement, and the plans are captured after the execution:
+     * only the queries which do not modify the data are explained
+     * @brief ExplainPlan::canExplain
+     */
+    bool ExplainPlan::canExplain(QString statement)
+    {
+        return QRegExp("^\\s*(SELECT|TABLE|WITH|\\()", Qt::CaseInsensitive).indexIn(statement) != -1
+                && QRegExp("\\b(INSERT|UPDATE|DELETE|REPLACE)\\b", Qt::CaseInsensitive).indexIn(statement) == -1;
+    }
+
+    void ExplainPlan::appendAnalyzeChildren(ExplainNode &parent, QList<QPair<int, ExplainNode> > &lines, int &index, int level)
+    {
+        while (index < lines.size() && lines.at(index).first >= level) {
+            ExplainNode node = lines.at(index).second;
+            index++;
+
+            if (index < lines.size() && lines.at(index).first > level) {
+                appendAnalyzeChildren(node, lines, index, lines.at(index).first);
+            }
+
+            parent.children << node;
+        }
+    }
+
+    /**
+     * Reads an operation of EXPLAIN ANALYZE with its estimations and its measures
+     */
+    ExplainNode ExplainPlan::readAnalyzeLine(QString line)
+    {
+        ExplainNode node = createNode(line.trimmed());
+
+        int details = line.indexOf(QRegExp("\\s+\\((cost=|actual time=|never executed)"));
+        if (details != -1) {
+            node.operation = line.left(details).trimmed();
+        }
+
+        QRegExp costRegExp("\\(cost=(?:" NUMBER "\\.\\.)?" NUMBER " rows=" NUMBER "\\)");
+        if (costRegExp.indexIn(line, qMax(0, details)) != -1) {
+            node.cost = costRegExp.cap(2).toDouble();
+            node.rows = costRegExp.cap(3).toDouble();
+        }
+
+        QRegExp actualRegExp("\\(actual time=" NUMBER "\\.\\." NUMBER " rows=" NUMBER " loops=" NUMBER "\\)");
+        if (actualRegExp.indexIn(line, qMax(0, details)) != -1) {
+            node.loops = actualRegExp.cap(4).toLongLong();
+            // The time and the rows are averages by loop
+            node.actualMsec = actualRegExp.cap(2).toDouble() * node.loops;
+            node.actualRows = actualRegExp.cap(3).toDouble();
+        } else if (line.contains("(never executed)")) {
+            node.flags << "never executed";
+        }
+
+        QRegExp tableRegExp(" on (\\S+)");
+        if (tableRegExp.indexIn(node.operation) != -1) {
+            node.table = tableRegExp.cap(1).remove('`');
+        }
+
+        QRegExp keyRegExp(" using (\\S+)");
+        if (keyRegExp.indexIn(node.operation) != -1) {
+            node.key = keyRegExp.cap(1).remove('`');
+        }
+
+        QString operation = node.operation;
+        if (operation.startsWith("Table scan")) {
+            node.accessType = "ALL";
+        } else if (operation.startsWith("Index scan") || operation.startsWith("Covering index scan")) {
+            node.accessType = "index";
+        } else if (operation.contains("index range scan", Qt::CaseInsensitive)) {
+            node.accessType = "range";
+        } else if (operation.startsWith("Single-row")) {
+            node.accessType = "eq_ref";
+        } else if (operation.contains("index lookup", Qt::CaseInsensitive)) {
+            node.accessType = "ref";
+        } else if (operation.startsWith("Constant row") || operation.startsWith("Rows fetched before execution")) {
+            node.accessType = "const";
+        }
+
+        if (operation.startsWith("Sort")) {
+            node.flags << "filesort";
+        } else if (operation.startsWith("Materialize") || operation.startsWith("Temporary table")) {
+            node.flags << "temporary table";
+        }
+
+        // The temporary tables (<temporary>, <subquery2>...) are not the tables of the query
+        bool fullScan = (node.accessType == "ALL" || node.accessType == "index") && !node.table.startsWith("<");
+        double rows = node.actualRows >= 0 ? node.actualRows : node.rows;
+        if (fullScan && node.loops > 1 && rows >= JOIN_SCAN_ROWS) {
+            node.warning = QString("Scanned %1 times, once for each row of the previous tables: missing index or bad join order").arg(node.loops);
+        } else if (fullScan && rows >= LARGE_TABLE_ROWS) {
+            node.warning = node.accessType == "ALL" ? "Full table scan" : "Full index scan";
+        }
+
+        return node;
+    }
+
+    ExplainNode ExplainPlan::createNode(QString operation)
+    {
+        ExplainNode node;
+        node.operation = operation;
+        node.rows = -1;
+        node.cost = -1;
+        node.actualMsec = -1;
+        node.actualRows = -1;
+        node.loops = -1;
+
+        return node;
+    }
+
+    /**
+     * Reads the operations of a query block (or of an operation on the rows of the block)
+     */
+    void ExplainPlan::readBlock(QJsonObject block, ExplainNode &node)
+    {
+        foreach (QString name, block.keys()) {
+            readOperation(name, block.value(name), node);
+        }
+    }
+
+    void ExplainPlan::readOperation(QString name, QJsonValue value, ExplainNode &parent)
+    {
+        static QHash<QString, QString> rowOperations;
+        if (rowOperations.isEmpty()) {
+            rowOperations.insert("ordering_operation", "ORDER BY");
+            rowOperations.insert("grouping_operation", "GROUP BY");
+            rowOperations.insert("duplicates_removal", "DISTINCT");
+            rowOperations.insert("windowing", "Window functions");
+            rowOperations.insert("buffer_result", "Buffer result");
+            rowOperations.insert("union_result", "UNION");
+            rowOperations.insert("materialized_from_subquery", "Materialized subquery");
+        }
+
+        if (name == "query_block") {
+            QJsonObject block = value.toObject();
+            ExplainNode node = createNode(QString("Query block #%1").arg(block.value("select_id").toInt()));
+            node.cost = toNumber(block.value("cost_info").toObject().value("query_cost"));
+            readBlock(block, node);
+            parent.children << node;
+        } else if (name == "table") {
+            parent.children << readTable(value.toObject());
+        } else if (name == "nested_loop") {
+            ExplainNode node = createNode("Nested loop join");
+            foreach (QJsonValue item, value.toArray()) {
+                readBlock(item.toObject(), node);
+            }
+            checkJoin(node);
+            parent.children << node;
+        } else if (rowOperations.contains(name)) {
+            QJsonObject object = value.toObject();
+            ExplainNode node = createNode(rowOperations.value(name));
+            readFlags(object, node);
+            readBlock(object, node);
+            parent.children << node;
+        } else if (name == "query_specifications") {
+            // The query blocks of a UNION
+            foreach (QJsonValue item, value.toArray()) {
+                readBlock(item.toObject(), parent);
+            }
+        } else if (name.endsWith("subqueries")) {
+            ExplainNode node = createNode(QString(name).replace('_', ' '));
+            node.operation[0] = node.operation.at(0).toUpper();
+            foreach (QJsonValue item, value.toArray()) {
+                readBlock(item.toObject(), node);
+            }
+            parent.children << node;
+        } else if (name == "message") {
+            // e.g. Impossible WHERE, No tables used
+            parent.children << createNode(value.toString());
+        }
+    }
+
+    ExplainNode ExplainPlan::readTable(QJsonObject table)
+    {
+        ExplainNode node = createNode("Table");
+        node.table = table.value("table_name").toString();
+        node.accessType = table.value("access_type").toString();
+        node.key = table.value("key").toString();
+        node.condition = table.value("attached_condition").toString();
+        node.rows = toNumber(table.value("rows_examined_per_scan"));
+
+        QJsonObject cost = table.value("cost_info").toObject();
+        if (cost.contains("read_cost")) {
+            node.cost = toNumber(cost.value("read_cost")) + toNumber(cost.value("eval_cost"));
+        }
+
+        readFlags(table, node);
+        if (table.value("using_join_buffer").isString()) {
+            node.flags << "join buffer (" + table.value("using_join_buffer").toString() + ")";
+        }
+        if (table.value("using_index").toBool()) {
+            node.flags << "covering index";
+        }
+
+        bool fullScan = (node.accessType == "ALL" || node.accessType == "index") && !node.table.startsWith("<");
+        if (fullScan && node.rows >= LARGE_TABLE_ROWS) {
+            node.warning = node.accessType == "ALL" ? "Full table scan" : "Full index scan";
+        }
+
+        foreach (QString name, table.keys()) {
+            if (name == "materialized_from_subquery" || name.endsWith("subqueries")) {
+                readOperation(name, table.value(name), node);
+            }
+        }
+
+        return node;
+    }
+
+    void ExplainPlan::readFlags(QJsonObject object, ExplainNode &node)
+    {
+        if (object.value("using_filesort").toBool()) {
+            node.flags << "filesort";
+        }
+        if (object.value("using_temporary_table").toBool()) {
+            node.flags << "temporary table";
+        }
+    }
+
+    /**
+     * The tables after the first one are read for each row of the previous tables, a full
+     * scan of these tables is a missing index or a bad join order
+     */
+    void ExplainPlan::checkJoin(ExplainNode &join)
+    {
+        for (int i = 1; i < join.children.size(); i++) {
+            ExplainNode &table = join.children[i];
+            bool fullScan = (table.accessType == "ALL" || table.accessType == "index") && !table.table.startsWith("<");
+            if (table.operation == "Table" && fullScan && table.rows >= JOIN_SCAN_ROWS) {
+                table.warning = "Scanned for each row of the previous tables: missing index or bad join order";
+            }
+        }
+    }
+
+    /**
+     * The numbers of EXPLAIN FORMAT=JSON are sometimes strings ("cost_info")
+     */
+    double ExplainPlan::toNumber(QJsonValue value)
+    {
+        if (value.isUndefined() || value.isNull()) {
+            return -1;
+        }
+
+        return value.toVariant().toDouble();
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef EXPLAINPLAN_H
+#define EXPLAINPLAN_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QJsonObject>
+#include <QJsonValue>
+
+struct ExplainNode {
+    QString operation;
+    QString table;
+    QString accessType; // ALL, index, range, ref...
+    QString key;
+    QString condition;
+    double rows; // estimated rows examined by each scan, -1 if unknown
+    double cost; // -1 if unknown
+    // EXPLAIN ANALYZE only, -1 otherwise
+    double actualMsec;
+    double actualRows;
+    qint64 loops;
+    QStringList flags; // filesort, temporary table, join buffer
+    QString warning; // full scan of a large table, bad join order
+    QList<ExplainNode> children;
+};
+
+namespace Util {
+    /**
+     * Reads the plan given by EXPLAIN FORMAT=JSON or by EXPLAIN ANALYZE (MySQL 8.0.18) as a
+     * tree of operations. The full scans of the large tables are marked with a warning, and
+     * more particularly the ones executed for each row of the previous tables of a join,
+     * which come from a missing index or a bad join order.
+     */
+    class ExplainPlan
+    {
+    public:
+        static ExplainNode fromJson(QString json, QString *error = nullptr);
+        static ExplainNode fromAnalyze(QString tree);
+        static QString signature(const ExplainNode &plan);
+        static QStringList outline(const ExplainNode &plan);
+        static bool canExplain(QString statement);
+
+    private:
+        static ExplainNode createNode(QString operation);
+        static void readOperation(QString name, QJsonValue value, ExplainNode &parent);
+        static void readBlock(QJsonObject block, ExplainNode &node);
+        static ExplainNode readTable(QJsonObject table);
+        static void readFlags(QJsonObject object, ExplainNode &node);
+        static void checkJoin(ExplainNode &join);
+        static ExplainNode readAnalyzeLine(QString line);
+        static void appendAnalyzeChildren(ExplainNode &parent, QList<QPair<int, ExplainNode> > &lines, int &index, int level);
+        static double toNumber(QJsonValue value);
+        static void appendSignature(const ExplainNode &node, QStringList &parts);
+        static void appendOutline(const ExplainNode &node, QStringList &lines, int level);
+    };
+}
+
+#endif // EXPLAINPLAN_H
@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "FanOutExecution.h"
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include <QThread>
+#include <QScopedPointer>
+#include <QSqlField>
+#include <QSqlError>
+#include <QMutexLocker>
+#include <QDebug>
+
+// Workers of an execution, the connections above the size of the pool are closed at the end
+#define MAX_CONCURRENCY 32
+
+namespace Util {
+
+    /**
+     * Thread of a worker, the worker has its own connection
+     */
+    class FanOutThread : public QThread
+    {
+    public:
+        FanOutThread(FanOutExecution *execution) : execution(execution) {}
+
+    protected:
+        void run()
+        {
+            this->execution->runWorker();
+        }
+
+    private:
+        FanOutExecution *execution;
+    };
+
+    FanOutExecution::FanOutExecution(QList<FanOutTarget> targets, QString query):
+        targets(targets),
+        query(query)
+    {
+        this->concurrency = 8;
+        this->rowLimit = 1000;
+        this->stop = false;
+        this->started = 0;
+
+        this->status.shards = targets.size();
+        this->status.finished = 0;
+        this->status.errors = 0;
+        this->status.rows = 0;
+        this->status.elapsedMsec = 0;
+    }
+
+    /**
+     * @brief FanOutExecution::setConcurrency
+     * @param workers the number of shards executed at the same time
+     */
+    void FanOutExecution::setConcurrency(int workers)
+    {
+        this->concurrency = qBound(1, workers, MAX_CONCURRENCY);
+    }
+
+    /**
+     * @brief FanOutExecution::setRowLimit
+     * @param rows the number of rows kept for each shard, the next ones are only counted
+     */
+    void FanOutExecution::setRowLimit(int rows)
+    {
+        this->rowLimit = qMax(0, rows);
+    }
+
+    /**
+     * Starts the workers and waits for them
+     * @brief FanOutExecution::execute
+     */
+    void FanOutExecution::execute()
+    {
+        this->statusMutex.lock();
+        this->started = 0;
+        this->timer.start();
+        this->statusMutex.unlock();
+
+        QList<FanOutThread *> workers;
+        for (int i = 0; i < qMin(this->concurrency, this->targets.size()); i++) {
+            FanOutThread *worker = new FanOutThread(this);
+            worker->start();
+            workers << worker;
+        }
+
+        foreach (FanOutThread *worker, workers) {
+            worker->wait();
+            delete worker;
+        }
+
+        this->statusMutex.lock();
+        this->status.elapsedMsec = this->timer.elapsed();
+        this->timer.invalidate();
+        this->statusMutex.unlock();
+
+        emit executionFinished(this->stop);
+    }
+
+    /**
+     * Executes the statement on the next databases until all of them are done,
+     * called in the thread of each worker
+     * @brief FanOutExecution::runWorker
+     */
+    void FanOutExecution::runWorker()
+    {
+        QScopedPointer<PooledConnection> connection;
+        ConnectionConfiguration server;
+
+        int index;
+        while (this->nextTarget(index)) {
+            // The connection is opened without database, the database of each shard is selected
+            ConnectionConfiguration configuration = this->targets.at(index).connection;
+            configuration.databaseName = "";
+
+            bool sameServer = !connection.isNull() && server.hostname == configuration.hostname && server.port == configuration.port
+                    && server.username == configuration.username && server.password == configuration.password;
+            if (!sameServer) {
+                if (!connection.isNull()) {
+                    // The pooled connections of the server do not keep the database of the last shard
+                    connection->discard();
+                }
+                connection.reset(new PooledConnection(configuration));
+                server = configuration;
+            }
+
+            FanOutShard shard = this->executeShard(connection->database(), index);
+            if (!connection->database().isOpen()) {
+                connection->discard();
+                connection.reset();
+            }
+
+            this->statusMutex.lock();
+            this->status.finished++;
+            this->status.rows += shard.isSelect ? shard.rows : 0;
+            if (!shard.error.isEmpty()) {
+                this->status.errors++;
+            }
+            this->statusMutex.unlock();
+
+            emit shardFinished(shard);
+        }
+
+        if (!connection.isNull()) {
+            connection->discard();
+        }
+    }
+
+    /**
+     * Gives the next shard to a worker
+     * @param index receives the index of the target
+     * @return false when all the shards are given, or when the execution is stopped
+     */
+    bool FanOutExecution::nextTarget(int &index)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        if (this->stop || this->started >= this->targets.size()) {
+            return false;
+        }
+
+        index = this->started++;
+        return true;
+    }
+
+    /**
+     * Executes the statement on the database of a shard and reads its first result set
+     * @brief FanOutExecution::executeShard
+     */
+    FanOutShard FanOutExecution::executeShard(QSqlDatabase database, int index)
+    {
+        FanOutTarget target = this->targets.at(index);
+
+        FanOutShard shard;
+        shard.index = index;
+        shard.server = target.server;
+        shard.databaseName = target.connection.databaseName;
+        shard.isSelect = false;
+        shard.rows = 0;
+        shard.limited = false;
+        shard.msec = 0;
+
+        if (!database.isOpen()) {
+            shard.error = database.lastError().text();
+            qDebug() << "FanOutExecution::executeShard - " + shard.error;
+            return shard;
+        }
+
+        QElapsedTimer executionTimer;
+        executionTimer.start();
+
+        MySQLCursor cursor(database);
+        if (!cursor.exec(QString("USE `%1`").arg(QString(shard.databaseName).replace("`", "``")))
+                || !cursor.exec(this->query)) {
+            shard.error = cursor.lastError();
+            shard.msec = executionTimer.elapsed();
+            return shard;
+        }
+
+        if (cursor.isSelect()) {
+            shard.isSelect = true;
+
+            QSqlRecord header;
+            header.append(QSqlField("_server", QVariant::String));
+            header.append(QSqlField("_database", QVariant::String));
+            QSqlRecord record = cursor.record();
+            for (int i = 0; i < record.count(); i++) {
+                header.append(record.field(i));
+            }
+
+            ResultSet data(header);
+            while (cursor.next()) {
+                if (shard.rows < this->rowLimit) {
+                    QVariantList values;
+                    values << shard.server << shard.databaseName;
+                    for (int i = 0; i < record.count(); i++) {
+                        values << (cursor.isNull(i) ? QVariant() : cursor.value(i));
+                    }
+                    data.appendRow(values);
+                }
+                shard.rows++;
+
+                if (this->stop) {
+                    break;
+                }
+            }
+
+            shard.data = data;
+            shard.limited = shard.rows > this->rowLimit;
+        } else {
+            shard.rows = cursor.numRowsAffected();
+        }
+
+        // The next results of the statement are read to free the connection
+        while (cursor.lastError().isEmpty() && cursor.nextResult()) {
+            while (cursor.next()) {
+            }
+        }
+
+        shard.error = cursor.lastError();
+        shard.msec = executionTimer.elapsed();
+
+        return shard;
+    }
+
+    FanOutStatus FanOutExecution::getStatus()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        if (this->timer.isValid()) {
+            this->status.elapsedMsec = this->timer.elapsed();
+        }
+
+        return this->status;
+    }
+
+    /**
+     * Stops after the current shards
+     * @brief FanOutExecution::stopRequired
+     */
+    void FanOutExecution::stopRequired()
+    {
+        this->stop = true;
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef FANOUTEXECUTION_H
+#define FANOUTEXECUTION_H
+
+#include "DataBase.h"
+#include "ResultSet.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QList>
+#include <QElapsedTimer>
+
+struct FanOutTarget {
+    QString server; // name of the session
+    ConnectionConfiguration connection; // with the database of the shard
+};
+
+struct FanOutShard {
+    int index; // in the targets
+    QString server;
+    QString databaseName;
+    Util::ResultSet data; // the rows with the _server and _database columns first
+    bool isSelect;
+    qint64 rows; // rows of the result, or rows affected
+    bool limited; // only the first rows are kept
+    qint64 msec;
+    QString error;
+};
+
+struct FanOutStatus {
+    int shards;
+    int finished;
+    int errors;
+    qint64 rows;
+    qint64 elapsedMsec;
+};
+
+namespace Util {
+    /**
+     * Executes a statement on many databases, possibly on several servers, with a bounded
+     * number of workers.
+     *
+     * Each worker has its own thread and takes the next database until all of them are done.
+     * A worker keeps its connection while its databases are on the same server and selects
+     * the database of each shard. The rows of the first result set of each shard, with the
+     * server and the database, are sent with shardFinished as soon as the shard is done.
+     */
+    class FanOutExecution : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        FanOutExecution(QList<FanOutTarget> targets, QString query);
+        void setConcurrency(int workers);
+        void setRowLimit(int rows);
+
+        FanOutStatus getStatus();
+        void stopRequired();
+        void runWorker();
+
+    public slots:
+        void execute();
+
+    signals:
+        void shardFinished(FanOutShard shard);
+        void executionFinished(bool stopped);
+
+    private:
+        QList<FanOutTarget> targets;
+        QString query;
+        int concurrency;
+        int rowLimit;
+        volatile bool stop;
+
+        QMutex statusMutex;
+        FanOutStatus status;
+        int started; // shards given to the workers
+        QElapsedTimer timer;
+
+        bool nextTarget(int &index);
+        FanOutShard executeShard(QSqlDatabase database, int index);
+    };
+}
+
+#endif // FANOUTEXECUTION_H
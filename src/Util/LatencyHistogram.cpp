@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "LatencyHistogram.h"
+
+// The values are kept with 3 significant digits: 2 * 10^3 rounded to a power of 2
+#define SUB_BUCKET_COUNT_MAGNITUDE 11
+#define SUB_BUCKET_COUNT (1 << SUB_BUCKET_COUNT_MAGNITUDE)
+#define SUB_BUCKET_HALF_COUNT_MAGNITUDE (SUB_BUCKET_COUNT_MAGNITUDE - 1)
+#define SUB_BUCKET_HALF_COUNT (1 << SUB_BUCKET_HALF_COUNT_MAGNITUDE)
+// The highest value, one hour in microseconds, the larger ones are counted as this one
+#define HIGHEST_TRACKABLE_VALUE (Q_INT64_C(3600) * 1000 * 1000)
+
+namespace Util {
+
+    LatencyHistogram::LatencyHistogram()
+    {
+        // Buckets needed to reach the highest value
+        int bucketCount = 1;
+        qint64 smallestUntrackableValue = SUB_BUCKET_COUNT;
+        while (smallestUntrackableValue <= HIGHEST_TRACKABLE_VALUE) {
+            smallestUntrackableValue <<= 1;
+            bucketCount++;
+        }
+
+        this->counts.fill(0, (bucketCount + 1) * SUB_BUCKET_HALF_COUNT);
+        this->reset();
+    }
+
+    /**
+     * @brief LatencyHistogram::record
+     * @param usec a latency in microseconds
+     */
+    void LatencyHistogram::record(qint64 usec)
+    {
+        qint64 value = qBound(Q_INT64_C(0), usec, HIGHEST_TRACKABLE_VALUE);
+
+        this->counts[countsIndex(value)]++;
+        this->totalCount++;
+        this->sum += value;
+        this->maxValue = qMax(this->maxValue, value);
+        this->minValue = this->totalCount == 1 ? value : qMin(this->minValue, value);
+    }
+
+    /**
+     * Adds the values of another histogram, e.g. the one of another worker
+     * @brief LatencyHistogram::add
+     */
+    void LatencyHistogram::add(const LatencyHistogram &other)
+    {
+        if (other.totalCount == 0) {
+            return;
+        }
+
+        for (int i = 0; i < this->counts.size(); i++) {
+            this->counts[i] += other.counts.at(i);
+        }
+
+        this->minValue = this->totalCount == 0 ? other.minValue : qMin(this->minValue, other.minValue);
+        this->maxValue = qMax(this->maxValue, other.maxValue);
+        this->totalCount += other.totalCount;
+        this->sum += other.sum;
+    }
+
+    void LatencyHistogram::reset()
+    {
+        this->counts.fill(0);
+        this->totalCount = 0;
+        this->maxValue = 0;
+        this->minValue = 0;
+        this->sum = 0;
+    }
+
+    qint64 LatencyHistogram::count() const
+    {
+        return this->totalCount;
+    }
+
+    qint64 LatencyHistogram::max() const
+    {
+        return this->maxValue;
+    }
+
+    qint64 LatencyHistogram::min() const
+    {
+        return this->minValue;
+    }
+
+    double LatencyHistogram::mean() const
+    {
+        return this->totalCount == 0 ? 0 : this->sum / this->totalCount;
+    }
+
+    /**
+     * @brief LatencyHistogram::valueAtPercentile
+     * @param percentile between 0 and 100
+     * @return the highest value of the sub-bucket which contains the percentile, in microseconds
+     */
+    qint64 LatencyHistogram::valueAtPercentile(double percentile) const
+    {
+        if (this->totalCount == 0) {
+            return 0;
+        }
+
+        qint64 countAtPercentile = qMax(Q_INT64_C(1), qint64(qBound(0.0, percentile, 100.0) / 100.0 * this->totalCount + 0.5));
+        qint64 total = 0;
+        for (int i = 0; i < this->counts.size(); i++) {
+            total += this->counts.at(i);
+            if (total >= countAtPercentile) {
+                return qMin(highestEquivalentValue(i), this->maxValue);
+            }
+        }
+
+        return this->maxValue;
+    }
+
+    int LatencyHistogram::countsIndex(qint64 value)
+    {
+        // Position of the highest bit of the value, at least the one of the first bucket
+        int magnitude = 0;
+        quint64 bits = quint64(value) | (SUB_BUCKET_COUNT - 1);
+        while (bits != 0) {
+            bits >>= 1;
+            magnitude++;
+        }
+
+        int bucketIndex = magnitude - SUB_BUCKET_COUNT_MAGNITUDE;
+        int subBucketIndex = int(value >> bucketIndex);
+
+        // The lower half of the sub-buckets of a bucket are in the previous bucket
+        return ((bucketIndex + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) + (subBucketIndex - SUB_BUCKET_HALF_COUNT);
+    }
+
+    qint64 LatencyHistogram::highestEquivalentValue(int index)
+    {
+        int bucketIndex = (index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+        int subBucketIndex = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+        if (bucketIndex < 0) {
+            subBucketIndex -= SUB_BUCKET_HALF_COUNT;
+            bucketIndex = 0;
+        }
+
+        // The values of a sub-bucket of the bucket n are 2^n wide
+        qint64 lowestValue = qint64(subBucketIndex) << bucketIndex;
+        return lowestValue + (Q_INT64_C(1) << bucketIndex) - 1;
+    }
+}
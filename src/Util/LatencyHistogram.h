@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QVector>
+
+namespace Util {
+    /**
+     * HDR histogram of latencies in microseconds, from 1 µs to one hour.
+     *
+     * The values are counted in buckets of 2048 sub-buckets, each bucket covers twice the
+     * range of the previous one: the percentiles have 3 significant digits whatever the
+     * latency, with a fixed memory (about 190 KB) and a constant time to record a value.
+     */
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram();
+
+        void record(qint64 usec);
+        void add(const LatencyHistogram &other);
+        void reset();
+
+        qint64 count() const;
+        qint64 max() const;
+        qint64 min() const;
+        double mean() const;
+        qint64 valueAtPercentile(double percentile) const;
+
+    private:
+        QVector<qint64> counts;
+        qint64 totalCount;
+        qint64 maxValue;
+        qint64 minValue;
+        double sum;
+
+        static int countsIndex(qint64 value);
+        static qint64 highestEquivalentValue(int index);
+    };
+}
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "MetadataService.h"
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QDebug>
+
+// Metadata requests executed at the same time, on different servers or databases
+#define METADATA_THREADS 2
+
+namespace Util {
+
+    /**
+     * Executes the queries of a request in a thread of the service
+     */
+    class MetadataTask : public QRunnable
+    {
+    public:
+        MetadataTask(QString key, quint64 ticket, ConnectionConfiguration configuration, QStringList queries) :
+            key(key), ticket(ticket), configuration(configuration), queries(queries) {}
+
+        void run()
+        {
+            MetadataService::instance()->execute(this->key, this->ticket, this->configuration, this->queries);
+        }
+
+    private:
+        QString key;
+        quint64 ticket;
+        ConnectionConfiguration configuration;
+        QStringList queries;
+    };
+
+    MetadataService::MetadataService()
+    {
+        this->lastTicket = 0;
+        this->threads.setMaxThreadCount(METADATA_THREADS);
+
+        qRegisterMetaType<Util::ResultSet>("Util::ResultSet");
+        qRegisterMetaType< QList<Util::ResultSet> >("QList<Util::ResultSet>");
+    }
+
+    MetadataService *MetadataService::instance()
+    {
+        static MetadataService service;
+        return &service;
+    }
+
+    /**
+     * Queues the queries, resultReady gives one result set for each query
+     * @brief MetadataService::request
+     * @param key the identifier of the request, the previous request with the same key is cancelled
+     * @param configuration the server, the database name is ignored
+     * @param queries the queries, with the database names
+     */
+    void MetadataService::request(QString key, ConnectionConfiguration configuration, QStringList queries)
+    {
+        // The same connections are used for all the databases of a server
+        configuration.databaseName = "";
+
+        this->mutex.lock();
+        quint64 ticket = ++this->lastTicket;
+        this->tickets.insert(key, ticket);
+        this->mutex.unlock();
+
+        this->threads.start(new MetadataTask(key, ticket, configuration, queries));
+    }
+
+    /**
+     * The pending request is skipped, or its result is ignored if it is running
+     * @brief MetadataService::cancel
+     * @param key the identifier of the request
+     */
+    void MetadataService::cancel(QString key)
+    {
+        QMutexLocker locker(&this->mutex);
+        this->tickets.remove(key);
+    }
+
+    bool MetadataService::isPending(QString key)
+    {
+        QMutexLocker locker(&this->mutex);
+        return this->tickets.contains(key);
+    }
+
+    /**
+     * Cancels all the requests and waits for the running ones, before the pool is closed
+     * @brief MetadataService::shutdown
+     */
+    void MetadataService::shutdown()
+    {
+        this->mutex.lock();
+        this->tickets.clear();
+        this->mutex.unlock();
+
+        this->threads.waitForDone();
+    }
+
+    /**
+     * @brief MetadataService::isCurrent
+     * @return false if the request has been cancelled or replaced by a newer one
+     */
+    bool MetadataService::isCurrent(QString key, quint64 ticket)
+    {
+        QMutexLocker locker(&this->mutex);
+        return this->tickets.value(key) == ticket;
+    }
+
+    /**
+     * Runs the queries of a request, called from a thread of the service
+     * @brief MetadataService::execute
+     */
+    void MetadataService::execute(QString key, quint64 ticket, ConnectionConfiguration configuration, QStringList queries)
+    {
+        if (!this->isCurrent(key, ticket)) {
+            return;
+        }
+
+        QList<ResultSet> results;
+        QString error;
+
+        {
+            PooledConnection connection(configuration);
+            QSqlDatabase database = connection.database();
+
+            if (!database.isOpen()) {
+                error = database.lastError().text();
+            } else {
+                MySQLCursor cursor(database);
+
+                foreach (QString query, queries) {
+                    // The next queries of a stale request are not sent
+                    if (!this->isCurrent(key, ticket)) {
+                        return;
+                    }
+
+                    if (!cursor.exec(query)) {
+                        error = cursor.lastError();
+                        break;
+                    }
+
+                    ResultSet result(cursor.record());
+                    while (cursor.next()) {
+                        result.appendRow(cursor);
+                    }
+
+                    if (!cursor.lastError().isEmpty()) {
+                        error = cursor.lastError();
+                        break;
+                    }
+
+                    results << result;
+                }
+            }
+        }
+
+        if (!error.isEmpty()) {
+            qDebug() << "MetadataService::execute - " + error;
+        }
+
+        QMetaObject::invokeMethod(this, "handleFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, key),
+                                  Q_ARG(quint64, ticket),
+                                  Q_ARG(QList<Util::ResultSet>, results),
+                                  Q_ARG(QString, error));
+    }
+
+    /**
+     * Delivers the result in the GUI thread, unless the request is stale
+     * @brief MetadataService::handleFinished
+     */
+    void MetadataService::handleFinished(QString key, quint64 ticket, QList<Util::ResultSet> results, QString error)
+    {
+        this->mutex.lock();
+        bool current = this->tickets.value(key) == ticket;
+        if (current) {
+            this->tickets.remove(key);
+        }
+        this->mutex.unlock();
+
+        if (!current) {
+            return;
+        }
+
+        if (error.isEmpty()) {
+            emit resultReady(key, results);
+        } else {
+            emit requestFailed(key, error);
+        }
+    }
+}
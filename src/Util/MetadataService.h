@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef METADATASERVICE_H
+#define METADATASERVICE_H
+
+#include "DataBase.h"
+#include "ResultSet.h"
+#include <QObject>
+#include <QThreadPool>
+#include <QStringList>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+
+namespace Util {
+    /**
+     * Executes the metadata queries (SHOW ..., information_schema) of the explorer in
+     * background threads, the results are delivered by signals in the GUI thread.
+     *
+     * The queries run on a connection of the pool opened without default database, so they
+     * must name the database (SHOW TABLES FROM ...). A request is identified by a key chosen
+     * by the caller: a new request with the same key makes the previous one stale, it is
+     * skipped if it has not started yet and its result is never delivered.
+     */
+    class MetadataService : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        static MetadataService *instance();
+
+        void request(QString key, ConnectionConfiguration configuration, QStringList queries);
+        void cancel(QString key);
+        bool isPending(QString key);
+        void shutdown();
+
+        bool isCurrent(QString key, quint64 ticket);
+        void execute(QString key, quint64 ticket, ConnectionConfiguration configuration, QStringList queries);
+
+    signals:
+        void resultReady(QString key, QList<Util::ResultSet> results);
+        void requestFailed(QString key, QString error);
+
+    private slots:
+        void handleFinished(QString key, quint64 ticket, QList<Util::ResultSet> results, QString error);
+
+    private:
+        MetadataService();
+
+        QThreadPool threads;
+        QMutex mutex;
+        QHash<QString, quint64> tickets;
+        quint64 lastTicket;
+    };
+}
+
+#endif // METADATASERVICE_H
@@ -0,0 +1,402 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "MySQLCursor.h"
+#include <QSqlDriver>
+#include <QSqlField>
+#include <QDateTime>
+#include <QDebug>
+
+// Character set number of the binary strings (BINARY, VARBINARY, BLOB)
+#define BINARY_CHARSET_NUMBER 63
+
+namespace Util {
+
+    /**
+     * Same conversion as the QMYSQL driver, except the DECIMAL values which are kept as string
+     * to avoid the loss of precision of a double
+     */
+    static QVariant::Type decodeType(const MYSQL_FIELD *field)
+    {
+        bool isUnsigned = field->flags & UNSIGNED_FLAG;
+
+        switch (field->type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_INT24:
+            return isUnsigned ? QVariant::UInt : QVariant::Int;
+        case MYSQL_TYPE_YEAR:
+            return QVariant::Int;
+        case MYSQL_TYPE_LONGLONG:
+            return isUnsigned ? QVariant::ULongLong : QVariant::LongLong;
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+            return QVariant::Double;
+        case MYSQL_TYPE_DATE:
+            return QVariant::Date;
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+            return QVariant::DateTime;
+        case MYSQL_TYPE_BIT:
+        case MYSQL_TYPE_GEOMETRY:
+            // GEOMETRY values are sent in the binary WKB format
+            return QVariant::ByteArray;
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_VAR_STRING:
+            return field->charsetnr == BINARY_CHARSET_NUMBER ? QVariant::ByteArray : QVariant::String;
+        default:
+            // TIME can be out of the range of QTime (e.g. 838:59:59)
+            return QVariant::String;
+        }
+    }
+
+    MySQLCursor::MySQLCursor(QSqlDatabase database)
+    {
+        this->mysql = nativeHandle(database);
+        this->result = nullptr;
+        this->row = nullptr;
+        this->lengths = nullptr;
+
+        if (this->mysql == nullptr) {
+            this->error = "MySQLCursor - the connection is not a MySQL connection";
+        }
+    }
+
+    /**
+     * Executes the query (or the statements separated by ;) and starts reading the first result
+     * @brief MySQLCursor::exec
+     * @param query the query
+     * @return false on error
+     */
+    bool MySQLCursor::exec(QString query)
+    {
+        if (this->mysql == nullptr) {
+            return false;
+        }
+
+        this->freeResult();
+        this->error.clear();
+
+        QByteArray sql = query.toUtf8();
+        if (mysql_real_query(this->mysql, sql.constData(), sql.size()) != 0) {
+            this->error = QString::fromUtf8(mysql_error(this->mysql));
+            return false;
+        }
+
+        this->result = mysql_use_result(this->mysql);
+        if (this->result == nullptr && mysql_field_count(this->mysql) > 0) {
+            this->error = QString::fromUtf8(mysql_error(this->mysql));
+            return false;
+        }
+
+        this->readHeader();
+
+        return true;
+    }
+
+    /**
+     * Skips the remaining rows of the current result and moves to the result of the next statement
+     * @brief MySQLCursor::nextResult
+     * @return false when there is no more result or on error (see lastError)
+     */
+    bool MySQLCursor::nextResult()
+    {
+        if (this->mysql == nullptr) {
+            return false;
+        }
+
+        this->freeResult();
+        if (!mysql_more_results(this->mysql)) {
+            return false;
+        }
+
+        int status = mysql_next_result(this->mysql);
+        if (status > 0) {
+            this->error = QString::fromUtf8(mysql_error(this->mysql));
+            return false;
+        } else if (status < 0) {
+            return false;
+        }
+
+        this->result = mysql_use_result(this->mysql);
+        this->readHeader();
+
+        return true;
+    }
+
+    /**
+     * The server flags the result sets followed by another one (multiple statements, procedures)
+     * @brief MySQLCursor::hasMoreResults
+     * @return true if the current result is not the last one
+     */
+    bool MySQLCursor::hasMoreResults() const
+    {
+        return this->mysql != nullptr && mysql_more_results(this->mysql);
+    }
+
+    bool MySQLCursor::isSelect() const
+    {
+        return this->result != nullptr;
+    }
+
+    /**
+     * @brief MySQLCursor::record
+     * @return the columns of the current result, without value
+     */
+    QSqlRecord MySQLCursor::record() const
+    {
+        return this->header;
+    }
+
+    int MySQLCursor::columnCount() const
+    {
+        return this->types.size();
+    }
+
+    /**
+     * Reads the next row from the network
+     * @brief MySQLCursor::next
+     * @return false at the end of the result
+     */
+    bool MySQLCursor::next()
+    {
+        if (this->result == nullptr) {
+            return false;
+        }
+
+        this->row = mysql_fetch_row(this->result);
+        if (this->row == nullptr) {
+            if (mysql_errno(this->mysql) != 0) {
+                this->error = QString::fromUtf8(mysql_error(this->mysql));
+            }
+            return false;
+        }
+
+        this->lengths = mysql_fetch_lengths(this->result);
+
+        return true;
+    }
+
+    bool MySQLCursor::isNull(int column) const
+    {
+        return this->row == nullptr || this->row[column] == nullptr;
+    }
+
+    /**
+     * @brief MySQLCursor::value
+     * @param column the column number
+     * @return the value of the column in the current row
+     */
+    QVariant MySQLCursor::value(int column) const
+    {
+        QVariant::Type type = this->types.at(column);
+        if (this->isNull(column)) {
+            return QVariant(type);
+        }
+
+        return decodeValue(type, this->row[column], this->lengths[column]);
+    }
+
+    /**
+     * The value is written as sent by the server so the conversion does not lose anything: the
+     * numbers (including DECIMAL) as they are, the other values as hexadecimal literals which do
+     * not depend on NO_BACKSLASH_ESCAPES, with the character set of the connection for the text
+     * so they are compared with the collation of the column
+     * @brief MySQLCursor::literal
+     * @param column the column number
+     * @return the value of the column in the current row as a SQL literal
+     */
+    QString MySQLCursor::literal(int column) const
+    {
+        if (this->isNull(column)) {
+            return "NULL";
+        }
+
+        QByteArray raw = QByteArray::fromRawData(this->row[column], int(this->lengths[column]));
+        if (this->numeric.at(column)) {
+            return QString::fromLatin1(raw);
+        } else if (this->types.at(column) == QVariant::ByteArray) {
+            return "X'" + QString::fromLatin1(raw.toHex()) + "'";
+        }
+
+        return "_utf8mb4 X'" + QString::fromLatin1(raw.toHex()) + "'";
+    }
+
+    /**
+     * @brief MySQLCursor::rawValue
+     * @param column the column number
+     * @return the bytes of the value as sent by the server, valid until the next row
+     */
+    const char *MySQLCursor::rawValue(int column) const
+    {
+        return this->isNull(column) ? nullptr : this->row[column];
+    }
+
+    int MySQLCursor::valueLength(int column) const
+    {
+        return this->isNull(column) ? 0 : int(this->lengths[column]);
+    }
+
+    /**
+     * @brief MySQLCursor::nativeHandle
+     * @param database the connection
+     * @return the handle of the native client library, nullptr if it is not an open QMYSQL connection
+     */
+    MYSQL *MySQLCursor::nativeHandle(QSqlDatabase database)
+    {
+        if (!database.isValid()) {
+            return nullptr;
+        }
+
+        QVariant handle = database.driver()->handle();
+        if (handle.isValid() && qstrcmp(handle.typeName(), "MYSQL*") == 0) {
+            return *static_cast<MYSQL **>(handle.data());
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Converts a value of the text protocol
+     * @brief MySQLCursor::decodeValue
+     * @param type the type of the column
+     * @param data the bytes of the value
+     * @param length the number of bytes
+     * @return the value
+     */
+    QVariant MySQLCursor::decodeValue(QVariant::Type type, const char *data, int length)
+    {
+        QByteArray raw = QByteArray::fromRawData(data, length);
+
+        switch (type) {
+        case QVariant::Int:
+            return raw.toInt();
+        case QVariant::UInt:
+            return raw.toUInt();
+        case QVariant::LongLong:
+            return raw.toLongLong();
+        case QVariant::ULongLong:
+            return raw.toULongLong();
+        case QVariant::Double:
+            return raw.toDouble();
+        case QVariant::Bool:
+            return raw.toInt() != 0;
+        case QVariant::Date:
+            return QDate::fromString(QString::fromLatin1(data, length), "yyyy-MM-dd");
+        case QVariant::DateTime:
+            // The fractional seconds are truncated to the milliseconds
+            if (length > 19) {
+                return QDateTime::fromString(QString::fromLatin1(data, qMin(length, 23)), "yyyy-MM-dd hh:mm:ss.zzz");
+            }
+            return QDateTime::fromString(QString::fromLatin1(data, length), "yyyy-MM-dd hh:mm:ss");
+        case QVariant::ByteArray:
+            return QByteArray(data, length);
+        default:
+            return QString::fromUtf8(data, length);
+        }
+    }
+
+    /**
+     * @brief MySQLCursor::rowLength
+     * @return the number of bytes of the values of the current row
+     */
+    qint64 MySQLCursor::rowLength() const
+    {
+        qint64 length = 0;
+        if (this->row != nullptr) {
+            for (int i = 0; i < this->types.size(); i++) {
+                length += this->lengths[i];
+            }
+        }
+
+        return length;
+    }
+
+    qint64 MySQLCursor::numRowsAffected() const
+    {
+        if (this->mysql == nullptr) {
+            return -1;
+        }
+
+        return qint64(mysql_affected_rows(this->mysql));
+    }
+
+    /**
+     * @brief MySQLCursor::connectionId
+     * @return the id of the connection on the server, as in SHOW PROCESSLIST
+     */
+    quint64 MySQLCursor::connectionId() const
+    {
+        return this->mysql == nullptr ? 0 : mysql_thread_id(this->mysql);
+    }
+
+    QString MySQLCursor::lastError() const
+    {
+        return this->error;
+    }
+
+    /**
+     * Frees the current result, the rows not read are read from the network and skipped
+     * @brief MySQLCursor::freeResult
+     */
+    void MySQLCursor::freeResult()
+    {
+        if (this->result != nullptr) {
+            mysql_free_result(this->result);
+            this->result = nullptr;
+        }
+
+        this->row = nullptr;
+        this->lengths = nullptr;
+        this->header.clear();
+        this->types.clear();
+        this->numeric.clear();
+    }
+
+    void MySQLCursor::readHeader()
+    {
+        this->header.clear();
+        this->types.clear();
+        this->numeric.clear();
+
+        if (this->result == nullptr) {
+            return;
+        }
+
+        unsigned int count = mysql_num_fields(this->result);
+        MYSQL_FIELD *fields = mysql_fetch_fields(this->result);
+        for (unsigned int i = 0; i < count; i++) {
+            QVariant::Type type = decodeType(&fields[i]);
+            QSqlField field(QString::fromUtf8(fields[i].name), type);
+            field.setLength(fields[i].length);
+            field.setPrecision(fields[i].decimals);
+            field.setRequired(fields[i].flags & NOT_NULL_FLAG);
+            this->header.append(field);
+            this->types << type;
+            this->numeric << IS_NUM(fields[i].type);
+        }
+    }
+
+    MySQLCursor::~MySQLCursor()
+    {
+        this->freeResult();
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef MYSQLCURSOR_H
+#define MYSQLCURSOR_H
+
+#include <QSqlDatabase>
+#include <QSqlRecord>
+#include <QVariant>
+#include <QList>
+#include <mysql.h>
+
+namespace Util {
+    /**
+     * Unbuffered cursor on a QMYSQL connection.
+     *
+     * The QMYSQL driver always reads the whole result set in memory (mysql_store_result) before
+     * the first row is available. The cursor uses the native handle of the connection with
+     * mysql_use_result so the rows are read from the network one by one, the first rows are
+     * available as soon as the server sends them.
+     *
+     * While a result set is being read, no other query can be executed on the connection.
+     */
+    class MySQLCursor
+    {
+    public:
+        MySQLCursor(QSqlDatabase database);
+        virtual ~MySQLCursor();
+
+        bool exec(QString query);
+        bool nextResult();
+        bool hasMoreResults() const;
+        bool isSelect() const;
+        QSqlRecord record() const;
+        int columnCount() const;
+
+        bool next();
+        bool isNull(int column) const;
+        QVariant value(int column) const;
+        const char *rawValue(int column) const;
+        QString literal(int column) const;
+        int valueLength(int column) const;
+        qint64 rowLength() const;
+
+        qint64 numRowsAffected() const;
+        quint64 connectionId() const;
+        QString lastError() const;
+        void freeResult();
+
+        static QVariant decodeValue(QVariant::Type type, const char *data, int length);
+        static MYSQL *nativeHandle(QSqlDatabase database);
+
+    private:
+        MYSQL *mysql;
+        MYSQL_RES *result;
+        MYSQL_ROW row;
+        unsigned long *lengths;
+        QSqlRecord header;
+        QList<QVariant::Type> types;
+        QList<bool> numeric;
+        QString error;
+
+        void readHeader();
+    };
+}
+
+#endif // MYSQLCURSOR_H
@@ -15,6 +15,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 #include "MySQLDump.h"
+#include "ConnectionPool.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -99,8 +100,9 @@ namespace Util {
      */
     void MySQLDump::dump()
     {
-        QSqlDatabase database = DataBase::createFromConfig(this->configuration);
-        if (!database.open()) {
+        PooledConnection connection(this->configuration);
+        QSqlDatabase database = connection.database();
+        if (!database.isOpen()) {
             qDebug() << database.lastError().text();
             emit dumpFinished(true);
             return ;
@@ -149,8 +151,6 @@ namespace Util {
             qDebug() << "Unable to open the file: "+this->filename;
         }
 
-        database.close();
-
         emit dumpFinished(this->stop);
     }
 
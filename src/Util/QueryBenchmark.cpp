@@ -0,0 +1,407 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "QueryBenchmark.h"
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include "SqlFingerprint.h"
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QRegExp>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+// Workers of a benchmark, the connections above the size of the pool are closed at the end
+#define MAX_CONCURRENCY 64
+
+namespace Util {
+
+    /**
+     * Thread of a worker, the worker has its own connection
+     */
+    class BenchmarkThread : public QThread
+    {
+    public:
+        BenchmarkThread(QueryBenchmark *benchmark) : benchmark(benchmark) {}
+
+    protected:
+        void run()
+        {
+            this->benchmark->runWorker();
+        }
+
+    private:
+        QueryBenchmark *benchmark;
+    };
+
+    QueryBenchmark::QueryBenchmark(ConnectionConfiguration conf, QString query):
+        configuration(conf),
+        query(query)
+    {
+        this->concurrency = 1;
+        this->iterations = 100;
+        this->durationSec = 0;
+        this->warmupIterations = 0;
+        this->stop = false;
+        this->started = 0;
+
+        this->status.warmup = false;
+        this->status.executions = 0;
+        this->status.warmupExecutions = 0;
+        this->status.errors = 0;
+        this->status.elapsedMsec = 0;
+    }
+
+    /**
+     * @brief QueryBenchmark::setConcurrency
+     * @param workers the number of statements executed at the same time
+     */
+    void QueryBenchmark::setConcurrency(int workers)
+    {
+        this->concurrency = qBound(1, workers, MAX_CONCURRENCY);
+    }
+
+    /**
+     * @brief QueryBenchmark::setIterations
+     * @param iterations the number of measured executions, for all the workers
+     */
+    void QueryBenchmark::setIterations(qint64 iterations)
+    {
+        this->iterations = qMax(Q_INT64_C(1), iterations);
+        this->durationSec = 0;
+    }
+
+    /**
+     * @brief QueryBenchmark::setDuration
+     * @param seconds the duration of the measured phase, instead of a number of executions
+     */
+    void QueryBenchmark::setDuration(int seconds)
+    {
+        this->durationSec = qMax(1, seconds);
+        this->iterations = 0;
+    }
+
+    /**
+     * @brief QueryBenchmark::setWarmup
+     * @param iterations the number of executions before the measures
+     */
+    void QueryBenchmark::setWarmup(qint64 iterations)
+    {
+        this->warmupIterations = qMax(Q_INT64_C(0), iterations);
+    }
+
+    /**
+     * Reads the values of the :name parameters of the statement, each execution takes the next line
+     * @brief QueryBenchmark::setParameters
+     * @param csvFilename a CSV file, its first line has the names of the parameters
+     * @param error receives the error if the file can not be used
+     */
+    bool QueryBenchmark::setParameters(QString csvFilename, QString *error)
+    {
+        QList<QStringList> rows = readCsv(csvFilename, error);
+        if (rows.size() < 2) {
+            if (error->isEmpty()) {
+                *error = tr("The CSV file needs a header with the names of the parameters and at least one line of values");
+            }
+            return false;
+        }
+
+        this->parameterNames.clear();
+        foreach (QString name, rows.takeFirst()) {
+            this->parameterNames << name.trimmed();
+        }
+        this->parameterValues = rows;
+
+        return true;
+    }
+
+    /**
+     * Starts the workers and waits for them
+     * @brief QueryBenchmark::execute
+     */
+    void QueryBenchmark::execute()
+    {
+        this->statusMutex.lock();
+        this->started = 0;
+        this->status.warmup = this->warmupIterations > 0;
+        this->timer.invalidate();
+        if (!this->status.warmup) {
+            this->timer.start();
+        }
+        this->statusMutex.unlock();
+
+        QList<BenchmarkThread *> workers;
+        for (int i = 0; i < this->concurrency; i++) {
+            BenchmarkThread *worker = new BenchmarkThread(this);
+            worker->start();
+            workers << worker;
+        }
+
+        foreach (BenchmarkThread *worker, workers) {
+            worker->wait();
+            delete worker;
+        }
+
+        this->statusMutex.lock();
+        this->status.elapsedMsec = this->timer.isValid() ? this->timer.elapsed() : 0;
+        this->timer.invalidate();
+        this->statusMutex.unlock();
+
+        emit executionFinished(this->stop);
+    }
+
+    /**
+     * Executes the statement on a connection of the pool until the end of the benchmark,
+     * called in the thread of each worker
+     * @brief QueryBenchmark::runWorker
+     */
+    void QueryBenchmark::runWorker()
+    {
+        // The session variables set by the statement are reset when the connection goes back to the pool
+        PooledConnection connection(this->configuration, true);
+        QSqlDatabase database = connection.database();
+        if (!database.isOpen()) {
+            qDebug() << "QueryBenchmark::runWorker - " + database.lastError().text();
+            QMutexLocker locker(&this->statusMutex);
+            this->status.lastError = database.lastError().text();
+            this->status.errors++;
+            return;
+        }
+
+        // The parameters are written as strings of the sql_mode of the session
+        bool noBackslashEscapes = false;
+        if (!this->parameterValues.isEmpty()) {
+            QSqlQuery sqlModeQuery(database);
+            if (sqlModeQuery.exec("SELECT @@SESSION.sql_mode") && sqlModeQuery.next()) {
+                noBackslashEscapes = sqlModeQuery.value(0).toString().split(',').contains("NO_BACKSLASH_ESCAPES");
+            }
+        }
+
+        bool warmup;
+        qint64 number;
+        QElapsedTimer executionTimer;
+        while (this->nextExecution(warmup, number)) {
+            QString statement = this->statementFor(number, noBackslashEscapes);
+            QString error;
+
+            executionTimer.start();
+            bool success = this->executeStatement(database, statement, error);
+            qint64 usec = executionTimer.nsecsElapsed() / 1000;
+
+            QMutexLocker locker(&this->statusMutex);
+            if (!success) {
+                this->status.errors++;
+                this->status.lastError = error;
+            } else if (warmup) {
+                this->status.warmupExecutions++;
+            } else {
+                this->status.executions++;
+                this->status.histogram.record(usec);
+            }
+        }
+    }
+
+    /**
+     * Gives the next execution to a worker
+     * @param warmup receives true if the execution is not measured
+     * @param number receives the number of the execution, from 0
+     * @return false at the end of the benchmark
+     */
+    bool QueryBenchmark::nextExecution(bool &warmup, qint64 &number)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        if (this->stop) {
+            return false;
+        }
+
+        number = this->started;
+        warmup = number < this->warmupIterations;
+
+        if (!warmup && this->iterations > 0 && number >= this->warmupIterations + this->iterations) {
+            return false;
+        } else if (!warmup && this->durationSec > 0 && this->timer.isValid() && this->timer.elapsed() >= this->durationSec * 1000) {
+            return false;
+        }
+
+        // The measured phase starts with its first execution
+        if (!warmup && !this->timer.isValid()) {
+            this->timer.start();
+            this->status.warmup = false;
+        }
+
+        this->started++;
+        return true;
+    }
+
+    /**
+     * The :name parameters are replaced in the code only, not in the strings, the quoted
+     * identifiers and the comments
+     * @param noBackslashEscapes true if the session has the NO_BACKSLASH_ESCAPES sql_mode
+     * @return the statement with the values of the line of the CSV file used by the execution
+     */
+    QString QueryBenchmark::statementFor(qint64 number, bool noBackslashEscapes)
+    {
+        if (this->parameterValues.isEmpty()) {
+            return this->query;
+        }
+
+        QStringList values = this->parameterValues.at(number % this->parameterValues.size());
+        QRegExp parameterRegExp("^:([A-Za-z_][A-Za-z0-9_]*)");
+        QString statement;
+        int size = this->query.size();
+        int i = 0;
+
+        while (i < size) {
+            int end = SqlFingerprint::commentEnd(this->query, i);
+            if (end == -1) {
+                end = SqlFingerprint::quotedEnd(this->query, i);
+            }
+
+            if (end != -1) {
+                statement += this->query.mid(i, end - i);
+                i = end;
+            } else if (this->query.at(i) == ':' && parameterRegExp.indexIn(this->query, i, QRegExp::CaretAtOffset) == i) {
+                int column = this->parameterNames.indexOf(parameterRegExp.cap(1));
+                statement += column == -1 ? parameterRegExp.cap(0) : quote(values.value(column), noBackslashEscapes);
+                i += parameterRegExp.matchedLength();
+            } else {
+                statement += this->query.at(i);
+                i++;
+            }
+        }
+
+        return statement;
+    }
+
+    /**
+     * Executes the statement and reads all its rows, as the client of the application would
+     * @return false on error
+     */
+    bool QueryBenchmark::executeStatement(QSqlDatabase database, QString statement, QString &error)
+    {
+        MySQLCursor cursor(database);
+        if (!cursor.exec(statement)) {
+            error = cursor.lastError();
+            return false;
+        }
+
+        do {
+            while (cursor.next()) {
+            }
+        } while (cursor.lastError().isEmpty() && cursor.nextResult());
+
+        error = cursor.lastError();
+
+        return error.isEmpty();
+    }
+
+    /**
+     * The numbers are used as they are, the other values as strings
+     * @param noBackslashEscapes true if the backslash is not an escape character in the session
+     */
+    QString QueryBenchmark::quote(QString value, bool noBackslashEscapes)
+    {
+        if (QRegExp("-?[0-9]+(\\.[0-9]+)?").exactMatch(value.trimmed())) {
+            return value.trimmed();
+        } else if (value.trimmed().compare("NULL", Qt::CaseInsensitive) == 0) {
+            return "NULL";
+        }
+
+        if (!noBackslashEscapes) {
+            value.replace("\\", "\\\\");
+        }
+
+        return "'" + value.replace("'", "''") + "'";
+    }
+
+    /**
+     * Reads a CSV file separated by commas, the values can be quoted with "
+     * @brief QueryBenchmark::readCsv
+     * @return the lines of the file
+     */
+    QList<QStringList> QueryBenchmark::readCsv(QString filename, QString *error)
+    {
+        QList<QStringList> rows;
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            *error = file.errorString();
+            return rows;
+        }
+
+        QTextStream stream(&file);
+        stream.setCodec("UTF-8");
+        QString content = stream.readAll();
+
+        QStringList row;
+        QString value;
+        bool quoted = false;
+        for (int i = 0; i < content.size(); i++) {
+            QChar c = content.at(i);
+            if (quoted) {
+                if (c == '"' && i + 1 < content.size() && content.at(i + 1) == '"') {
+                    value += c;
+                    i++;
+                } else if (c == '"') {
+                    quoted = false;
+                } else {
+                    value += c;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                row << value;
+                value.clear();
+            } else if (c == '\n') {
+                row << value;
+                value.clear();
+                if (row.size() > 1 || !row.first().isEmpty()) {
+                    rows << row;
+                }
+                row.clear();
+            } else {
+                value += c;
+            }
+        }
+
+        if (!value.isEmpty() || !row.isEmpty()) {
+            rows << (row << value);
+        }
+
+        return rows;
+    }
+
+    BenchmarkStatus QueryBenchmark::getStatus()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        if (this->timer.isValid()) {
+            this->status.elapsedMsec = this->timer.elapsed();
+        }
+
+        return this->status;
+    }
+
+    /**
+     * Stops after the current executions
+     * @brief QueryBenchmark::stopRequired
+     */
+    void QueryBenchmark::stopRequired()
+    {
+        this->stop = true;
+    }
+}
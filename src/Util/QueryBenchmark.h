@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef QUERYBENCHMARK_H
+#define QUERYBENCHMARK_H
+
+#include "DataBase.h"
+#include "LatencyHistogram.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QStringList>
+#include <QElapsedTimer>
+
+struct BenchmarkStatus {
+    bool warmup;
+    qint64 executions; // measured executions, without the warmup
+    qint64 warmupExecutions;
+    qint64 errors;
+    qint64 elapsedMsec; // of the measured phase
+    QString lastError;
+    Util::LatencyHistogram histogram;
+};
+
+namespace Util {
+    /**
+     * Executes a statement many times on several connections of the pool to measure its
+     * latency under load.
+     *
+     * Each worker has its own connection and thread. The first executions (warmup) fill the
+     * caches and are not measured, then the latencies, with the rows read, are counted in an
+     * HDR histogram. The statement can have :name parameters, replaced by the values of the
+     * next line of a CSV file whose header gives the names.
+     */
+    class QueryBenchmark : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        QueryBenchmark(ConnectionConfiguration conf, QString query);
+        void setConcurrency(int workers);
+        void setIterations(qint64 iterations);
+        void setDuration(int seconds);
+        void setWarmup(qint64 iterations);
+        bool setParameters(QString csvFilename, QString *error);
+
+        BenchmarkStatus getStatus();
+        void stopRequired();
+        void runWorker();
+
+        static QList<QStringList> readCsv(QString filename, QString *error);
+
+    public slots:
+        void execute();
+
+    signals:
+        void executionFinished(bool stopped);
+
+    private:
+        ConnectionConfiguration configuration;
+        QString query;
+        int concurrency;
+        qint64 iterations; // 0 when the benchmark is limited by its duration
+        int durationSec;
+        qint64 warmupIterations;
+        QStringList parameterNames;
+        QList<QStringList> parameterValues;
+        volatile bool stop;
+
+        QMutex statusMutex;
+        BenchmarkStatus status;
+        qint64 started; // executions given to the workers
+        QElapsedTimer timer;
+
+        bool nextExecution(bool &warmup, qint64 &number);
+        QString statementFor(qint64 number, bool noBackslashEscapes);
+        bool executeStatement(QSqlDatabase database, QString statement, QString &error);
+        static QString quote(QString value, bool noBackslashEscapes);
+    };
+}
+
+#endif // QUERYBENCHMARK_H
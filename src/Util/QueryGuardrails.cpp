@@ -0,0 +1,159 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "QueryGuardrails.h"
+#include "SqlSplitter.h"
+#include <QRegExp>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QDebug>
+
+namespace Util {
+
+    /**
+     * @brief Guardrails::fromSession
+     * @param session the configuration of a session, the limits are not set in the old sessions
+     */
+    QueryGuardrails Guardrails::fromSession(QJsonObject session)
+    {
+        QueryGuardrails guardrails;
+        guardrails.maxExecutionSec = session.value("maxExecutionTime").toInt(0);
+        guardrails.confirmRows = qint64(session.value("confirmRowEstimate").toDouble(0));
+        guardrails.rowCap = qint64(session.value("rowCap").toDouble(0));
+
+        return guardrails;
+    }
+
+    void Guardrails::writeSession(QueryGuardrails guardrails, QJsonObject &session)
+    {
+        session.insert("maxExecutionTime", guardrails.maxExecutionSec);
+        session.insert("confirmRowEstimate", double(guardrails.confirmRows));
+        session.insert("rowCap", double(guardrails.rowCap));
+    }
+
+    /**
+     * Adds the MAX_EXECUTION_TIME hint to the SELECT statements of a script, the other
+     * statements and the statements which already have the hint are not modified
+     * @brief Guardrails::withMaxExecutionTime
+     * @param msec the limit, the query is returned as it is if it is 0
+     */
+    QString Guardrails::withMaxExecutionTime(QString query, int msec)
+    {
+        if (msec <= 0) {
+            return query;
+        }
+
+        QString result;
+        int from = 0;
+        QRegExp selectRegExp("^SELECT\\b", Qt::CaseInsensitive);
+
+        foreach (QString statement, SqlSplitter::split(query)) {
+            int start = query.indexOf(statement, from);
+            if (start == -1) {
+                break;
+            }
+
+            result += query.mid(from, start - from);
+            from = start + statement.size();
+
+            int select = skipComments(statement, 0);
+            if (selectRegExp.indexIn(statement.mid(select)) == -1 || statement.contains("MAX_EXECUTION_TIME", Qt::CaseInsensitive)) {
+                result += statement;
+                continue;
+            }
+
+            // Only the first hint comment of a query block is read by the server
+            int keywordEnd = select + 6;
+            int hint = keywordEnd;
+            while (hint < statement.size() && statement.at(hint).isSpace()) {
+                hint++;
+            }
+
+            if (statement.mid(hint, 3) == "/*+") {
+                result += statement.left(hint + 3) + QString(" MAX_EXECUTION_TIME(%1)").arg(msec) + statement.mid(hint + 3);
+            } else {
+                result += statement.left(keywordEnd) + QString(" /*+ MAX_EXECUTION_TIME(%1) */").arg(msec) + statement.mid(keywordEnd);
+            }
+        }
+
+        return result + query.mid(from);
+    }
+
+    /**
+     * Estimates the rows examined by a statement from its plan: the rows of each table of a
+     * join are read for each row kept from the previous tables
+     * @brief Guardrails::estimateRows
+     * @return the estimated rows, -1 if the statement cannot be explained
+     */
+    double Guardrails::estimateRows(QSqlDatabase database, QString statement, QString *error)
+    {
+        QSqlQuery query(database);
+        if (!query.exec("EXPLAIN " + statement)) {
+            qDebug() << "Guardrails::estimateRows - " + query.lastError().text();
+            if (error != nullptr) {
+                *error = query.lastError().text();
+            }
+            return -1;
+        }
+
+        int idColumn = query.record().indexOf("id");
+        int rowsColumn = query.record().indexOf("rows");
+        int filteredColumn = query.record().indexOf("filtered");
+
+        double total = 0;
+        double prefix = 1;
+        QVariant currentId;
+        while (query.next()) {
+            // A new SELECT of the statement, its tables are not joined with the previous ones
+            if (query.value(idColumn) != currentId) {
+                currentId = query.value(idColumn);
+                prefix = 1;
+            }
+
+            double rows = query.value(rowsColumn).toDouble();
+            double filtered = filteredColumn == -1 || query.value(filteredColumn).isNull() ? 100 : query.value(filteredColumn).toDouble();
+
+            total += prefix * rows;
+            prefix *= rows * filtered / 100.0;
+        }
+
+        return total;
+    }
+
+    /**
+     * @return the position of the first character which is not a space or in a comment
+     */
+    int Guardrails::skipComments(const QString &query, int position)
+    {
+        while (position < query.size()) {
+            if (query.at(position).isSpace()) {
+                position++;
+            } else if (query.at(position) == '#' || query.mid(position, 3) == "-- ") {
+                int end = query.indexOf('\n', position);
+                position = end == -1 ? query.size() : end + 1;
+            } else if (query.mid(position, 2) == "/*" && query.mid(position, 3) != "/*+") {
+                int end = query.indexOf("*/", position + 2);
+                position = end == -1 ? query.size() : end + 2;
+            } else {
+                break;
+            }
+        }
+
+        return position;
+    }
+}
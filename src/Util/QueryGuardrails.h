@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QUERYGUARDRAILS_H
+#define QUERYGUARDRAILS_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QSqlDatabase>
+
+struct QueryGuardrails {
+    int maxExecutionSec; // MAX_EXECUTION_TIME of the SELECT statements, 0 for no limit
+    qint64 confirmRows; // estimated rows examined above which the execution is confirmed, 0 to never ask
+    qint64 rowCap; // sql_select_limit, 0 for no limit
+};
+
+namespace Util {
+    /**
+     * Limits of the statements executed in the query tabs, saved with each session.
+     *
+     * The SELECT statements get a MAX_EXECUTION_TIME optimizer hint (MySQL 5.7.8, the other
+     * servers ignore it as a comment) and the rows they return are capped by sql_select_limit.
+     * Before the execution, the rows examined by the statements are estimated from their
+     * plan, so the user can confirm a statement which would read too much.
+     *
+     * The server counts the time of a statement until its last row is sent: a large result read
+     * while the view is scrolled is also stopped after MAX_EXECUTION_TIME, with the error 3024
+     * (ER_QUERY_TIMEOUT). The rows read before are kept and the result tab shows the error.
+     */
+    class Guardrails
+    {
+    public:
+        static QueryGuardrails fromSession(QJsonObject session);
+        static void writeSession(QueryGuardrails guardrails, QJsonObject &session);
+        static QString withMaxExecutionTime(QString query, int msec);
+        static double estimateRows(QSqlDatabase database, QString statement, QString *error = nullptr);
+
+    private:
+        static int skipComments(const QString &query, int position);
+    };
+}
+
+#endif // QUERYGUARDRAILS_H
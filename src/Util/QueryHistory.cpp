@@ -0,0 +1,549 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "QueryHistory.h"
+#include "SqlFingerprint.h"
+#include "ExplainPlan.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QDir>
+#include <QMap>
+#include <QRegExp>
+#include <QVariant>
+#include <QtMath>
+#include <algorithm>
+#include <QDebug>
+
+// Delay before the recorded statements are written
+#define FLUSH_DELAY 1000
+// Executions of a fingerprint needed to detect a latency jump
+#define LATENCY_MIN_EXECUTIONS 5
+// A latency jump is slower than the median by this factor, and by this time
+#define LATENCY_JUMP_FACTOR 3
+#define LATENCY_JUMP_MSEC 100
+
+namespace Util {
+
+    QueryHistory::QueryHistory()
+    {
+        this->opened = false;
+        this->fullText = false;
+
+        this->flushTimer.setSingleShot(true);
+        connect(&this->flushTimer, SIGNAL(timeout()), SLOT(handleFlushTimer()));
+    }
+
+    QueryHistory *QueryHistory::instance()
+    {
+        static QueryHistory history;
+        return &history;
+    }
+
+    /**
+     * Adds an executed statement, it is written with the next batch
+     * @brief QueryHistory::record
+     */
+    void QueryHistory::record(HistoryEntry entry)
+    {
+        if (entry.fingerprint.isEmpty()) {
+            entry.fingerprint = SqlFingerprint::normalize(entry.query);
+        }
+
+        this->pending << entry;
+        if (!this->flushTimer.isActive()) {
+            this->flushTimer.start(FLUSH_DELAY);
+        }
+    }
+
+    void QueryHistory::handleFlushTimer()
+    {
+        this->flush();
+    }
+
+    /**
+     * Writes the recorded statements in one transaction
+     * @brief QueryHistory::flush
+     */
+    void QueryHistory::flush()
+    {
+        this->flushTimer.stop();
+        if (this->pending.isEmpty()) {
+            return;
+        }
+
+        if (!this->open()) {
+            this->pending.clear();
+            return;
+        }
+
+        this->database.transaction();
+
+        QSqlQuery insert(this->database);
+        insert.prepare("INSERT INTO history (executed_at, session, database_name, query, fingerprint_id, total_msec, "
+                       "first_row_msec, fetch_msec, server_msec, rows, error) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+        QSqlQuery index(this->database);
+        index.prepare("INSERT INTO history_fts (docid, query) VALUES (?, ?)");
+
+        foreach (HistoryEntry entry, this->pending) {
+            // The failed statements have no latency
+            bool failed = !entry.error.isEmpty();
+
+            qint64 id = this->fingerprintId(entry.fingerprint, entry.executedAt);
+            if (!entry.plan.isEmpty()) {
+                this->storePlan(id, entry.plan, entry.executedAt);
+            }
+
+            insert.addBindValue(entry.executedAt.toMSecsSinceEpoch());
+            insert.addBindValue(entry.session);
+            insert.addBindValue(entry.databaseName);
+            insert.addBindValue(entry.query);
+            insert.addBindValue(id);
+            insert.addBindValue(failed ? QVariant(QVariant::Double) : QVariant(entry.totalMsec));
+            insert.addBindValue(failed ? QVariant(QVariant::Double) : QVariant(entry.firstRowMsec));
+            insert.addBindValue(failed ? QVariant(QVariant::Double) : QVariant(entry.fetchMsec));
+            insert.addBindValue(entry.serverMsec < 0 ? QVariant(QVariant::Double) : QVariant(entry.serverMsec));
+            insert.addBindValue(entry.rows);
+            insert.addBindValue(failed ? QVariant(entry.error) : QVariant(QVariant::String));
+
+            if (!insert.exec()) {
+                qDebug() << "QueryHistory::flush - " + insert.lastError().text();
+                continue;
+            }
+
+            if (this->fullText) {
+                index.addBindValue(insert.lastInsertId());
+                index.addBindValue(entry.query);
+                if (!index.exec()) {
+                    qDebug() << "QueryHistory::flush - " + index.lastError().text();
+                }
+            }
+        }
+
+        this->database.commit();
+        this->pending.clear();
+    }
+
+    /**
+     * Writes the last statements, called when the application quits
+     * @brief QueryHistory::close
+     */
+    void QueryHistory::close()
+    {
+        this->flush();
+        if (this->database.isOpen()) {
+            this->database.close();
+        }
+    }
+
+    /**
+     * @brief QueryHistory::search
+     * @param text the words to look for in the statements, empty for the last statements
+     * @param limit the maximum number of statements
+     * @return the statements, the most recent first
+     */
+    QList<HistoryEntry> QueryHistory::search(QString text, int limit)
+    {
+        QList<HistoryEntry> entries;
+        this->flush();
+        if (!this->open()) {
+            return entries;
+        }
+
+        QString columns = "SELECT h.executed_at, h.session, h.database_name, h.query, f.text, h.total_msec, h.first_row_msec, "
+                          "h.fetch_msec, h.server_msec, h.rows, h.error FROM history h LEFT JOIN fingerprint f ON f.id = h.fingerprint_id ";
+
+        QSqlQuery query(this->database);
+        QStringList words = text.split(QRegExp("[\\W_]+"), QString::SkipEmptyParts);
+        if (words.isEmpty()) {
+            query.prepare(columns + "ORDER BY h.id DESC LIMIT ?");
+        } else if (this->fullText) {
+            // Each word is a prefix: "sel user" finds SELECT * FROM users
+            query.prepare(columns + "WHERE h.id IN (SELECT docid FROM history_fts WHERE history_fts MATCH ? ORDER BY docid DESC LIMIT ?) "
+                                    "ORDER BY h.id DESC");
+            query.addBindValue(words.join("* ") + "*");
+        } else {
+            query.prepare(columns + "WHERE h.query LIKE ? ESCAPE '\\' ORDER BY h.id DESC LIMIT ?");
+            QString pattern = text.trimmed().replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+            query.addBindValue("%" + pattern + "%");
+        }
+        query.addBindValue(limit);
+
+        if (!query.exec()) {
+            qDebug() << "QueryHistory::search - " + query.lastError().text();
+            return entries;
+        }
+
+        while (query.next()) {
+            HistoryEntry entry;
+            entry.executedAt = QDateTime::fromMSecsSinceEpoch(query.value(0).toLongLong());
+            entry.session = query.value(1).toString();
+            entry.databaseName = query.value(2).toString();
+            entry.query = query.value(3).toString();
+            entry.fingerprint = query.value(4).toString();
+            entry.totalMsec = query.value(5).isNull() ? -1 : query.value(5).toDouble();
+            entry.firstRowMsec = query.value(6).isNull() ? -1 : query.value(6).toDouble();
+            entry.fetchMsec = query.value(7).isNull() ? -1 : query.value(7).toDouble();
+            entry.serverMsec = query.value(8).isNull() ? -1 : query.value(8).toDouble();
+            entry.rows = query.value(9).toLongLong();
+            entry.error = query.value(10).toString();
+            entries << entry;
+        }
+
+        return entries;
+    }
+
+    /**
+     * @brief QueryHistory::statistics
+     * @param limit the number of fingerprints
+     * @return the latencies of the most executed fingerprints
+     */
+    QList<FingerprintStatistics> QueryHistory::statistics(int limit)
+    {
+        QList<FingerprintStatistics> result;
+        this->flush();
+        if (!this->open()) {
+            return result;
+        }
+
+        QSqlQuery query(this->database);
+        query.prepare("SELECT f.id, f.text, f.count, f.last_seen, (SELECT COUNT(*) FROM plan p WHERE p.fingerprint_id = f.id) "
+                      "FROM fingerprint f ORDER BY f.count DESC LIMIT ?");
+        query.addBindValue(limit);
+        if (!query.exec()) {
+            qDebug() << "QueryHistory::statistics - " + query.lastError().text();
+            return result;
+        }
+
+        // The latencies are read with the index on (fingerprint_id, total_msec)
+        QSqlQuery latencies(this->database);
+        latencies.prepare("SELECT COUNT(total_msec), MAX(total_msec) FROM history WHERE fingerprint_id = ?");
+
+        while (query.next()) {
+            FingerprintStatistics statistics;
+            statistics.id = query.value(0).toLongLong();
+            statistics.fingerprint = query.value(1).toString();
+            statistics.count = query.value(2).toLongLong();
+            statistics.lastSeen = QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong());
+            statistics.planCount = query.value(4).toInt();
+            statistics.max = -1;
+            statistics.p50 = -1;
+            statistics.p95 = -1;
+
+            latencies.addBindValue(statistics.id);
+            if (latencies.exec() && latencies.next() && latencies.value(0).toLongLong() > 0) {
+                qint64 count = latencies.value(0).toLongLong();
+                statistics.max = latencies.value(1).toDouble();
+                statistics.p50 = this->percentile(statistics.id, count, 0.5);
+                statistics.p95 = this->percentile(statistics.id, count, 0.95);
+            }
+
+            result << statistics;
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief QueryHistory::trend
+     * @param fingerprintId the fingerprint
+     * @param days the number of days before today
+     * @return the latencies of the fingerprint for each day
+     */
+    QList<FingerprintTrend> QueryHistory::trend(qint64 fingerprintId, int days)
+    {
+        QList<FingerprintTrend> result;
+        this->flush();
+        if (!this->open()) {
+            return result;
+        }
+
+        QSqlQuery query(this->database);
+        query.prepare("SELECT executed_at, total_msec FROM history WHERE fingerprint_id = ? AND executed_at >= ? "
+                      "AND total_msec IS NOT NULL ORDER BY executed_at");
+        query.addBindValue(fingerprintId);
+        query.addBindValue(QDateTime(QDate::currentDate().addDays(-days)).toMSecsSinceEpoch());
+        if (!query.exec()) {
+            qDebug() << "QueryHistory::trend - " + query.lastError().text();
+            return result;
+        }
+
+        QMap<QDate, QList<double> > values;
+        while (query.next()) {
+            values[QDateTime::fromMSecsSinceEpoch(query.value(0).toLongLong()).date()] << query.value(1).toDouble();
+        }
+
+        foreach (QDate day, values.keys()) {
+            QList<double> latencies = values.value(day);
+            std::sort(latencies.begin(), latencies.end());
+
+            FingerprintTrend point;
+            point.day = day;
+            point.count = latencies.size();
+            point.p50 = percentile(latencies, 0.5);
+            point.p95 = percentile(latencies, 0.95);
+            point.max = latencies.last();
+            result << point;
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief QueryHistory::plans
+     * @param fingerprintId the fingerprint
+     * @param limit the number of versions
+     * @return the last versions of the plan of the fingerprint, the most recent first
+     */
+    QList<PlanVersion> QueryHistory::plans(qint64 fingerprintId, int limit)
+    {
+        QList<PlanVersion> result;
+        this->flush();
+        if (!this->open()) {
+            return result;
+        }
+
+        QSqlQuery query(this->database);
+        query.prepare("SELECT signature, plan, first_seen, last_seen FROM plan WHERE fingerprint_id = ? ORDER BY id DESC LIMIT ?");
+        query.addBindValue(fingerprintId);
+        query.addBindValue(limit);
+        if (!query.exec()) {
+            qDebug() << "QueryHistory::plans - " + query.lastError().text();
+            return result;
+        }
+
+        while (query.next()) {
+            PlanVersion version;
+            version.signature = query.value(0).toString();
+            version.plan = query.value(1).toString();
+            version.firstSeen = QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong());
+            version.lastSeen = QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong());
+            result << version;
+        }
+
+        return result;
+    }
+
+    /**
+     * Compares an execution with the previous ones of its fingerprint, called before the execution is recorded
+     * @brief QueryHistory::checkRegression
+     * @param entry the execution
+     * @param regression receives the changes
+     * @return true if the plan has changed or if the statement is much slower than usual
+     */
+    bool QueryHistory::checkRegression(HistoryEntry entry, PlanRegression *regression)
+    {
+        this->flush();
+        if (!this->open() || !entry.error.isEmpty()) {
+            return false;
+        }
+
+        QString fingerprint = entry.fingerprint.isEmpty() ? SqlFingerprint::normalize(entry.query) : entry.fingerprint;
+        QSqlQuery query(this->database);
+        query.prepare("SELECT id FROM fingerprint WHERE hash = ?");
+        query.addBindValue(SqlFingerprint::hash(fingerprint));
+        if (!query.exec() || !query.next()) {
+            // First execution
+            return false;
+        }
+        qint64 id = query.value(0).toLongLong();
+
+        regression->fingerprint = fingerprint;
+        regression->totalMsec = entry.totalMsec;
+        regression->p50 = -1;
+        regression->latencyJump = false;
+        regression->planChanged = false;
+        regression->previousPlan = PlanVersion();
+        regression->plan = entry.plan;
+        regression->signature = entry.plan.isEmpty() ? "" : ExplainPlan::signature(ExplainPlan::fromJson(entry.plan));
+
+        query.prepare("SELECT COUNT(total_msec) FROM history WHERE fingerprint_id = ?");
+        query.addBindValue(id);
+        if (query.exec() && query.next() && query.value(0).toLongLong() >= LATENCY_MIN_EXECUTIONS) {
+            regression->p50 = this->percentile(id, query.value(0).toLongLong(), 0.5);
+            regression->latencyJump = entry.totalMsec >= regression->p50 * LATENCY_JUMP_FACTOR
+                    && entry.totalMsec - regression->p50 >= LATENCY_JUMP_MSEC;
+        }
+
+        QList<PlanVersion> versions = this->plans(id, 1);
+        if (!versions.isEmpty()) {
+            regression->previousPlan = versions.first();
+            regression->planChanged = !regression->signature.isEmpty() && regression->signature != regression->previousPlan.signature;
+        }
+
+        return regression->planChanged || regression->latencyJump;
+    }
+
+    bool QueryHistory::hasFullTextSearch()
+    {
+        return this->open() && this->fullText;
+    }
+
+    /**
+     * Opens the history file and creates the tables
+     * @return false if the history is not available
+     */
+    bool QueryHistory::open()
+    {
+        if (this->opened) {
+            return this->database.isOpen();
+        }
+        this->opened = true;
+
+        QString directory = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/smartarello";
+        QDir().mkpath(directory);
+
+        this->database = QSqlDatabase::addDatabase("QSQLITE", "query-history");
+        this->database.setDatabaseName(directory + "/mysqlclient-history.sqlite");
+        if (!this->database.open()) {
+            qDebug() << "QueryHistory::open - " + this->database.lastError().text();
+            return false;
+        }
+
+        QStringList schema;
+        schema << "PRAGMA journal_mode = WAL";
+        schema << "PRAGMA synchronous = NORMAL";
+        schema << "CREATE TABLE IF NOT EXISTS fingerprint (id INTEGER PRIMARY KEY, hash TEXT NOT NULL UNIQUE, text TEXT NOT NULL, "
+                  "count INTEGER NOT NULL DEFAULT 0, last_seen INTEGER)";
+        schema << "CREATE INDEX IF NOT EXISTS fingerprint_count ON fingerprint (count)";
+        schema << "CREATE TABLE IF NOT EXISTS history (id INTEGER PRIMARY KEY, executed_at INTEGER NOT NULL, session TEXT, "
+                  "database_name TEXT, query TEXT NOT NULL, fingerprint_id INTEGER NOT NULL, total_msec REAL, first_row_msec REAL, "
+                  "fetch_msec REAL, server_msec REAL, rows INTEGER, error TEXT)";
+        schema << "CREATE INDEX IF NOT EXISTS history_latency ON history (fingerprint_id, total_msec)";
+        schema << "CREATE INDEX IF NOT EXISTS history_time ON history (fingerprint_id, executed_at)";
+        schema << "CREATE TABLE IF NOT EXISTS plan (id INTEGER PRIMARY KEY, fingerprint_id INTEGER NOT NULL, signature TEXT NOT NULL, "
+                  "plan TEXT NOT NULL, first_seen INTEGER, last_seen INTEGER)";
+        schema << "CREATE INDEX IF NOT EXISTS plan_fingerprint ON plan (fingerprint_id, id)";
+
+        QSqlQuery query(this->database);
+        foreach (QString statement, schema) {
+            if (!query.exec(statement)) {
+                qDebug() << "QueryHistory::open - " + query.lastError().text();
+            }
+        }
+
+        // The index only keeps the words, the text is read from the history table
+        this->fullText = query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS history_fts USING fts4(content=\"history\", query, order=DESC)");
+        if (!this->fullText) {
+            qDebug() << "QueryHistory::open - no full-text search: " + query.lastError().text();
+        }
+
+        return true;
+    }
+
+    /**
+     * @return the id of the fingerprint, which is created if needed, its counter is incremented
+     */
+    qint64 QueryHistory::fingerprintId(QString fingerprint, QDateTime executedAt)
+    {
+        QString hash = SqlFingerprint::hash(fingerprint);
+        qint64 id = this->fingerprintIds.value(hash, 0);
+
+        QSqlQuery query(this->database);
+        if (id == 0) {
+            query.prepare("SELECT id FROM fingerprint WHERE hash = ?");
+            query.addBindValue(hash);
+            if (query.exec() && query.next()) {
+                id = query.value(0).toLongLong();
+            } else {
+                query.prepare("INSERT INTO fingerprint (hash, text) VALUES (?, ?)");
+                query.addBindValue(hash);
+                query.addBindValue(fingerprint);
+                query.exec();
+                id = query.lastInsertId().toLongLong();
+            }
+
+            this->fingerprintIds.insert(hash, id);
+        }
+
+        query.prepare("UPDATE fingerprint SET count = count + 1, last_seen = ? WHERE id = ?");
+        query.addBindValue(executedAt.toMSecsSinceEpoch());
+        query.addBindValue(id);
+        query.exec();
+
+        return id;
+    }
+
+    /**
+     * Keeps the plan of an execution if its signature is not the one of the last plan of the fingerprint
+     */
+    void QueryHistory::storePlan(qint64 fingerprintId, QString plan, QDateTime executedAt)
+    {
+        QString signature = ExplainPlan::signature(ExplainPlan::fromJson(plan));
+        if (signature.isEmpty()) {
+            // No table, e.g. SELECT NOW()
+            return;
+        }
+
+        QSqlQuery query(this->database);
+        query.prepare("SELECT id, signature FROM plan WHERE fingerprint_id = ? ORDER BY id DESC LIMIT 1");
+        query.addBindValue(fingerprintId);
+
+        if (query.exec() && query.next() && query.value(1).toString() == signature) {
+            qint64 id = query.value(0).toLongLong();
+            query.prepare("UPDATE plan SET last_seen = ? WHERE id = ?");
+            query.addBindValue(executedAt.toMSecsSinceEpoch());
+            query.addBindValue(id);
+        } else {
+            query.prepare("INSERT INTO plan (fingerprint_id, signature, plan, first_seen, last_seen) VALUES (?, ?, ?, ?, ?)");
+            query.addBindValue(fingerprintId);
+            query.addBindValue(signature);
+            query.addBindValue(plan);
+            query.addBindValue(executedAt.toMSecsSinceEpoch());
+            query.addBindValue(executedAt.toMSecsSinceEpoch());
+        }
+
+        if (!query.exec()) {
+            qDebug() << "QueryHistory::storePlan - " + query.lastError().text();
+        }
+    }
+
+    /**
+     * Reads a percentile of the latencies of a fingerprint with the index, without reading them all
+     * @param count the number of latencies of the fingerprint
+     * @param rank the percentile, between 0 and 1
+     */
+    double QueryHistory::percentile(qint64 fingerprintId, qint64 count, double rank)
+    {
+        QSqlQuery query(this->database);
+        query.prepare("SELECT total_msec FROM history WHERE fingerprint_id = ? AND total_msec IS NOT NULL "
+                      "ORDER BY total_msec LIMIT 1 OFFSET ?");
+        query.addBindValue(fingerprintId);
+        query.addBindValue(qBound(Q_INT64_C(0), (qint64) qCeil(rank * count) - 1, count - 1));
+
+        if (query.exec() && query.next()) {
+            return query.value(0).toDouble();
+        }
+
+        return -1;
+    }
+
+    /**
+     * Nearest-rank percentile
+     * @param sortedValues the values in ascending order
+     * @param rank the percentile, between 0 and 1
+     */
+    double QueryHistory::percentile(QList<double> sortedValues, double rank)
+    {
+        if (sortedValues.isEmpty()) {
+            return -1;
+        }
+
+        int index = qBound(0, qCeil(rank * sortedValues.size()) - 1, sortedValues.size() - 1);
+        return sortedValues.at(index);
+    }
+}
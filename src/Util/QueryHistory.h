@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef QUERYHISTORY_H
+#define QUERYHISTORY_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QTimer>
+#include <QList>
+#include <QHash>
+
+struct HistoryEntry {
+    QDateTime executedAt;
+    QString session;
+    QString databaseName;
+    QString query;
+    QString fingerprint;
+    double totalMsec;
+    double firstRowMsec;
+    double fetchMsec;
+    double serverMsec; // -1 if unknown
+    qint64 rows;
+    QString error;
+    QString plan; // EXPLAIN FORMAT=JSON, empty if the statement is not explained
+};
+
+struct FingerprintStatistics {
+    qint64 id;
+    QString fingerprint;
+    qint64 count;
+    double p50;
+    double p95;
+    double max;
+    QDateTime lastSeen;
+    int planCount;
+};
+
+struct FingerprintTrend {
+    QDate day;
+    qint64 count;
+    double p50;
+    double p95;
+    double max;
+};
+
+struct PlanVersion {
+    QString signature;
+    QString plan;
+    QDateTime firstSeen;
+    QDateTime lastSeen;
+};
+
+struct PlanRegression {
+    QString fingerprint;
+    bool planChanged;
+    bool latencyJump;
+    double totalMsec;
+    double p50; // of the previous executions, -1 if there are not enough of them
+    PlanVersion previousPlan;
+    QString signature;
+    QString plan;
+};
+
+namespace Util {
+    /**
+     * Keeps the statements executed in the query tabs in a SQLite file of the user data directory.
+     *
+     * The statements are grouped by fingerprint (see SqlFingerprint) to give the latency
+     * percentiles of each query. The text of the statements is indexed with FTS4 when the
+     * SQLite library has it, otherwise the search uses LIKE. The entries are written by
+     * batches, a few times per second at most, from the GUI thread.
+     *
+     * The plans of the queries are kept by signature (see ExplainPlan::signature): a new
+     * version is stored when the join order or the access to a table changes.
+     */
+    class QueryHistory : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        static QueryHistory *instance();
+
+        void record(HistoryEntry entry);
+        void flush();
+        void close();
+
+        QList<HistoryEntry> search(QString text, int limit = 500);
+        QList<FingerprintStatistics> statistics(int limit = 200);
+        QList<FingerprintTrend> trend(qint64 fingerprintId, int days = 30);
+        QList<PlanVersion> plans(qint64 fingerprintId, int limit = 2);
+        bool checkRegression(HistoryEntry entry, PlanRegression *regression);
+        bool hasFullTextSearch();
+
+    private slots:
+        void handleFlushTimer();
+
+    private:
+        QueryHistory();
+
+        QSqlDatabase database;
+        QList<HistoryEntry> pending;
+        QHash<QString, qint64> fingerprintIds;
+        QTimer flushTimer;
+        bool opened;
+        bool fullText;
+
+        bool open();
+        qint64 fingerprintId(QString fingerprint, QDateTime executedAt);
+        void storePlan(qint64 fingerprintId, QString plan, QDateTime executedAt);
+        double percentile(qint64 fingerprintId, qint64 count, double rank);
+        static double percentile(QList<double> sortedValues, double rank);
+    };
+}
+
+#endif // QUERYHISTORY_H
@@ -0,0 +1,232 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ResultCache.h"
+#include <QSettings>
+#include <QRegExp>
+#include <QMutexLocker>
+#include <QDebug>
+#include "SqlFingerprint.h"
+#include "SqlSplitter.h"
+#include "ExplainPlan.h"
+
+#define DEFAULT_TTL_SECONDS 300
+#define DEFAULT_MEMORY_MB 64
+
+namespace Util {
+
+    ResultCache::ResultCache()
+    {
+        QSettings settings("smartarello", "mysqlclient");
+        this->ttl = settings.value("resultCache/ttlSeconds", DEFAULT_TTL_SECONDS).toInt();
+        this->memoryBudget = settings.value("resultCache/memoryMB", DEFAULT_MEMORY_MB).toLongLong() * 1024 * 1024;
+        this->memory = 0;
+        this->useCounter = 0;
+    }
+
+    ResultCache *ResultCache::instance()
+    {
+        static ResultCache cache;
+        return &cache;
+    }
+
+    /**
+     * A query can be cached when it is a single statement which reads the data, without locks,
+     * variables, or functions giving a different value at each execution
+     * @brief ResultCache::isCacheable
+     */
+    bool ResultCache::isCacheable(QString query)
+    {
+        QStringList statements = SqlSplitter::split(query);
+        if (statements.size() != 1) {
+            return false;
+        }
+
+        // The literals are replaced by ?, their content is not taken for a function or a keyword
+        QString normalized = SqlFingerprint::normalize(statements.first());
+        if (!ExplainPlan::canExplain(normalized)) {
+            return false;
+        }
+
+        QRegExp excluded("\\binto\\b|\\bfor (update|share)\\b|\\block in share mode\\b|\\bsql_no_cache\\b|@"
+                         "|\\b(information_schema|performance_schema|sys|mysql)\\."
+                         "|\\b(current_date|current_time|current_timestamp|current_user|localtime|localtimestamp|utc_date|utc_time|utc_timestamp)\\b"
+                         "|\\b(now|sysdate|curdate|curtime|unix_timestamp|rand|uuid|uuid_short|connection_id|last_insert_id|found_rows|row_count"
+                         "|user|session_user|system_user|database|schema|sleep|get_lock|release_lock|is_free_lock|is_used_lock|benchmark) ?\\(");
+
+        return excluded.indexIn(normalized) == -1;
+    }
+
+    /**
+     * @brief ResultCache::isReadOnly
+     * @return true if the statement does not modify the data or the structure of the tables
+     */
+    bool ResultCache::isReadOnly(QString statement)
+    {
+        QString normalized = SqlFingerprint::normalize(statement);
+        if (normalized.isEmpty() || ExplainPlan::canExplain(normalized)) {
+            return true;
+        }
+
+        return QRegExp("^(show|desc|describe|explain|help|use|set|begin|start transaction|commit|rollback)\\b").indexIn(normalized) != -1
+                && QRegExp("\\b(insert|update|delete|replace)\\b").indexIn(normalized) == -1;
+    }
+
+    /**
+     * @brief ResultCache::lookup
+     * @param owner the tab executing the query
+     * @param result the result of the previous execution of the query
+     * @return false if the query has no result in the cache, or if it has expired
+     */
+    bool ResultCache::lookup(ConnectionConfiguration connection, QString owner, QString query, CachedResult *result)
+    {
+        QMutexLocker locker(&this->mutex);
+
+        QString key = this->key(connection, owner, query);
+        if (!this->entries.contains(key)) {
+            return false;
+        }
+
+        Entry &entry = this->entries[key];
+        if (entry.result.cachedAt.secsTo(QDateTime::currentDateTime()) >= this->ttl) {
+            this->remove(key);
+            return false;
+        }
+
+        entry.lastUsed = ++this->useCounter;
+        *result = entry.result;
+
+        return true;
+    }
+
+    /**
+     * Keeps the complete result of a query, the least recently used results are removed to stay in the memory budget
+     * @brief ResultCache::insert
+     * @param owner the tab which executed the query
+     * @param msec the time of the execution
+     */
+    void ResultCache::insert(ConnectionConfiguration connection, QString owner, QString query, ResultSet data, qint64 msec)
+    {
+        // A large result would remove all the others
+        qint64 size = data.memoryUsage();
+        if (size > this->memoryBudget / 4) {
+            return;
+        }
+
+        QMutexLocker locker(&this->mutex);
+
+        QString key = this->key(connection, owner, query);
+        this->remove(key);
+
+        Entry entry;
+        entry.session = this->session(connection);
+        entry.result.data = data;
+        entry.result.msec = msec;
+        entry.result.cachedAt = QDateTime::currentDateTime();
+        entry.memory = size;
+        entry.lastUsed = ++this->useCounter;
+
+        this->entries.insert(key, entry);
+        this->memory += size;
+        this->evict();
+    }
+
+    /**
+     * Removes the results made obsolete by a statement executed from the client
+     * @brief ResultCache::invalidate
+     * @param statement a statement of the session, nothing is removed if it does not modify the data
+     */
+    void ResultCache::invalidate(ConnectionConfiguration connection, QString statement)
+    {
+        if (!isReadOnly(statement)) {
+            this->invalidateSession(connection);
+        }
+    }
+
+    /**
+     * Removes the results of all the databases of a session
+     * @brief ResultCache::invalidateSession
+     */
+    void ResultCache::invalidateSession(ConnectionConfiguration connection)
+    {
+        QMutexLocker locker(&this->mutex);
+
+        QString session = this->session(connection);
+        foreach (QString key, this->entries.keys()) {
+            if (this->entries[key].session == session) {
+                this->remove(key);
+            }
+        }
+    }
+
+    void ResultCache::clear()
+    {
+        QMutexLocker locker(&this->mutex);
+
+        this->entries.clear();
+        this->memory = 0;
+    }
+
+    int ResultCache::ttlSeconds() const
+    {
+        return this->ttl;
+    }
+
+    void ResultCache::remove(QString key)
+    {
+        if (this->entries.contains(key)) {
+            this->memory -= this->entries.take(key).memory;
+        }
+    }
+
+    /**
+     * Removes the expired results, then the least recently used ones while the memory budget is exceeded
+     * @brief ResultCache::evict
+     */
+    void ResultCache::evict()
+    {
+        QDateTime now = QDateTime::currentDateTime();
+        foreach (QString key, this->entries.keys()) {
+            if (this->entries[key].result.cachedAt.secsTo(now) >= this->ttl) {
+                this->remove(key);
+            }
+        }
+
+        while (this->memory > this->memoryBudget && !this->entries.isEmpty()) {
+            QString oldest;
+            qint64 lastUsed = -1;
+            for (QHash<QString, Entry>::const_iterator it = this->entries.constBegin(); it != this->entries.constEnd(); ++it) {
+                if (lastUsed == -1 || it.value().lastUsed < lastUsed) {
+                    oldest = it.key();
+                    lastUsed = it.value().lastUsed;
+                }
+            }
+
+            this->remove(oldest);
+        }
+    }
+
+    QString ResultCache::session(ConnectionConfiguration connection)
+    {
+        return QString("%1@%2:%3").arg(connection.username).arg(connection.hostname).arg(connection.port);
+    }
+
+    QString ResultCache::key(ConnectionConfiguration connection, QString owner, QString query)
+    {
+        return session(connection) + "\n" + owner + "\n" + connection.databaseName + "\n" + SqlFingerprint::canonical(query);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include "DataBase.h"
+#include "ResultSet.h"
+
+struct CachedResult {
+    Util::ResultSet data;
+    qint64 msec; // time of the execution which gave the result
+    QDateTime cachedAt;
+};
+
+namespace Util {
+    /**
+     * Keeps the results of the read-only queries executed in the query tabs, to show them again
+     * without executing the query on the server.
+     *
+     * The results are found by session, owner (the tab which executed the query, as the
+     * temporary tables and the variables of a tab are not seen by the others), database and
+     * canonical text of the query (see SqlFingerprint::canonical). They expire after a delay and
+     * the least recently used ones are removed when the memory budget is reached. Both limits
+     * are read from the settings (resultCache/ttlSeconds and resultCache/memoryMB).
+     *
+     * A statement modifying the data executed from the client invalidates all the results of
+     * the session: the foreign keys (ON DELETE CASCADE), the triggers and the views can change
+     * the result of queries which do not name the written table. The changes made by other
+     * clients are only seen when the results expire.
+     */
+    class ResultCache
+    {
+    public:
+        static ResultCache *instance();
+
+        static bool isCacheable(QString query);
+        static bool isReadOnly(QString statement);
+
+        bool lookup(ConnectionConfiguration connection, QString owner, QString query, CachedResult *result);
+        void insert(ConnectionConfiguration connection, QString owner, QString query, ResultSet data, qint64 msec);
+        void invalidate(ConnectionConfiguration connection, QString statement);
+        void invalidateSession(ConnectionConfiguration connection);
+        void clear();
+        int ttlSeconds() const;
+
+    private:
+        struct Entry {
+            QString session;
+            CachedResult result;
+            qint64 memory;
+            qint64 lastUsed;
+        };
+
+        ResultCache();
+
+        QMutex mutex;
+        QHash<QString, Entry> entries;
+        qint64 memory;
+        qint64 memoryBudget;
+        int ttl;
+        qint64 useCounter;
+
+        void remove(QString key);
+        void evict();
+        static QString session(ConnectionConfiguration connection);
+        static QString key(ConnectionConfiguration connection, QString owner, QString query);
+    };
+}
+
+#endif // RESULTCACHE_H
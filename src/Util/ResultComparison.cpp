@@ -0,0 +1,395 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ResultComparison.h"
+#include "ConnectionWorker.h"
+#include "MySQLCursor.h"
+#include <QSqlRecord>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+
+// Number of rows of each block of the ordered hash
+#define ORDERED_BLOCK_SIZE 1000
+// Number of buckets of the order insensitive hash
+#define UNORDERED_BUCKETS 1024
+// Maximum number of differing rows listed
+#define MAX_DIFFERENCES 100
+
+namespace Util {
+
+    /**
+     * Serializes the values of the current row as sent by the server, the NULL values and the length
+     * of each value are part of the data so ("a", "bc") and ("ab", "c") are different
+     */
+    static QByteArray rowData(const MySQLCursor &cursor, int columnCount, QStringList *values)
+    {
+        QByteArray data;
+        for (int i = 0; i < columnCount; i++) {
+            if (cursor.isNull(i)) {
+                data.append(char(0));
+                if (values != nullptr) {
+                    *values << "(NULL)";
+                }
+            } else {
+                data.append(char(1));
+                data.append(QByteArray::number(cursor.valueLength(i)));
+                data.append(':');
+                data.append(cursor.rawValue(i), cursor.valueLength(i));
+                if (values != nullptr) {
+                    *values << QString::fromUtf8(cursor.rawValue(i), cursor.valueLength(i));
+                }
+            }
+        }
+
+        return data;
+    }
+
+    static quint64 rowHash(const QByteArray &data)
+    {
+        QByteArray digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+        return qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(digest.constData()));
+    }
+
+    ResultComparison::ResultComparison(ConnectionConfiguration source, ConnectionConfiguration target, QString query, bool ordered):
+        source(source),
+        target(target),
+        query(query),
+        ordered(ordered)
+    {
+        this->stop = false;
+        this->report.match = false;
+        this->report.ordered = ordered;
+    }
+
+    /**
+     * Executes the query on both connections then lists the first differing rows if the results differ
+     * @brief ResultComparison::compare
+     */
+    void ResultComparison::compare()
+    {
+        ConnectionWorker sourceWorker(this->source);
+        ConnectionWorker targetWorker(this->target);
+        sourceWorker.start();
+        targetWorker.start();
+
+        SidePass sourcePass, targetPass;
+        QSemaphore done;
+        sourceWorker.post([&](QSqlDatabase db) {
+            this->hashResult(db, this->source, sourcePass);
+            done.release();
+        });
+        targetWorker.post([&](QSqlDatabase db) {
+            this->hashResult(db, this->target, targetPass);
+            done.release();
+        });
+        done.acquire(2);
+
+        this->report.source = this->sideReport(sourcePass);
+        this->report.target = this->sideReport(targetPass);
+        this->report.columns = sourcePass.columns;
+
+        if (this->stop || !sourcePass.error.isEmpty() || !targetPass.error.isEmpty()) {
+            emit compareFinished(this->stop);
+            return;
+        }
+
+        if (sourcePass.columns != targetPass.columns) {
+            this->report.message = tr("The columns are different: %1 / %2").arg(sourcePass.columns.join(", ")).arg(targetPass.columns.join(", "));
+            emit compareFinished(false);
+            return;
+        }
+
+        this->report.match = sourcePass.rows == targetPass.rows && sourcePass.hash == targetPass.hash;
+        if (this->report.match) {
+            emit compareFinished(false);
+            return;
+        }
+
+        // Finds the first block (ordered) or bucket (order insensitive) which differs
+        int slot = -1;
+        if (this->ordered) {
+            int blocks = qMax(sourcePass.blocks.size(), targetPass.blocks.size());
+            for (int i = 0; i < blocks && slot < 0; i++) {
+                if (i >= sourcePass.blocks.size() || i >= targetPass.blocks.size() || sourcePass.blocks.at(i) != targetPass.blocks.at(i)) {
+                    slot = i;
+                }
+            }
+        } else {
+            for (int i = 0; i < UNORDERED_BUCKETS && slot < 0; i++) {
+                if (sourcePass.buckets.at(i) != targetPass.buckets.at(i)) {
+                    slot = i;
+                }
+            }
+        }
+
+        if (slot < 0) {
+            // Same blocks with a different number of rows, should not happen
+            emit compareFinished(false);
+            return;
+        }
+
+        QList<CollectedRow> sourceRows, targetRows;
+        QString sourceError, targetError;
+        sourceWorker.post([&](QSqlDatabase db) {
+            this->collectRows(db, this->source, slot, sourceRows, sourceError);
+            done.release();
+        });
+        targetWorker.post([&](QSqlDatabase db) {
+            this->collectRows(db, this->target, slot, targetRows, targetError);
+            done.release();
+        });
+        done.acquire(2);
+
+        if (!sourceError.isEmpty() || !targetError.isEmpty()) {
+            this->report.message = sourceError.isEmpty() ? targetError : sourceError;
+        } else if (this->ordered) {
+            this->listOrderedDifferences(sourceRows, targetRows);
+        } else {
+            this->listUnorderedDifferences(sourceRows, targetRows);
+        }
+
+        emit compareFinished(this->stop);
+    }
+
+    /**
+     * Executes the query and computes the hash of the result without keeping the rows, the
+     * rows are read from the network one by one
+     * @brief ResultComparison::hashResult
+     * @param db the connection
+     * @param conf the configuration of the connection, to kill the query when the comparison stops
+     * @param pass the hash, the number of rows and the timings of the execution
+     */
+    void ResultComparison::hashResult(QSqlDatabase db, ConnectionConfiguration conf, SidePass &pass)
+    {
+        pass.rows = 0;
+        pass.executionMsec = 0;
+        pass.totalMsec = 0;
+        pass.buckets.fill(0, UNORDERED_BUCKETS);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        MySQLCursor cursor(db);
+        if (!cursor.exec(this->query)) {
+            pass.error = cursor.lastError();
+            return;
+        }
+
+        pass.executionMsec = timer.elapsed();
+
+        int columnCount = cursor.columnCount();
+        if (!cursor.isSelect() || columnCount == 0) {
+            pass.error = tr("The query does not return a result set");
+            return;
+        }
+
+        for (int i = 0; i < columnCount; i++) {
+            pass.columns << cursor.record().fieldName(i);
+        }
+
+        QCryptographicHash resultHash(QCryptographicHash::Sha1);
+        QCryptographicHash blockHash(QCryptographicHash::Sha1);
+        quint64 sum = 0;
+
+        while (!this->stop && cursor.next()) {
+            QByteArray data = rowData(cursor, columnCount, nullptr);
+            pass.rows++;
+
+            if (this->ordered) {
+                resultHash.addData(data);
+                blockHash.addData(data);
+                if (pass.rows % ORDERED_BLOCK_SIZE == 0) {
+                    pass.blocks << blockHash.result();
+                    blockHash.reset();
+                }
+            } else {
+                // The sum of the hashes does not depend on the order and keeps the duplicated rows
+                quint64 hash = rowHash(data);
+                sum += hash;
+                pass.buckets[hash % UNORDERED_BUCKETS] += hash;
+            }
+        }
+
+        if (this->stop) {
+            // The rest of the result would be read when it is freed
+            DataBase::killQuery(conf, cursor.connectionId());
+            return;
+        } else if (!cursor.lastError().isEmpty()) {
+            pass.error = cursor.lastError();
+            return;
+        }
+
+        if (this->ordered) {
+            if (pass.rows % ORDERED_BLOCK_SIZE != 0) {
+                pass.blocks << blockHash.result();
+            }
+            pass.hash = resultHash.result().toHex();
+        } else {
+            pass.hash = QByteArray::number(sum, 16).rightJustified(16, '0');
+        }
+
+        pass.totalMsec = timer.elapsed();
+    }
+
+    /**
+     * Executes the query again and keeps the rows of a block (ordered) or a bucket (order insensitive)
+     * @brief ResultComparison::collectRows
+     * @param db the connection
+     * @param conf the configuration of the connection, to kill the query once the block is read
+     * @param slot the block or bucket number
+     * @param rows the rows of the block or bucket
+     * @param error set when the query fails
+     */
+    void ResultComparison::collectRows(QSqlDatabase db, ConnectionConfiguration conf, int slot, QList<CollectedRow> &rows, QString &error)
+    {
+        MySQLCursor cursor(db);
+        if (!cursor.exec(this->query)) {
+            error = cursor.lastError();
+            return;
+        }
+
+        int columnCount = cursor.columnCount();
+        qint64 position = 0;
+        qint64 firstRow = qint64(slot) * ORDERED_BLOCK_SIZE;
+        bool interrupted = false;
+
+        while (!interrupted && cursor.next()) {
+            position++;
+            if (this->stop || (this->ordered && position > firstRow + ORDERED_BLOCK_SIZE)) {
+                interrupted = true;
+                continue;
+            } else if (this->ordered && position <= firstRow) {
+                continue;
+            }
+
+            CollectedRow row;
+            QByteArray data = rowData(cursor, columnCount, &row.values);
+            row.row = position;
+            row.hash = rowHash(data);
+
+            if (this->ordered || row.hash % UNORDERED_BUCKETS == quint64(slot)) {
+                rows << row;
+            }
+        }
+
+        if (interrupted) {
+            // The next rows are not needed
+            DataBase::killQuery(conf, cursor.connectionId());
+        } else if (!cursor.lastError().isEmpty()) {
+            error = cursor.lastError();
+        }
+    }
+
+    /**
+     * Compares the rows of the block at the same position
+     * @brief ResultComparison::listOrderedDifferences
+     */
+    void ResultComparison::listOrderedDifferences(QList<CollectedRow> sourceRows, QList<CollectedRow> targetRows)
+    {
+        int count = qMax(sourceRows.size(), targetRows.size());
+        for (int i = 0; i < count && this->report.differences.size() < MAX_DIFFERENCES; i++) {
+            bool hasSource = i < sourceRows.size();
+            bool hasTarget = i < targetRows.size();
+            if (hasSource && hasTarget && sourceRows.at(i).hash == targetRows.at(i).hash) {
+                continue;
+            }
+
+            if (hasSource) {
+                ResultDifference difference;
+                difference.side = hasTarget ? tr("Source") : tr("Only on the source");
+                difference.row = sourceRows.at(i).row;
+                difference.values = sourceRows.at(i).values;
+                this->report.differences << difference;
+            }
+
+            if (hasTarget) {
+                ResultDifference difference;
+                difference.side = hasSource ? tr("Target") : tr("Only on the target");
+                difference.row = targetRows.at(i).row;
+                difference.values = targetRows.at(i).values;
+                this->report.differences << difference;
+            }
+        }
+    }
+
+    /**
+     * Lists the rows of the bucket which are not on both sides, duplicated rows are counted
+     * @brief ResultComparison::listUnorderedDifferences
+     */
+    void ResultComparison::listUnorderedDifferences(QList<CollectedRow> sourceRows, QList<CollectedRow> targetRows)
+    {
+        QHash<quint64, int> balance;
+        foreach (CollectedRow row, sourceRows) {
+            balance[row.hash]++;
+        }
+
+        foreach (CollectedRow row, targetRows) {
+            balance[row.hash]--;
+        }
+
+        foreach (CollectedRow row, sourceRows) {
+            if (balance.value(row.hash) > 0 && this->report.differences.size() < MAX_DIFFERENCES) {
+                balance[row.hash]--;
+                ResultDifference difference;
+                difference.side = tr("Only on the source");
+                difference.row = row.row;
+                difference.values = row.values;
+                this->report.differences << difference;
+            }
+        }
+
+        foreach (CollectedRow row, targetRows) {
+            if (balance.value(row.hash) < 0 && this->report.differences.size() < MAX_DIFFERENCES) {
+                balance[row.hash]++;
+                ResultDifference difference;
+                difference.side = tr("Only on the target");
+                difference.row = row.row;
+                difference.values = row.values;
+                this->report.differences << difference;
+            }
+        }
+    }
+
+    ResultSideReport ResultComparison::sideReport(const SidePass &pass)
+    {
+        ResultSideReport sideReport;
+        sideReport.rows = pass.rows;
+        sideReport.executionMsec = pass.executionMsec;
+        sideReport.totalMsec = pass.totalMsec;
+        sideReport.hash = pass.hash;
+        sideReport.error = pass.error;
+
+        return sideReport;
+    }
+
+    /**
+     * @brief ResultComparison::getReport
+     * @return the result of the comparison, to call when the comparison is finished
+     */
+    ResultComparisonReport ResultComparison::getReport()
+    {
+        return this->report;
+    }
+
+    void ResultComparison::stopRequired()
+    {
+        this->stop = true;
+    }
+}
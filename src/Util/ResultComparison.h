@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef RESULTCOMPARISON_H
+#define RESULTCOMPARISON_H
+
+#include "DataBase.h"
+#include <QObject>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+
+struct ResultSideReport {
+    qint64 rows;
+    qint64 executionMsec;
+    qint64 totalMsec;
+    QByteArray hash;
+    QString error;
+};
+
+struct ResultDifference {
+    QString side;
+    qint64 row;
+    QStringList values;
+};
+
+struct ResultComparisonReport {
+    bool match;
+    bool ordered;
+    QString message;
+    QStringList columns;
+    ResultSideReport source;
+    ResultSideReport target;
+    QList<ResultDifference> differences;
+};
+
+namespace Util {
+    /**
+     * Executes the same query on two connections at the same time and compares the results.
+     *
+     * The rows are read one by one with an unbuffered cursor and are not kept: each result set goes
+     * through a hash of the values as sent by the server, either ordered (the rows must come in the
+     * same order) or order insensitive (sum of the hash of each row). The hash is also split in
+     * blocks of rows (ordered) or buckets of row hashes (order insensitive), so when the results differ
+     * the query is executed again and only the rows of the first mismatching block or bucket are kept
+     * to list the differing rows.
+     */
+    class ResultComparison : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        ResultComparison(ConnectionConfiguration source, ConnectionConfiguration target, QString query, bool ordered);
+        ResultComparisonReport getReport();
+        void stopRequired();
+
+    public slots:
+        void compare();
+
+    signals:
+        void compareFinished(bool stopped);
+
+    private:
+        struct SidePass {
+            qint64 rows;
+            qint64 executionMsec;
+            qint64 totalMsec;
+            QByteArray hash;
+            QList<QByteArray> blocks;
+            QVector<quint64> buckets;
+            QStringList columns;
+            QString error;
+        };
+
+        struct CollectedRow {
+            qint64 row;
+            quint64 hash;
+            QStringList values;
+        };
+
+        ConnectionConfiguration source;
+        ConnectionConfiguration target;
+        QString query;
+        bool ordered;
+        volatile bool stop;
+        ResultComparisonReport report;
+
+        void hashResult(QSqlDatabase db, ConnectionConfiguration conf, SidePass &pass);
+        void collectRows(QSqlDatabase db, ConnectionConfiguration conf, int slot, QList<CollectedRow> &rows, QString &error);
+        void listOrderedDifferences(QList<CollectedRow> sourceRows, QList<CollectedRow> targetRows);
+        void listUnorderedDifferences(QList<CollectedRow> sourceRows, QList<CollectedRow> targetRows);
+        ResultSideReport sideReport(const SidePass &pass);
+    };
+}
+
+#endif // RESULTCOMPARISON_H
@@ -0,0 +1,355 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ResultSet.h"
+#include <QSqlField>
+#include <QDateTime>
+#include <cstring>
+
+// Size from which the rows are copied in a new slab
+#define SLAB_SIZE (1024 * 1024)
+// Flag of the end offset of a NULL value
+#define NULL_VALUE_FLAG 0x80000000u
+#define OFFSET_MASK 0x7fffffffu
+
+namespace Util {
+
+    ResultSet::ResultSet()
+    {
+    }
+
+    /**
+     * @brief ResultSet::ResultSet
+     * @param header the names and the types of the columns, the values are ignored
+     */
+    ResultSet::ResultSet(QSqlRecord header)
+    {
+        this->header = header;
+        this->header.clearValues();
+
+        for (int i = 0; i < header.count(); i++) {
+            this->types << header.field(i).type();
+        }
+    }
+
+    /**
+     * @brief ResultSet::record
+     * @return the columns, without value
+     */
+    QSqlRecord ResultSet::record() const
+    {
+        return this->header;
+    }
+
+    int ResultSet::columnCount() const
+    {
+        return this->types.size();
+    }
+
+    int ResultSet::rowCount() const
+    {
+        return this->rowOffsets.size();
+    }
+
+    bool ResultSet::isEmpty() const
+    {
+        return this->rowOffsets.isEmpty();
+    }
+
+    QString ResultSet::fieldName(int column) const
+    {
+        return this->header.fieldName(column);
+    }
+
+    int ResultSet::indexOf(QString name) const
+    {
+        return this->header.indexOf(name);
+    }
+
+    /**
+     * @brief ResultSet::appendRow
+     * @param values the values of the row, in the order of the columns
+     */
+    void ResultSet::appendRow(const QVariantList &values)
+    {
+        QList<QByteArray> encoded;
+        QList<bool> nulls;
+        for (int i = 0; i < this->types.size(); i++) {
+            QVariant value = i < values.size() ? values.at(i) : QVariant();
+            encoded << (value.isNull() ? QByteArray() : encodeValue(this->types.at(i), value));
+            nulls << value.isNull();
+        }
+
+        this->appendEncodedRow(encoded, nulls);
+    }
+
+    /**
+     * @brief ResultSet::appendRow
+     * @param query the query positioned on the row to append
+     */
+    void ResultSet::appendRow(const QSqlQuery &query)
+    {
+        QList<QByteArray> encoded;
+        QList<bool> nulls;
+        for (int i = 0; i < this->types.size(); i++) {
+            bool isNull = query.isNull(i);
+            encoded << (isNull ? QByteArray() : encodeValue(this->types.at(i), query.value(i)));
+            nulls << isNull;
+        }
+
+        this->appendEncodedRow(encoded, nulls);
+    }
+
+    /**
+     * Copies the bytes of the current row of the cursor, without conversion
+     * @brief ResultSet::appendRow
+     * @param cursor the cursor positioned on the row to append
+     */
+    void ResultSet::appendRow(const MySQLCursor &cursor)
+    {
+        int count = this->types.size();
+        int dataLength = 0;
+        for (int i = 0; i < count; i++) {
+            dataLength += cursor.valueLength(i);
+        }
+
+        char *row = this->allocateRow(dataLength);
+        char *data = row + count * sizeof(quint32);
+        quint32 end = 0;
+        for (int i = 0; i < count; i++) {
+            quint32 offset = end | NULL_VALUE_FLAG;
+            if (!cursor.isNull(i)) {
+                int length = cursor.valueLength(i);
+                memcpy(data + end, cursor.rawValue(i), length);
+                end += length;
+                offset = end;
+            }
+            memcpy(row + i * sizeof(quint32), &offset, sizeof(quint32));
+        }
+    }
+
+    /**
+     * Appends the rows of another result set with the same columns, e.g. a batch of streamed rows.
+     * The slabs of the other result set are shared, the rows are not copied.
+     * @brief ResultSet::append
+     * @param other the rows to append
+     */
+    void ResultSet::append(const ResultSet &other)
+    {
+        if (this->types.isEmpty() && this->rowOffsets.isEmpty()) {
+            *this = other;
+            return;
+        }
+
+        if (other.types.size() != this->types.size()) {
+            return;
+        }
+
+        int firstSlab = this->slabs.size();
+        this->slabs += other.slabs;
+        this->rowSlabs.reserve(this->rowSlabs.size() + other.rowSlabs.size());
+        foreach (int slab, other.rowSlabs) {
+            this->rowSlabs << firstSlab + slab;
+        }
+        this->rowOffsets += other.rowOffsets;
+    }
+
+    /**
+     * The bytes of the removed row stay in its slab until the result set is released
+     * @brief ResultSet::removeRow
+     * @param row the row number
+     */
+    void ResultSet::removeRow(int row)
+    {
+        if (row < 0 || row >= this->rowOffsets.size()) {
+            return;
+        }
+
+        this->rowSlabs.remove(row);
+        this->rowOffsets.remove(row);
+    }
+
+    bool ResultSet::isNull(int row, int column) const
+    {
+        int length;
+        bool isNull;
+        this->cell(row, column, length, isNull);
+
+        return isNull;
+    }
+
+    /**
+     * Converts the bytes of the cell, the result is not kept
+     * @brief ResultSet::value
+     * @param row the row number
+     * @param column the column number
+     * @return the value of the cell, a null value of the column type for NULL
+     */
+    QVariant ResultSet::value(int row, int column) const
+    {
+        QVariant::Type type = this->types.at(column);
+
+        int length;
+        bool isNull;
+        const char *data = this->cell(row, column, length, isNull);
+        if (isNull) {
+            return QVariant(type);
+        }
+
+        QVariant value = MySQLCursor::decodeValue(type, data, length);
+        if (value.type() != type && type != QVariant::Invalid) {
+            value.convert(type);
+        }
+
+        return value;
+    }
+
+    /**
+     * The row is copied with the new value at the end of the last slab
+     * @brief ResultSet::setValue
+     * @param row the row number
+     * @param column the column number
+     * @param value the new value
+     */
+    void ResultSet::setValue(int row, int column, const QVariant &value)
+    {
+        if (row < 0 || row >= this->rowOffsets.size()) {
+            return;
+        }
+
+        QList<QByteArray> encoded;
+        QList<bool> nulls;
+        for (int i = 0; i < this->types.size(); i++) {
+            if (i == column) {
+                encoded << (value.isNull() ? QByteArray() : encodeValue(this->types.at(i), value));
+                nulls << value.isNull();
+            } else {
+                int length;
+                bool isNull;
+                const char *data = this->cell(row, i, length, isNull);
+                encoded << QByteArray(data, length);
+                nulls << isNull;
+            }
+        }
+
+        this->appendEncodedRow(encoded, nulls);
+        this->rowSlabs[row] = this->rowSlabs.takeLast();
+        this->rowOffsets[row] = this->rowOffsets.takeLast();
+    }
+
+    /**
+     * @brief ResultSet::memoryUsage
+     * @return the number of bytes used by the rows
+     */
+    qint64 ResultSet::memoryUsage() const
+    {
+        qint64 size = (this->rowSlabs.size() + this->rowOffsets.size()) * sizeof(int);
+        foreach (const QByteArray &slab, this->slabs) {
+            size += slab.size();
+        }
+
+        return size;
+    }
+
+    /**
+     * Reserves the space of a new row at the end of the last slab, or in a new slab when it is full
+     * @brief ResultSet::allocateRow
+     * @param dataLength the number of bytes of the values
+     * @return the beginning of the row
+     */
+    char *ResultSet::allocateRow(int dataLength)
+    {
+        int size = this->types.size() * sizeof(quint32) + dataLength;
+        if (this->slabs.isEmpty() || (!this->slabs.last().isEmpty() && this->slabs.last().size() + size > SLAB_SIZE)) {
+            this->slabs << QByteArray();
+        }
+
+        QByteArray &slab = this->slabs.last();
+        int offset = slab.size();
+        slab.resize(offset + size);
+
+        this->rowSlabs << this->slabs.size() - 1;
+        this->rowOffsets << offset;
+
+        return slab.data() + offset;
+    }
+
+    void ResultSet::appendEncodedRow(const QList<QByteArray> &values, const QList<bool> &nulls)
+    {
+        int dataLength = 0;
+        foreach (const QByteArray &value, values) {
+            dataLength += value.size();
+        }
+
+        char *row = this->allocateRow(dataLength);
+        char *data = row + values.size() * sizeof(quint32);
+        quint32 end = 0;
+        for (int i = 0; i < values.size(); i++) {
+            memcpy(data + end, values.at(i).constData(), values.at(i).size());
+            end += values.at(i).size();
+            quint32 offset = nulls.at(i) ? end | NULL_VALUE_FLAG : end;
+            memcpy(row + i * sizeof(quint32), &offset, sizeof(quint32));
+        }
+    }
+
+    /**
+     * @brief ResultSet::cell
+     * @param row the row number
+     * @param column the column number
+     * @param length set to the number of bytes of the value
+     * @param isNull set to true for a NULL value
+     * @return the bytes of the value in the slab
+     */
+    const char *ResultSet::cell(int row, int column, int &length, bool &isNull) const
+    {
+        const char *data = this->slabs.at(this->rowSlabs.at(row)).constData() + this->rowOffsets.at(row);
+
+        quint32 start = 0;
+        quint32 end;
+        if (column > 0) {
+            memcpy(&start, data + (column - 1) * sizeof(quint32), sizeof(quint32));
+            start &= OFFSET_MASK;
+        }
+        memcpy(&end, data + column * sizeof(quint32), sizeof(quint32));
+
+        isNull = end & NULL_VALUE_FLAG;
+        length = int((end & OFFSET_MASK) - start);
+
+        return data + this->types.size() * sizeof(quint32) + start;
+    }
+
+    /**
+     * @brief ResultSet::encodeValue
+     * @param type the type of the column
+     * @param value the value
+     * @return the value as sent by the server with the text protocol
+     */
+    QByteArray ResultSet::encodeValue(QVariant::Type type, const QVariant &value)
+    {
+        switch (type) {
+        case QVariant::ByteArray:
+            return value.toByteArray();
+        case QVariant::Bool:
+            return value.toBool() ? "1" : "0";
+        case QVariant::Date:
+            return value.toDate().toString("yyyy-MM-dd").toLatin1();
+        case QVariant::DateTime:
+            return value.toDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz").toLatin1();
+        default:
+            return value.toString().toUtf8();
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef RESULTSET_H
+#define RESULTSET_H
+
+#include <QSqlRecord>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QVector>
+#include <QByteArray>
+#include "MySQLCursor.h"
+
+namespace Util {
+    /**
+     * Rows of a query result kept as the bytes of the MySQL text protocol.
+     *
+     * The column names and types are stored once in a header record. Each row is copied as a
+     * single block in a slab of about 1 MB: the end offset of each value (the high bit flags the
+     * NULL values) followed by the bytes of the values. No QVariant is created when a row is
+     * appended, a cell is converted to a QVariant only when it is read, in constant time.
+     *
+     * The slabs are implicitly shared: a copy (e.g. in a queued signal) or the rows appended from
+     * another result set do not copy the bytes.
+     */
+    class ResultSet
+    {
+    public:
+        ResultSet();
+        explicit ResultSet(QSqlRecord header);
+
+        QSqlRecord record() const;
+        int columnCount() const;
+        int rowCount() const;
+        bool isEmpty() const;
+        QString fieldName(int column) const;
+        int indexOf(QString name) const;
+
+        void appendRow(const QVariantList &values);
+        void appendRow(const QSqlQuery &query);
+        void appendRow(const MySQLCursor &cursor);
+        void append(const ResultSet &other);
+        void removeRow(int row);
+
+        bool isNull(int row, int column) const;
+        QVariant value(int row, int column) const;
+        void setValue(int row, int column, const QVariant &value);
+
+        qint64 memoryUsage() const;
+
+    private:
+        QSqlRecord header;
+        QVector<QVariant::Type> types;
+        QVector<QByteArray> slabs;
+        QVector<int> rowSlabs;
+        QVector<int> rowOffsets;
+
+        char *allocateRow(int dataLength);
+        void appendEncodedRow(const QList<QByteArray> &values, const QList<bool> &nulls);
+        const char *cell(int row, int column, int &length, bool &isNull) const;
+        static QByteArray encodeValue(QVariant::Type type, const QVariant &value);
+    };
+}
+
+#endif // RESULTSET_H
@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SchemaCompare.h"
+#include "ConnectionWorker.h"
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+
+namespace Util {
+    SchemaCompare::SchemaCompare(ConnectionConfiguration source, ConnectionConfiguration target):
+        source(source),
+        target(target)
+    {
+        this->sourceTableCount = 0;
+        this->targetTableCount = 0;
+        this->elapsedTime = 0;
+    }
+
+    /**
+     * Loads both schemas then generates the script, emits compareFinished when done
+     * @brief SchemaCompare::compare
+     */
+    void SchemaCompare::compare()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        SchemaDefinition sourceSchema(this->source.databaseName);
+        SchemaDefinition targetSchema(this->target.databaseName);
+
+        QList<ConnectionWorker *> workers;
+        QSemaphore done;
+        QMutex errorMutex;
+        QString error;
+
+        QList<QPair<SchemaDefinition *, ConnectionConfiguration> > sides;
+        sides << qMakePair(&sourceSchema, this->source) << qMakePair(&targetSchema, this->target);
+
+        for (int i = 0; i < sides.size(); i++) {
+            SchemaDefinition *schema = sides.at(i).first;
+            QString prefix = i == 0 ? tr("Source: ") : tr("Target: ");
+
+            // One connection for each part of the definition
+            for (int part = 0; part < 4; part++) {
+                ConnectionWorker *worker = new ConnectionWorker(sides.at(i).second);
+                worker->start();
+                workers << worker;
+
+                worker->post([&, schema, prefix, part](QSqlDatabase db) {
+                    QString partError;
+                    if (!db.isOpen()) {
+                        partError = tr("Unable to connect");
+                    } else if (part == 0) {
+                        partError = schema->loadTables(db);
+                    } else if (part == 1) {
+                        partError = schema->loadColumns(db);
+                    } else if (part == 2) {
+                        partError = schema->loadIndexes(db);
+                    } else {
+                        partError = schema->loadForeignKeys(db);
+                    }
+
+                    if (!partError.isEmpty()) {
+                        QMutexLocker locker(&errorMutex);
+                        error = prefix + partError;
+                    }
+
+                    done.release();
+                });
+            }
+        }
+
+        done.acquire(workers.size());
+        qDeleteAll(workers);
+
+        if (error.isEmpty()) {
+            sourceSchema.build();
+            targetSchema.build();
+
+            SchemaDiff diff(sourceSchema, targetSchema);
+            this->differences = diff.differences();
+            this->statements = diff.statements();
+            this->sourceTableCount = sourceSchema.tables().size();
+            this->targetTableCount = targetSchema.tables().size();
+        }
+
+        this->error = error;
+        this->elapsedTime = timer.elapsed();
+
+        emit compareFinished();
+    }
+
+    /**
+     * @brief SchemaCompare::getDifferences
+     * @return the tables which differ
+     */
+    QList<SchemaDifference> SchemaCompare::getDifferences()
+    {
+        return this->differences;
+    }
+
+    /**
+     * @brief SchemaCompare::getStatements
+     * @return the statements which make the target schema identical to the source schema
+     */
+    QStringList SchemaCompare::getStatements()
+    {
+        return this->statements;
+    }
+
+    QString SchemaCompare::getError()
+    {
+        return this->error;
+    }
+
+    int SchemaCompare::getSourceTableCount()
+    {
+        return this->sourceTableCount;
+    }
+
+    int SchemaCompare::getTargetTableCount()
+    {
+        return this->targetTableCount;
+    }
+
+    /**
+     * @brief SchemaCompare::getElapsedTime
+     * @return the duration of the comparison in milliseconds
+     */
+    qint64 SchemaCompare::getElapsedTime()
+    {
+        return this->elapsedTime;
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SCHEMACOMPARE_H
+#define SCHEMACOMPARE_H
+
+#include "DataBase.h"
+#include "SchemaDiff.h"
+#include <QObject>
+#include <QStringList>
+#include <QList>
+
+namespace Util {
+    /**
+     * Loads the schema of two databases and compares them in a background thread.
+     *
+     * The four information_schema queries of each schema are executed at the same time,
+     * each one with its own connection, so the loading time is the one of the slowest query.
+     */
+    class SchemaCompare : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        SchemaCompare(ConnectionConfiguration source, ConnectionConfiguration target);
+        QList<SchemaDifference> getDifferences();
+        QStringList getStatements();
+        QString getError();
+        int getSourceTableCount();
+        int getTargetTableCount();
+        qint64 getElapsedTime();
+
+    public slots:
+        void compare();
+
+    signals:
+        void compareFinished();
+
+    private:
+        ConnectionConfiguration source;
+        ConnectionConfiguration target;
+        QList<SchemaDifference> differences;
+        QStringList statements;
+        QString error;
+        int sourceTableCount;
+        int targetTableCount;
+        qint64 elapsedTime;
+    };
+}
+
+#endif // SCHEMACOMPARE_H
@@ -0,0 +1,323 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SchemaDefinition.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+namespace Util {
+
+    /**
+     * Executes a query on information_schema with the schema name as parameter
+     * @return the error message, empty on success
+     */
+    static QString execSchemaQuery(QSqlQuery &query, QString sql, QString schema)
+    {
+        query.setForwardOnly(true);
+        query.prepare(sql);
+        query.addBindValue(schema);
+        if (!query.exec()) {
+            qDebug() << "SchemaDefinition - " + query.lastError().text();
+            return query.lastError().text();
+        }
+
+        return QString();
+    }
+
+    SchemaDefinition::SchemaDefinition(QString schema):
+        schemaName(schema)
+    {
+    }
+
+    /**
+     * Reads the tables and their options
+     * @brief SchemaDefinition::loadTables
+     * @param db the connection
+     * @return the error message, empty on success
+     */
+    QString SchemaDefinition::loadTables(QSqlDatabase db)
+    {
+        QSqlQuery query(db);
+        QString error = execSchemaQuery(query, "SELECT TABLE_NAME, ENGINE, TABLE_COLLATION, TABLE_COMMENT "
+                                               "FROM information_schema.TABLES "
+                                               "WHERE TABLE_SCHEMA = ? AND TABLE_TYPE = 'BASE TABLE'", this->schemaName);
+
+        while (error.isEmpty() && query.next()) {
+            SchemaTable table;
+            table.name = query.value(0).toString();
+            table.engine = query.value(1).toString();
+            table.collation = query.value(2).toString();
+            table.comment = query.value(3).toString();
+            this->tableMap.insert(table.name, table);
+        }
+
+        return error;
+    }
+
+    /**
+     * Reads the columns of all the tables
+     * @brief SchemaDefinition::loadColumns
+     * @param db the connection
+     * @return the error message, empty on success
+     */
+    QString SchemaDefinition::loadColumns(QSqlDatabase db)
+    {
+        QSqlQuery query(db);
+        QString error = execSchemaQuery(query, "SELECT TABLE_NAME, COLUMN_NAME, COLUMN_TYPE, IS_NULLABLE, COLUMN_DEFAULT, EXTRA, COLLATION_NAME, COLUMN_COMMENT "
+                                               "FROM information_schema.COLUMNS "
+                                               "WHERE TABLE_SCHEMA = ? "
+                                               "ORDER BY TABLE_NAME, ORDINAL_POSITION", this->schemaName);
+
+        while (error.isEmpty() && query.next()) {
+            SchemaColumn column;
+            column.name = query.value(1).toString();
+            column.columnType = query.value(2).toString();
+            column.nullable = query.value(3).toString() == "YES";
+            column.defaultValue = query.isNull(4) ? QVariant() : query.value(4);
+            column.extra = query.value(5).toString();
+            column.collation = query.value(6).toString();
+            column.comment = query.value(7).toString();
+            this->columnMap[query.value(0).toString()] << column;
+        }
+
+        return error;
+    }
+
+    /**
+     * Reads the indexes of all the tables, one row for each column of an index
+     * @brief SchemaDefinition::loadIndexes
+     * @param db the connection
+     * @return the error message, empty on success
+     */
+    QString SchemaDefinition::loadIndexes(QSqlDatabase db)
+    {
+        QSqlQuery query(db);
+        QString error = execSchemaQuery(query, "SELECT TABLE_NAME, INDEX_NAME, NON_UNIQUE, COLUMN_NAME, SUB_PART, INDEX_TYPE "
+                                               "FROM information_schema.STATISTICS "
+                                               "WHERE TABLE_SCHEMA = ? "
+                                               "ORDER BY TABLE_NAME, INDEX_NAME, SEQ_IN_INDEX", this->schemaName);
+
+        while (error.isEmpty() && query.next()) {
+            QList<SchemaIndex> &indexes = this->indexMap[query.value(0).toString()];
+            QString indexName = query.value(1).toString();
+            if (indexes.isEmpty() || indexes.last().name != indexName) {
+                SchemaIndex index;
+                index.name = indexName;
+                index.unique = query.value(2).toInt() == 0;
+                index.type = query.value(5).toString();
+                indexes << index;
+            }
+
+            // The functional indexes have no column name
+            if (!query.isNull(3)) {
+                QString column = quoteIdentifier(query.value(3).toString());
+                if (!query.isNull(4)) {
+                    column += "(" + query.value(4).toString() + ")";
+                }
+                indexes.last().columns << column;
+            }
+        }
+
+        return error;
+    }
+
+    /**
+     * Reads the foreign keys of all the tables, one row for each column of a foreign key
+     * @brief SchemaDefinition::loadForeignKeys
+     * @param db the connection
+     * @return the error message, empty on success
+     */
+    QString SchemaDefinition::loadForeignKeys(QSqlDatabase db)
+    {
+        QSqlQuery query(db);
+        QString error = execSchemaQuery(query, "SELECT k.TABLE_NAME, k.CONSTRAINT_NAME, k.COLUMN_NAME, k.REFERENCED_TABLE_NAME, k.REFERENCED_COLUMN_NAME, r.UPDATE_RULE, r.DELETE_RULE "
+                                               "FROM information_schema.KEY_COLUMN_USAGE k "
+                                               "JOIN information_schema.REFERENTIAL_CONSTRAINTS r "
+                                               "ON r.CONSTRAINT_SCHEMA = k.CONSTRAINT_SCHEMA AND r.TABLE_NAME = k.TABLE_NAME AND r.CONSTRAINT_NAME = k.CONSTRAINT_NAME "
+                                               "WHERE k.TABLE_SCHEMA = ? AND k.REFERENCED_TABLE_NAME IS NOT NULL "
+                                               "ORDER BY k.TABLE_NAME, k.CONSTRAINT_NAME, k.ORDINAL_POSITION", this->schemaName);
+
+        while (error.isEmpty() && query.next()) {
+            QList<SchemaForeignKey> &foreignKeys = this->foreignKeyMap[query.value(0).toString()];
+            QString keyName = query.value(1).toString();
+            if (foreignKeys.isEmpty() || foreignKeys.last().name != keyName) {
+                SchemaForeignKey foreignKey;
+                foreignKey.name = keyName;
+                foreignKey.referencedTable = query.value(3).toString();
+                foreignKey.onUpdate = query.value(5).toString();
+                foreignKey.onDelete = query.value(6).toString();
+                foreignKeys << foreignKey;
+            }
+
+            foreignKeys.last().columns << quoteIdentifier(query.value(2).toString());
+            foreignKeys.last().referencedColumns << quoteIdentifier(query.value(4).toString());
+        }
+
+        return error;
+    }
+
+    /**
+     * Adds the columns, indexes and foreign keys to their table, called when all the parts are loaded
+     * @brief SchemaDefinition::build
+     */
+    void SchemaDefinition::build()
+    {
+        QMap<QString, SchemaTable>::iterator it;
+        for (it = this->tableMap.begin(); it != this->tableMap.end(); ++it) {
+            it->columns = this->columnMap.take(it.key());
+            it->indexes = this->indexMap.take(it.key());
+            it->foreignKeys = this->foreignKeyMap.take(it.key());
+        }
+
+        // The remaining columns belong to the views
+        this->columnMap.clear();
+        this->indexMap.clear();
+        this->foreignKeyMap.clear();
+    }
+
+    QString SchemaDefinition::schema() const
+    {
+        return this->schemaName;
+    }
+
+    QMap<QString, SchemaTable> SchemaDefinition::tables() const
+    {
+        return this->tableMap;
+    }
+
+    QString SchemaDefinition::quoteIdentifier(QString name)
+    {
+        return "`" + name.replace("`", "``") + "`";
+    }
+
+    QString SchemaDefinition::quoteString(QString value)
+    {
+        return "'" + value.replace("\\", "\\\\").replace("'", "''") + "'";
+    }
+
+    /**
+     * @brief SchemaDefinition::columnDefinition
+     * @param column the column
+     * @return the definition of the column as in CREATE TABLE
+     */
+    QString SchemaDefinition::columnDefinition(const SchemaColumn &column)
+    {
+        QString sql = quoteIdentifier(column.name) + " " + column.columnType;
+        if (!column.collation.isEmpty()) {
+            sql += " COLLATE " + column.collation;
+        }
+
+        sql += column.nullable ? " NULL" : " NOT NULL";
+
+        // MySQL 8 flags the expression defaults with DEFAULT_GENERATED
+        QString extra = column.extra;
+        bool expressionDefault = extra.contains("DEFAULT_GENERATED", Qt::CaseInsensitive);
+        extra.remove("DEFAULT_GENERATED", Qt::CaseInsensitive);
+        extra = extra.trimmed();
+
+        if (!column.defaultValue.isNull()) {
+            QString value = column.defaultValue.toString();
+            if (value.startsWith("CURRENT_TIMESTAMP", Qt::CaseInsensitive) || column.columnType.startsWith("bit", Qt::CaseInsensitive)) {
+                sql += " DEFAULT " + value;
+            } else if (expressionDefault) {
+                sql += " DEFAULT (" + value + ")";
+            } else {
+                sql += " DEFAULT " + quoteString(value);
+            }
+        } else if (column.nullable) {
+            sql += " DEFAULT NULL";
+        }
+
+        if (!extra.isEmpty()) {
+            sql += " " + extra;
+        }
+
+        if (!column.comment.isEmpty()) {
+            sql += " COMMENT " + quoteString(column.comment);
+        }
+
+        return sql;
+    }
+
+    /**
+     * @brief SchemaDefinition::indexDefinition
+     * @param index the index
+     * @return the definition of the index as in CREATE TABLE
+     */
+    QString SchemaDefinition::indexDefinition(const SchemaIndex &index)
+    {
+        QString columns = "(" + index.columns.join(", ") + ")";
+        if (index.name == "PRIMARY") {
+            return "PRIMARY KEY " + columns;
+        } else if (index.type == "FULLTEXT" || index.type == "SPATIAL") {
+            return index.type + " KEY " + quoteIdentifier(index.name) + " " + columns;
+        } else if (index.unique) {
+            return "UNIQUE KEY " + quoteIdentifier(index.name) + " " + columns;
+        }
+
+        return "KEY " + quoteIdentifier(index.name) + " " + columns;
+    }
+
+    /**
+     * @brief SchemaDefinition::foreignKeyDefinition
+     * @param foreignKey the foreign key
+     * @return the definition of the foreign key as in CREATE TABLE
+     */
+    QString SchemaDefinition::foreignKeyDefinition(const SchemaForeignKey &foreignKey)
+    {
+        return QString("CONSTRAINT %1 FOREIGN KEY (%2) REFERENCES %3 (%4) ON DELETE %5 ON UPDATE %6")
+                .arg(quoteIdentifier(foreignKey.name))
+                .arg(foreignKey.columns.join(", "))
+                .arg(quoteIdentifier(foreignKey.referencedTable))
+                .arg(foreignKey.referencedColumns.join(", "))
+                .arg(foreignKey.onDelete)
+                .arg(foreignKey.onUpdate);
+    }
+
+    /**
+     * The foreign keys are not part of the statement, they are added when all the tables exist
+     * @brief SchemaDefinition::createTable
+     * @param table the table
+     * @return the CREATE TABLE statement of the table
+     */
+    QString SchemaDefinition::createTable(const SchemaTable &table)
+    {
+        QStringList definitions;
+        foreach (SchemaColumn column, table.columns) {
+            definitions << "  " + columnDefinition(column);
+        }
+
+        foreach (SchemaIndex index, table.indexes) {
+            definitions << "  " + indexDefinition(index);
+        }
+
+        QString sql = "CREATE TABLE " + quoteIdentifier(table.name) + " (\n" + definitions.join(",\n") + "\n)";
+        if (!table.engine.isEmpty()) {
+            sql += " ENGINE=" + table.engine;
+        }
+
+        if (!table.collation.isEmpty()) {
+            sql += " COLLATE=" + table.collation;
+        }
+
+        if (!table.comment.isEmpty()) {
+            sql += " COMMENT=" + quoteString(table.comment);
+        }
+
+        return sql;
+    }
+}
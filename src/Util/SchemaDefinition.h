@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SCHEMADEFINITION_H
+#define SCHEMADEFINITION_H
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVariant>
+#include <QHash>
+#include <QMap>
+#include <QList>
+
+struct SchemaColumn {
+    QString name;
+    QString columnType;
+    bool nullable;
+    QVariant defaultValue;
+    QString extra;
+    QString collation;
+    QString comment;
+};
+
+struct SchemaIndex {
+    QString name;
+    bool unique;
+    QString type;
+    QStringList columns;
+};
+
+struct SchemaForeignKey {
+    QString name;
+    QStringList columns;
+    QString referencedTable;
+    QStringList referencedColumns;
+    QString onUpdate;
+    QString onDelete;
+};
+
+struct SchemaTable {
+    QString name;
+    QString engine;
+    QString collation;
+    QString comment;
+    QList<SchemaColumn> columns;
+    QList<SchemaIndex> indexes;
+    QList<SchemaForeignKey> foreignKeys;
+};
+
+namespace Util {
+    /**
+     * Definition of all the tables of a database, read with one information_schema query for each
+     * part of the definition (tables, columns, indexes and foreign keys) instead of one
+     * SHOW CREATE TABLE per table.
+     *
+     * Each load method only writes its own part, so the four queries can be executed at the same
+     * time by different threads with their own connection. build() merges the parts when all
+     * the queries are done.
+     */
+    class SchemaDefinition
+    {
+    public:
+        SchemaDefinition(QString schema = "");
+        QString loadTables(QSqlDatabase db);
+        QString loadColumns(QSqlDatabase db);
+        QString loadIndexes(QSqlDatabase db);
+        QString loadForeignKeys(QSqlDatabase db);
+        void build();
+
+        QString schema() const;
+        QMap<QString, SchemaTable> tables() const;
+
+        static QString quoteIdentifier(QString name);
+        static QString quoteString(QString value);
+        static QString columnDefinition(const SchemaColumn &column);
+        static QString indexDefinition(const SchemaIndex &index);
+        static QString foreignKeyDefinition(const SchemaForeignKey &foreignKey);
+        static QString createTable(const SchemaTable &table);
+
+    private:
+        QString schemaName;
+        QMap<QString, SchemaTable> tableMap;
+        QHash<QString, QList<SchemaColumn> > columnMap;
+        QHash<QString, QList<SchemaIndex> > indexMap;
+        QHash<QString, QList<SchemaForeignKey> > foreignKeyMap;
+    };
+}
+
+#endif // SCHEMADEFINITION_H
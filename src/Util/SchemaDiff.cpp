@@ -0,0 +1,243 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SchemaDiff.h"
+#include <QObject>
+#include <QHash>
+#include <QSet>
+
+namespace Util {
+    SchemaDiff::SchemaDiff(const SchemaDefinition &source, const SchemaDefinition &target)
+    {
+        QMap<QString, SchemaTable> sourceTables = source.tables();
+        QMap<QString, SchemaTable> targetTables = target.tables();
+
+        foreach (SchemaTable table, sourceTables) {
+            if (targetTables.contains(table.name)) {
+                this->compareTable(table, targetTables.value(table.name));
+                continue;
+            }
+
+            this->createTables << SchemaDefinition::createTable(table) + ";";
+            foreach (SchemaForeignKey foreignKey, table.foreignKeys) {
+                this->addForeignKeys << QString("ALTER TABLE %1 ADD %2;").arg(SchemaDefinition::quoteIdentifier(table.name)).arg(SchemaDefinition::foreignKeyDefinition(foreignKey));
+            }
+
+            SchemaDifference difference;
+            difference.table = table.name;
+            difference.type = QObject::tr("Missing on the target");
+            this->diffs << difference;
+        }
+
+        // The foreign keys of the other tables referencing a dropped table are not in the source, they are dropped first.
+        // The foreign keys of the dropped tables are also dropped first, two dropped tables can reference each other.
+        foreach (SchemaTable table, targetTables) {
+            if (!sourceTables.contains(table.name)) {
+                foreach (SchemaForeignKey foreignKey, table.foreignKeys) {
+                    this->dropForeignKeys << QString("ALTER TABLE %1 DROP FOREIGN KEY %2;").arg(SchemaDefinition::quoteIdentifier(table.name)).arg(SchemaDefinition::quoteIdentifier(foreignKey.name));
+                }
+                this->dropTables << QString("DROP TABLE %1;").arg(SchemaDefinition::quoteIdentifier(table.name));
+
+                SchemaDifference difference;
+                difference.table = table.name;
+                difference.type = QObject::tr("Only on the target");
+                this->diffs << difference;
+            }
+        }
+    }
+
+    /**
+     * Compares the foreign keys, the indexes, the columns and the options of a table
+     * @brief SchemaDiff::compareTable
+     * @param source the table definition on the source
+     * @param target the table definition on the target
+     */
+    void SchemaDiff::compareTable(const SchemaTable &source, const SchemaTable &target)
+    {
+        QString tableName = SchemaDefinition::quoteIdentifier(source.name);
+        QStringList details;
+        QStringList dropClauses, columnClauses, addClauses, optionClauses;
+
+        // Foreign keys
+        QHash<QString, QString> targetForeignKeys;
+        foreach (SchemaForeignKey foreignKey, target.foreignKeys) {
+            targetForeignKeys.insert(foreignKey.name, SchemaDefinition::foreignKeyDefinition(foreignKey));
+        }
+
+        QSet<QString> sourceForeignKeys;
+        QList<SchemaForeignKey> unchangedForeignKeys;
+        foreach (SchemaForeignKey foreignKey, source.foreignKeys) {
+            QString definition = SchemaDefinition::foreignKeyDefinition(foreignKey);
+            sourceForeignKeys << foreignKey.name;
+            if (targetForeignKeys.contains(foreignKey.name) && targetForeignKeys.value(foreignKey.name) == definition) {
+                targetForeignKeys.remove(foreignKey.name);
+                unchangedForeignKeys << foreignKey;
+                continue;
+            }
+
+            if (targetForeignKeys.contains(foreignKey.name)) {
+                details << QObject::tr("Foreign key %1 is different").arg(foreignKey.name);
+            } else {
+                details << QObject::tr("Foreign key %1 is missing").arg(foreignKey.name);
+            }
+
+            this->addForeignKeys << QString("ALTER TABLE %1 ADD %2;").arg(tableName).arg(definition);
+        }
+
+        foreach (SchemaForeignKey foreignKey, target.foreignKeys) {
+            if (targetForeignKeys.contains(foreignKey.name)) {
+                this->dropForeignKeys << QString("ALTER TABLE %1 DROP FOREIGN KEY %2;").arg(tableName).arg(SchemaDefinition::quoteIdentifier(foreignKey.name));
+                if (!sourceForeignKeys.contains(foreignKey.name)) {
+                    details << QObject::tr("Foreign key %1 only on the target").arg(foreignKey.name);
+                }
+            }
+        }
+
+        // Indexes
+        QHash<QString, QString> sourceIndexes, targetIndexes;
+        foreach (SchemaIndex index, source.indexes) {
+            sourceIndexes.insert(index.name, SchemaDefinition::indexDefinition(index));
+        }
+
+        foreach (SchemaIndex index, target.indexes) {
+            targetIndexes.insert(index.name, SchemaDefinition::indexDefinition(index));
+        }
+
+        QList<QStringList> droppedIndexColumns;
+        foreach (SchemaIndex index, target.indexes) {
+            if (sourceIndexes.value(index.name) != targetIndexes.value(index.name)) {
+                dropClauses << (index.name == "PRIMARY" ? QString("DROP PRIMARY KEY") : "DROP INDEX " + SchemaDefinition::quoteIdentifier(index.name));
+                droppedIndexColumns << index.columns;
+                if (!sourceIndexes.contains(index.name)) {
+                    details << QObject::tr("Index %1 only on the target").arg(index.name);
+                }
+            }
+        }
+
+        // MySQL refuses to drop the index used by a foreign key (error 1553), the unchanged
+        // foreign keys on the columns of a dropped index are dropped first and added again
+        foreach (SchemaForeignKey foreignKey, unchangedForeignKeys) {
+            foreach (QStringList indexColumns, droppedIndexColumns) {
+                if (indexColumns.mid(0, foreignKey.columns.size()) == foreignKey.columns) {
+                    this->dropForeignKeys << QString("ALTER TABLE %1 DROP FOREIGN KEY %2;").arg(tableName).arg(SchemaDefinition::quoteIdentifier(foreignKey.name));
+                    this->addForeignKeys << QString("ALTER TABLE %1 ADD %2;").arg(tableName).arg(SchemaDefinition::foreignKeyDefinition(foreignKey));
+                    break;
+                }
+            }
+        }
+
+        foreach (SchemaIndex index, source.indexes) {
+            if (sourceIndexes.value(index.name) != targetIndexes.value(index.name)) {
+                addClauses << "ADD " + sourceIndexes.value(index.name);
+                details << (targetIndexes.contains(index.name) ? QObject::tr("Index %1 is different") : QObject::tr("Index %1 is missing")).arg(index.name);
+            }
+        }
+
+        // Columns, the new and modified columns are put at the same position as on the source
+        QHash<QString, QString> targetColumns;
+        foreach (SchemaColumn column, target.columns) {
+            targetColumns.insert(column.name, SchemaDefinition::columnDefinition(column));
+        }
+
+        // Order of the columns which exist on both sides
+        QSet<QString> sourceColumns;
+        QStringList sourceOrder, targetOrder;
+        foreach (SchemaColumn column, source.columns) {
+            sourceColumns << column.name;
+            if (targetColumns.contains(column.name)) {
+                sourceOrder << column.name;
+            }
+        }
+
+        foreach (SchemaColumn column, target.columns) {
+            if (sourceColumns.contains(column.name)) {
+                targetOrder << column.name;
+            }
+        }
+
+        QString position = "FIRST";
+        foreach (SchemaColumn column, source.columns) {
+            QString definition = SchemaDefinition::columnDefinition(column);
+
+            if (!targetColumns.contains(column.name)) {
+                columnClauses << "ADD COLUMN " + definition + " " + position;
+                details << QObject::tr("Column %1 is missing").arg(column.name);
+            } else if (targetColumns.value(column.name) != definition) {
+                columnClauses << "MODIFY COLUMN " + definition + " " + position;
+                details << QObject::tr("Column %1 is different: %2").arg(column.name).arg(targetColumns.value(column.name));
+            } else if (sourceOrder.indexOf(column.name) != targetOrder.indexOf(column.name)) {
+                columnClauses << "MODIFY COLUMN " + definition + " " + position;
+                details << QObject::tr("Column %1 is at a different position").arg(column.name);
+            }
+
+            position = "AFTER " + SchemaDefinition::quoteIdentifier(column.name);
+        }
+
+        foreach (SchemaColumn column, target.columns) {
+            if (!sourceColumns.contains(column.name)) {
+                columnClauses << "DROP COLUMN " + SchemaDefinition::quoteIdentifier(column.name);
+                details << QObject::tr("Column %1 only on the target").arg(column.name);
+            }
+        }
+
+        // Table options
+        if (source.engine != target.engine && !source.engine.isEmpty()) {
+            optionClauses << "ENGINE=" + source.engine;
+            details << QObject::tr("Engine %1 instead of %2").arg(target.engine).arg(source.engine);
+        }
+
+        if (source.collation != target.collation && !source.collation.isEmpty()) {
+            optionClauses << "COLLATE=" + source.collation;
+            details << QObject::tr("Collation %1 instead of %2").arg(target.collation).arg(source.collation);
+        }
+
+        if (source.comment != target.comment) {
+            optionClauses << "COMMENT=" + SchemaDefinition::quoteString(source.comment);
+            details << QObject::tr("Comment is different");
+        }
+
+        QStringList clauses = dropClauses + columnClauses + addClauses + optionClauses;
+        if (!clauses.isEmpty()) {
+            this->alterTables << QString("ALTER TABLE %1\n  %2;").arg(tableName).arg(clauses.join(",\n  "));
+        }
+
+        if (!details.isEmpty()) {
+            SchemaDifference difference;
+            difference.table = source.name;
+            difference.type = QObject::tr("Different");
+            difference.details = details.join("\n");
+            this->diffs << difference;
+        }
+    }
+
+    /**
+     * @brief SchemaDiff::differences
+     * @return the list of tables which differ with a description of the differences
+     */
+    QList<SchemaDifference> SchemaDiff::differences() const
+    {
+        return this->diffs;
+    }
+
+    /**
+     * @brief SchemaDiff::statements
+     * @return the ordered statements which make the target identical to the source
+     */
+    QStringList SchemaDiff::statements() const
+    {
+        return this->dropForeignKeys + this->createTables + this->alterTables + this->dropTables + this->addForeignKeys;
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SCHEMADIFF_H
+#define SCHEMADIFF_H
+
+#include "SchemaDefinition.h"
+#include <QStringList>
+#include <QList>
+
+struct SchemaDifference {
+    QString table;
+    QString type;
+    QString details;
+};
+
+namespace Util {
+    /**
+     * Compares two schema definitions and generates the script which makes the target schema
+     * identical to the source schema.
+     *
+     * The statements are ordered so the script can be executed with the foreign key checks enabled:
+     * the foreign keys to change are dropped first, then the tables are created, altered and dropped,
+     * and the foreign keys are added when all the tables exist. Each table is changed with a single
+     * ALTER TABLE statement so it is rebuilt at most once.
+     */
+    class SchemaDiff
+    {
+    public:
+        SchemaDiff(const SchemaDefinition &source, const SchemaDefinition &target);
+        QList<SchemaDifference> differences() const;
+        QStringList statements() const;
+
+    private:
+        QList<SchemaDifference> diffs;
+        QStringList dropForeignKeys;
+        QStringList createTables;
+        QStringList alterTables;
+        QStringList dropTables;
+        QStringList addForeignKeys;
+
+        void compareTable(const SchemaTable &source, const SchemaTable &target);
+    };
+}
+
+#endif // SCHEMADIFF_H
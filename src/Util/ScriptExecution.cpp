@@ -0,0 +1,256 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "ScriptExecution.h"
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include "SqlSplitter.h"
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <QTextStream>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QScopedPointer>
+#include <QDebug>
+
+// Bytes of the script read at once
+#define CHUNK_SIZE (1024 * 1024)
+// Characters of the current statement kept for the progress
+#define STATEMENT_PREVIEW_SIZE 2000
+
+namespace Util {
+
+    ScriptExecution::ScriptExecution(ConnectionConfiguration conf, QString filename):
+        configuration(conf),
+        filename(filename)
+    {
+        this->errorPolicy = STOP;
+        this->commitInterval = 0;
+        this->stop = false;
+
+        this->status.bytesRead = 0;
+        this->status.totalBytes = 0;
+        this->status.statements = 0;
+        this->status.committedStatements = 0;
+        this->status.errors = 0;
+    }
+
+    /**
+     * @brief ScriptExecution::setErrorPolicy
+     * @param policy what to do when a statement fails
+     */
+    void ScriptExecution::setErrorPolicy(ErrorPolicy policy)
+    {
+        this->errorPolicy = policy;
+    }
+
+    /**
+     * @brief ScriptExecution::setLogFile
+     * @param logFilename the file which receives the failing statements with the LOG policy
+     */
+    void ScriptExecution::setLogFile(QString logFilename)
+    {
+        this->logFilename = logFilename;
+    }
+
+    /**
+     * @brief ScriptExecution::setCommitInterval
+     * @param statements the number of statements of each transaction, 0 to keep the autocommit
+     */
+    void ScriptExecution::setCommitInterval(int statements)
+    {
+        this->commitInterval = qMax(0, statements);
+    }
+
+    /**
+     * Opens the script and the log file and executes the script on a connection of the pool
+     * @brief ScriptExecution::execute
+     */
+    void ScriptExecution::execute()
+    {
+        QFile script(this->filename);
+        QScopedPointer<QFile> log;
+
+        QString error;
+        if (!script.open(QIODevice::ReadOnly)) {
+            error = script.errorString();
+        } else if (this->errorPolicy == LOG) {
+            log.reset(new QFile(this->logFilename));
+            if (!log->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+                error = log->errorString();
+            }
+        }
+
+        if (error.isEmpty()) {
+            this->statusMutex.lock();
+            this->status.totalBytes = script.size();
+            this->statusMutex.unlock();
+
+            // The session (autocommit, variables set by the script) is reset when the connection goes back to the pool
+            PooledConnection connection(this->configuration, true);
+            QSqlDatabase database = connection.database();
+            if (!database.isOpen()) {
+                error = database.lastError().text();
+            } else if (!this->executeScript(database, &script, log.data())) {
+                // The connection may be in the middle of a transaction
+                connection.discard();
+            }
+        }
+
+        if (!error.isEmpty()) {
+            qDebug() << "ScriptExecution::execute - " + error;
+            QMutexLocker locker(&this->statusMutex);
+            this->status.lastError = error;
+            this->status.errors++;
+        }
+
+        emit executionFinished(this->stop);
+    }
+
+    /**
+     * Reads the script by chunks and executes each statement when its delimiter is read
+     * @return false if the execution has been interrupted (error or stop)
+     */
+    bool ScriptExecution::executeScript(QSqlDatabase database, QFile *script, QFile *log)
+    {
+        QString error;
+        if (this->commitInterval > 0 && !this->executeStatement(database, "SET autocommit = 0", error)) {
+            QMutexLocker locker(&this->statusMutex);
+            this->status.lastError = error;
+            this->status.errors++;
+            return false;
+        }
+
+        // The multi-bytes characters can be split between two chunks
+        QScopedPointer<QTextDecoder> decoder(QTextCodec::codecForName("UTF-8")->makeDecoder());
+        SqlSplitter splitter;
+        qint64 executed = 0;
+        qint64 uncommitted = 0;
+        bool endOfFile = false;
+
+        while (!this->stop) {
+            if (!splitter.hasStatement()) {
+                if (endOfFile) {
+                    break;
+                }
+
+                QByteArray chunk = script->read(CHUNK_SIZE);
+                if (chunk.isEmpty()) {
+                    splitter.finish();
+                    endOfFile = true;
+                } else {
+                    splitter.append(decoder->toUnicode(chunk));
+                }
+
+                QMutexLocker locker(&this->statusMutex);
+                this->status.bytesRead = script->pos();
+                continue;
+            }
+
+            QString statement = splitter.takeStatement();
+
+            this->statusMutex.lock();
+            this->status.currentStatement = statement.left(STATEMENT_PREVIEW_SIZE);
+            this->statusMutex.unlock();
+
+            bool success = this->executeStatement(database, statement, error);
+            executed++;
+
+            if (!success) {
+                QMutexLocker locker(&this->statusMutex);
+                this->status.lastError = QString("Statement %1: %2").arg(executed).arg(error);
+                this->status.errors++;
+                this->status.statements = executed;
+
+                if (this->errorPolicy == STOP) {
+                    break;
+                } else if (this->errorPolicy == LOG && log != nullptr) {
+                    QTextStream stream(log);
+                    stream.setCodec("UTF-8");
+                    stream << "-- Statement " << executed << ": " << error.replace("\n", " ") << "\n";
+                    stream << statement << "\n" << splitter.getDelimiter() << "\n\n";
+                }
+                continue;
+            }
+
+            uncommitted++;
+            if (this->commitInterval > 0 && uncommitted >= this->commitInterval) {
+                if (!this->executeStatement(database, "COMMIT", error)) {
+                    QMutexLocker locker(&this->statusMutex);
+                    this->status.lastError = error;
+                    this->status.errors++;
+                    return false;
+                }
+                uncommitted = 0;
+            }
+
+            QMutexLocker locker(&this->statusMutex);
+            this->status.statements = executed;
+            if (this->commitInterval == 0 || uncommitted == 0) {
+                this->status.committedStatements = executed;
+            }
+        }
+
+        bool completed = !this->stop && !splitter.hasStatement() && endOfFile;
+        if (this->commitInterval > 0) {
+            // The statements of an interrupted transaction are rolled back
+            this->executeStatement(database, completed ? "COMMIT" : "ROLLBACK", error);
+            if (completed) {
+                QMutexLocker locker(&this->statusMutex);
+                this->status.committedStatements = executed;
+            }
+        }
+
+        return completed;
+    }
+
+    /**
+     * Executes a statement and skips its results (e.g. the SELECT of the script)
+     * @return false on error
+     */
+    bool ScriptExecution::executeStatement(QSqlDatabase database, QString statement, QString &error)
+    {
+        MySQLCursor cursor(database);
+        if (!cursor.exec(statement)) {
+            error = cursor.lastError();
+            return false;
+        }
+
+        do {
+            while (cursor.next()) {
+            }
+        } while (cursor.lastError().isEmpty() && cursor.nextResult());
+
+        error = cursor.lastError();
+
+        return error.isEmpty();
+    }
+
+    ScriptExecutionStatus ScriptExecution::getStatus()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        return this->status;
+    }
+
+    /**
+     * Stops after the current statement, the uncommitted statements are rolled back
+     * @brief ScriptExecution::stopRequired
+     */
+    void ScriptExecution::stopRequired()
+    {
+        this->stop = true;
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SCRIPTEXECUTION_H
+#define SCRIPTEXECUTION_H
+
+#include "DataBase.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QFile>
+
+struct ScriptExecutionStatus {
+    qint64 bytesRead;
+    qint64 totalBytes;
+    qint64 statements;
+    qint64 committedStatements;
+    qint64 errors;
+    QString currentStatement;
+    QString lastError;
+};
+
+namespace Util {
+    /**
+     * Executes a SQL script file without loading it in memory.
+     *
+     * The file is read by chunks and split in statements (see SqlSplitter), each statement is
+     * executed on a connection of the pool as soon as it is read. With a commit interval, the
+     * statements are executed in transactions of N statements.
+     */
+    class ScriptExecution : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+
+        enum ErrorPolicy {
+            STOP,   // stops at the first error
+            SKIP,   // ignores the failing statements
+            LOG     // writes the failing statements and their error in the log file
+        };
+
+        ScriptExecution(ConnectionConfiguration conf, QString filename);
+        void setErrorPolicy(ErrorPolicy policy);
+        void setLogFile(QString logFilename);
+        void setCommitInterval(int statements);
+
+        ScriptExecutionStatus getStatus();
+        void stopRequired();
+
+    public slots:
+        void execute();
+
+    signals:
+        void executionFinished(bool stopped);
+
+    private:
+        ConnectionConfiguration configuration;
+        QString filename;
+        QString logFilename;
+        ErrorPolicy errorPolicy;
+        int commitInterval;
+        volatile bool stop;
+
+        QMutex statusMutex;
+        ScriptExecutionStatus status;
+
+        bool executeStatement(QSqlDatabase database, QString statement, QString &error);
+        bool executeScript(QSqlDatabase database, QFile *script, QFile *log);
+    };
+}
+
+#endif // SCRIPTEXECUTION_H
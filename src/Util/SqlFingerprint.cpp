@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SqlFingerprint.h"
+#include <QCryptographicHash>
+#include <QRegExp>
+
+namespace Util {
+
+    /**
+     * @brief SqlFingerprint::normalize
+     * @param query a statement
+     * @return the fingerprint of the statement
+     */
+    QString SqlFingerprint::normalize(QString query)
+    {
+        QString result = scan(query, false);
+
+        // The lists of values have any size: IN (?, ?, ?) and VALUES (?, ?), (?, ?)
+        result.replace(QRegExp("\\(\\s*\\?(\\s*,\\s*\\?)*\\s*\\)"), "(?+)");
+        result.replace(QRegExp("\\(\\?\\+\\)(\\s*,\\s*\\(\\?\\+\\))+"), "(?+)");
+
+        return result;
+    }
+
+    /**
+     * @brief SqlFingerprint::canonical
+     * @param query a statement
+     * @return the statement without its comments and with the spaces collapsed, the literals and the case are kept
+     */
+    QString SqlFingerprint::canonical(QString query)
+    {
+        return scan(query, true);
+    }
+
+    /**
+     * Reads the tokens of a statement, the comments are removed and the spaces collapsed
+     * @brief SqlFingerprint::scan
+     * @param keepLiterals keeps the literals and the case of the keywords, instead of ? and lower case
+     */
+    QString SqlFingerprint::scan(QString query, bool keepLiterals)
+    {
+        QString result;
+        result.reserve(query.size());
+
+        int i = 0;
+        int size = query.size();
+        bool space = false;
+
+        while (i < size) {
+            QChar c = query.at(i);
+
+            if (c.isSpace()) {
+                space = true;
+                i++;
+                continue;
+            }
+
+            // Comments
+            int end = commentEnd(query, i);
+            if (end != -1) {
+                i = end;
+                space = true;
+                continue;
+            }
+
+            if (space && !result.isEmpty()) {
+                result += ' ';
+            }
+            space = false;
+
+            end = quotedEnd(query, i);
+            if (end != -1) {
+                // The identifiers are kept as they are, the strings are literals
+                result += keepLiterals || c == '`' ? query.mid(i, end - i) : QString("?");
+                i = end;
+            } else if (c.isDigit() && (result.isEmpty() || !(result.at(result.size() - 1).isLetterOrNumber() || result.at(result.size() - 1) == '_' || result.at(result.size() - 1) == '$'))) {
+                // Number: 12, 1.5, 1e10, 0x1F
+                int start = i;
+                i++;
+                while (i < size && (query.at(i).isLetterOrNumber() || query.at(i) == '.'
+                                    || ((query.at(i) == '+' || query.at(i) == '-') && query.at(i - 1).toLower() == 'e'))) {
+                    i++;
+                }
+                result += keepLiterals ? query.mid(start, i - start) : QString("?");
+            } else {
+                result += keepLiterals ? c : c.toLower();
+                i++;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief SqlFingerprint::commentEnd
+     * @param query a statement
+     * @param i a position in the code of the statement
+     * @return the position after the comment starting at i, -1 if no comment starts at i
+     */
+    int SqlFingerprint::commentEnd(const QString &query, int i)
+    {
+        int size = query.size();
+        QChar c = query.at(i);
+        QChar next = i + 1 < size ? query.at(i + 1) : QChar();
+
+        if (c == '#' || (c == '-' && next == '-' && (i + 2 >= size || query.at(i + 2).isSpace()))) {
+            int end = query.indexOf('\n', i);
+            return end == -1 ? size : end;
+        } else if (c == '/' && next == '*') {
+            int end = query.indexOf("*/", i + 2);
+            return end == -1 ? size : end + 2;
+        }
+
+        return -1;
+    }
+
+    /**
+     * Reads a string literal, with the escaped and doubled quotes, or a quoted identifier
+     * @brief SqlFingerprint::quotedEnd
+     * @param query a statement
+     * @param i a position in the code of the statement
+     * @return the position after the quoted text starting at i, -1 if no quote starts at i
+     */
+    int SqlFingerprint::quotedEnd(const QString &query, int i)
+    {
+        int size = query.size();
+        QChar c = query.at(i);
+
+        if (c == '`') {
+            int end = query.indexOf('`', i + 1);
+            return end == -1 ? size : end + 1;
+        } else if (c != '\'' && c != '"') {
+            return -1;
+        }
+
+        i++;
+        while (i < size) {
+            if (query.at(i) == '\\') {
+                i += 2;
+            } else if (query.at(i) == c && i + 1 < size && query.at(i + 1) == c) {
+                i += 2;
+            } else if (query.at(i) == c) {
+                return i + 1;
+            } else {
+                i++;
+            }
+        }
+
+        return size;
+    }
+
+    /**
+     * @brief SqlFingerprint::hash
+     * @return a short key of the fingerprint
+     */
+    QString SqlFingerprint::hash(QString fingerprint)
+    {
+        return QString::fromLatin1(QCryptographicHash::hash(fingerprint.toUtf8(), QCryptographicHash::Md5).toHex());
+    }
+}
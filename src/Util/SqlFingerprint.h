@@ -0,0 +1,44 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SQLFINGERPRINT_H
+#define SQLFINGERPRINT_H
+
+#include <QString>
+
+namespace Util {
+    /**
+     * Normalizes a statement to group the executions of the same query with different values:
+     * the literals are replaced by ?, the lists of values by (?+), the comments are removed,
+     * the spaces are collapsed and the keywords are in lower case, e.g.
+     * SELECT * FROM t WHERE id IN (1, 2, 3) AND name = 'x'
+     * gives select * from t where id in (?+) and name = ?
+     */
+    class SqlFingerprint
+    {
+    public:
+        static QString normalize(QString query);
+        static QString canonical(QString query);
+        static QString hash(QString fingerprint);
+        static int commentEnd(const QString &query, int i);
+        static int quotedEnd(const QString &query, int i);
+
+    private:
+        static QString scan(QString query, bool keepLiterals);
+    };
+}
+
+#endif // SQLFINGERPRINT_H
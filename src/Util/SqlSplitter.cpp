@@ -0,0 +1,276 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "SqlSplitter.h"
+#include <QRegExp>
+
+#define DELIMITER_COMMAND "DELIMITER"
+
+namespace Util {
+
+    SqlSplitter::SqlSplitter()
+    {
+        this->delimiter = ";";
+        this->state = Code;
+        this->start = 0;
+        this->position = 0;
+        this->escaped = false;
+        this->hasCode = false;
+        this->finished = false;
+    }
+
+    /**
+     * Adds the next part of the script
+     * @brief SqlSplitter::append
+     * @param text the text which follows the previous part
+     */
+    void SqlSplitter::append(QString text)
+    {
+        // The text of the statements already read is removed once for each part
+        if (this->start > 0) {
+            this->buffer.remove(0, this->start);
+            this->position -= this->start;
+            this->start = 0;
+        }
+
+        this->buffer += text;
+        this->scan();
+    }
+
+    /**
+     * The end of the script is reached, the last statement does not need a delimiter
+     * @brief SqlSplitter::finish
+     */
+    void SqlSplitter::finish()
+    {
+        this->finished = true;
+        this->scan();
+        this->endStatement(this->buffer.size(), 0);
+        this->buffer.clear();
+        this->start = 0;
+        this->position = 0;
+    }
+
+    bool SqlSplitter::hasStatement() const
+    {
+        return !this->statements.isEmpty();
+    }
+
+    /**
+     * @brief SqlSplitter::takeStatement
+     * @return the next complete statement, without its delimiter
+     */
+    QString SqlSplitter::takeStatement()
+    {
+        return this->statements.isEmpty() ? QString() : this->statements.takeFirst();
+    }
+
+    /**
+     * @brief SqlSplitter::getDelimiter
+     * @return the current delimiter
+     */
+    QString SqlSplitter::getDelimiter() const
+    {
+        return this->delimiter;
+    }
+
+    /**
+     * @brief SqlSplitter::split
+     * @param sql the script
+     * @return the statements of the script, the statements with only comments are ignored
+     */
+    QStringList SqlSplitter::split(QString sql)
+    {
+        SqlSplitter splitter;
+        splitter.append(sql);
+        splitter.finish();
+
+        QStringList statements;
+        while (splitter.hasStatement()) {
+            statements << splitter.takeStatement();
+        }
+
+        return statements;
+    }
+
+    /**
+     * Reads the buffer from the last position, stops before a text which depends on the next
+     * characters (delimiter, comments, DELIMITER line) when the end of the script is not reached
+     */
+    void SqlSplitter::scan()
+    {
+        int i = this->position;
+
+        while (i < this->buffer.size()) {
+            QChar c = this->buffer.at(i);
+            bool last = i + 1 >= this->buffer.size();
+
+            switch (this->state) {
+            case Code:
+                if (!this->hasCode && (c == 'D' || c == 'd')) {
+                    int next = this->readDelimiterCommand(i);
+                    if (next == -1) {
+                        this->position = i;
+                        return;
+                    } else if (next != i) {
+                        i = next;
+                        continue;
+                    }
+                }
+
+                if (c == this->delimiter.at(0)) {
+                    if (i + this->delimiter.size() > this->buffer.size() && !this->finished) {
+                        this->position = i;
+                        return;
+                    }
+
+                    if (this->buffer.mid(i, this->delimiter.size()) == this->delimiter) {
+                        this->endStatement(i, this->delimiter.size());
+                        i = this->start;
+                        continue;
+                    }
+                }
+
+                if (c == '\'') {
+                    this->state = SingleQuote;
+                } else if (c == '"') {
+                    this->state = DoubleQuote;
+                } else if (c == '`') {
+                    this->state = Backtick;
+                } else if (c == '#') {
+                    this->state = LineComment;
+                } else if (c == '-' || c == '/') {
+                    // "-- " starts a comment only when it is followed by a space,
+                    // "/*!" and "/*+" start a comment executed by the server
+                    int needed = 2;
+                    if (i + needed >= this->buffer.size() && !this->finished) {
+                        this->position = i;
+                        return;
+                    }
+
+                    if (c == '-' && this->buffer.mid(i, 2) == "--" && (i + 2 >= this->buffer.size() || this->buffer.at(i + 2).isSpace())) {
+                        this->state = LineComment;
+                        i++;
+                    } else if (c == '/' && !last && this->buffer.at(i + 1) == '*') {
+                        this->state = BlockComment;
+                        if (i + 2 < this->buffer.size() && (this->buffer.at(i + 2) == '!' || this->buffer.at(i + 2) == '+')) {
+                            this->hasCode = true;
+                        }
+                        i++;
+                    } else {
+                        this->hasCode = true;
+                    }
+                } else if (!c.isSpace()) {
+                    this->hasCode = true;
+                }
+
+                if (this->state == SingleQuote || this->state == DoubleQuote || this->state == Backtick) {
+                    this->hasCode = true;
+                }
+                break;
+
+            case SingleQuote:
+            case DoubleQuote:
+            case Backtick:
+                if (this->escaped) {
+                    this->escaped = false;
+                } else if (c == '\\' && this->state != Backtick) {
+                    this->escaped = true;
+                } else if ((c == '\'' && this->state == SingleQuote) || (c == '"' && this->state == DoubleQuote) || (c == '`' && this->state == Backtick)) {
+                    this->state = Code;
+                }
+                break;
+
+            case LineComment:
+                if (c == '\n') {
+                    this->state = Code;
+                }
+                break;
+
+            case BlockComment:
+                if (c == '*') {
+                    if (last && !this->finished) {
+                        this->position = i;
+                        return;
+                    }
+
+                    if (!last && this->buffer.at(i + 1) == '/') {
+                        this->state = Code;
+                        i++;
+                    }
+                }
+                break;
+            }
+
+            i++;
+        }
+
+        this->position = i;
+    }
+
+    /**
+     * Reads a DELIMITER line at the beginning of a statement, the line is not a statement
+     * @param i the position of the first character of the statement
+     * @return the position after the line, i if it is not a DELIMITER line, -1 if more text is needed
+     */
+    int SqlSplitter::readDelimiterCommand(int i)
+    {
+        QString command(DELIMITER_COMMAND);
+        if (i + command.size() >= this->buffer.size() && !this->finished) {
+            return -1;
+        }
+
+        if (this->buffer.mid(i, command.size()).compare(command, Qt::CaseInsensitive) != 0
+                || i + command.size() >= this->buffer.size()
+                || !this->buffer.at(i + command.size()).isSpace()) {
+            return i;
+        }
+
+        int end = this->buffer.indexOf('\n', i);
+        if (end == -1 && !this->finished) {
+            return -1;
+        } else if (end == -1) {
+            end = this->buffer.size();
+        }
+
+        QString newDelimiter = this->buffer.mid(i + command.size(), end - i - command.size()).trimmed();
+        if (!newDelimiter.isEmpty()) {
+            this->delimiter = newDelimiter.split(QRegExp("\\s+")).first();
+        }
+
+        // The comments before the command are dropped with it
+        this->start = qMin(end + 1, this->buffer.size());
+        this->hasCode = false;
+
+        return this->start;
+    }
+
+    /**
+     * Keeps the text before the delimiter as a statement
+     * @param end the position of the delimiter
+     * @param delimiterLength the length of the delimiter
+     */
+    void SqlSplitter::endStatement(int end, int delimiterLength)
+    {
+        QString statement = this->buffer.mid(this->start, end - this->start).trimmed();
+        if (this->hasCode && !statement.isEmpty()) {
+            this->statements << statement;
+        }
+
+        this->start = end + delimiterLength;
+        this->hasCode = false;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef SQLSPLITTER_H
+#define SQLSPLITTER_H
+
+#include <QString>
+#include <QStringList>
+
+namespace Util {
+    /**
+     * Splits a SQL script in statements on the delimiters which are not in a string, a quoted
+     * identifier or a comment. As in the mysql client, the delimiter (; by default) is changed
+     * by a DELIMITER line, e.g. to define procedures and triggers. A text with only comments is
+     * not a statement, except the comments executed by the server (starting with /*! or /*+).
+     *
+     * The script can be given in several parts: a statement is available as soon as its
+     * delimiter is read, the text after the last delimiter is kept for the next part.
+     */
+    class SqlSplitter
+    {
+    public:
+        SqlSplitter();
+
+        void append(QString text);
+        void finish();
+        bool hasStatement() const;
+        QString takeStatement();
+        QString getDelimiter() const;
+
+        static QStringList split(QString sql);
+
+    private:
+        enum State {
+            Code,
+            SingleQuote,
+            DoubleQuote,
+            Backtick,
+            LineComment,
+            BlockComment
+        };
+
+        QString buffer;
+        QStringList statements;
+        QString delimiter;
+        State state;
+        int start;
+        int position;
+        bool escaped;
+        bool hasCode;
+        bool finished;
+
+        void scan();
+        int readDelimiterCommand(int i);
+        void endStatement(int end, int delimiterLength);
+    };
+}
+
+#endif // SQLSPLITTER_H
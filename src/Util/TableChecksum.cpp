@@ -0,0 +1,551 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "TableChecksum.h"
+#include "TableDefinition.h"
+#include "MySQLCursor.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSemaphore>
+#include <QMutexLocker>
+#include <QHash>
+#include <QPair>
+#include <QDebug>
+
+// Below this number of rows, a mismatching chunk is compared row by row
+#define ROW_COMPARISON_THRESHOLD 100
+
+namespace Util {
+
+    /**
+     * Executes a checksum query, the query returns the row count and the checksum
+     * @return the error message, empty on success
+     */
+    static QString readChunkChecksum(QSqlDatabase db, QString sql, qint64 &rows, quint64 &checksum)
+    {
+        QSqlQuery query(db);
+        if (!query.exec(sql)) {
+            return query.lastError().text();
+        }
+
+        rows = 0;
+        checksum = 0;
+        if (query.next()) {
+            rows = query.value(0).toLongLong();
+            checksum = query.value(1).toULongLong();
+        }
+
+        return QString();
+    }
+
+    /**
+     * Executes a query returning the key columns followed by the checksum of each row, the keys
+     * are read as sent by the server (DECIMAL, fractional seconds)
+     * @return the error message, empty on success
+     */
+    static QString readRowChecksums(QSqlDatabase db, QString sql, QStringList keyNames, QList<QPair<QString, quint64> > &rows)
+    {
+        MySQLCursor cursor(db);
+        if (!cursor.exec(sql)) {
+            return cursor.lastError();
+        }
+
+        while (cursor.next()) {
+            QStringList key;
+            for (int i = 0; i < keyNames.size(); i++) {
+                key << keyNames.at(i) + "=" + (cursor.isNull(i) ? QString("NULL") : QString::fromUtf8(cursor.rawValue(i), cursor.valueLength(i)));
+            }
+
+            rows << qMakePair(key.join(", "), cursor.value(keyNames.size()).toULongLong());
+        }
+
+        return cursor.lastError();
+    }
+
+    TableChecksum::TableChecksum(ConnectionConfiguration source, ConnectionConfiguration target):
+        source(source),
+        target(target)
+    {
+        this->sourceWorker = nullptr;
+        this->targetWorker = nullptr;
+        this->chunkSize = 10000;
+        this->maxDifferences = 1000;
+        this->stop = false;
+    }
+
+    /**
+     * @brief TableChecksum::setTables
+     * @param tableList the list of tables to compare
+     */
+    void TableChecksum::setTables(QStringList tableList)
+    {
+        this->tables = tableList;
+    }
+
+    /**
+     * @brief TableChecksum::setChunkSize
+     * @param rows the number of rows of each chunk
+     */
+    void TableChecksum::setChunkSize(int rows)
+    {
+        this->chunkSize = qMax(ROW_COMPARISON_THRESHOLD, rows);
+    }
+
+    /**
+     * @brief TableChecksum::setMaxDifferences
+     * @param differences the comparison of a table stops when this number of rows differ
+     */
+    void TableChecksum::setMaxDifferences(int differences)
+    {
+        this->maxDifferences = qMax(1, differences);
+    }
+
+    /**
+     * Compares the tables one after the other, returns when all the tables are compared
+     * @brief TableChecksum::compare
+     */
+    void TableChecksum::compare()
+    {
+        this->statusMutex.lock();
+        this->status.clear();
+        this->differences.clear();
+        foreach (QString table, this->tables) {
+            TableChecksumStatus tableStatus;
+            tableStatus.table = table;
+            tableStatus.chunks = 0;
+            tableStatus.rows = 0;
+            tableStatus.differences = 0;
+            tableStatus.finished = false;
+            this->status << tableStatus;
+        }
+        this->statusMutex.unlock();
+
+        // Each side has its own thread so the checksums of a chunk are computed at the same time
+        this->sourceWorker = new ConnectionWorker(this->source);
+        this->targetWorker = new ConnectionWorker(this->target);
+        this->sourceWorker->start();
+        this->targetWorker->start();
+
+        foreach (QString table, this->tables) {
+            this->table = table;
+            if (this->stop) {
+                this->updateStatus(true, tr("Cancelled"));
+                continue;
+            }
+
+            this->compareTable();
+        }
+
+        delete this->sourceWorker;
+        delete this->targetWorker;
+        this->sourceWorker = nullptr;
+        this->targetWorker = nullptr;
+
+        emit compareFinished(this->stop);
+    }
+
+    /**
+     * Reads the definition of the table on both sides then compares the chunks in the primary key order
+     * @brief TableChecksum::compareTable
+     */
+    void TableChecksum::compareTable()
+    {
+        QList<ColumnDefinition> sourceColumns, targetColumns;
+        QStringList primaryKey;
+        QString table = this->table;
+
+        this->runOnBothSides([&](QSqlDatabase db) {
+            TableDefinition definition(db, table);
+            sourceColumns = definition.columns();
+            primaryKey = definition.primaryKey();
+        }, [&](QSqlDatabase db) {
+            targetColumns = TableDefinition(db, table).columns();
+        });
+
+        if (sourceColumns.isEmpty()) {
+            this->updateStatus(true, tr("Unable to read the table definition"));
+            return;
+        }
+
+        if (targetColumns.isEmpty()) {
+            this->updateStatus(true, tr("The table does not exist on the target"));
+            return;
+        }
+
+        this->columns.clear();
+        QStringList targetNames;
+        QStringList nullFlags;
+        foreach (ColumnDefinition column, sourceColumns) {
+            this->columns << "`" + column.name + "`";
+            nullFlags << "ISNULL(`" + column.name + "`)";
+        }
+
+        foreach (ColumnDefinition column, targetColumns) {
+            targetNames << "`" + column.name + "`";
+        }
+
+        if (targetNames != this->columns) {
+            this->updateStatus(true, tr("The columns are different on the target"));
+            return;
+        }
+
+        this->keyNames.clear();
+        this->key.clear();
+        foreach (QString column, primaryKey) {
+            this->keyNames << column.trimmed();
+            this->key << "`" + column.trimmed() + "`";
+        }
+
+        // CONCAT_WS skips the NULL values, the flags make the difference between NULL and an empty string
+        this->rowChecksum = QString("CRC32(CONCAT_WS('#', %1, CONCAT(%2)))").arg(this->columns.join(", ")).arg(nullFlags.join(", "));
+
+        if (this->key.isEmpty()) {
+            // Without primary key, the table is compared as a single chunk
+            if (this->compareRange(KeyRange(), 0)) {
+                this->updateStatus(true);
+            }
+            return;
+        }
+
+        KeyRange range;
+        while (!this->stop) {
+            // The chunk boundaries come from the source, the last chunk is not bounded
+            // to include the rows which only exist on the target
+            QString error;
+            KeyRange next;
+            next.lower = range.lower;
+            range.upper = this->findBoundary(this->sourceWorker, next, this->chunkSize - 1, error);
+            if (!error.isEmpty()) {
+                this->updateStatus(true, tr("Source: ") + error);
+                return;
+            }
+
+            if (!this->compareRange(range, 0)) {
+                return;
+            }
+
+            if (this->tableDifferences() >= this->maxDifferences) {
+                this->updateStatus(true, tr("Stopped after %1 differences").arg(this->maxDifferences));
+                return;
+            }
+
+            if (range.upper.isEmpty()) {
+                break;
+            }
+
+            range.lower = range.upper;
+            range.upper.clear();
+        }
+
+        this->updateStatus(true, this->stop ? tr("Cancelled") : QString());
+    }
+
+    /**
+     * Compares the checksums of a key range, a mismatching range is split in two halves
+     * until it contains few enough rows to be compared row by row.
+     *
+     * @brief TableChecksum::compareRange
+     * @param range the key range
+     * @param depth 0 for the chunks of the table, incremented for each split
+     * @return false on error
+     */
+    bool TableChecksum::compareRange(KeyRange range, int depth)
+    {
+        if (this->stop || this->tableDifferences() >= this->maxDifferences) {
+            return true;
+        }
+
+        QString sql = QString("SELECT COUNT(*), BIT_XOR(%1) FROM `%2`%3").arg(this->rowChecksum).arg(this->table).arg(this->rangeCondition(range));
+        qint64 sourceRows = 0, targetRows = 0;
+        quint64 sourceChecksum = 0, targetChecksum = 0;
+        QString sourceError, targetError;
+
+        this->runOnBothSides([&](QSqlDatabase db) {
+            sourceError = readChunkChecksum(db, sql, sourceRows, sourceChecksum);
+        }, [&](QSqlDatabase db) {
+            targetError = readChunkChecksum(db, sql, targetRows, targetChecksum);
+        });
+
+        if (!sourceError.isEmpty() || !targetError.isEmpty()) {
+            qDebug() << "TableChecksum::compareRange - " + sourceError + targetError;
+            this->updateStatus(true, sourceError.isEmpty() ? tr("Target: ") + targetError : tr("Source: ") + sourceError);
+            return false;
+        }
+
+        if (depth == 0) {
+            this->addChunk(sourceRows);
+        }
+
+        if (sourceRows == targetRows && sourceChecksum == targetChecksum) {
+            return true;
+        }
+
+        if (this->key.isEmpty()) {
+            this->addDifference("", tr("The table has no primary key, the rows cannot be located (%1 rows on the source, %2 rows on the target)").arg(sourceRows).arg(targetRows));
+            return true;
+        }
+
+        qint64 rows = qMax(sourceRows, targetRows);
+        if (rows <= ROW_COMPARISON_THRESHOLD) {
+            return this->listDifferences(range);
+        }
+
+        // The middle key is taken on the side which has the most rows so each half is smaller
+        QString error;
+        ConnectionWorker *worker = sourceRows >= targetRows ? this->sourceWorker : this->targetWorker;
+        QStringList middle = this->findBoundary(worker, range, rows / 2 - 1, error);
+        if (!error.isEmpty()) {
+            this->updateStatus(true, error);
+            return false;
+        }
+
+        if (middle.isEmpty() || middle == range.upper) {
+            return this->listDifferences(range);
+        }
+
+        KeyRange lowerHalf, upperHalf;
+        lowerHalf.lower = range.lower;
+        lowerHalf.upper = middle;
+        upperHalf.lower = middle;
+        upperHalf.upper = range.upper;
+
+        return this->compareRange(lowerHalf, depth + 1) && this->compareRange(upperHalf, depth + 1);
+    }
+
+    /**
+     * Compares the checksum of each row of the range and adds the differences
+     * @brief TableChecksum::listDifferences
+     * @param range the key range
+     * @return false on error
+     */
+    bool TableChecksum::listDifferences(KeyRange range)
+    {
+        QString sql = QString("SELECT %1, %2 FROM `%3`%4 ORDER BY %1")
+                .arg(this->key.join(", "))
+                .arg(this->rowChecksum)
+                .arg(this->table)
+                .arg(this->rangeCondition(range));
+        QStringList keyNames = this->keyNames;
+        QList<QPair<QString, quint64> > sourceRows, targetRows;
+        QString sourceError, targetError;
+
+        this->runOnBothSides([&](QSqlDatabase db) {
+            sourceError = readRowChecksums(db, sql, keyNames, sourceRows);
+        }, [&](QSqlDatabase db) {
+            targetError = readRowChecksums(db, sql, keyNames, targetRows);
+        });
+
+        if (!sourceError.isEmpty() || !targetError.isEmpty()) {
+            this->updateStatus(true, sourceError.isEmpty() ? tr("Target: ") + targetError : tr("Source: ") + sourceError);
+            return false;
+        }
+
+        QHash<QString, quint64> targetChecksums;
+        for (int i = 0; i < targetRows.size(); i++) {
+            targetChecksums.insert(targetRows.at(i).first, targetRows.at(i).second);
+        }
+
+        for (int i = 0; i < sourceRows.size(); i++) {
+            QString rowKey = sourceRows.at(i).first;
+            if (!targetChecksums.contains(rowKey)) {
+                this->addDifference(rowKey, tr("Missing on the target"));
+            } else if (targetChecksums.take(rowKey) != sourceRows.at(i).second) {
+                this->addDifference(rowKey, tr("Different values"));
+            }
+        }
+
+        for (int i = 0; i < targetRows.size(); i++) {
+            if (targetChecksums.contains(targetRows.at(i).first)) {
+                this->addDifference(targetRows.at(i).first, tr("Missing on the source"));
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Reads the key of the row at the given position of the range
+     * @brief TableChecksum::findBoundary
+     * @param worker the side on which the key is read
+     * @param range the key range
+     * @param offset the position of the row in the range
+     * @param error set when the query fails
+     * @return the key values as literals, empty when the range has less rows
+     */
+    QStringList TableChecksum::findBoundary(ConnectionWorker *worker, KeyRange range, qint64 offset, QString &error)
+    {
+        QString sql = QString("SELECT %1 FROM `%2`%3 ORDER BY %1 LIMIT 1 OFFSET %4")
+                .arg(this->key.join(", "))
+                .arg(this->table)
+                .arg(this->rangeCondition(range))
+                .arg(qMax(Q_INT64_C(0), offset));
+        int keySize = this->key.size();
+        QStringList boundary;
+
+        this->runOn(worker, [&](QSqlDatabase db) {
+            MySQLCursor cursor(db);
+            if (!cursor.exec(sql)) {
+                error = cursor.lastError();
+                return;
+            }
+
+            // The values are kept exact, a DECIMAL read as a double or a DATETIME(6) truncated
+            // to the milliseconds would make the chunks overlap
+            if (cursor.next()) {
+                for (int i = 0; i < keySize; i++) {
+                    boundary << cursor.literal(i);
+                }
+            }
+
+            // Reads the end of the result before the next query
+            while (cursor.next()) {
+            }
+            error = cursor.lastError();
+        });
+
+        return boundary;
+    }
+
+    /**
+     * @brief TableChecksum::rangeCondition
+     * @param range the key range
+     * @return the WHERE clause of the range
+     */
+    QString TableChecksum::rangeCondition(KeyRange range)
+    {
+        QStringList conditions;
+        if (!range.lower.isEmpty()) {
+            conditions << QString("(%1) > (%2)").arg(this->key.join(", ")).arg(range.lower.join(", "));
+        }
+
+        if (!range.upper.isEmpty()) {
+            conditions << QString("(%1) <= (%2)").arg(this->key.join(", ")).arg(range.upper.join(", "));
+        }
+
+        return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+    }
+
+    /**
+     * Executes a job in the thread of a worker and waits for its end
+     * @brief TableChecksum::runOn
+     */
+    void TableChecksum::runOn(ConnectionWorker *worker, ConnectionWorker::Job job)
+    {
+        QSemaphore done;
+        worker->post([&](QSqlDatabase db) {
+            job(db);
+            done.release();
+        });
+        done.acquire();
+    }
+
+    /**
+     * Executes a job on each side at the same time and waits for both
+     * @brief TableChecksum::runOnBothSides
+     */
+    void TableChecksum::runOnBothSides(ConnectionWorker::Job sourceJob, ConnectionWorker::Job targetJob)
+    {
+        QSemaphore done;
+        this->sourceWorker->post([&](QSqlDatabase db) {
+            sourceJob(db);
+            done.release();
+        });
+        this->targetWorker->post([&](QSqlDatabase db) {
+            targetJob(db);
+            done.release();
+        });
+        done.acquire(2);
+    }
+
+    /**
+     * @brief TableChecksum::getStatus
+     * @return the progress of each table
+     */
+    QList<TableChecksumStatus> TableChecksum::getStatus()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        return this->status;
+    }
+
+    /**
+     * @brief TableChecksum::getDifferences
+     * @param from the number of differences already read
+     * @return the differences found since the given position
+     */
+    QList<RowDifference> TableChecksum::getDifferences(int from)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        return this->differences.mid(from);
+    }
+
+    void TableChecksum::stopRequired()
+    {
+        this->stop = true;
+    }
+
+    void TableChecksum::addChunk(qint64 rows)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == this->table) {
+                this->status[i].chunks++;
+                this->status[i].rows += rows;
+                break;
+            }
+        }
+    }
+
+    void TableChecksum::addDifference(QString key, QString difference)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        RowDifference rowDifference;
+        rowDifference.table = this->table;
+        rowDifference.key = key;
+        rowDifference.difference = difference;
+        this->differences << rowDifference;
+
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == this->table) {
+                this->status[i].differences++;
+                break;
+            }
+        }
+    }
+
+    void TableChecksum::updateStatus(bool finished, QString error)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == this->table) {
+                this->status[i].finished = finished;
+                this->status[i].error = error;
+                break;
+            }
+        }
+    }
+
+    qint64 TableChecksum::tableDifferences()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == this->table) {
+                return this->status.at(i).differences;
+            }
+        }
+
+        return 0;
+    }
+}
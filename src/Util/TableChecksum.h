@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef TABLECHECKSUM_H
+#define TABLECHECKSUM_H
+
+#include "DataBase.h"
+#include "ConnectionWorker.h"
+#include <QObject>
+#include <QStringList>
+#include <QMutex>
+#include <QList>
+
+struct TableChecksumStatus {
+    QString table;
+    qint64 chunks;
+    qint64 rows;
+    qint64 differences;
+    bool finished;
+    QString error;
+};
+
+struct RowDifference {
+    QString table;
+    QString key;
+    QString difference;
+};
+
+namespace Util {
+    /**
+     * Compares the data of tables between two connections (e.g. a server and its copy after a migration).
+     *
+     * The tables are split in chunks of primary key ranges. For each chunk, a checksum
+     * BIT_XOR(CRC32(CONCAT_WS(...))) and the row count are computed on both sides in parallel.
+     * A chunk which differs is split in two until it is small enough to compare the checksum
+     * of each row, so only the rows of the mismatching chunks are read. Unlike CHECKSUM TABLE
+     * the tables are not locked: each query is a consistent read of its side, but the two sides
+     * are not read in the same snapshot, the rows modified during the comparison can be reported
+     * as different. The tables should not be written while they are compared.
+     */
+    class TableChecksum : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        TableChecksum(ConnectionConfiguration source, ConnectionConfiguration target);
+        void setTables(QStringList tableList);
+        void setChunkSize(int rows);
+        void setMaxDifferences(int differences);
+
+        QList<TableChecksumStatus> getStatus();
+        QList<RowDifference> getDifferences(int from = 0);
+        void stopRequired();
+
+    public slots:
+        void compare();
+
+    signals:
+        void compareFinished(bool stopped);
+
+    private:
+        struct KeyRange {
+            // Exclusive lower bound and inclusive upper bound as literals, empty when the range is not bounded
+            QStringList lower;
+            QStringList upper;
+        };
+
+        ConnectionConfiguration source;
+        ConnectionConfiguration target;
+        ConnectionWorker *sourceWorker;
+        ConnectionWorker *targetWorker;
+        QStringList tables;
+        int chunkSize;
+        int maxDifferences;
+        volatile bool stop;
+
+        // Definition of the table being compared
+        QString table;
+        QStringList columns;
+        QStringList keyNames;
+        QStringList key;
+        QString rowChecksum;
+
+        QMutex statusMutex;
+        QList<TableChecksumStatus> status;
+        QList<RowDifference> differences;
+
+        void compareTable();
+        bool compareRange(KeyRange range, int depth);
+        bool listDifferences(KeyRange range);
+        QStringList findBoundary(ConnectionWorker *worker, KeyRange range, qint64 offset, QString &error);
+        QString rangeCondition(KeyRange range);
+        void runOn(ConnectionWorker *worker, ConnectionWorker::Job job);
+        void runOnBothSides(ConnectionWorker::Job sourceJob, ConnectionWorker::Job targetJob);
+        void addChunk(qint64 rows);
+        void addDifference(QString key, QString difference);
+        void updateStatus(bool finished, QString error = QString());
+        qint64 tableDifferences();
+    };
+}
+
+#endif // TABLECHECKSUM_H
@@ -0,0 +1,487 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "TableCopy.h"
+#include "TableDefinition.h"
+#include "ConnectionPool.h"
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QSqlField>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QDebug>
+
+// Seconds the server waits for the client reading an unbuffered result, the rows are inserted meanwhile
+#define UNBUFFERED_WRITE_TIMEOUT 3600
+
+namespace Util {
+
+    /**
+     * Copies one table in a thread of the pool
+     */
+    class TableCopyTask : public QRunnable
+    {
+    public:
+        TableCopyTask(TableCopy *tableCopy, QString table) : tableCopy(tableCopy), table(table) {}
+
+        void run()
+        {
+            this->tableCopy->copyTable(this->table);
+        }
+
+    private:
+        TableCopy *tableCopy;
+        QString table;
+    };
+
+    TableCopy::TableCopy(ConnectionConfiguration source, ConnectionConfiguration target):
+        source(source),
+        target(target)
+    {
+        this->createTable = true;
+        this->dropTable = false;
+        this->parallelism = 4;
+        this->batchSize = 1000;
+        this->stop = false;
+    }
+
+    /**
+     * @brief TableCopy::setTables
+     * @param tableList the list of tables to copy
+     */
+    void TableCopy::setTables(QStringList tableList)
+    {
+        this->tables = tableList;
+    }
+
+    /**
+     * @brief TableCopy::setCreateTable
+     * @param createTable if true, the tables are created on the target when they do not exist
+     */
+    void TableCopy::setCreateTable(bool createTable)
+    {
+        this->createTable = createTable;
+    }
+
+    /**
+     * @brief TableCopy::setDropTable
+     * @param dropTable if true, the existing tables of the target are dropped and created again
+     */
+    void TableCopy::setDropTable(bool dropTable)
+    {
+        this->dropTable = dropTable;
+    }
+
+    /**
+     * @brief TableCopy::setParallelism
+     * @param workers the number of tables copied at the same time
+     */
+    void TableCopy::setParallelism(int workers)
+    {
+        this->parallelism = qMax(1, workers);
+    }
+
+    /**
+     * @brief TableCopy::setBatchSize
+     * @param rows the number of rows inserted by each INSERT statement
+     */
+    void TableCopy::setBatchSize(int rows)
+    {
+        this->batchSize = qMax(1, rows);
+    }
+
+    /**
+     * Starts the copy, returns when all the tables are copied
+     * @brief TableCopy::copy
+     */
+    void TableCopy::copy()
+    {
+        this->statusMutex.lock();
+        this->status.clear();
+        foreach (QString table, this->tables) {
+            TableCopyStatus tableStatus;
+            tableStatus.table = table;
+            tableStatus.rowsCopied = 0;
+            tableStatus.estimatedRows = 0;
+            tableStatus.finished = false;
+            this->status << tableStatus;
+        }
+        this->statusMutex.unlock();
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(this->parallelism);
+
+        foreach (QString table, this->tables) {
+            pool.start(new TableCopyTask(this, table));
+        }
+
+        pool.waitForDone();
+
+        emit copyFinished(this->stop);
+    }
+
+    /**
+     * Copies a table with its own connections, called from a thread of the pool
+     * @brief TableCopy::copyTable
+     * @param table the table name
+     */
+    void TableCopy::copyTable(QString table)
+    {
+        if (this->stop) {
+            this->updateStatus(table, 0, true, tr("Cancelled"));
+            return;
+        }
+
+        // The copy changes session variables, they are reset when the connections go back to the pool
+        PooledConnection sourceConnection(this->source, true);
+        PooledConnection targetConnection(this->target, true);
+        QSqlDatabase sourceDatabase = sourceConnection.database();
+        QSqlDatabase targetDatabase = targetConnection.database();
+
+        if (!sourceDatabase.isOpen()) {
+            this->updateStatus(table, 0, true, sourceDatabase.lastError().text());
+        } else if (!targetDatabase.isOpen()) {
+            this->updateStatus(table, 0, true, targetDatabase.lastError().text());
+        } else {
+            this->copyTable(sourceDatabase, targetDatabase, table);
+        }
+    }
+
+    /**
+     * Creates the table on the target and copies the rows by chunks.
+     * The chunks follow the primary key order (keyset pagination) so each chunk is an index range scan,
+     * the tables without primary key are read with a single unbuffered SELECT as their order is not
+     * stable between two statements. The values are copied as sent by the server, the DECIMAL and
+     * temporal values (including the zero dates) are not converted.
+     *
+     * @brief TableCopy::copyTable
+     * @param sourceDatabase the source connection
+     * @param targetDatabase the target connection
+     * @param table the table name
+     */
+    void TableCopy::copyTable(QSqlDatabase sourceDatabase, QSqlDatabase targetDatabase, QString table)
+    {
+        QSqlQuery targetQuery(targetDatabase);
+        targetQuery.exec("SET FOREIGN_KEY_CHECKS = 0");
+        targetQuery.exec("SET UNIQUE_CHECKS = 0");
+
+        // The rows accepted by the source (e.g. zero dates) are accepted by the target
+        QSqlQuery sqlModeQuery(sourceDatabase);
+        if (sqlModeQuery.exec("SELECT @@SESSION.sql_mode") && sqlModeQuery.next()) {
+            QSqlQuery setSqlModeQuery(targetDatabase);
+            setSqlModeQuery.prepare("SET SESSION sql_mode = ?");
+            setSqlModeQuery.addBindValue(sqlModeQuery.value(0).toString());
+            if (!setSqlModeQuery.exec()) {
+                qDebug() << "TableCopy::copyTable - " + setSqlModeQuery.lastError().text();
+            }
+        }
+
+        if (this->createTable) {
+            QSqlQuery createTableQuery(sourceDatabase);
+            if (!createTableQuery.exec(QString("SHOW CREATE TABLE `%1`").arg(table)) || !createTableQuery.next()) {
+                this->updateStatus(table, 0, true, createTableQuery.lastError().text());
+                return;
+            }
+
+            QString createStatement = createTableQuery.value(1).toString();
+            if (this->dropTable) {
+                if (!targetQuery.exec(QString("DROP TABLE IF EXISTS `%1`").arg(table))) {
+                    this->updateStatus(table, 0, true, targetQuery.lastError().text());
+                    return;
+                }
+            } else {
+                createStatement.replace(QRegExp("^CREATE TABLE"), "CREATE TABLE IF NOT EXISTS");
+            }
+
+            if (!targetQuery.exec(createStatement)) {
+                this->updateStatus(table, 0, true, targetQuery.lastError().text());
+                return;
+            }
+        }
+
+        // The estimation from the table statistics avoids a full scan with COUNT(*)
+        QSqlQuery estimateQuery(sourceDatabase);
+        estimateQuery.prepare("SELECT TABLE_ROWS FROM information_schema.TABLES WHERE TABLE_SCHEMA = :schema AND TABLE_NAME = :table");
+        estimateQuery.bindValue(":schema", sourceDatabase.databaseName());
+        estimateQuery.bindValue(":table", table);
+        if (estimateQuery.exec() && estimateQuery.next()) {
+            this->setEstimatedRows(table, estimateQuery.value(0).toLongLong());
+        }
+
+        TableDefinition definition(sourceDatabase, table);
+        QStringList columns;
+        QStringList quotedColumns;
+        QStringList columnTypes;
+        foreach (ColumnDefinition column, definition.columns()) {
+            columns << column.name;
+            quotedColumns << "`" + column.name + "`";
+            columnTypes << column.type.toLower();
+        }
+
+        if (columns.isEmpty()) {
+            this->updateStatus(table, 0, true, tr("Unable to read the table definition"));
+            return;
+        }
+
+        QStringList primaryKey = definition.primaryKey();
+        QStringList quotedKey;
+        QList<int> keyPositions;
+        foreach (QString key, primaryKey) {
+            quotedKey << "`" + key.trimmed() + "`";
+            keyPositions << columns.indexOf(key.trimmed());
+        }
+        bool keyset = !primaryKey.isEmpty() && !keyPositions.contains(-1);
+
+        if (!keyset) {
+            // The rows are inserted on the target while the result is read
+            QSqlQuery timeoutQuery(sourceDatabase);
+            if (!timeoutQuery.exec(QString("SET SESSION net_write_timeout = %1").arg(UNBUFFERED_WRITE_TIMEOUT))) {
+                qDebug() << "TableCopy::copyTable - " + timeoutQuery.lastError().text();
+            }
+        }
+
+        // A prepared statement accepts at most 65535 placeholders
+        int rowsPerBatch = qMax(1, qMin(this->batchSize, 65535 / columns.size()));
+        int chunkSize = rowsPerBatch * 10;
+
+        QSqlQuery insertQuery(targetDatabase);
+        int preparedRows = 0;
+        QList<QVariantList> rows;
+        QStringList lastKey;
+        qint64 copied = 0;
+        bool hasMore = true;
+
+        while (hasMore && !this->stop) {
+            QString sql = QString("SELECT %1 FROM `%2`").arg(quotedColumns.join(", ")).arg(table);
+            if (keyset) {
+                if (!lastKey.isEmpty()) {
+                    sql += QString(" WHERE (%1) > (%2)").arg(quotedKey.join(", ")).arg(lastKey.join(", "));
+                }
+                sql += QString(" ORDER BY %1 LIMIT %2").arg(quotedKey.join(", ")).arg(chunkSize);
+            }
+
+            MySQLCursor cursor(sourceDatabase);
+            if (!cursor.exec(sql)) {
+                this->updateStatus(table, copied, true, cursor.lastError());
+                return;
+            }
+
+            int fetched = 0;
+            QVariantList lastRow;
+            while (cursor.next()) {
+                QVariantList row;
+                for (int i = 0; i < columns.size(); i++) {
+                    row << copyValue(cursor, i);
+                }
+
+                lastRow = row;
+                rows << row;
+                fetched++;
+
+                if (rows.size() == rowsPerBatch) {
+                    bool inserted = this->insertRows(targetDatabase, insertQuery, preparedRows, table, quotedColumns, rows);
+                    if (inserted) {
+                        copied += rowsPerBatch;
+                        this->updateStatus(table, copied, false);
+                    }
+
+                    if (!inserted || this->stop) {
+                        // The rest of the table would be read when the unbuffered result is freed
+                        if (!keyset) {
+                            DataBase::killQuery(this->source, cursor.connectionId());
+                        }
+
+                        if (!inserted) {
+                            return;
+                        }
+                        break;
+                    }
+                }
+            }
+
+            if (!this->stop && !cursor.lastError().isEmpty()) {
+                this->updateStatus(table, copied, true, cursor.lastError());
+                return;
+            }
+
+            if (keyset && fetched == chunkSize) {
+                lastKey.clear();
+                foreach (int position, keyPositions) {
+                    lastKey << formatKey(cursor.record().field(position).type(), columnTypes.at(position), lastRow.at(position));
+                }
+            } else {
+                hasMore = false;
+            }
+        }
+
+        int remaining = rows.size();
+        if (!this->stop && !this->insertRows(targetDatabase, insertQuery, preparedRows, table, quotedColumns, rows)) {
+            return;
+        }
+
+        copied += remaining;
+        this->updateStatus(table, copied, true, this->stop ? tr("Cancelled") : QString());
+    }
+
+    /**
+     * @brief TableCopy::copyValue
+     * @return the value of the column of the current row, the numbers are kept as text unless
+     * they are integers and the binary strings are kept as bytes
+     */
+    QVariant TableCopy::copyValue(MySQLCursor &cursor, int column)
+    {
+        if (cursor.isNull(column)) {
+            return QVariant();
+        }
+
+        switch (cursor.record().field(column).type()) {
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+        case QVariant::ByteArray:
+            return cursor.value(column);
+        default:
+            return QString::fromUtf8(cursor.rawValue(column), cursor.valueLength(column));
+        }
+    }
+
+    /**
+     * @brief TableCopy::formatKey
+     * @return the value of a primary key column as a literal of the next chunk, the integers are
+     * not quoted so the comparison uses the index without conversion, the other numbers are kept
+     * as sent by the server so a DECIMAL is not compared as a double. The other values are
+     * hexadecimal literals, which do not depend on NO_BACKSLASH_ESCAPES, the text values with
+     * the character set of the connection so they are compared with the collation of the column.
+     */
+    QString TableCopy::formatKey(QVariant::Type type, QString columnType, QVariant value)
+    {
+        static const QStringList numericTypes = QStringList() << "decimal" << "numeric" << "float" << "double" << "real";
+
+        if (type == QVariant::Int || type == QVariant::UInt || type == QVariant::LongLong || type == QVariant::ULongLong
+                || numericTypes.contains(columnType)) {
+            return value.toString();
+        } else if (type == QVariant::ByteArray) {
+            return "X'" + QString::fromLatin1(value.toByteArray().toHex()) + "'";
+        }
+
+        return "_utf8mb4 X'" + QString::fromLatin1(value.toString().toUtf8().toHex()) + "'";
+    }
+
+    /**
+     * Inserts the rows with a single multi-row INSERT statement in a transaction.
+     * The statement is prepared once for a given number of rows and reused for the following batches.
+     *
+     * @brief TableCopy::insertRows
+     * @param targetDatabase the target connection
+     * @param insertQuery the prepared statement, prepared again if the number of rows changes
+     * @param preparedRows the number of rows of the prepared statement
+     * @param table the table name
+     * @param columns the quoted column names
+     * @param rows the rows to insert, the list is cleared when the rows are inserted
+     * @return true if the rows are inserted
+     */
+    bool TableCopy::insertRows(QSqlDatabase targetDatabase, QSqlQuery &insertQuery, int &preparedRows, QString table, QStringList columns, QList<QVariantList> &rows)
+    {
+        if (rows.isEmpty()) {
+            return true;
+        }
+
+        if (preparedRows != rows.size()) {
+            QStringList placeholders;
+            for (int i = 0; i < columns.size(); i++) {
+                placeholders << "?";
+            }
+
+            QString valueTuple = "(" + placeholders.join(",") + ")";
+            QStringList tuples;
+            for (int i = 0; i < rows.size(); i++) {
+                tuples << valueTuple;
+            }
+
+            insertQuery.prepare(QString("INSERT INTO `%1` (%2) VALUES %3").arg(table).arg(columns.join(", ")).arg(tuples.join(",")));
+            preparedRows = rows.size();
+        }
+
+        foreach (QVariantList row, rows) {
+            foreach (QVariant value, row) {
+                insertQuery.addBindValue(value);
+            }
+        }
+
+        targetDatabase.transaction();
+        if (!insertQuery.exec()) {
+            qDebug() << "TableCopy::insertRows - " + insertQuery.lastError().text();
+            targetDatabase.rollback();
+            this->updateStatus(table, 0, true, insertQuery.lastError().text());
+            return false;
+        }
+
+        targetDatabase.commit();
+        rows.clear();
+
+        return true;
+    }
+
+    void TableCopy::updateStatus(QString table, qint64 rowsCopied, bool finished, QString error)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == table) {
+                TableCopyStatus tableStatus = this->status.at(i);
+                if (rowsCopied > 0) {
+                    tableStatus.rowsCopied = rowsCopied;
+                }
+                tableStatus.finished = finished;
+                tableStatus.error = error;
+                this->status.replace(i, tableStatus);
+                break;
+            }
+        }
+    }
+
+    void TableCopy::setEstimatedRows(QString table, qint64 rows)
+    {
+        QMutexLocker locker(&this->statusMutex);
+        for (int i = 0; i < this->status.size(); i++) {
+            if (this->status.at(i).table == table) {
+                this->status[i].estimatedRows = rows;
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief TableCopy::getStatus
+     * @return the progress of each table
+     */
+    QList<TableCopyStatus> TableCopy::getStatus()
+    {
+        QMutexLocker locker(&this->statusMutex);
+        return this->status;
+    }
+
+    /**
+     * Stops the copy, the tables are left partially copied
+     * @brief TableCopy::stopRequired
+     */
+    void TableCopy::stopRequired()
+    {
+        this->stop = true;
+    }
+}
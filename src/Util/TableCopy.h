@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef TABLECOPY_H
+#define TABLECOPY_H
+
+#include "DataBase.h"
+#include "MySQLCursor.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QMutex>
+#include <QList>
+
+struct TableCopyStatus {
+    QString table;
+    qint64 rowsCopied;
+    qint64 estimatedRows;
+    bool finished;
+    QString error;
+};
+
+namespace Util {
+    /**
+     * Copies tables from a connection to another one (e.g. between two servers) without temporary file.
+     *
+     * The rows are read by primary key ranges (or with a single unbuffered SELECT for the tables
+     * without primary key) on the source connection and written on the target
+     * connection with batched multi-row prepared INSERT statements. Each table is copied by its own
+     * worker with its own pair of connections, several tables are copied in parallel.
+     */
+    class TableCopy : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        TableCopy(ConnectionConfiguration source, ConnectionConfiguration target);
+        void setTables(QStringList tableList);
+        void setCreateTable(bool createTable);
+        void setDropTable(bool dropTable);
+        void setParallelism(int workers);
+        void setBatchSize(int rows);
+
+        QList<TableCopyStatus> getStatus();
+        void stopRequired();
+        void copyTable(QString table);
+
+    public slots:
+        void copy();
+
+    signals:
+        void copyFinished(bool stopped);
+
+    private:
+        ConnectionConfiguration source;
+        ConnectionConfiguration target;
+        QStringList tables;
+        bool createTable;
+        bool dropTable;
+        int parallelism;
+        int batchSize;
+        volatile bool stop;
+
+        QMutex statusMutex;
+        QList<TableCopyStatus> status;
+
+        void copyTable(QSqlDatabase sourceDatabase, QSqlDatabase targetDatabase, QString table);
+        bool insertRows(QSqlDatabase targetDatabase, QSqlQuery &insertQuery, int &preparedRows, QString table, QStringList columns, QList<QVariantList> &rows);
+        void updateStatus(QString table, qint64 rowsCopied, bool finished, QString error = QString());
+        void setEstimatedRows(QString table, qint64 rows);
+        static QVariant copyValue(MySQLCursor &cursor, int column);
+        static QString formatKey(QVariant::Type type, QString columnType, QVariant value);
+    };
+}
+
+#endif // TABLECOPY_H
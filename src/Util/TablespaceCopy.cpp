@@ -0,0 +1,471 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "TablespaceCopy.h"
+#include "ConnectionPool.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QTextStream>
+#include <QDebug>
+
+namespace Util {
+    TablespaceCopy::TablespaceCopy(ConnectionConfiguration conf, QString directory, TablespaceCopyMode mode):
+        configuration(conf),
+        directory(directory),
+        mode(mode)
+    {
+        this->tableCount = 0;
+        this->progress = 0;
+        this->bytesCopied = 0;
+        this->totalBytes = 0;
+        this->currentTable = "";
+        this->stop = false;
+    }
+
+    /**
+     * @brief TablespaceCopy::setTables
+     * @param tableList the list of tables to copy, if the list is not set all the InnoDB tables are copied
+     */
+    void TablespaceCopy::setTables(QStringList tableList)
+    {
+        this->tables = tableList;
+    }
+
+    /**
+     * Starts the export or the import of the tablespaces
+     * @brief TablespaceCopy::copy
+     */
+    void TablespaceCopy::copy()
+    {
+        // The tables locked by the export are released by the reset of the session
+        PooledConnection connection(this->configuration, true);
+        QSqlDatabase database = connection.database();
+        if (!database.isOpen()) {
+            qDebug() << database.lastError().text();
+            this->error = database.lastError().text();
+            emit copyFinished(true);
+            return ;
+        }
+
+        QString databaseDirectory = this->getDatabaseDirectory(database);
+        if (!databaseDirectory.isEmpty()) {
+            if (this->mode == EXPORT) {
+                this->exportTables(database, databaseDirectory);
+            } else {
+                this->importTables(database, databaseDirectory);
+            }
+        }
+
+        emit copyFinished(this->stop);
+    }
+
+    /**
+     * Flushes the tables for export, copies the tablespace files into the output directory and releases the lock.
+     * The CREATE TABLE statement of each table is saved next to the files, it is used by the import
+     * to create the missing tables.
+     *
+     * @brief TablespaceCopy::exportTables
+     * @param database the source database
+     * @param databaseDirectory the directory of the database in the server data directory
+     */
+    void TablespaceCopy::exportTables(QSqlDatabase database, QString databaseDirectory)
+    {
+        QDir output(this->directory);
+        if (!output.exists() && !output.mkpath(".")) {
+            this->error = QString(tr("Unable to create the directory %1")).arg(this->directory);
+            return ;
+        }
+
+        QStringList innodbTables = this->getInnoDBTables(database);
+        if (this->tables.isEmpty()) {
+            this->tables = innodbTables;
+        }
+
+        QStringList exportedTables;
+        QStringList lockedTables;
+        foreach (QString table, this->tables) {
+            if (!innodbTables.contains(table)) {
+                qWarning() << "TablespaceCopy::exportTables - not an InnoDB table, skipped: " + table;
+                continue;
+            }
+
+            QSqlQuery createTableQuery(database);
+            if (createTableQuery.exec(QString("SHOW CREATE TABLE `%1`").arg(table)) && createTableQuery.next()) {
+                QFile definition(output.filePath(table + ".sql"));
+                if (definition.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                    QTextStream stream(&definition);
+                    stream << createTableQuery.value(1).toString() + ";" << endl;
+                }
+            }
+
+            foreach (QString file, this->getTablespaceFiles(QDir(databaseDirectory), table)) {
+                if (file.endsWith(".ibd")) {
+                    this->totalBytes += QFileInfo(QDir(databaseDirectory).filePath(file)).size();
+                }
+            }
+
+            exportedTables << table;
+            lockedTables << "`" + table + "`";
+        }
+
+        this->tableCount = exportedTables.size();
+        if (exportedTables.isEmpty()) {
+            this->error = tr("There is no InnoDB table to export");
+            return ;
+        }
+
+        // Quiesces the tables and creates the .cfg files, the tables are read only until UNLOCK TABLES
+        if (!this->exec(database, "FLUSH TABLES " + lockedTables.join(", ") + " FOR EXPORT")) {
+            return ;
+        }
+
+        foreach (QString table, exportedTables) {
+            if (this->stop || !this->error.isEmpty()) {
+                break;
+            }
+
+            this->currentTable = table;
+            QStringList copiedFiles;
+            bool copied = true;
+            foreach (QString file, this->getTablespaceFiles(QDir(databaseDirectory), table)) {
+                copiedFiles << output.filePath(file);
+                if (!this->copyFile(QDir(databaseDirectory).filePath(file), output.filePath(file))) {
+                    copied = false;
+                    break;
+                }
+            }
+
+            // The files of a table which is not entirely copied can not be imported
+            if (!copied) {
+                foreach (QString file, copiedFiles) {
+                    QFile::remove(file);
+                }
+                QFile::remove(output.filePath(table + ".sql"));
+                break;
+            }
+
+            this->progress++;
+        }
+
+        this->exec(database, "UNLOCK TABLES");
+    }
+
+    /**
+     * Replaces the tablespace of the tables by the files found in the input directory.
+     * The tables which do not exist in the database are created from the definition saved by the export.
+     *
+     * @brief TablespaceCopy::importTables
+     * @param database the target database
+     * @param databaseDirectory the directory of the database in the server data directory
+     */
+    void TablespaceCopy::importTables(QSqlDatabase database, QString databaseDirectory)
+    {
+        QDir input(this->directory);
+        if (!QFileInfo(databaseDirectory).isWritable()) {
+            this->error = QString(tr("The directory %1 is not writable")).arg(databaseDirectory);
+            return ;
+        }
+
+        // Tables available in the input directory
+        QStringList availableTables;
+        foreach (QString file, input.entryList(QStringList() << "*.ibd", QDir::Files)) {
+            QString table = QFileInfo(file).completeBaseName().split(QRegExp("#[Pp]#")).first();
+            if (!availableTables.contains(table)) {
+                availableTables << table;
+            }
+        }
+
+        QStringList importedTables;
+        foreach (QString table, availableTables) {
+            if (this->tables.isEmpty() || this->tables.contains(table)) {
+                importedTables << table;
+
+                foreach (QString file, this->getTablespaceFiles(input, table)) {
+                    if (file.endsWith(".ibd")) {
+                        this->totalBytes += QFileInfo(input.filePath(file)).size();
+                    }
+                }
+            }
+        }
+
+        this->tableCount = importedTables.size();
+        if (importedTables.isEmpty()) {
+            this->error = QString(tr("There is no tablespace file to import in %1")).arg(this->directory);
+            return ;
+        }
+
+        QStringList existingTables = database.tables();
+        this->exec(database, "SET FOREIGN_KEY_CHECKS = 0");
+
+        foreach (QString table, importedTables) {
+            // The stop is only checked between two tables, a discarded tablespace must always be imported
+            if (this->stop || !this->error.isEmpty()) {
+                break;
+            }
+
+            this->currentTable = table;
+
+            if (!existingTables.contains(table)) {
+                QFile definition(input.filePath(table + ".sql"));
+                if (!definition.open(QIODevice::ReadOnly)) {
+                    this->error = QString(tr("The table %1 does not exist and its definition is not found")).arg(table);
+                    break;
+                }
+
+                if (!this->exec(database, QString::fromUtf8(definition.readAll()))) {
+                    break;
+                }
+            }
+
+            if (!this->exec(database, QString("ALTER TABLE `%1` DISCARD TABLESPACE").arg(table))) {
+                break;
+            }
+
+            bool copied = true;
+            foreach (QString file, this->getTablespaceFiles(input, table)) {
+                QString source = input.filePath(file);
+                QString destination = QDir(databaseDirectory).filePath(file);
+                if (!this->copyFile(source, destination)) {
+                    copied = false;
+                    break;
+                }
+
+                // The files keep the permissions of the exported files, mysqld must be able to read and write them
+                QFile::setPermissions(destination, QFile::permissions(source));
+            }
+
+            // An incomplete tablespace is not imported, the table stays without tablespace
+            if (!copied) {
+                this->error = QString(tr("The tablespace of the table %1 is discarded and has not been imported, import it again once the error is fixed: %2"))
+                        .arg(table).arg(this->error);
+                break;
+            }
+
+            if (!this->exec(database, QString("ALTER TABLE `%1` IMPORT TABLESPACE").arg(table))) {
+                break;
+            }
+            this->progress++;
+        }
+
+        this->exec(database, "SET FOREIGN_KEY_CHECKS = 1");
+    }
+
+    /**
+     * @brief TablespaceCopy::getInnoDBTables
+     * @param database the database
+     * @return the list of InnoDB tables of the database
+     */
+    QStringList TablespaceCopy::getInnoDBTables(QSqlDatabase database)
+    {
+        QStringList innodbTables;
+        QSqlQuery query(database);
+        query.prepare("SELECT TABLE_NAME FROM information_schema.TABLES WHERE TABLE_SCHEMA = :schema AND ENGINE = 'InnoDB' AND TABLE_TYPE = 'BASE TABLE'");
+        query.bindValue(":schema", database.databaseName());
+
+        if (query.exec()) {
+            while (query.next()) {
+                innodbTables << query.value(0).toString();
+            }
+        } else {
+            qDebug() << "TablespaceCopy::getInnoDBTables - " + query.lastError().text();
+        }
+
+        return innodbTables;
+    }
+
+    /**
+     * Finds the directory of the database in the server data directory and checks that
+     * the tables use their own tablespace file.
+     *
+     * @brief TablespaceCopy::getDatabaseDirectory
+     * @param database the database
+     * @return the directory of the database, empty when the directory is not accessible
+     */
+    QString TablespaceCopy::getDatabaseDirectory(QSqlDatabase database)
+    {
+        QSqlQuery query(database);
+        if (!query.exec("SELECT @@datadir, @@innodb_file_per_table") || !query.next()) {
+            this->error = query.lastError().text();
+            return QString();
+        }
+
+        if (!query.value(1).toBool()) {
+            this->error = tr("The server option innodb_file_per_table is disabled, the tables do not have their own tablespace file");
+            return QString();
+        }
+
+        QString databaseDirectory = QDir(query.value(0).toString()).filePath(database.databaseName());
+        QFileInfo info(databaseDirectory);
+        if (!info.isDir() || !info.isReadable()) {
+            this->error = QString(tr("The server data directory %1 is not accessible from this computer")).arg(databaseDirectory);
+            return QString();
+        }
+
+        return databaseDirectory;
+    }
+
+    /**
+     * @brief TablespaceCopy::getTablespaceFiles
+     * @param directory the directory to search in
+     * @param table the table name
+     * @return the .ibd and .cfg file names of the table, including the files of the partitions
+     */
+    QStringList TablespaceCopy::getTablespaceFiles(QDir directory, QString table)
+    {
+        QStringList filters;
+        filters << table + ".ibd" << table + ".cfg";
+        filters << table + "#P#*.ibd" << table + "#P#*.cfg";
+        filters << table + "#p#*.ibd" << table + "#p#*.cfg";
+
+        return directory.entryList(filters, QDir::Files);
+    }
+
+    /**
+     * Copies a file by blocks to report the progress
+     *
+     * @brief TablespaceCopy::copyFile
+     * @param source the source file
+     * @param destination the destination file, replaced if it exists
+     * @return true if the file is copied, false if the copy fails or is stopped (the destination
+     * file is removed)
+     */
+    bool TablespaceCopy::copyFile(QString source, QString destination)
+    {
+        QFile input(source);
+        QFile output(destination);
+
+        if (!input.open(QIODevice::ReadOnly)) {
+            this->error = QString(tr("Unable to read the file %1: %2")).arg(source).arg(input.errorString());
+            return false;
+        }
+
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            this->error = QString(tr("Unable to write the file %1: %2")).arg(destination).arg(output.errorString());
+            return false;
+        }
+
+        // Only the export can be interrupted during a copy, the import must leave a complete file
+        while (!input.atEnd()) {
+            if (this->stop && this->mode == EXPORT) {
+                output.remove();
+                return false;
+            }
+
+            QByteArray block = input.read(4 * 1024 * 1024);
+            if (block.isEmpty() || output.write(block) != block.size()) {
+                this->error = QString(tr("Unable to copy the file %1: %2")).arg(source).arg(output.errorString());
+                output.remove();
+                return false;
+            }
+
+            if (source.endsWith(".ibd")) {
+                this->bytesCopied += block.size();
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Executes a statement, the error is kept to be displayed at the end of the process
+     *
+     * @brief TablespaceCopy::exec
+     * @param database the database
+     * @param sql the statement
+     * @return true if the statement is executed successfully
+     */
+    bool TablespaceCopy::exec(QSqlDatabase database, QString sql)
+    {
+        QSqlQuery query(database);
+        if (!query.exec(sql)) {
+            qDebug() << "TablespaceCopy::exec - " + query.lastError().text();
+            if (this->error.isEmpty()) {
+                this->error = sql + ": " + query.lastError().text();
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief TablespaceCopy::getProgress
+     * @return the number of tables copied
+     */
+    int TablespaceCopy::getProgress()
+    {
+        return this->progress;
+    }
+
+    /**
+     * @brief TablespaceCopy::getTableCount
+     * @return the number of tables to copy
+     */
+    int TablespaceCopy::getTableCount()
+    {
+        return this->tableCount;
+    }
+
+    /**
+     * @brief TablespaceCopy::getBytesCopied
+     * @return the size of the tablespace files already copied
+     */
+    qint64 TablespaceCopy::getBytesCopied()
+    {
+        return this->bytesCopied;
+    }
+
+    /**
+     * @brief TablespaceCopy::getTotalBytes
+     * @return the size of all the tablespace files to copy
+     */
+    qint64 TablespaceCopy::getTotalBytes()
+    {
+        return this->totalBytes;
+    }
+
+    /**
+     * @brief TablespaceCopy::getCurrentTable
+     * @return the table which is processing
+     */
+    QString TablespaceCopy::getCurrentTable()
+    {
+        return this->currentTable;
+    }
+
+    /**
+     * @brief TablespaceCopy::getError
+     * @return the first error encountered, empty if the copy succeeded
+     */
+    QString TablespaceCopy::getError()
+    {
+        return this->error;
+    }
+
+    /**
+     * Stops the copy process
+     * @brief TablespaceCopy::stopRequired
+     */
+    void TablespaceCopy::stopRequired()
+    {
+        this->stop = true;
+    }
+}
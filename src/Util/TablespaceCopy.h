@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef TABLESPACECOPY_H
+#define TABLESPACECOPY_H
+
+#include "DataBase.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QDir>
+
+namespace Util {
+    /**
+     * Copies InnoDB tables as raw tablespace files (transportable tablespaces).
+     *
+     * The export flushes the tables with FLUSH TABLES ... FOR EXPORT and copies the .ibd/.cfg
+     * files from the server data directory, the import discards the tablespace of the target
+     * tables and imports the copied files. Both operations require the server data directory
+     * to be accessible from this computer (local server, local standby, test instance). The
+     * imported files keep the permissions of the exported ones, they must be readable and
+     * writable by the user of mysqld.
+     */
+    class TablespaceCopy : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+
+        enum TablespaceCopyMode {
+            EXPORT,
+            IMPORT
+        };
+
+        TablespaceCopy(ConnectionConfiguration conf, QString directory, TablespaceCopyMode mode);
+        void setTables(QStringList tableList);
+
+        int getProgress();
+        int getTableCount();
+        qint64 getBytesCopied();
+        qint64 getTotalBytes();
+        QString getCurrentTable();
+        QString getError();
+        void stopRequired();
+
+    public slots:
+        void copy();
+
+    signals:
+        void copyFinished(bool stopped);
+
+    private:
+        ConnectionConfiguration configuration;
+        QString directory;
+        TablespaceCopyMode mode;
+        QStringList tables;
+        QString currentTable;
+        QString error;
+        int progress;
+        int tableCount;
+        qint64 bytesCopied;
+        qint64 totalBytes;
+        bool stop;
+
+        void exportTables(QSqlDatabase database, QString databaseDirectory);
+        void importTables(QSqlDatabase database, QString databaseDirectory);
+        QStringList getInnoDBTables(QSqlDatabase database);
+        QString getDatabaseDirectory(QSqlDatabase database);
+        QStringList getTablespaceFiles(QDir directory, QString table);
+        bool copyFile(QString source, QString destination);
+        bool exec(QSqlDatabase database, QString sql);
+    };
+}
+
+#endif // TABLESPACECOPY_H
@@ -0,0 +1,331 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "VariantComparison.h"
+#include "ConnectionPool.h"
+#include "MySQLCursor.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QtEndian>
+#include <QPair>
+#include <QDebug>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+namespace Util {
+
+    VariantComparison::VariantComparison(ConnectionConfiguration conf, QStringList variants):
+        configuration(conf)
+    {
+        this->rounds = 100;
+        this->warmup = 1;
+        this->ordered = false;
+        this->stop = false;
+
+        this->status.round = 0;
+        this->status.rounds = this->warmup + this->rounds;
+        this->status.resultsMatch = true;
+        foreach (QString query, variants) {
+            VariantStatistics variant;
+            variant.query = query;
+            variant.rows = 0;
+            this->status.variants << variant;
+        }
+    }
+
+    /**
+     * @brief VariantComparison::setRounds
+     * @param rounds the number of measured executions of each variant
+     */
+    void VariantComparison::setRounds(int rounds)
+    {
+        this->rounds = qMax(1, rounds);
+        this->status.rounds = this->warmup + this->rounds;
+    }
+
+    /**
+     * @brief VariantComparison::setWarmup
+     * @param rounds the number of executions of each variant which are not measured, at least
+     * one to compare the results
+     */
+    void VariantComparison::setWarmup(int rounds)
+    {
+        this->warmup = qMax(1, rounds);
+        this->status.rounds = this->warmup + this->rounds;
+    }
+
+    /**
+     * @brief VariantComparison::setOrdered
+     * @param ordered the variants must return the rows in the same order
+     */
+    void VariantComparison::setOrdered(bool ordered)
+    {
+        this->ordered = ordered;
+    }
+
+    /**
+     * Executes the rounds on a connection of the pool, a failing variant stops the comparison
+     * @brief VariantComparison::execute
+     */
+    void VariantComparison::execute()
+    {
+        // The session variables set by the variants are reset when the connection goes back to the pool
+        PooledConnection connection(this->configuration, true);
+        QSqlDatabase database = connection.database();
+        if (!database.isOpen()) {
+            qDebug() << "VariantComparison::execute - " + database.lastError().text();
+            QMutexLocker locker(&this->statusMutex);
+            this->status.lastError = database.lastError().text();
+            emit executionFinished(this->stop);
+            return;
+        }
+
+        QStringList queries;
+        QList<int> order;
+        for (int i = 0; i < this->status.variants.size(); i++) {
+            queries << this->status.variants.at(i).query;
+            order << i;
+        }
+
+        std::mt19937 random(QDateTime::currentMSecsSinceEpoch());
+        bool failed = false;
+
+        for (int round = 0; round < this->warmup + this->rounds && !this->stop && !failed; round++) {
+            std::shuffle(order.begin(), order.end(), random);
+            bool verify = round == 0;
+
+            foreach (int index, order) {
+                QByteArray hash;
+                qint64 rows = 0;
+                QString error;
+
+                QElapsedTimer timer;
+                timer.start();
+                bool success = this->executeVariant(database, queries.at(index), verify, hash, rows, error);
+                double msec = timer.nsecsElapsed() / 1000000.0;
+
+                QMutexLocker locker(&this->statusMutex);
+                VariantStatistics &variant = this->status.variants[index];
+                if (!success) {
+                    this->status.lastError = QString(tr("Variant %1: %2")).arg(QChar('A' + index)).arg(error);
+                    failed = true;
+                    break;
+                } else if (verify) {
+                    variant.hash = hash;
+                    variant.rows = rows;
+                } else if (round >= this->warmup) {
+                    variant.latencies << msec;
+                }
+            }
+
+            QMutexLocker locker(&this->statusMutex);
+            if (verify && !failed) {
+                // The rewrites must give the same result as the first variant
+                foreach (VariantStatistics variant, this->status.variants) {
+                    if (variant.hash != this->status.variants.first().hash || variant.rows != this->status.variants.first().rows) {
+                        this->status.resultsMatch = false;
+                    }
+                }
+            }
+            this->status.round = round + 1;
+        }
+
+        if (failed) {
+            // The failing statement may have left a transaction open
+            connection.discard();
+        }
+
+        emit executionFinished(this->stop);
+    }
+
+    /**
+     * Executes a variant and reads all its rows
+     * @param hash true to compute the hash of the result, not done when the variant is measured
+     * @param resultHash receives the hash of the rows, ordered or not
+     * @param rows receives the number of rows
+     * @return false on error
+     */
+    bool VariantComparison::executeVariant(QSqlDatabase database, QString query, bool hash, QByteArray &resultHash, qint64 &rows, QString &error)
+    {
+        MySQLCursor cursor(database);
+        if (!cursor.exec(query)) {
+            error = cursor.lastError();
+            return false;
+        }
+
+        QCryptographicHash orderedHash(QCryptographicHash::Sha1);
+        quint64 sum = 0;
+
+        do {
+            int columnCount = cursor.columnCount();
+            while (cursor.next()) {
+                rows++;
+                if (!hash) {
+                    continue;
+                }
+
+                // The length of each value is part of the data, ("a", "bc") and ("ab", "c") are different
+                QByteArray data;
+                for (int i = 0; i < columnCount; i++) {
+                    if (cursor.isNull(i)) {
+                        data.append(char(0));
+                    } else {
+                        data.append(char(1));
+                        data.append(QByteArray::number(cursor.valueLength(i)));
+                        data.append(':');
+                        data.append(cursor.rawValue(i), cursor.valueLength(i));
+                    }
+                }
+
+                if (this->ordered) {
+                    orderedHash.addData(data);
+                } else {
+                    // The sum of the hashes of the rows does not depend on their order
+                    QByteArray digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+                    sum += qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(digest.constData()));
+                }
+            }
+        } while (cursor.lastError().isEmpty() && cursor.nextResult());
+
+        error = cursor.lastError();
+        resultHash = this->ordered ? orderedHash.result().toHex() : QByteArray::number(sum, 16).rightJustified(16, '0');
+
+        return error.isEmpty();
+    }
+
+    /**
+     * @return the progress and the latencies of the variants, compared with the first one
+     */
+    VariantComparisonStatus VariantComparison::getStatus()
+    {
+        this->statusMutex.lock();
+        VariantComparisonStatus status = this->status;
+        this->statusMutex.unlock();
+
+        for (int i = 0; i < status.variants.size(); i++) {
+            computeStatistics(status.variants[i], status.variants.first());
+        }
+
+        return status;
+    }
+
+    void VariantComparison::computeStatistics(VariantStatistics &variant, const VariantStatistics &baseline)
+    {
+        QList<double> sorted = variant.latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        variant.min = sorted.isEmpty() ? -1 : sorted.first();
+        variant.max = sorted.isEmpty() ? -1 : sorted.last();
+        variant.median = percentile(sorted, 0.5);
+        variant.p90 = percentile(sorted, 0.9);
+
+        double sum = 0;
+        foreach (double latency, sorted) {
+            sum += latency;
+        }
+        variant.mean = sorted.isEmpty() ? -1 : sum / sorted.size();
+
+        // The baseline is computed first
+        bool first = &variant == &baseline;
+        variant.change = !first && baseline.median > 0 && variant.median >= 0 ? variant.median / baseline.median - 1 : 0;
+        variant.pValue = first ? -1 : mannWhitney(baseline.latencies, variant.latencies);
+    }
+
+    /**
+     * Nearest-rank percentile
+     * @param sortedValues the values in ascending order
+     * @param rank the percentile, between 0 and 1
+     */
+    double VariantComparison::percentile(QList<double> sortedValues, double rank)
+    {
+        if (sortedValues.isEmpty()) {
+            return -1;
+        }
+
+        int index = qBound(0, int(std::ceil(rank * sortedValues.size())) - 1, sortedValues.size() - 1);
+        return sortedValues.at(index);
+    }
+
+    /**
+     * Two-sided Mann-Whitney U test with the normal approximation, corrected for the ties
+     * @brief VariantComparison::mannWhitney
+     * @return the probability that the two samples come from the same distribution, -1 if
+     * there are not enough values
+     */
+    double VariantComparison::mannWhitney(QList<double> first, QList<double> second)
+    {
+        double n1 = first.size();
+        double n2 = second.size();
+        if (n1 < 2 || n2 < 2) {
+            return -1;
+        }
+
+        QList<QPair<double, int> > values;
+        foreach (double value, first) {
+            values << qMakePair(value, 0);
+        }
+        foreach (double value, second) {
+            values << qMakePair(value, 1);
+        }
+        std::sort(values.begin(), values.end());
+
+        // The equal values have the average of their ranks
+        double firstRanks = 0;
+        double ties = 0;
+        int i = 0;
+        while (i < values.size()) {
+            int j = i;
+            while (j + 1 < values.size() && values.at(j + 1).first == values.at(i).first) {
+                j++;
+            }
+
+            double rank = (i + j) / 2.0 + 1;
+            for (int k = i; k <= j; k++) {
+                if (values.at(k).second == 0) {
+                    firstRanks += rank;
+                }
+            }
+
+            double count = j - i + 1;
+            ties += count * count * count - count;
+            i = j + 1;
+        }
+
+        double n = n1 + n2;
+        double u = firstRanks - n1 * (n1 + 1) / 2;
+        double mean = n1 * n2 / 2;
+        double sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+        if (sigma == 0) {
+            return 1;
+        }
+
+        double z = qMax(0.0, std::fabs(u - mean) - 0.5) / sigma;
+        return std::erfc(z / std::sqrt(2.0));
+    }
+
+    /**
+     * Stops after the current execution
+     * @brief VariantComparison::stopRequired
+     */
+    void VariantComparison::stopRequired()
+    {
+        this->stop = true;
+    }
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2016  Stéphane Martarello
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#ifndef VARIANTCOMPARISON_H
+#define VARIANTCOMPARISON_H
+
+#include "DataBase.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+struct VariantStatistics {
+    QString query;
+    QByteArray hash; // of the result of the first round
+    qint64 rows;
+    QList<double> latencies; // milliseconds, one by measured round
+    double min;
+    double median;
+    double p90;
+    double mean;
+    double max;
+    double change; // of the median relative to the first variant, -0.3 is 30% faster
+    double pValue; // Mann-Whitney test against the first variant, -1 for the first variant
+};
+
+struct VariantComparisonStatus {
+    int round; // rounds done, the first one is not measured
+    int rounds;
+    bool resultsMatch;
+    QString lastError;
+    QList<VariantStatistics> variants;
+};
+
+namespace Util {
+    /**
+     * Executes several versions of a query (e.g. two rewrites) alternately on the same
+     * connection to know which one is the fastest.
+     *
+     * Each round executes all the variants in a random order, so the caches and the load
+     * of the server change the same way for all of them. The warmup rounds are not measured,
+     * during the first one the result of each variant is hashed and compared with the result
+     * of the first variant. The latencies of each variant are compared with the ones of the
+     * first variant with a Mann-Whitney U test, which does not expect a normal distribution.
+     */
+    class VariantComparison : public QObject
+    {
+
+        Q_OBJECT
+
+    public:
+        VariantComparison(ConnectionConfiguration conf, QStringList variants);
+        void setRounds(int rounds);
+        void setWarmup(int rounds);
+        void setOrdered(bool ordered);
+
+        VariantComparisonStatus getStatus();
+        void stopRequired();
+
+        static double mannWhitney(QList<double> first, QList<double> second);
+
+    public slots:
+        void execute();
+
+    signals:
+        void executionFinished(bool stopped);
+
+    private:
+        ConnectionConfiguration configuration;
+        int rounds;
+        int warmup;
+        bool ordered;
+        volatile bool stop;
+
+        QMutex statusMutex;
+        VariantComparisonStatus status;
+
+        bool executeVariant(QSqlDatabase database, QString query, bool hash, QByteArray &resultHash, qint64 &rows, QString &error);
+        static void computeStatistics(VariantStatistics &variant, const VariantStatistics &baseline);
+        static double percentile(QList<double> sortedValues, double rank);
+    };
+}
+
+#endif // VARIANTCOMPARISON_H
@@ -22,6 +22,9 @@
 #include <QFontDatabase>
 #include <QDebug>
 #include "UI/MainWindow.h"
+#include "Util/DataBase.h"
+#include "Util/MetadataService.h"
+#include "Util/QueryHistory.h"
 
 int main(int argc, char *argv[])
 {
@@ -55,11 +58,22 @@ int main(int argc, char *argv[])
 //    myappTranslator.load("mysqlclient_" + QLocale::system().name());
 //    app.installTranslator(&myappTranslator);
 
-    UI::MainWindow win ;
+    int result;
+    {
+        UI::MainWindow win ;
+
+        win.show();
+
+        result = app.exec();
+    }
 
-    win.show();
+    // The windows have released their connections
+    Util::MetadataService::instance()->shutdown();
+    Util::DataBase::closePool();
+    // The query tabs have given their last statements
+    Util::QueryHistory::instance()->close();
 
-    return app.exec();
+    return result;
 }
 
 
@@ -11,6 +11,15 @@ DESTDIR = ../dist
 RESOURCES     = mysqlclient.qrc
 QMAKE_CXXFLAGS += -std=c++0x
 
+# The native client library is used for the unbuffered results (Util/MySQLCursor)
+unix {
+    INCLUDEPATH += /usr/include/mysql
+    LIBS += -lmysqlclient
+}
+win32 {
+    LIBS += -llibmysql
+}
+
 # Input
 HEADERS += UI/MainWindow.h \
 			UI/ToolBar.h \
@@ -44,7 +53,41 @@ HEADERS += UI/MainWindow.h \
     UI/Explorer/Tabs/TableDetails/ForeignKeyModel.h \
     UI/Explorer/Tabs/TableDetails/TableIndexModel.h \
     Util/TableDefinition.h \
-    UI/Explorer/Tabs/Table/InsertWindow.h
+    UI/Explorer/Tabs/Table/InsertWindow.h \
+    Util/TablespaceCopy.h \
+    Util/TableCopy.h \
+    UI/Explorer/Copy/CopyTableWindow.h \
+    Util/ConnectionWorker.h \
+    Util/TableChecksum.h \
+    UI/Explorer/Compare/DataCompareWindow.h \
+    Util/ResultComparison.h \
+    Util/SchemaDefinition.h \
+    Util/SchemaDiff.h \
+    Util/SchemaCompare.h \
+    UI/Explorer/Compare/SchemaCompareWindow.h \
+    Util/MySQLCursor.h \
+    Util/ResultSet.h \
+    Util/ConnectionPool.h \
+    Util/MetadataService.h \
+    Util/SqlSplitter.h \
+    Util/ScriptExecution.h \
+    UI/Explorer/Script/ExecuteScriptWindow.h \
+    Util/ExplainPlan.h \
+    UI/Explorer/Tabs/Query/ExplainView.h \
+    UI/Explorer/Tabs/Query/OptimizerTraceView.h \
+    Util/SqlFingerprint.h \
+    Util/QueryHistory.h \
+    UI/History/QueryHistoryWindow.h \
+    UI/History/PlanDiffView.h \
+    Util/LatencyHistogram.h \
+    Util/QueryBenchmark.h \
+    UI/Explorer/Tabs/Query/BenchmarkWindow.h \
+    Util/VariantComparison.h \
+    UI/Explorer/Tabs/Query/VariantComparisonWindow.h \
+    Util/ResultCache.h \
+    Util/FanOutExecution.h \
+    UI/Explorer/Script/FanOutWindow.h \
+    Util/QueryGuardrails.h
 SOURCES += main.cpp \
 		Util/DataBase.cpp \
            UI/MainWindow.cpp \
@@ -78,7 +121,41 @@ SOURCES += main.cpp \
     UI/Explorer/Tabs/TableDetails/ForeignKeyModel.cpp \
     UI/Explorer/Tabs/TableDetails/TableIndexModel.cpp \
     Util/TableDefinition.cpp \
-    UI/Explorer/Tabs/Table/InsertWindow.cpp
+    UI/Explorer/Tabs/Table/InsertWindow.cpp \
+    Util/TablespaceCopy.cpp \
+    Util/TableCopy.cpp \
+    UI/Explorer/Copy/CopyTableWindow.cpp \
+    Util/ConnectionWorker.cpp \
+    Util/TableChecksum.cpp \
+    UI/Explorer/Compare/DataCompareWindow.cpp \
+    Util/ResultComparison.cpp \
+    Util/SchemaDefinition.cpp \
+    Util/SchemaDiff.cpp \
+    Util/SchemaCompare.cpp \
+    UI/Explorer/Compare/SchemaCompareWindow.cpp \
+    Util/MySQLCursor.cpp \
+    Util/ResultSet.cpp \
+    Util/ConnectionPool.cpp \
+    Util/MetadataService.cpp \
+    Util/SqlSplitter.cpp \
+    Util/ScriptExecution.cpp \
+    UI/Explorer/Script/ExecuteScriptWindow.cpp \
+    Util/ExplainPlan.cpp \
+    UI/Explorer/Tabs/Query/ExplainView.cpp \
+    UI/Explorer/Tabs/Query/OptimizerTraceView.cpp \
+    Util/SqlFingerprint.cpp \
+    Util/QueryHistory.cpp \
+    UI/History/QueryHistoryWindow.cpp \
+    UI/History/PlanDiffView.cpp \
+    Util/LatencyHistogram.cpp \
+    Util/QueryBenchmark.cpp \
+    UI/Explorer/Tabs/Query/BenchmarkWindow.cpp \
+    Util/VariantComparison.cpp \
+    UI/Explorer/Tabs/Query/VariantComparisonWindow.cpp \
+    Util/ResultCache.cpp \
+    Util/FanOutExecution.cpp \
+    UI/Explorer/Script/FanOutWindow.cpp \
+    Util/QueryGuardrails.cpp
 TRANSLATIONS += mysqlclient_en.ts
 
 win32:debug {